@@ -0,0 +1,29 @@
+#include "ev_log.h"
+
+// Formats a binary log written by ev_binlog_start
+int main(int argc, char** argv)
+{
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s <binary log> [output file]\n", argv[0]);
+    return 2;
+  }
+  FILE* in = fopen(argv[1], "rb");
+  if (!in) {
+    fprintf(stderr, "%s: cannot open %s\n", argv[0], argv[1]);
+    return 1;
+  }
+  FILE* out = argc == 3 ? fopen(argv[2], "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "%s: cannot open %s\n", argv[0], argv[2]);
+    fclose(in);
+    return 1;
+  }
+
+  bool ok = ev_binlog_decode(in, out);
+  if (!ok)
+    fprintf(stderr, "%s: %s is not a binary log, or is truncated\n", argv[0], argv[1]);
+  fclose(in);
+  if (out != stdout)
+    fclose(out);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#define EV_BLOOM_IMPLEMENTATION
+#include "ev_bloom.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#if !EV_OS_WINDOWS
+#include <sys/mman.h>
+#endif
+
+#define INSERT_COUNT 100000
+#define PROBE_COUNT 1000000
+
+// Inserts even IDs, then probes odd ones that were never inserted.
+static f64 measure_fp_rate(ev_bloom_t *b)
+{
+  for(u64 i = 0; i < INSERT_COUNT; i++) {
+    u64 id = i * 2;
+    ev_bloom_add(b, &id, sizeof(id));
+  }
+  for(u64 i = 0; i < INSERT_COUNT; i++) {
+    u64 id = i * 2;
+    assert(ev_bloom_contains(b, &id, sizeof(id))); // No false negatives
+  }
+
+  u64 false_positives = 0;
+  for(u64 i = 0; i < PROBE_COUNT; i++) {
+    u64 id = i * 2 + 1;
+    false_positives += ev_bloom_contains(b, &id, sizeof(id));
+  }
+  return (f64)false_positives / PROBE_COUNT;
+}
+
+int main()
+{
+  const f64 targets[] = { 0.1, 0.01, 0.001 };
+  for(u32 t = 0; t < EV_ARRSIZE(targets); t++) {
+    ev_bloom_t classic, blocked;
+    assert(ev_bloom_init(&classic, INSERT_COUNT, targets[t]) == EV_BLOOM_ERR_NONE);
+    assert(ev_bloom_init_blocked(&blocked, INSERT_COUNT, targets[t]) == EV_BLOOM_ERR_NONE);
+
+    f64 classic_fp = measure_fp_rate(&classic);
+    f64 blocked_fp = measure_fp_rate(&blocked);
+    printf("target %.4f: classic %.5f (%llu bits, k=%u), blocked %.5f (%llu bits, k=%u)\n",
+           targets[t],
+           classic_fp, classic.nbits, classic.k,
+           blocked_fp, blocked.nbits, blocked.k);
+
+    // Leave room for sampling noise
+    assert(classic_fp <= targets[t] * 1.15);
+    assert(blocked_fp <= targets[t] * 1.15);
+    assert(ev_bloom_estimate_fp_rate(&blocked, INSERT_COUNT) <= targets[t]);
+
+    ev_bloom_fini(&classic);
+    ev_bloom_fini(&blocked);
+  }
+
+  { // Union and serialization
+    ev_bloom_t a, b, c;
+    ev_bloom_init_blocked(&a, 1000, 0.01);
+    ev_bloom_init_blocked(&b, 1000, 0.01);
+    ev_bloom_init(&c, 1000, 0.01);
+    assert(ev_bloom_union(&a, &c) == EV_BLOOM_ERR_MISMATCH);
+
+    ev_bloom_add(&a, "textures/wall.png", 17);
+    ev_bloom_add(&b, "textures/floor.png", 18);
+    assert(!ev_bloom_contains(&a, "textures/floor.png", 18));
+    assert(ev_bloom_union(&a, &b) == EV_BLOOM_ERR_NONE);
+    assert(ev_bloom_contains(&a, "textures/wall.png", 17));
+    assert(ev_bloom_contains(&a, "textures/floor.png", 18));
+
+    u64 size = ev_bloom_serialized_size(&a);
+    u8 *buf = malloc(size);
+    assert(ev_bloom_serialize(&a, buf) == size);
+
+    ev_bloom_t loaded;
+    assert(ev_bloom_deserialize(&loaded, buf, size - 1) == EV_BLOOM_ERR_INVALID_DATA);
+    assert(ev_bloom_deserialize(&loaded, buf, size) == EV_BLOOM_ERR_NONE);
+    assert(loaded.nbits == a.nbits && loaded.k == a.k && loaded.blocked);
+    assert(memcmp(loaded.bits, a.bits, a.nbits / 8) == 0);
+    assert(ev_bloom_contains(&loaded, "textures/floor.png", 18));
+
+    free(buf);
+    ev_bloom_fini(&loaded);
+    ev_bloom_fini(&a);
+    ev_bloom_fini(&b);
+    ev_bloom_fini(&c);
+  }
+
+  { // Invalid parameters and tiny filters
+    ev_bloom_t b;
+    const f64 invalid_rates[] = { 1.0, 1.5, 0.0, -0.1, NAN };
+    for(u32 i = 0; i < sizeof(invalid_rates) / sizeof(invalid_rates[0]); i++) {
+      assert(ev_bloom_init(&b, 100, invalid_rates[i]) == EV_BLOOM_ERR_INVALID_ARGUMENT);
+      assert(ev_bloom_init_blocked(&b, 100, invalid_rates[i]) == EV_BLOOM_ERR_INVALID_ARGUMENT);
+    }
+    assert(ev_bloom_init(&b, 0, 0.01) == EV_BLOOM_ERR_INVALID_ARGUMENT);
+    assert(ev_bloom_init_blocked(&b, 0, 0.01) == EV_BLOOM_ERR_INVALID_ARGUMENT);
+
+    assert(ev_bloom_init(&b, 1, 0.99) == EV_BLOOM_ERR_NONE);
+    assert(b.nbits == 64 && b.k >= 1);
+    ev_bloom_add(&b, "a", 1);
+    assert(ev_bloom_contains(&b, "a", 1));
+    ev_bloom_fini(&b);
+
+    assert(ev_bloom_init_blocked(&b, 1, 0.99) == EV_BLOOM_ERR_NONE);
+    assert(b.nbits == EV_BLOOM_BLOCK_BITS);
+    ev_bloom_add(&b, "a", 1);
+    assert(ev_bloom_contains(&b, "a", 1));
+    ev_bloom_fini(&b);
+  }
+
+#if !EV_OS_WINDOWS
+  { // Keys of 4 GiB or more are hashed whole, not modulo 2^32 bytes
+    u64 len = (1ull << 32) + 1;
+    u8 *zeros = mmap(NULL, len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(zeros != MAP_FAILED) {
+      ev_bloom_t b;
+      assert(ev_bloom_init(&b, 1000, 0.001) == EV_BLOOM_ERR_NONE);
+      ev_bloom_add(&b, zeros, 1);
+      assert(!ev_bloom_contains(&b, zeros, len));
+      ev_bloom_fini(&b);
+      munmap(zeros, len);
+    }
+  }
+#endif
+
+  puts("ev_bloom tests passed");
+  return 0;
+}
@@ -0,0 +1,2 @@
+#define EV_BLOOM_IMPLEMENTATION
+#include "../ev_bloom.h"
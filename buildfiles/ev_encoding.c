@@ -0,0 +1,2 @@
+#define EV_ENCODING_IMPLEMENTATION
+#include "../ev_encoding.h"
@@ -0,0 +1,2 @@
+#define EV_GLOB_IMPLEMENTATION
+#include "../ev_glob.h"
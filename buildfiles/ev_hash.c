@@ -0,0 +1,2 @@
+#define EV_HASH_IMPLEMENTATION
+#include "../ev_hash.h"
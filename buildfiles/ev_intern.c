@@ -0,0 +1,2 @@
+#define EV_INTERN_IMPLEMENTATION
+#include "../ev_intern.h"
@@ -0,0 +1,2 @@
+#define EV_JSON_IMPLEMENTATION
+#include "../ev_json.h"
@@ -0,0 +1,2 @@
+#define EV_SET_IMPLEMENTATION
+#include "../ev_set.h"
@@ -0,0 +1,2 @@
+#define EV_SKETCH_IMPLEMENTATION
+#include "../ev_sketch.h"
@@ -0,0 +1,2 @@
+#define EV_STRBUILDER_IMPLEMENTATION
+#include "../ev_strbuilder.h"
@@ -0,0 +1,2 @@
+#define EV_STRMATCHER_IMPLEMENTATION
+#include "../ev_strmatcher.h"
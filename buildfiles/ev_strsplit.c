@@ -0,0 +1,2 @@
+#define EV_STRSPLIT_IMPLEMENTATION
+#include "../ev_strsplit.h"
@@ -0,0 +1,2 @@
+#define EV_STRTABLE_IMPLEMENTATION
+#include "../ev_strtable.h"
@@ -0,0 +1,2 @@
+#define EV_UTF8_IMPLEMENTATION
+#include "../ev_utf8.h"
@@ -78,6 +78,29 @@
 # endif
 #endif
 
+// SIMD Detection
+#ifndef EV_SIMD_SSE2
+# if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define EV_SIMD_SSE2 1
+# else
+#  define EV_SIMD_SSE2 0
+# endif
+#endif
+#ifndef EV_SIMD_SSSE3
+# if defined(__SSSE3__) || defined(__AVX2__)
+#  define EV_SIMD_SSSE3 1
+# else
+#  define EV_SIMD_SSSE3 0
+# endif
+#endif
+#ifndef EV_SIMD_AVX2
+# if defined(__AVX2__)
+#  define EV_SIMD_AVX2 1
+# else
+#  define EV_SIMD_AVX2 0
+# endif
+#endif
+
 #if !defined(EV_BUILDTYPE_DEBUG) && !defined(EV_BUILDTYPE_DEBUG_OPT) && !defined(EV_BUILDTYPE_RELEASE)
 #define EV_BUILDTYPE_RELEASE 1
 #endif
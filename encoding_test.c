@@ -0,0 +1,223 @@
+#define EV_STR_IMPLEMENTATION
+#define EV_ENCODING_IMPLEMENTATION
+#include "ev_encoding.h"
+
+#include <stdio.h>
+
+static u64 rng_state = 0x9E3779B97F4A7C15ull;
+static u64 rng()
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+// Straightforward encoders to compare against
+static void reference_hex(const u8 *src, u64 len, char *dst)
+{
+  for(u64 i = 0; i < len; i++) {
+    sprintf(dst + 2 * i, "%02x", src[i]);
+  }
+}
+
+static void reference_base64(const u8 *src, u64 len, char *dst)
+{
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  u64 bits = 0;
+  u32 nbits = 0;
+  u64 out = 0;
+  for(u64 i = 0; i < len; i++) {
+    bits = (bits << 8) | src[i];
+    nbits += 8;
+    while(nbits >= 6) {
+      nbits -= 6;
+      dst[out++] = alphabet[(bits >> nbits) & 0x3F];
+    }
+  }
+  if(nbits > 0) {
+    dst[out++] = alphabet[(bits << (6 - nbits)) & 0x3F];
+  }
+  while(out % 4 != 0) {
+    dst[out++] = '=';
+  }
+}
+
+static bool is_base64_char(u32 c)
+{
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '+' || c == '/';
+}
+
+static bool is_hex_char(u32 c)
+{
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+typedef struct {
+  u8 bytes[11];
+} Blob;
+DEFINE_DEFAULT_TOSTR_FUNCTION(Blob)
+
+int main()
+{
+  // RFC 4648 test vectors
+  {
+    const char *plain[] = { "", "f", "fo", "foo", "foob", "fooba", "foobar" };
+    const char *base64[] = { "", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy" };
+    const char *hex[] = { "", "66", "666f", "666f6f", "666f6f62", "666f6f6261", "666f6f626172" };
+    char buf[64];
+    for(u32 i = 0; i < 7; i++) {
+      u64 len = strlen(plain[i]);
+      assert(ev_base64_encodedLength(len) == strlen(base64[i]));
+      assert(ev_base64_encode(plain[i], len, buf) == strlen(base64[i]));
+      assert(memcmp(buf, base64[i], strlen(base64[i])) == 0);
+      assert(ev_base64_decodedLength(base64[i], strlen(base64[i])) == len);
+      assert(ev_base64_decode(base64[i], strlen(base64[i]), buf) == len);
+      assert(memcmp(buf, plain[i], len) == 0);
+
+      ev_hex_encode(plain[i], len, buf);
+      assert(memcmp(buf, hex[i], 2 * len) == 0);
+      assert(ev_hex_decode(hex[i], 2 * len, buf) == len);
+      assert(memcmp(buf, plain[i], len) == 0);
+    }
+
+    u8 bytes[4];
+    assert(ev_hex_decode("00fFA9b0", 8, bytes) == 4);
+    assert(bytes[0] == 0x00 && bytes[1] == 0xFF && bytes[2] == 0xA9 && bytes[3] == 0xB0);
+  }
+
+  // Round trips of random data, at every length around the vector widths
+  {
+    u8 *data = malloc(1024);
+    u8 *decoded = malloc(1024);
+    char *encoded = malloc(2048 + 1);
+    char *expected = malloc(2048 + 1);
+    for(u32 round = 0; round < 20000; round++) {
+      u64 len = round < 300 ? round : rng() % 1024;
+      for(u64 i = 0; i < len; i++) {
+        data[i] = (u8)rng();
+      }
+
+      ev_hex_encode(data, len, encoded);
+      reference_hex(data, len, expected);
+      assert(memcmp(encoded, expected, 2 * len) == 0);
+      assert(ev_hex_decode(encoded, 2 * len, decoded) == len);
+      assert(memcmp(decoded, data, len) == 0);
+
+      u64 base64_len = ev_base64_encode(data, len, encoded);
+      assert(base64_len == ev_base64_encodedLength(len));
+      reference_base64(data, len, expected);
+      assert(memcmp(encoded, expected, base64_len) == 0);
+      assert(ev_base64_decodedLength(encoded, base64_len) == len);
+      assert(ev_base64_decode(encoded, base64_len, decoded) == len);
+      assert(memcmp(decoded, data, len) == 0);
+    }
+    free(data);
+    free(decoded);
+    free(encoded);
+    free(expected);
+  }
+
+  // Every byte value at every position of a block is classified correctly
+  {
+    u8 data[96];
+    char text[192];
+    u8 decoded[96];
+    for(u32 i = 0; i < sizeof(data); i++) {
+      data[i] = (u8)rng();
+    }
+    ev_base64_encode(data, 96, text);
+    for(u32 pos = 0; pos < 128; pos++) {
+      for(u32 c = 0; c < 256; c++) {
+        char saved = text[pos];
+        text[pos] = (char)c;
+        u64 res = ev_base64_decode(text, 128, decoded);
+        // The last character may also be padding
+        bool padding = pos == 127 && c == '=';
+        assert((res != EV_ENCODING_INVALID) == (is_base64_char(c) || padding));
+        if(res != EV_ENCODING_INVALID && !padding) {
+          char reencoded[128];
+          ev_base64_encode(decoded, res, reencoded);
+          assert(memcmp(reencoded, text, 128) == 0);
+        }
+        text[pos] = saved;
+      }
+    }
+
+    ev_hex_encode(data, 96, text);
+    for(u32 pos = 0; pos < 192; pos++) {
+      for(u32 c = 0; c < 256; c++) {
+        char saved = text[pos];
+        text[pos] = (char)c;
+        u64 res = ev_hex_decode(text, 192, decoded);
+        assert((res != EV_ENCODING_INVALID) == is_hex_char(c));
+        if(res != EV_ENCODING_INVALID) {
+          u32 nibble = decoded[pos / 2] >> (pos % 2 ? 0 : 4) & 0xF;
+          assert(EV_TOHEX_CHAR(nibble) == (c | 0x20));
+        }
+        text[pos] = saved;
+      }
+    }
+  }
+
+  // Malformed lengths and padding
+  {
+    u8 buf[64];
+    assert(ev_hex_decode("abc", 3, buf) == EV_ENCODING_INVALID);
+    const char *invalid[] = { "Zg=", "Zg", "Z===", "====", "Zg=a", "=Zg=", "Zg==Zm8=", "Zm9vYg=a", "Zm9v====" };
+    for(u32 i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+      assert(ev_base64_decode(invalid[i], strlen(invalid[i]), buf) == EV_ENCODING_INVALID);
+    }
+  }
+
+  // Appending to evstrings
+  {
+    evstring s = evstring_new("sha:");
+    u8 digest[20];
+    for(u32 i = 0; i < sizeof(digest); i++) {
+      digest[i] = (u8)(i * 13);
+    }
+    assert(evstring_pushHex(&s, digest, sizeof(digest)) == EV_STR_ERR_NONE);
+    assert(evstring_getLength(s) == 4 + 40);
+    assert(strcmp(s, "sha:000d1a2734414e5b6875828f9ca9b6c3d0ddeaf7") == 0);
+
+    evstring bytes = evstring_new("");
+    assert(evstring_pushFromHex(&bytes, evstring_view_toStrview(evstring_slice(s, 4, 44))) == EV_STR_ERR_NONE);
+    assert(evstring_getLength(bytes) == 20 && memcmp(bytes, digest, 20) == 0);
+    assert(evstring_pushFromHex(&bytes, ev_strview_fromStr("0g")) == EV_STR_ERR_PARSE);
+    assert(evstring_getLength(bytes) == 20);
+
+    // Shared strings are detached before they are written
+    evstring shared = evstring_share(s);
+    assert(evstring_pushBase64(&shared, "foobar", 6) == EV_STR_ERR_NONE);
+    assert(strcmp(shared, "sha:000d1a2734414e5b6875828f9ca9b6c3d0ddeaf7Zm9vYmFy") == 0);
+    assert(evstring_getLength(s) == 44);
+    evstring_clear(&shared);
+    assert(evstring_pushFromBase64(&shared, ev_strview_fromStr("Zm9vYmE=")) == EV_STR_ERR_NONE);
+    assert(strcmp(shared, "fooba") == 0);
+    assert(evstring_pushFromBase64(&shared, ev_strview_fromStr("Zm9vYmE")) == EV_STR_ERR_PARSE);
+    assert(strcmp(shared, "fooba") == 0);
+
+    evstring_free(shared);
+    evstring_free(bytes);
+    evstring_free(s);
+  }
+
+  // The default tostr hook
+  {
+    Blob b;
+    for(u32 i = 0; i < sizeof(b.bytes); i++) {
+      b.bytes[i] = (u8)(0xF0 - i * 7);
+    }
+    char out[2 * sizeof(Blob) + 1];
+    char expected[2 * sizeof(Blob) + 1];
+    out[2 * sizeof(Blob)] = '#';
+    TOSTR_FUNCTION(Blob, DEFAULT)(&b, out);
+    reference_hex(b.bytes, sizeof(b.bytes), expected);
+    assert(memcmp(out, expected, 2 * sizeof(Blob)) == 0);
+    assert(out[2 * sizeof(Blob)] == '#');
+  }
+
+  puts("ev_encoding tests passed");
+  return 0;
+}
@@ -0,0 +1,546 @@
+/*!
+ * \file ev_bloom.h
+ * \brief Bloom filters for cheap negative membership tests
+ */
+#ifndef EV_BLOOM_HEADER
+#define EV_BLOOM_HEADER
+
+#include "ev_types.h"
+
+#if defined(EV_BLOOM_SHARED)
+# if defined (EV_BLOOM_IMPL)
+#  define EV_BLOOM_API EV_EXPORT
+# else
+#  define EV_BLOOM_API EV_IMPORT
+# endif
+#else
+# define EV_BLOOM_API
+#endif
+
+#ifndef EV_BLOOM_HASH_SEED
+#define EV_BLOOM_HASH_SEED 0
+#endif
+
+//! Number of bits in a block of a blocked filter; one cache line.
+#define EV_BLOOM_BLOCK_BITS 512
+
+#define EV_BLOOM_MAGIC (0x65766266)
+
+typedef enum {
+  EV_BLOOM_ERR_NONE = 0,
+  EV_BLOOM_ERR_OOM = 1,
+  //! Filters that are combined must have been created with the same parameters
+  EV_BLOOM_ERR_MISMATCH = 2,
+  //! Serialized data is truncated or was not produced by `ev_bloom_serialize`
+  EV_BLOOM_ERR_INVALID_DATA = 3,
+  //! `expected_count` is 0, or `fp_rate` is not strictly between 0 and 1
+  EV_BLOOM_ERR_INVALID_ARGUMENT = 4
+} ev_bloom_error_t;
+TYPEDATA_GEN(ev_bloom_error_t, DEFAULT(EV_BLOOM_ERR_NONE));
+
+typedef struct {
+  //! Bit array. For blocked filters, it is aligned to a cache line.
+  u64 *bits;
+  //! Number of bits in `bits`. A multiple of 64 (512 for blocked filters).
+  u64 nbits;
+  //! Number of bits that are set per element
+  u32 k;
+  /*!
+   * Whether all of an element's bits are set within a single 512-bit block,
+   * so that every probe touches one cache line.
+   */
+  bool blocked;
+} ev_bloom_t;
+
+/*!
+ * \brief Creates a classic bloom filter that is sized so that, after
+ * `expected_count` insertions, the false-positive rate is `fp_rate`. The
+ * filter has at least 64 bits.
+ *
+ * \returns `EV_BLOOM_ERR_NONE` on success, `EV_BLOOM_ERR_OOM` on OOM,
+ * `EV_BLOOM_ERR_INVALID_ARGUMENT` if `expected_count` is 0 or `fp_rate` is not
+ * in (0, 1)
+ */
+EV_BLOOM_API ev_bloom_error_t
+ev_bloom_init(
+  ev_bloom_t *b,
+  u64 expected_count,
+  f64 fp_rate);
+
+/*!
+ * \brief Creates a cache-line-blocked bloom filter. An element's bits are all
+ * in one 64-byte block, which makes probes cheaper at the cost of a slightly
+ * larger filter for the same false-positive rate. The size is chosen so that
+ * the expected false-positive rate after `expected_count` insertions is at
+ * most `fp_rate`. The filter has at least one block.
+ *
+ * \returns `EV_BLOOM_ERR_NONE` on success, `EV_BLOOM_ERR_OOM` on OOM,
+ * `EV_BLOOM_ERR_INVALID_ARGUMENT` if `expected_count` is 0 or `fp_rate` is not
+ * in (0, 1)
+ */
+EV_BLOOM_API ev_bloom_error_t
+ev_bloom_init_blocked(
+  ev_bloom_t *b,
+  u64 expected_count,
+  f64 fp_rate);
+
+/*!
+ * \brief Frees the filter's bit array
+ */
+EV_BLOOM_API void
+ev_bloom_fini(
+  ev_bloom_t *b);
+
+/*!
+ * \brief Adds `len` bytes at `data` to the filter
+ */
+EV_BLOOM_API void
+ev_bloom_add(
+  ev_bloom_t *b,
+  const void *data,
+  u64 len);
+
+/*!
+ * \returns `false` if the bytes were definitely never added to the filter.
+ * `true` if they were added, or with a probability of about the configured
+ * false-positive rate, if they were not.
+ */
+EV_BLOOM_API bool
+ev_bloom_contains(
+  const ev_bloom_t *b,
+  const void *data,
+  u64 len);
+
+/*!
+ * \brief Same as `ev_bloom_add`, but takes the two 64-bit halves of an
+ * already computed 128-bit hash of the element.
+ */
+EV_BLOOM_API void
+ev_bloom_add_hash(
+  ev_bloom_t *b,
+  const u64 hash[2]);
+
+EV_BLOOM_API bool
+ev_bloom_contains_hash(
+  const ev_bloom_t *b,
+  const u64 hash[2]);
+
+/*!
+ * \brief Merges `src` into `dst`. `dst` then reports every element that was
+ * added to either filter.
+ *
+ * \returns `EV_BLOOM_ERR_MISMATCH` if the filters have different sizes,
+ * number of hashes or layouts.
+ */
+EV_BLOOM_API ev_bloom_error_t
+ev_bloom_union(
+  ev_bloom_t *dst,
+  const ev_bloom_t *src);
+
+/*!
+ * \brief Empties the filter
+ */
+EV_BLOOM_API void
+ev_bloom_clear(
+  ev_bloom_t *b);
+
+/*!
+ * \returns Number of bytes that `ev_bloom_serialize` writes for this filter
+ */
+EV_BLOOM_API u64
+ev_bloom_serialized_size(
+  const ev_bloom_t *b);
+
+/*!
+ * \brief Writes the filter's parameters followed by its bit array to `out`,
+ * which must have room for `ev_bloom_serialized_size(b)` bytes. The data is
+ * written in the host's byte order.
+ *
+ * \returns Number of bytes written
+ */
+EV_BLOOM_API u64
+ev_bloom_serialize(
+  const ev_bloom_t *b,
+  void *out);
+
+/*!
+ * \brief Creates a filter from data that was written by `ev_bloom_serialize`
+ *
+ * \returns `EV_BLOOM_ERR_NONE` on success, `EV_BLOOM_ERR_INVALID_DATA` if the
+ * data is malformed or too short, `EV_BLOOM_ERR_OOM` on OOM.
+ */
+EV_BLOOM_API ev_bloom_error_t
+ev_bloom_deserialize(
+  ev_bloom_t *b,
+  const void *data,
+  u64 size);
+
+/*!
+ * \returns The false-positive rate that is expected for a filter with the
+ * given parameters after `count` insertions.
+ */
+EV_BLOOM_API f64
+ev_bloom_estimate_fp_rate(
+  const ev_bloom_t *b,
+  u64 count);
+
+#ifdef EV_BLOOM_IMPLEMENTATION
+#undef EV_BLOOM_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if EV_OS_WINDOWS
+# include <malloc.h>
+#endif
+
+#define __EV_BLOOM_BLOCK_WORDS (EV_BLOOM_BLOCK_BITS / 64)
+#define __EV_BLOOM_MAX_K 16
+#define __EV_BLOOM_LN2 0.69314718055994530942
+#define __EV_BLOOM_BLOCK_SHIFT 55 // 64 - log2(EV_BLOOM_BLOCK_BITS)
+#define __EV_BLOOM_BLOCK_BIT(h) \
+  ((u32)((((h) ^ ((h) >> 29)) * 0x9E3779B97F4A7C15ull) >> __EV_BLOOM_BLOCK_SHIFT))
+#define __EV_BLOOM_BLOCK_STEP(h) ((((h) >> 32) | ((h) << 32)) | 1)
+
+struct __ev_bloom_header_t {
+  u32 magic;
+  u32 k;
+  u64 nbits;
+  u32 blocked;
+  u32 reserved;
+};
+
+static u64 *
+__ev_bloom_alloc(
+  u64 nbits,
+  bool blocked)
+{
+  u64 bytes = nbits / 8;
+  void *p = NULL;
+  if(blocked) {
+#if EV_OS_WINDOWS
+    p = _aligned_malloc(bytes, 64);
+#else
+    p = aligned_alloc(64, bytes);
+#endif
+  } else {
+    p = malloc(bytes);
+  }
+  if(p) {
+    memset(p, 0, bytes);
+  }
+  return p;
+}
+
+static f64
+__ev_bloom_classic_fp(
+  f64 nbits,
+  f64 count,
+  u32 k)
+{
+  return pow(1.0 - exp(-(f64)k * count / nbits), (f64)k);
+}
+
+// Blocked filters distribute elements over blocks, so the load of a block is
+// Poisson distributed. The false-positive rate is the average of the rate of
+// a 512-bit classic filter over that distribution.
+static f64
+__ev_bloom_blocked_fp(
+  u64 nblocks,
+  f64 count,
+  u32 k)
+{
+  f64 lambda = count / (f64)nblocks;
+  f64 bit_miss = 1.0 - 1.0 / EV_BLOOM_BLOCK_BITS;
+  u64 last = (u64)(lambda + 12.0 * sqrt(lambda) + 32.0);
+
+  f64 fp = 0.0;
+  f64 poisson = exp(-lambda);
+  for(u64 i = 0; i <= last; i++) {
+    fp += poisson * pow(1.0 - pow(bit_miss, (f64)(k * i)), (f64)k);
+    poisson *= lambda / (f64)(i + 1);
+  }
+  return fp;
+}
+
+ev_bloom_error_t
+ev_bloom_init(
+  ev_bloom_t *b,
+  u64 expected_count,
+  f64 fp_rate)
+{
+  // Also rejects NaN
+  if(expected_count == 0 || !(fp_rate > 0.0 && fp_rate < 1.0)) {
+    return EV_BLOOM_ERR_INVALID_ARGUMENT;
+  }
+  f64 n = (f64)expected_count;
+  f64 m = ceil(-n * log(fp_rate) / (__EV_BLOOM_LN2 * __EV_BLOOM_LN2));
+  u64 nbits = ((u64)m + 63) & ~63ull;
+  if(nbits < 64) {
+    nbits = 64;
+  }
+  u32 k = (u32)round((f64)nbits / n * __EV_BLOOM_LN2);
+  if(k < 1) {
+    k = 1;
+  }
+
+  b->bits = __ev_bloom_alloc(nbits, false);
+  if(!b->bits) {
+    return EV_BLOOM_ERR_OOM;
+  }
+  b->nbits = nbits;
+  b->k = k;
+  b->blocked = false;
+  return EV_BLOOM_ERR_NONE;
+}
+
+ev_bloom_error_t
+ev_bloom_init_blocked(
+  ev_bloom_t *b,
+  u64 expected_count,
+  f64 fp_rate)
+{
+  if(expected_count == 0 || !(fp_rate > 0.0 && fp_rate < 1.0)) {
+    return EV_BLOOM_ERR_INVALID_ARGUMENT;
+  }
+  f64 n = (f64)expected_count;
+  f64 m = ceil(-n * log(fp_rate) / (__EV_BLOOM_LN2 * __EV_BLOOM_LN2));
+  u64 nblocks = ((u64)m + EV_BLOOM_BLOCK_BITS - 1) / EV_BLOOM_BLOCK_BITS;
+  if(nblocks < 1) {
+    nblocks = 1;
+  }
+
+  // Start from the classic size and grow by ~2% until the expected rate is
+  // met with the best number of hashes.
+  u32 k = 1;
+  for(;;) {
+    f64 best_fp = 1.0;
+    for(u32 kk = 1; kk <= __EV_BLOOM_MAX_K; kk++) {
+      f64 fp = __ev_bloom_blocked_fp(nblocks, n, kk);
+      if(fp < best_fp) {
+        best_fp = fp;
+        k = kk;
+      }
+    }
+    if(best_fp <= fp_rate) {
+      break;
+    }
+    nblocks += nblocks / 50 + 1;
+  }
+
+  b->bits = __ev_bloom_alloc(nblocks * EV_BLOOM_BLOCK_BITS, true);
+  if(!b->bits) {
+    return EV_BLOOM_ERR_OOM;
+  }
+  b->nbits = nblocks * EV_BLOOM_BLOCK_BITS;
+  b->k = k;
+  b->blocked = true;
+  return EV_BLOOM_ERR_NONE;
+}
+
+void
+ev_bloom_fini(
+  ev_bloom_t *b)
+{
+#if EV_OS_WINDOWS
+  if(b->blocked) {
+    _aligned_free(b->bits);
+  } else {
+    free(b->bits);
+  }
+#else
+  free(b->bits);
+#endif
+  b->bits = NULL;
+  b->nbits = 0;
+}
+
+// Double hashing: bit i of an element is `h1 + i * h2`. For blocked filters,
+// `h1` selects the block and the sequence is `h2 + i * h1'` where `h1'` is
+// `h1` with its halves swapped, so that it does not correlate with the block
+// index. Each 64-bit value goes through a xor-shift-multiply mix before its
+// top 9 bits select the bit in the block. Without the non-linear mix, the top
+// bits of the sequence only depend on a few bits of `h2` and `h1'`, which
+// leaves too few distinct bit patterns per block.
+void
+ev_bloom_add_hash(
+  ev_bloom_t *b,
+  const u64 hash[2])
+{
+  if(b->blocked) {
+    u64 *block = b->bits + (hash[0] % (b->nbits / EV_BLOOM_BLOCK_BITS)) * __EV_BLOOM_BLOCK_WORDS;
+    u64 h = hash[1];
+    u64 step = __EV_BLOOM_BLOCK_STEP(hash[0]);
+    for(u32 i = 0; i < b->k; i++, h += step) {
+      u32 bit = __EV_BLOOM_BLOCK_BIT(h);
+      block[bit / 64] |= 1ull << (bit % 64);
+    }
+  } else {
+    u64 h = hash[0];
+    for(u32 i = 0; i < b->k; i++, h += hash[1]) {
+      u64 bit = h % b->nbits;
+      b->bits[bit / 64] |= 1ull << (bit % 64);
+    }
+  }
+}
+
+bool
+ev_bloom_contains_hash(
+  const ev_bloom_t *b,
+  const u64 hash[2])
+{
+  if(b->blocked) {
+    const u64 *block = b->bits + (hash[0] % (b->nbits / EV_BLOOM_BLOCK_BITS)) * __EV_BLOOM_BLOCK_WORDS;
+    u64 mask[__EV_BLOOM_BLOCK_WORDS] = { 0 };
+    u64 h = hash[1];
+    u64 step = __EV_BLOOM_BLOCK_STEP(hash[0]);
+    for(u32 i = 0; i < b->k; i++, h += step) {
+      u32 bit = __EV_BLOOM_BLOCK_BIT(h);
+      mask[bit / 64] |= 1ull << (bit % 64);
+    }
+    // Branchless check of the whole line
+    u64 missing = 0;
+    for(u32 w = 0; w < __EV_BLOOM_BLOCK_WORDS; w++) {
+      missing |= mask[w] & ~block[w];
+    }
+    return missing == 0;
+  } else {
+    u64 h = hash[0];
+    for(u32 i = 0; i < b->k; i++, h += hash[1]) {
+      u64 bit = h % b->nbits;
+      if(!(b->bits[bit / 64] & (1ull << (bit % 64)))) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+// MurmurHash3 takes a 32-bit length, so keys of 4 GiB or more are hashed in
+// chunks, each seeded with the hash of the ones before it. Shorter keys get
+// the plain MurmurHash3.
+static void
+__ev_bloom_hash(
+  const void *data,
+  u64 len,
+  u64 hash[2])
+{
+  const u8 *p = data;
+  u32 seed = EV_BLOOM_HASH_SEED;
+  for(; len > 0xFFFFFFFFull; len -= 0x80000000ull, p += 0x80000000ull) {
+    MurmurHash3_x64_128(p, 0x80000000u, seed, hash);
+    seed = (u32)(hash[0] ^ hash[1]);
+  }
+  MurmurHash3_x64_128(p, (u32)len, seed, hash);
+}
+
+void
+ev_bloom_add(
+  ev_bloom_t *b,
+  const void *data,
+  u64 len)
+{
+  u64 hash[2];
+  __ev_bloom_hash(data, len, hash);
+  ev_bloom_add_hash(b, hash);
+}
+
+bool
+ev_bloom_contains(
+  const ev_bloom_t *b,
+  const void *data,
+  u64 len)
+{
+  u64 hash[2];
+  __ev_bloom_hash(data, len, hash);
+  return ev_bloom_contains_hash(b, hash);
+}
+
+ev_bloom_error_t
+ev_bloom_union(
+  ev_bloom_t *dst,
+  const ev_bloom_t *src)
+{
+  if(dst->nbits != src->nbits || dst->k != src->k || dst->blocked != src->blocked) {
+    return EV_BLOOM_ERR_MISMATCH;
+  }
+  for(u64 i = 0; i < dst->nbits / 64; i++) {
+    dst->bits[i] |= src->bits[i];
+  }
+  return EV_BLOOM_ERR_NONE;
+}
+
+void
+ev_bloom_clear(
+  ev_bloom_t *b)
+{
+  memset(b->bits, 0, b->nbits / 8);
+}
+
+u64
+ev_bloom_serialized_size(
+  const ev_bloom_t *b)
+{
+  return sizeof(struct __ev_bloom_header_t) + b->nbits / 8;
+}
+
+u64
+ev_bloom_serialize(
+  const ev_bloom_t *b,
+  void *out)
+{
+  struct __ev_bloom_header_t header = {
+    .magic = EV_BLOOM_MAGIC,
+    .k = b->k,
+    .nbits = b->nbits,
+    .blocked = b->blocked,
+  };
+  memcpy(out, &header, sizeof(header));
+  memcpy((u8 *)out + sizeof(header), b->bits, b->nbits / 8);
+  return ev_bloom_serialized_size(b);
+}
+
+ev_bloom_error_t
+ev_bloom_deserialize(
+  ev_bloom_t *b,
+  const void *data,
+  u64 size)
+{
+  struct __ev_bloom_header_t header;
+  if(size < sizeof(header)) {
+    return EV_BLOOM_ERR_INVALID_DATA;
+  }
+  memcpy(&header, data, sizeof(header));
+
+  u64 granularity = header.blocked ? EV_BLOOM_BLOCK_BITS : 64;
+  if(header.magic != EV_BLOOM_MAGIC || header.k == 0 || header.nbits == 0 ||
+     header.nbits % granularity != 0 || size - sizeof(header) < header.nbits / 8) {
+    return EV_BLOOM_ERR_INVALID_DATA;
+  }
+
+  b->bits = __ev_bloom_alloc(header.nbits, header.blocked);
+  if(!b->bits) {
+    return EV_BLOOM_ERR_OOM;
+  }
+  b->nbits = header.nbits;
+  b->k = header.k;
+  b->blocked = header.blocked;
+  memcpy(b->bits, (const u8 *)data + sizeof(header), header.nbits / 8);
+  return EV_BLOOM_ERR_NONE;
+}
+
+f64
+ev_bloom_estimate_fp_rate(
+  const ev_bloom_t *b,
+  u64 count)
+{
+  if(b->blocked) {
+    return __ev_bloom_blocked_fp(b->nbits / EV_BLOOM_BLOCK_BITS, (f64)count, b->k);
+  }
+  return __ev_bloom_classic_fp((f64)b->nbits, (f64)count, b->k);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,623 @@
+/*!
+ * \file ev_encoding.h
+ * \brief Hex and base64 encoding and decoding, into caller buffers or
+ * appended to evstrings
+ */
+#ifndef EV_ENCODING_HEADER
+#define EV_ENCODING_HEADER
+
+#include "ev_str.h"
+
+#if defined(EV_ENCODING_SHARED)
+# if defined (EV_ENCODING_IMPL)
+#  define EV_ENCODING_API EV_EXPORT
+# else
+#  define EV_ENCODING_API EV_IMPORT
+# endif
+#else
+# define EV_ENCODING_API
+#endif
+
+/*!
+ * \brief Value returned by the decoding functions when the input is not valid
+ */
+#define EV_ENCODING_INVALID (~0ull)
+
+/*!
+ * \returns The number of characters that `len` bytes are hex encoded to
+ */
+#define ev_hex_encodedLength(len) ((len) * 2)
+
+/*!
+ * \returns The number of characters, padding included, that `len` bytes are
+ * base64 encoded to
+ */
+#define ev_base64_encodedLength(len) (((len) + 2) / 3 * 4)
+
+/*!
+ * \brief Writes the lowercase hex digits of `len` bytes to `dst`, which must
+ * have room for `ev_hex_encodedLength(len)` characters. No null terminator is
+ * written.
+ *
+ * With SSE2/AVX2, 16 or 32 bytes are encoded per iteration: their nibbles are
+ * split and interleaved, and turned into digits with a compare and two adds.
+ */
+EV_ENCODING_API void
+ev_hex_encode(
+  const void *src,
+  u64 len,
+  char *dst);
+
+/*!
+ * \brief Decodes `len` hex digits, upper or lower case, to `dst`, which must
+ * have room for `len / 2` bytes. If the input is not valid, `dst` may have
+ * been partially written.
+ *
+ * \returns The number of bytes written, or `EV_ENCODING_INVALID` if `len` is
+ * odd or a character is not a hex digit
+ */
+EV_ENCODING_API u64
+ev_hex_decode(
+  const char *src,
+  u64 len,
+  void *dst);
+
+/*!
+ * \brief Writes the standard (RFC 4648) base64 encoding of `len` bytes to
+ * `dst`, which must have room for `ev_base64_encodedLength(len)` characters.
+ * The output is padded with '='. No null terminator is written.
+ *
+ * With SSSE3/AVX2, 12 or 24 bytes are encoded per iteration: a shuffle and two
+ * multiplies split them into 6-bit indices, which are mapped to the alphabet
+ * with a single table lookup (Muła and Lemire, "Faster Base64 Encoding and
+ * Decoding Using AVX2 Instructions").
+ *
+ * \returns The number of characters written
+ */
+EV_ENCODING_API u64
+ev_base64_encode(
+  const void *src,
+  u64 len,
+  char *dst);
+
+/*!
+ * \returns The number of bytes that valid base64 text of `len` characters
+ * decodes to
+ */
+EV_ENCODING_API u64
+ev_base64_decodedLength(
+  const char *src,
+  u64 len);
+
+/*!
+ * \brief Decodes padded, standard base64 to `dst`, which must have room for
+ * `ev_base64_decodedLength(src, len)` bytes. Whitespace and the URL-safe
+ * alphabet are not accepted. If the input is not valid, `dst` may have been
+ * partially written.
+ *
+ * \returns The number of bytes written, or `EV_ENCODING_INVALID`
+ */
+EV_ENCODING_API u64
+ev_base64_decode(
+  const char *src,
+  u64 len,
+  void *dst);
+
+/*!
+ * \brief Appends the hex encoding of `len` bytes to the string. `data` must
+ * not point into the string.
+ *
+ * \details Sample usage:
+ * ```
+ * u8 digest[16];
+ * evstring s = evstring_new("md5:");
+ * evstring_pushHex(&s, digest, sizeof(digest));
+ * ```
+ */
+EV_ENCODING_API evstring_error_t
+evstring_pushHex(
+  evstring *s,
+  const void *data,
+  u64 len);
+
+/*!
+ * \brief Appends the base64 encoding of `len` bytes to the string. `data`
+ * must not point into the string.
+ */
+EV_ENCODING_API evstring_error_t
+evstring_pushBase64(
+  evstring *s,
+  const void *data,
+  u64 len);
+
+/*!
+ * \brief Decodes hex text and appends the bytes to the string
+ *
+ * \returns `EV_STR_ERR_PARSE` if the text is not valid, in which case the
+ * string is unchanged
+ */
+EV_ENCODING_API evstring_error_t
+evstring_pushFromHex(
+  evstring *s,
+  ev_strview hex);
+
+/*!
+ * \brief Decodes base64 text and appends the bytes to the string
+ *
+ * \returns `EV_STR_ERR_PARSE` if the text is not valid, in which case the
+ * string is unchanged
+ */
+EV_ENCODING_API evstring_error_t
+evstring_pushFromBase64(
+  evstring *s,
+  ev_strview base64);
+
+#ifdef EV_ENCODING_IMPLEMENTATION
+#undef EV_ENCODING_IMPLEMENTATION
+
+#include <string.h>
+
+#if EV_SIMD_AVX2
+#include <immintrin.h>
+#elif EV_SIMD_SSSE3
+#include <tmmintrin.h>
+#elif EV_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+static const char __ev_base64_alphabet[64] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Value of each base64 character, 0xFF for characters outside of the alphabet
+static const u8 __ev_base64_values[256] = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+  0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+  0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+// \returns The value of a hex digit, or a value above 15
+static inline u32
+__ev_hex_value(
+  u8 c)
+{
+  u32 digit = (u32)c - '0';
+  u32 letter = ((u32)c | 0x20) - 'a';
+  return digit < 10 ? digit : (letter < 6 ? letter + 10 : 0xFF);
+}
+
+#if EV_SIMD_SSE2
+// Turns nibbles into lowercase hex digits
+static EV_FORCEINLINE __m128i
+__ev_hex_digits16(
+  __m128i nibbles)
+{
+  __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+  return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+
+// Turns 16 hex digits into 8 bytes, one in the low byte of each 16-bit lane
+// \returns A mask with the bytes that are not hex digits set
+static EV_FORCEINLINE __m128i
+__ev_hex_decode16(
+  __m128i x,
+  __m128i *bytes)
+{
+  // Unsigned range checks: `v <= max` is `min(v, max) == v`
+  __m128i digit = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+  __m128i letter = _mm_sub_epi8(_mm_or_si128(x, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+  __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+  __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+  __m128i values = _mm_or_si128(_mm_and_si128(is_digit, digit),
+      _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+  // Each 16-bit lane holds a high nibble in its low byte and a low nibble in
+  // its high byte
+  *bytes = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values, _mm_set1_epi16(0xFF)), 4), _mm_srli_epi16(values, 8));
+  return _mm_andnot_si128(_mm_or_si128(is_digit, is_letter), _mm_set1_epi8(-1));
+}
+#endif
+
+void
+ev_hex_encode(
+  const void *src,
+  u64 len,
+  char *dst)
+{
+  const u8 *s = (const u8 *)src;
+  u64 i = 0;
+#if EV_SIMD_AVX2
+  for(; i + 32 <= len; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), _mm256_set1_epi8(0x0F));
+    __m256i lo = _mm256_and_si256(x, _mm256_set1_epi8(0x0F));
+    // Interleaving works within 128-bit lanes, so the halves are put back in
+    // order afterwards
+    __m256i first = _mm256_unpacklo_epi8(hi, lo);
+    __m256i second = _mm256_unpackhi_epi8(hi, lo);
+    __m256i nibbles[2] = {
+      _mm256_permute2x128_si256(first, second, 0x20),
+      _mm256_permute2x128_si256(first, second, 0x31),
+    };
+    for(u32 k = 0; k < 2; k++) {
+      __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(nibbles[k], _mm256_set1_epi8(9)),
+          _mm256_set1_epi8('a' - '0' - 10));
+      __m256i digits = _mm256_add_epi8(_mm256_add_epi8(nibbles[k], _mm256_set1_epi8('0')), letters);
+      _mm256_storeu_si256((__m256i *)(dst + 2 * i + 32 * k), digits);
+    }
+  }
+#endif
+#if EV_SIMD_SSE2
+  for(; i + 16 <= len; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi8(0x0F));
+    __m128i lo = _mm_and_si128(x, _mm_set1_epi8(0x0F));
+    _mm_storeu_si128((__m128i *)(dst + 2 * i), __ev_hex_digits16(_mm_unpacklo_epi8(hi, lo)));
+    _mm_storeu_si128((__m128i *)(dst + 2 * i + 16), __ev_hex_digits16(_mm_unpackhi_epi8(hi, lo)));
+  }
+#endif
+  __ev_hex_encodeScalar(s + i, len - i, dst + 2 * i);
+}
+
+u64
+ev_hex_decode(
+  const char *src,
+  u64 len,
+  void *dst)
+{
+  if(len % 2 != 0) {
+    return EV_ENCODING_INVALID;
+  }
+  const u8 *s = (const u8 *)src;
+  u8 *d = (u8 *)dst;
+  u64 i = 0;
+  // An invalid block is left to the scalar loop
+#if EV_SIMD_AVX2
+  for(; i + 64 <= len; i += 64) {
+    __m256i bytes[2];
+    __m256i invalid = _mm256_setzero_si256();
+    for(u32 k = 0; k < 2; k++) {
+      __m256i x = _mm256_loadu_si256((const __m256i *)(s + i + 32 * k));
+      __m256i digit = _mm256_sub_epi8(x, _mm256_set1_epi8('0'));
+      __m256i letter = _mm256_sub_epi8(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+      __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+      __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+      invalid = _mm256_or_si256(invalid, _mm256_andnot_si256(_mm256_or_si256(is_digit, is_letter),
+          _mm256_set1_epi8(-1)));
+      __m256i values = _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+          _mm256_and_si256(is_letter, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+      bytes[k] = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(values, _mm256_set1_epi16(0xFF)), 4),
+          _mm256_srli_epi16(values, 8));
+    }
+    if(!_mm256_testz_si256(invalid, invalid)) {
+      break;
+    }
+    // Packing works within 128-bit lanes
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(bytes[0], bytes[1]), 0xD8);
+    _mm256_storeu_si256((__m256i *)(d + i / 2), packed);
+  }
+#endif
+#if EV_SIMD_SSE2
+  for(; i + 32 <= len; i += 32) {
+    __m128i lo, hi;
+    __m128i invalid = _mm_or_si128(__ev_hex_decode16(_mm_loadu_si128((const __m128i *)(s + i)), &lo),
+        __ev_hex_decode16(_mm_loadu_si128((const __m128i *)(s + i + 16)), &hi));
+    if(_mm_movemask_epi8(invalid) != 0) {
+      break;
+    }
+    _mm_storeu_si128((__m128i *)(d + i / 2), _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for(; i < len; i += 2) {
+    u32 hi = __ev_hex_value(s[i]);
+    u32 lo = __ev_hex_value(s[i + 1]);
+    if((hi | lo) > 0xF) {
+      return EV_ENCODING_INVALID;
+    }
+    d[i / 2] = (u8)((hi << 4) | lo);
+  }
+  return len / 2;
+}
+
+#if EV_SIMD_SSSE3
+// Splits each group of 3 bytes in the low 12 bytes into 4 6-bit indices, one
+// per byte
+static EV_FORCEINLINE __m128i
+__ev_base64_indices16(
+  __m128i x)
+{
+  x = _mm_shuffle_epi8(x, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  __m128i ac = _mm_mulhi_epu16(_mm_and_si128(x, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+  __m128i bd = _mm_mullo_epi16(_mm_and_si128(x, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(ac, bd);
+}
+
+// Maps indices to the alphabet: each of its five ranges is a constant offset
+// from its index, selected with a lookup
+static EV_FORCEINLINE __m128i
+__ev_base64_chars16(
+  __m128i indices)
+{
+  const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  // 0 for a-z, 1-10 for digits, 11 for '+', 12 for '/', 13 for A-Z
+  __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+  return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+// Turns 16 base64 characters into their values. Each character is classified
+// by its nibbles: a character is in the alphabet iff the classes of its low
+// and high nibble have no bit in common.
+// \returns false if a character is not in the alphabet
+static EV_FORCEINLINE bool
+__ev_base64_values16(
+  __m128i x,
+  __m128i *values)
+{
+  const __m128i lo_classes = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i hi_classes = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  // Offset from a character to its value, by high nibble; '/' is the only
+  // character that shares its high nibble with '+' but not its offset
+  const __m128i offsets = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  __m128i hi = _mm_and_si128(_mm_srli_epi32(x, 4), _mm_set1_epi8(0x0F));
+  __m128i lo = _mm_and_si128(x, _mm_set1_epi8(0x0F));
+  __m128i classes = _mm_and_si128(_mm_shuffle_epi8(lo_classes, lo), _mm_shuffle_epi8(hi_classes, hi));
+  if(_mm_movemask_epi8(_mm_cmpeq_epi8(classes, _mm_setzero_si128())) != 0xFFFF) {
+    return false;
+  }
+  __m128i is_slash = _mm_cmpeq_epi8(x, _mm_set1_epi8('/'));
+  *values = _mm_add_epi8(x, _mm_shuffle_epi8(offsets, _mm_add_epi8(is_slash, hi)));
+  return true;
+}
+
+// Packs 16 6-bit values into 12 bytes, in the low bytes of the result
+static EV_FORCEINLINE __m128i
+__ev_base64_pack16(
+  __m128i values)
+{
+  __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+  return _mm_shuffle_epi8(groups, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+#endif
+
+u64
+ev_base64_encode(
+  const void *src,
+  u64 len,
+  char *dst)
+{
+  const u8 *s = (const u8 *)src;
+  u64 i = 0;
+  u64 out = 0;
+#if EV_SIMD_AVX2
+  // Each 128-bit lane encodes 12 bytes, and each of its loads reads 16
+  for(; i + 28 <= len; i += 24, out += 32) {
+    __m256i x = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(s + i))),
+        _mm_loadu_si128((const __m128i *)(s + i + 12)), 1);
+    x = _mm256_shuffle_epi8(x, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    __m256i ac = _mm256_mulhi_epu16(_mm256_and_si256(x, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040));
+    __m256i bd = _mm256_mullo_epi16(_mm256_and_si256(x, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010));
+    __m256i indices = _mm256_or_si256(ac, bd);
+
+    const __m256i offsets = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    range = _mm256_or_si256(range,
+        _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+    _mm256_storeu_si256((__m256i *)(dst + out), _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices));
+  }
+#endif
+#if EV_SIMD_SSSE3
+  for(; i + 16 <= len; i += 12, out += 16) {
+    __m128i indices = __ev_base64_indices16(_mm_loadu_si128((const __m128i *)(s + i)));
+    _mm_storeu_si128((__m128i *)(dst + out), __ev_base64_chars16(indices));
+  }
+#endif
+  for(; i + 3 <= len; i += 3, out += 4) {
+    u32 v = ((u32)s[i] << 16) | ((u32)s[i + 1] << 8) | s[i + 2];
+    dst[out] = __ev_base64_alphabet[v >> 18];
+    dst[out + 1] = __ev_base64_alphabet[(v >> 12) & 0x3F];
+    dst[out + 2] = __ev_base64_alphabet[(v >> 6) & 0x3F];
+    dst[out + 3] = __ev_base64_alphabet[v & 0x3F];
+  }
+  if(i < len) {
+    u32 v = (u32)s[i] << 16;
+    if(i + 1 < len) {
+      v |= (u32)s[i + 1] << 8;
+    }
+    dst[out] = __ev_base64_alphabet[v >> 18];
+    dst[out + 1] = __ev_base64_alphabet[(v >> 12) & 0x3F];
+    dst[out + 2] = i + 1 < len ? __ev_base64_alphabet[(v >> 6) & 0x3F] : '=';
+    dst[out + 3] = '=';
+    out += 4;
+  }
+  return out;
+}
+
+u64
+ev_base64_decodedLength(
+  const char *src,
+  u64 len)
+{
+  u64 padding = 0;
+  if(len >= 4 && len % 4 == 0) {
+    padding = (src[len - 1] == '=') + (src[len - 1] == '=' && src[len - 2] == '=');
+  }
+  return len / 4 * 3 - padding;
+}
+
+u64
+ev_base64_decode(
+  const char *src,
+  u64 len,
+  void *dst)
+{
+  if(len % 4 != 0) {
+    return EV_ENCODING_INVALID;
+  }
+  if(len == 0) {
+    return 0;
+  }
+  const u8 *s = (const u8 *)src;
+  u8 *d = (u8 *)dst;
+  // The last group may be padded, and is decoded on its own
+  u64 body = len - 4;
+  u64 i = 0;
+  u64 out = 0;
+  // The vector loops store 4 or 8 bytes past their output, so they stop
+  // early enough for the following groups to overwrite them. An invalid block
+  // is left to the scalar loop.
+#if EV_SIMD_AVX2
+  for(; i + 32 + 16 <= len; i += 32, out += 24) {
+    // The same classification as __ev_base64_values16, on both lanes
+    const __m256i lo_classes = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i hi_classes = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i offsets = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi32(x, 4), _mm256_set1_epi8(0x0F));
+    __m256i lo = _mm256_and_si256(x, _mm256_set1_epi8(0x0F));
+    __m256i classes = _mm256_and_si256(_mm256_shuffle_epi8(lo_classes, lo), _mm256_shuffle_epi8(hi_classes, hi));
+    if(!_mm256_testz_si256(classes, classes)) {
+      break;
+    }
+    __m256i is_slash = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('/'));
+    __m256i v = _mm256_add_epi8(x, _mm256_shuffle_epi8(offsets, _mm256_add_epi8(is_slash, hi)));
+    __m256i pairs = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+    __m256i groups = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    groups = _mm256_shuffle_epi8(groups, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    groups = _mm256_permutevar8x32_epi32(groups, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    _mm256_storeu_si256((__m256i *)(d + out), groups);
+  }
+#endif
+#if EV_SIMD_SSSE3
+  for(; i + 16 + 8 <= len; i += 16, out += 12) {
+    __m128i values;
+    if(!__ev_base64_values16(_mm_loadu_si128((const __m128i *)(s + i)), &values)) {
+      break;
+    }
+    _mm_storeu_si128((__m128i *)(d + out), __ev_base64_pack16(values));
+  }
+#endif
+  for(; i < body; i += 4, out += 3) {
+    u32 a = __ev_base64_values[s[i]];
+    u32 b = __ev_base64_values[s[i + 1]];
+    u32 c = __ev_base64_values[s[i + 2]];
+    u32 e = __ev_base64_values[s[i + 3]];
+    if((a | b | c | e) > 0x3F) {
+      return EV_ENCODING_INVALID;
+    }
+    u32 v = (a << 18) | (b << 12) | (c << 6) | e;
+    d[out] = (u8)(v >> 16);
+    d[out + 1] = (u8)(v >> 8);
+    d[out + 2] = (u8)v;
+  }
+
+  u32 a = __ev_base64_values[s[i]];
+  u32 b = __ev_base64_values[s[i + 1]];
+  u32 c = s[i + 2] == '=' && s[i + 3] == '=' ? 0 : __ev_base64_values[s[i + 2]];
+  u32 e = s[i + 3] == '=' ? 0 : __ev_base64_values[s[i + 3]];
+  if((a | b | c | e) > 0x3F) {
+    return EV_ENCODING_INVALID;
+  }
+  u32 v = (a << 18) | (b << 12) | (c << 6) | e;
+  d[out++] = (u8)(v >> 16);
+  if(s[i + 2] != '=') {
+    d[out++] = (u8)(v >> 8);
+  }
+  if(s[i + 3] != '=') {
+    d[out++] = (u8)v;
+  }
+  return out;
+}
+
+evstring_error_t
+evstring_pushHex(
+  evstring *s,
+  const void *data,
+  u64 len)
+{
+  u64 old_len = evstring_getLength(*s);
+  evstring_error_t err = evstring_setLength(s, old_len + ev_hex_encodedLength(len));
+  if(err != EV_STR_ERR_NONE) {
+    return err;
+  }
+  ev_hex_encode(data, len, *s + old_len);
+  return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+evstring_pushBase64(
+  evstring *s,
+  const void *data,
+  u64 len)
+{
+  u64 old_len = evstring_getLength(*s);
+  evstring_error_t err = evstring_setLength(s, old_len + ev_base64_encodedLength(len));
+  if(err != EV_STR_ERR_NONE) {
+    return err;
+  }
+  ev_base64_encode(data, len, *s + old_len);
+  return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+evstring_pushFromHex(
+  evstring *s,
+  ev_strview hex)
+{
+  u64 old_len = evstring_getLength(*s);
+  evstring_error_t err = evstring_setLength(s, old_len + hex.len / 2);
+  if(err != EV_STR_ERR_NONE) {
+    return err;
+  }
+  if(ev_hex_decode(hex.ptr, hex.len, *s + old_len) == EV_ENCODING_INVALID) {
+    evstring_setLength(s, old_len);
+    return EV_STR_ERR_PARSE;
+  }
+  return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+evstring_pushFromBase64(
+  evstring *s,
+  ev_strview base64)
+{
+  u64 old_len = evstring_getLength(*s);
+  evstring_error_t err = evstring_setLength(s, old_len + ev_base64_decodedLength(base64.ptr, base64.len));
+  if(err != EV_STR_ERR_NONE) {
+    return err;
+  }
+  if(ev_base64_decode(base64.ptr, base64.len, *s + old_len) == EV_ENCODING_INVALID) {
+    evstring_setLength(s, old_len);
+    return EV_STR_ERR_PARSE;
+  }
+  return EV_STR_ERR_NONE;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,874 @@
+/*!
+ * \file ev_glob.h
+ * \brief Glob patterns for paths (`*`, `**`, `?`, `[set]`, `{a,b}`), compiled
+ * into automata that match in linear time
+ */
+#ifndef EV_GLOB_HEADER
+#define EV_GLOB_HEADER
+
+#include "ev_str.h"
+
+#if defined(EV_GLOB_SHARED)
+# if defined (EV_GLOB_IMPL)
+#  define EV_GLOB_API EV_EXPORT
+# else
+#  define EV_GLOB_API EV_IMPORT
+# endif
+#else
+# define EV_GLOB_API
+#endif
+
+#ifndef EV_GLOB_MAX_POSITIONS
+/*!
+ * \brief Largest number of characters, wildcards and sets in a pattern. It
+ * bounds the state that a match keeps on the stack.
+ */
+#define EV_GLOB_MAX_POSITIONS 512
+#endif
+
+#ifndef EV_GLOB_MAX_DFA_STATES
+/*!
+ * \brief Number of DFA states above which a pattern is matched by simulating
+ * its NFA instead, which is still linear in the length of the text
+ */
+#define EV_GLOB_MAX_DFA_STATES 1024
+#endif
+
+/*!
+ * \brief A compiled pattern. Compiling it is the only operation that writes
+ * to it, so a compiled pattern can be used by any number of threads at the
+ * same time.
+ */
+typedef struct ev_glob_t ev_glob_t;
+
+/*!
+ * \brief Compiles a C string, an `evstring`, an `evstring_view` or an
+ * `ev_strview`
+ *
+ * \details Sample usage:
+ * ```
+ * ev_glob_t *images = ev_glob_compile("*.{png,jpg}");
+ * if(ev_glob_match(images, name)) { ... }
+ * ev_glob_fini(images);
+ * ```
+ */
+#define ev_glob_compile(pattern) _Generic((pattern), \
+        evstring_view: ev_glob_compile_view, \
+        ev_strview: ev_glob_compile_strview, \
+        default: ev_glob_compile_str \
+        )(pattern)
+
+/*!
+ * \brief Matches a C string, an `evstring`, an `evstring_view` or an
+ * `ev_strview`. An `evstring` is a `char *` to `_Generic`, so it is matched as
+ * a C string; `ev_glob_match_evstring` uses its stored length instead.
+ */
+#define ev_glob_match(g, text) _Generic((text), \
+        evstring_view: ev_glob_match_view, \
+        ev_strview: ev_glob_match_strview, \
+        default: ev_glob_match_str \
+        )(g, text)
+
+/*!
+ * \brief Compiles a pattern, which has to match the whole text:
+ * - `*` matches any characters except '/'
+ * - `**` as a whole path component matches any number of components, none
+ *   included, so that the pattern "textures", "**", "a.png" joined with '/'
+ *   matches `textures/a.png` and `textures/env/a.png`. At the end of a
+ *   pattern, it matches everything below the directory before it. Elsewhere,
+ *   it is the same as `*`.
+ * - `?` matches one character except '/'
+ * - `[abc]`, `[a-z]`, and their negations `[!a-z]` or `[^a-z]`, match one
+ *   character of the set; '/' is never part of a set
+ * - `{a,b}` matches one of the comma-separated alternatives, which are
+ *   patterns themselves and can be nested
+ * - `\` matches the character after it literally
+ *
+ * Characters are bytes: `?` matches a single byte of a UTF-8 sequence.
+ *
+ * \returns The compiled pattern, or NULL if the pattern is not valid
+ * (unterminated set or braces, a trailing `\`, more than
+ * `EV_GLOB_MAX_POSITIONS` positions) or on OOM
+ */
+EV_GLOB_API ev_glob_t *
+ev_glob_compile_strview(
+  ev_strview pattern);
+
+EV_GLOB_API ev_glob_t *
+ev_glob_compile_view(
+  evstring_view pattern);
+
+EV_GLOB_API ev_glob_t *
+ev_glob_compile_str(
+  const char *pattern);
+
+EV_GLOB_API void
+ev_glob_fini(
+  ev_glob_t *g);
+
+/*!
+ * \brief Checks whether the whole text matches. The literal parts of the
+ * pattern are checked first: its literal prefix and suffix are compared, and
+ * its longest literal in between is searched for with `ev_strview_find`. The
+ * text is then run through the automaton, one table lookup per byte, and
+ * stops as soon as the outcome cannot change. Nothing is allocated.
+ */
+EV_GLOB_API bool
+ev_glob_match_strview(
+  const ev_glob_t *g,
+  ev_strview text);
+
+EV_GLOB_API bool
+ev_glob_match_view(
+  const ev_glob_t *g,
+  evstring_view text);
+
+EV_GLOB_API bool
+ev_glob_match_str(
+  const ev_glob_t *g,
+  const char *text);
+
+EV_GLOB_API bool
+ev_glob_match_evstring(
+  const ev_glob_t *g,
+  const evstring text);
+
+#ifdef EV_GLOB_IMPLEMENTATION
+#undef EV_GLOB_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+
+#if EV_CC_MSVC
+#include <intrin.h>
+#endif
+
+#define __EV_GLOB_MAX_WORDS ((EV_GLOB_MAX_POSITIONS + 63) / 64)
+#define __EV_GLOB_NONE (~0u)
+
+// Status of a DFA state
+#define __EV_GLOB_ACCEPT (1 << 0)
+// No later byte changes the outcome
+#define __EV_GLOB_FINAL  (1 << 1)
+
+// The pattern is compiled into a position (Glushkov) automaton: every
+// character, wildcard or set is a position, which accepts a set of bytes and
+// is followed by a set of positions. A state of the matcher is the set of
+// positions that can take the next byte, plus whether the text read so far
+// matches. Sets of positions are bitsets of `words` u64s.
+struct ev_glob_t {
+  u32 position_count;
+  u32 words;
+  u32 class_count;
+  //! Bytes that no position tells apart share a class
+  u8 classes[256];
+
+  //! Every match starts with the prefix, ends with the suffix, and contains
+  //! the needle in between; they are stored one after the other
+  char *literals;
+  u64 prefix_len;
+  u64 suffix_len;
+  u64 needle_len;
+
+  //! `state_count * class_count` transitions, or NULL if the DFA has too many
+  //! states. The start state is 0.
+  u32 *transitions;
+  u8 *status;
+  u32 state_count;
+
+  //! Positions that follow each position
+  u64 *follow;
+  //! Positions that accept each class
+  u64 *class_positions;
+  //! Positions that a match can end with
+  u64 *last;
+  //! State after the prefix
+  u64 *start;
+  bool start_accept;
+};
+
+typedef struct {
+  bool nullable;
+  u64 *first;
+  u64 *last;
+} __ev_glob_frag;
+
+typedef struct {
+  const u8 *p;
+  u64 len;
+  u64 i;
+  u32 depth;
+  u32 words;
+  u32 count;
+  bool invalid;
+  bool oom;
+  //! Bytes that each position accepts
+  u8 (*sets)[32];
+  u64 *follow;
+  //! Byte of each top-level element, or -1 for elements that are not a
+  //! single literal
+  i32 *top;
+  u64 top_count;
+} __ev_glob_parser;
+
+static inline u32
+__ev_glob_ctz64(
+  u64 x)
+{
+#if EV_CC_MSVC
+  unsigned long idx;
+  _BitScanForward64(&idx, x);
+  return (u32)idx;
+#else
+  return (u32)__builtin_ctzll(x);
+#endif
+}
+
+static inline void
+__ev_glob_or(
+  u64 *dst,
+  const u64 *src,
+  u32 words)
+{
+  for(u32 w = 0; w < words; w++) {
+    dst[w] |= src[w];
+  }
+}
+
+static inline bool
+__ev_glob_intersects(
+  const u64 *a,
+  const u64 *b,
+  u32 words)
+{
+  u64 any = 0;
+  for(u32 w = 0; w < words; w++) {
+    any |= a[w] & b[w];
+  }
+  return any != 0;
+}
+
+// Positions that can take the byte after the positions in `taken`
+static inline void
+__ev_glob_followers(
+  const u64 *follow,
+  const u64 *taken,
+  u32 words,
+  u64 *out)
+{
+  memset(out, 0, words * sizeof(u64));
+  for(u32 w = 0; w < words; w++) {
+    for(u64 bits = taken[w]; bits; bits &= bits - 1) {
+      __ev_glob_or(out, follow + (u64)(w * 64 + __ev_glob_ctz64(bits)) * words, words);
+    }
+  }
+}
+
+static __ev_glob_frag
+__ev_glob_frag_new(
+  __ev_glob_parser *P,
+  bool nullable)
+{
+  __ev_glob_frag f = { .nullable = nullable };
+  f.first = calloc(2 * P->words, sizeof(u64));
+  if(!f.first) {
+    P->oom = true;
+    return f;
+  }
+  f.last = f.first + P->words;
+  return f;
+}
+
+// A fragment made of a new position, which repeats if `loop` is set
+static __ev_glob_frag
+__ev_glob_position(
+  __ev_glob_parser *P,
+  const u8 *set,
+  bool loop)
+{
+  __ev_glob_frag f = __ev_glob_frag_new(P, loop);
+  if(!f.first) {
+    return f;
+  }
+  if(P->count == EV_GLOB_MAX_POSITIONS) {
+    P->invalid = true;
+    return f;
+  }
+  u32 pos = P->count++;
+  memcpy(P->sets[pos], set, 32);
+  f.first[pos / 64] |= 1ull << (pos % 64);
+  f.last[pos / 64] |= 1ull << (pos % 64);
+  if(loop) {
+    P->follow[(u64)pos * P->words + pos / 64] |= 1ull << (pos % 64);
+  }
+  return f;
+}
+
+// Appends `e` to `r`
+static void
+__ev_glob_concat(
+  __ev_glob_parser *P,
+  __ev_glob_frag *r,
+  const __ev_glob_frag *e)
+{
+  u32 words = P->words;
+  for(u32 w = 0; w < words; w++) {
+    for(u64 bits = r->last[w]; bits; bits &= bits - 1) {
+      __ev_glob_or(P->follow + (u64)(w * 64 + __ev_glob_ctz64(bits)) * words, e->first, words);
+    }
+  }
+  if(r->nullable) {
+    __ev_glob_or(r->first, e->first, words);
+  }
+  if(e->nullable) {
+    __ev_glob_or(r->last, e->last, words);
+  } else {
+    memcpy(r->last, e->last, words * sizeof(u64));
+  }
+  r->nullable = r->nullable && e->nullable;
+}
+
+static __ev_glob_frag
+__ev_glob_sequence(
+  __ev_glob_parser *P);
+
+static inline void
+__ev_glob_setAll(
+  u8 *set,
+  bool slash)
+{
+  memset(set, 0xFF, 32);
+  if(!slash) {
+    set['/' / 8] &= (u8)~(1u << ('/' % 8));
+  }
+}
+
+static inline void
+__ev_glob_setByte(
+  u8 *set,
+  u8 c)
+{
+  set[c / 8] |= (u8)(1u << (c % 8));
+}
+
+// Parses the set that starts after a '['
+static bool
+__ev_glob_bracket(
+  __ev_glob_parser *P,
+  u8 *set)
+{
+  const u8 *p = P->p;
+  bool negate = P->i < P->len && (p[P->i] == '!' || p[P->i] == '^');
+  P->i += negate;
+  memset(set, 0, 32);
+  // A ']' right after the opening bracket is a member
+  bool first = true;
+  while(P->i < P->len && (p[P->i] != ']' || first)) {
+    first = false;
+    u8 lo = p[P->i++];
+    if(lo == '\\') {
+      if(P->i == P->len) {
+        return false;
+      }
+      lo = p[P->i++];
+    }
+    u8 hi = lo;
+    if(P->i + 1 < P->len && p[P->i] == '-' && p[P->i + 1] != ']') {
+      hi = p[P->i + 1];
+      P->i += 2;
+      if(hi == '\\') {
+        if(P->i == P->len) {
+          return false;
+        }
+        hi = p[P->i++];
+      }
+    }
+    for(u32 c = lo; c <= hi; c++) {
+      __ev_glob_setByte(set, (u8)c);
+    }
+  }
+  if(P->i == P->len) {
+    return false;
+  }
+  P->i++;
+  if(negate) {
+    for(u32 b = 0; b < 32; b++) {
+      set[b] = (u8)~set[b];
+    }
+  }
+  set['/' / 8] &= (u8)~(1u << ('/' % 8));
+  return true;
+}
+
+// Parses one element at `P->i`. `literal` is set to its byte if it is a
+// single literal character, and to -1 otherwise.
+static __ev_glob_frag
+__ev_glob_element(
+  __ev_glob_parser *P,
+  i32 *literal)
+{
+  const u8 *p = P->p;
+  u8 set[32] = { 0 };
+  u64 start = P->i;
+  u8 c = p[P->i++];
+  *literal = -1;
+
+  if(c == '*') {
+    while(P->i < P->len && p[P->i] == '*') {
+      P->i++;
+    }
+    bool inside = P->depth > 0;
+    bool starts_component = start == 0 || p[start - 1] == '/' || (inside && (p[start - 1] == '{' || p[start - 1] == ','));
+    bool ends_component = P->i == P->len || p[P->i] == '/' || (inside && (p[P->i] == '}' || p[P->i] == ','));
+    if(P->i - start < 2 || !starts_component || !ends_component) {
+      __ev_glob_setAll(set, false);
+      return __ev_glob_position(P, set, true);
+    }
+    __ev_glob_setAll(set, true);
+    __ev_glob_frag any = __ev_glob_position(P, set, true);
+    if(P->i == P->len || p[P->i] != '/' || !any.first || P->invalid) {
+      return any;
+    }
+    // `**/` is an optional run of anything that ends with '/'
+    P->i++;
+    memset(set, 0, 32);
+    __ev_glob_setByte(set, '/');
+    __ev_glob_frag slash = __ev_glob_position(P, set, false);
+    if(slash.first) {
+      __ev_glob_concat(P, &any, &slash);
+      any.nullable = true;
+      free(slash.first);
+    }
+    return any;
+  }
+
+  if(c == '?') {
+    __ev_glob_setAll(set, false);
+    return __ev_glob_position(P, set, false);
+  }
+
+  if(c == '[') {
+    if(!__ev_glob_bracket(P, set)) {
+      P->invalid = true;
+    }
+    return __ev_glob_position(P, set, false);
+  }
+
+  if(c == '{') {
+    P->depth++;
+    __ev_glob_frag alt = __ev_glob_frag_new(P, false);
+    while(alt.first && !P->invalid && !P->oom) {
+      __ev_glob_frag branch = __ev_glob_sequence(P);
+      if(!branch.first) {
+        break;
+      }
+      alt.nullable = alt.nullable || branch.nullable;
+      __ev_glob_or(alt.first, branch.first, P->words);
+      __ev_glob_or(alt.last, branch.last, P->words);
+      free(branch.first);
+      if(P->i == P->len) {
+        P->invalid = true;
+      } else if(p[P->i++] == '}') {
+        break;
+      }
+    }
+    P->depth--;
+    return alt;
+  }
+
+  if(c == '}') {
+    P->invalid = true;
+  } else if(c == '\\') {
+    if(P->i == P->len) {
+      P->invalid = true;
+    } else {
+      c = p[P->i++];
+    }
+  }
+  *literal = c;
+  __ev_glob_setByte(set, c);
+  return __ev_glob_position(P, set, false);
+}
+
+// Parses elements until the end of the pattern, or the end of the current
+// alternative
+static __ev_glob_frag
+__ev_glob_sequence(
+  __ev_glob_parser *P)
+{
+  __ev_glob_frag r = __ev_glob_frag_new(P, true);
+  while(r.first && P->i < P->len && !P->invalid && !P->oom) {
+    if(P->depth > 0 && (P->p[P->i] == ',' || P->p[P->i] == '}')) {
+      break;
+    }
+    u32 depth = P->depth;
+    i32 literal;
+    __ev_glob_frag e = __ev_glob_element(P, &literal);
+    if(!e.first) {
+      break;
+    }
+    if(depth == 0) {
+      P->top[P->top_count++] = literal;
+    }
+    __ev_glob_concat(P, &r, &e);
+    free(e.first);
+  }
+  return r;
+}
+
+// Arrays of the DFA while it is built
+typedef struct {
+  u32 capacity;
+  //! Key of each state: its candidate positions, then whether it accepts
+  u64 *keys;
+  u32 *transitions;
+  u32 *table;
+  u32 table_mask;
+} __ev_glob_dfa;
+
+// Finds the state for `key`, and adds it if it is new
+// \returns The state, or `__EV_GLOB_NONE` if there are too many states or on
+// OOM
+static u32
+__ev_glob_state(
+  ev_glob_t *g,
+  __ev_glob_dfa *dfa,
+  const u64 *key)
+{
+  u32 key_words = g->words + 1;
+  u64 slot = ev_hash_murmur3(key, key_words * sizeof(u64), 0) & dfa->table_mask;
+  for(; dfa->table[slot]; slot = (slot + 1) & dfa->table_mask) {
+    if(memcmp(dfa->keys + (u64)(dfa->table[slot] - 1) * key_words, key, key_words * sizeof(u64)) == 0) {
+      return dfa->table[slot] - 1;
+    }
+  }
+  if(g->state_count == EV_GLOB_MAX_DFA_STATES) {
+    return __EV_GLOB_NONE;
+  }
+  if(g->state_count == dfa->capacity) {
+    u32 capacity = dfa->capacity ? 2 * dfa->capacity : 16;
+    u64 *keys = realloc(dfa->keys, (u64)capacity * key_words * sizeof(u64));
+    if(keys) {
+      dfa->keys = keys;
+    }
+    u32 *transitions = realloc(dfa->transitions, (u64)capacity * g->class_count * sizeof(u32));
+    if(transitions) {
+      dfa->transitions = transitions;
+    }
+    if(!keys || !transitions) {
+      return __EV_GLOB_NONE;
+    }
+    dfa->capacity = capacity;
+  }
+  u32 s = g->state_count++;
+  memcpy(dfa->keys + (u64)s * key_words, key, key_words * sizeof(u64));
+  dfa->table[slot] = s + 1;
+  return s;
+}
+
+// Builds the DFA with the subset construction. If it has too many states,
+// `g->transitions` is left NULL and the NFA is used.
+static void
+__ev_glob_buildDfa(
+  ev_glob_t *g)
+{
+  u32 words = g->words;
+  u32 key_words = words + 1;
+  u32 table_size = 1;
+  while(table_size < 2 * EV_GLOB_MAX_DFA_STATES) {
+    table_size *= 2;
+  }
+  __ev_glob_dfa dfa = {
+    .table = calloc(table_size, sizeof(u32)),
+    .table_mask = table_size - 1,
+  };
+  u64 key[__EV_GLOB_MAX_WORDS + 1];
+  u64 candidates[__EV_GLOB_MAX_WORDS];
+  u64 taken[__EV_GLOB_MAX_WORDS];
+
+  g->state_count = 0;
+  memcpy(key, g->start, words * sizeof(u64));
+  key[words] = g->start_accept;
+  bool ok = dfa.table && __ev_glob_state(g, &dfa, key) != __EV_GLOB_NONE;
+  for(u32 s = 0; ok && s < g->state_count; s++) {
+    // Adding states moves the keys
+    memcpy(candidates, dfa.keys + (u64)s * key_words, words * sizeof(u64));
+    for(u32 k = 0; ok && k < g->class_count; k++) {
+      const u64 *accepting = g->class_positions + (u64)k * words;
+      for(u32 w = 0; w < words; w++) {
+        taken[w] = candidates[w] & accepting[w];
+      }
+      __ev_glob_followers(g->follow, taken, words, key);
+      key[words] = __ev_glob_intersects(taken, g->last, words);
+      u32 next = __ev_glob_state(g, &dfa, key);
+      ok = next != __EV_GLOB_NONE;
+      dfa.transitions[(u64)s * g->class_count + k] = next;
+    }
+  }
+
+  if(ok) {
+    g->status = malloc(g->state_count);
+    ok = g->status != NULL;
+  }
+  if(ok) {
+    for(u32 s = 0; s < g->state_count; s++) {
+      bool loops = true;
+      for(u32 k = 0; k < g->class_count; k++) {
+        loops = loops && dfa.transitions[(u64)s * g->class_count + k] == s;
+      }
+      bool accept = dfa.keys[(u64)s * key_words + words] != 0;
+      g->status[s] = (accept ? __EV_GLOB_ACCEPT : 0) | (loops ? __EV_GLOB_FINAL : 0);
+    }
+    g->transitions = dfa.transitions;
+    dfa.transitions = NULL;
+  } else {
+    g->state_count = 0;
+  }
+  free(dfa.transitions);
+  free(dfa.keys);
+  free(dfa.table);
+}
+
+ev_glob_t *
+ev_glob_compile_strview(
+  ev_strview pattern)
+{
+  u32 max_positions = pattern.len < EV_GLOB_MAX_POSITIONS ? (u32)pattern.len : EV_GLOB_MAX_POSITIONS;
+  __ev_glob_parser P = {
+    .p = (const u8 *)pattern.ptr,
+    .len = pattern.len,
+    .words = max_positions ? (max_positions + 63) / 64 : 1,
+  };
+  P.sets = malloc(((u64)max_positions + 1) * 32);
+  P.follow = calloc(((u64)max_positions + 1) * P.words, sizeof(u64));
+  P.top = malloc((pattern.len + 1) * sizeof(i32));
+  ev_glob_t *g = calloc(1, sizeof(ev_glob_t));
+  __ev_glob_frag root = { 0 };
+  if(P.sets && P.follow && P.top && g) {
+    root = __ev_glob_sequence(&P);
+  }
+  if(!root.first || P.invalid || P.oom) {
+    goto fail;
+  }
+
+  u32 words = P.words;
+  g->position_count = P.count;
+  g->words = words;
+  g->follow = P.follow;
+  P.follow = NULL;
+  g->last = malloc(words * sizeof(u64));
+  g->start = malloc(words * sizeof(u64));
+  g->class_positions = malloc(256 * words * sizeof(u64));
+  g->literals = malloc(pattern.len + 1);
+  if(!g->last || !g->start || !g->class_positions || !g->literals) {
+    goto fail;
+  }
+  memcpy(g->last, root.last, words * sizeof(u64));
+
+  // Bytes that are accepted by the same positions share a class
+  for(u32 b = 0; b < 256; b++) {
+    u64 *positions = g->class_positions + (u64)g->class_count * words;
+    memset(positions, 0, words * sizeof(u64));
+    for(u32 pos = 0; pos < P.count; pos++) {
+      if(P.sets[pos][b / 8] & (1u << (b % 8))) {
+        positions[pos / 64] |= 1ull << (pos % 64);
+      }
+    }
+    u32 k = 0;
+    while(k < g->class_count && memcmp(g->class_positions + (u64)k * words, positions, words * sizeof(u64)) != 0) {
+      k++;
+    }
+    g->classes[b] = (u8)k;
+    g->class_count += k == g->class_count;
+  }
+
+  // Literal runs of the top level: the first one is the prefix if it starts
+  // the pattern, the last one is the suffix if it ends it, and the longest of
+  // the others is the needle
+  u64 prefix_end = 0;
+  while(prefix_end < P.top_count && P.top[prefix_end] >= 0) {
+    prefix_end++;
+  }
+  u64 suffix_start = P.top_count;
+  while(suffix_start > prefix_end && P.top[suffix_start - 1] >= 0) {
+    suffix_start--;
+  }
+  u64 needle_start = 0;
+  for(u64 i = prefix_end; i < suffix_start;) {
+    u64 run = i;
+    while(run < suffix_start && P.top[run] >= 0) {
+      run++;
+    }
+    if(run - i > g->needle_len) {
+      needle_start = i;
+      g->needle_len = run - i;
+    }
+    i = run + (run == i);
+  }
+  if(g->needle_len < 2) {
+    g->needle_len = 0;
+  }
+  g->prefix_len = prefix_end;
+  g->suffix_len = P.top_count - suffix_start;
+  char *out = g->literals;
+  for(u64 i = 0; i < prefix_end; i++) {
+    *out++ = (char)P.top[i];
+  }
+  for(u64 i = suffix_start; i < P.top_count; i++) {
+    *out++ = (char)P.top[i];
+  }
+  for(u64 i = 0; i < g->needle_len; i++) {
+    *out++ = (char)P.top[needle_start + i];
+  }
+
+  // The prefix is run through the automaton once, here
+  u64 taken[__EV_GLOB_MAX_WORDS];
+  memcpy(g->start, root.first, words * sizeof(u64));
+  g->start_accept = root.nullable;
+  for(u64 i = 0; i < g->prefix_len; i++) {
+    const u64 *accepting = g->class_positions + (u64)g->classes[(u8)g->literals[i]] * words;
+    for(u32 w = 0; w < words; w++) {
+      taken[w] = g->start[w] & accepting[w];
+    }
+    __ev_glob_followers(g->follow, taken, words, g->start);
+    g->start_accept = __ev_glob_intersects(taken, g->last, words);
+  }
+
+  __ev_glob_buildDfa(g);
+
+  free(root.first);
+  free(P.sets);
+  free(P.top);
+  return g;
+
+fail:
+  free(root.first);
+  free(P.sets);
+  free(P.follow);
+  free(P.top);
+  ev_glob_fini(g);
+  return NULL;
+}
+
+ev_glob_t *
+ev_glob_compile_view(
+  evstring_view pattern)
+{
+  return ev_glob_compile_strview(evstring_view_toStrview(pattern));
+}
+
+ev_glob_t *
+ev_glob_compile_str(
+  const char *pattern)
+{
+  return ev_glob_compile_strview(ev_strview_fromStr(pattern));
+}
+
+void
+ev_glob_fini(
+  ev_glob_t *g)
+{
+  if(!g) {
+    return;
+  }
+  free(g->literals);
+  free(g->transitions);
+  free(g->status);
+  free(g->follow);
+  free(g->class_positions);
+  free(g->last);
+  free(g->start);
+  free(g);
+}
+
+// Runs `len` bytes through the NFA, from the state after the prefix
+static bool
+__ev_glob_matchNfa(
+  const ev_glob_t *g,
+  const u8 *data,
+  u64 len)
+{
+  u32 words = g->words;
+  u64 candidates[__EV_GLOB_MAX_WORDS];
+  u64 taken[__EV_GLOB_MAX_WORDS];
+  memcpy(candidates, g->start, words * sizeof(u64));
+  bool accept = g->start_accept;
+  for(u64 i = 0; i < len; i++) {
+    const u64 *accepting = g->class_positions + (u64)g->classes[data[i]] * words;
+    u64 any = 0;
+    for(u32 w = 0; w < words; w++) {
+      taken[w] = candidates[w] & accepting[w];
+      any |= taken[w];
+    }
+    if(!any) {
+      return false;
+    }
+    __ev_glob_followers(g->follow, taken, words, candidates);
+    accept = __ev_glob_intersects(taken, g->last, words);
+  }
+  return accept;
+}
+
+bool
+ev_glob_match_strview(
+  const ev_glob_t *g,
+  ev_strview text)
+{
+  if(text.len < g->prefix_len + g->suffix_len + g->needle_len) {
+    return false;
+  }
+  const char *suffix = g->literals + g->prefix_len;
+  if((g->prefix_len && memcmp(text.ptr, g->literals, g->prefix_len) != 0) ||
+     (g->suffix_len && memcmp(text.ptr + text.len - g->suffix_len, suffix, g->suffix_len) != 0)) {
+    return false;
+  }
+  if(g->needle_len) {
+    ev_strview between = ev_strview_from(text.ptr + g->prefix_len, text.len - g->prefix_len - g->suffix_len);
+    ev_strview needle = ev_strview_from(suffix + g->suffix_len, g->needle_len);
+    if(ev_strview_find(between, needle) == EV_STR_NPOS) {
+      return false;
+    }
+  }
+
+  const u8 *data = (const u8 *)text.ptr + g->prefix_len;
+  u64 len = text.len - g->prefix_len;
+  if(!g->transitions) {
+    return __ev_glob_matchNfa(g, data, len);
+  }
+  const u32 *trans = g->transitions;
+  const u8 *classes = g->classes;
+  const u64 class_count = g->class_count;
+  u32 s = 0;
+  for(u64 i = 0; i < len && !(g->status[s] & __EV_GLOB_FINAL); i++) {
+    s = trans[s * class_count + classes[data[i]]];
+  }
+  return g->status[s] & __EV_GLOB_ACCEPT;
+}
+
+bool
+ev_glob_match_view(
+  const ev_glob_t *g,
+  evstring_view text)
+{
+  return ev_glob_match_strview(g, evstring_view_toStrview(text));
+}
+
+bool
+ev_glob_match_str(
+  const ev_glob_t *g,
+  const char *text)
+{
+  return ev_glob_match_strview(g, ev_strview_fromStr(text));
+}
+
+bool
+ev_glob_match_evstring(
+  const ev_glob_t *g,
+  const evstring text)
+{
+  return ev_glob_match_strview(g, evstring_toStrview(text));
+}
+
+#endif
+
+#endif
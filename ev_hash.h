@@ -1,6 +1,7 @@
 #ifndef EV_HEADERS_HASH_H
 #define EV_HEADERS_HASH_H
 
+#include "ev_macros.h"
 #include "ev_internal.h"
 
 /*!
@@ -8,9 +9,17 @@
  */
 u64 ev_hash_murmur3(const void *data, u32 len, u64 seed);
 
+/*!
+ * \brief MurmurHash3 x64 128-bit version. Writes both 64-bit halves of the
+ * hash to `out`, which must have room for two `u64`s.
+ */
+void MurmurHash3_x64_128(const void *key, const u32 len, const u32 seed, void *out);
+
 #ifdef EV_HASH_IMPLEMENTATION
 #undef EV_HASH_IMPLEMENTATION
 
+#include <string.h>
+
 //-----------------------------------------------------------------------------
 // MurmurHash3 was written by Austin Appleby, and is placed in the public
 // domain. The author hereby disclaims copyright to this source code.
@@ -51,7 +60,10 @@ static inline u64 rotl64 ( u64 x, i8 r )
 
 EV_FORCEINLINE u64 getblock64 ( const u64 * p, u32 i )
 {
-  return p[i];
+  // Keys can start at any byte, e.g. inside a string table
+  u64 block;
+  memcpy(&block, (const u8 *)p + i * sizeof(u64), sizeof(block));
+  return block;
 }
 
 //-----------------------------------------------------------------------------
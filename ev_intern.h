@@ -0,0 +1,514 @@
+/*!
+ * \file ev_intern.h
+ * \brief String interning table that maps strings to stable 32-bit IDs
+ */
+#ifndef EV_INTERN_HEADER
+#define EV_INTERN_HEADER
+
+#include "ev_str.h"
+
+#if defined(EV_INTERN_SHARED)
+# if defined (EV_INTERN_IMPL)
+#  define EV_INTERN_API EV_EXPORT
+# else
+#  define EV_INTERN_API EV_IMPORT
+# endif
+#else
+# define EV_INTERN_API
+#endif
+
+#ifndef EV_INTERN_SHARD_BITS
+/*!
+ * \brief log2 of the number of independently locked shards in a table
+ */
+#define EV_INTERN_SHARD_BITS 4
+#endif
+
+#ifndef EV_INTERN_BLOCK_SIZE
+/*!
+ * \brief Size of the blocks that interned characters are stored in
+ */
+#define EV_INTERN_BLOCK_SIZE (64 * 1024)
+#endif
+
+#ifndef EV_INTERN_HASH_SEED
+/*!
+ * \brief Seed of the hashes that are stored with interned strings. Matches
+ * `EV_STR_HASH_SEED` by default, which lets the canonical strings be created
+ * with their hash already cached.
+ */
+#define EV_INTERN_HASH_SEED EV_STR_HASH_SEED
+#endif
+
+//! ID that is never assigned to an interned string
+#define EV_INTERN_INVALID_ID (~0u)
+
+typedef struct ev_intern_t ev_intern_t;
+
+/*!
+ * \brief Interns a `const char *` or an `evstring_view`
+ * \details Sample usage:
+ * ```
+ * u32 a = ev_intern(table, "Transform");
+ * u32 b = ev_intern(table, evstring_slice(name, 0, -1));
+ * if(a == b) { ... }
+ * ```
+ */
+#define ev_intern(t, str) _Generic((str), \
+        evstring_view: ev_intern_view, \
+        default: ev_intern_str \
+        )(t, str)
+
+/*!
+ * \returns A new, empty interning table. NULL on OOM.
+ */
+EV_INTERN_API ev_intern_t *
+ev_intern_init(void);
+
+/*!
+ * \brief Frees the table along with every interned string. Strings returned
+ * by `ev_intern_get` are invalid after this call.
+ */
+EV_INTERN_API void
+ev_intern_fini(
+  ev_intern_t *t);
+
+/*!
+ * \brief Returns the ID of `len` bytes at `data`, interning a copy of them if
+ * they were not seen before. Safe to call from multiple threads.
+ *
+ * \returns A stable ID, or `EV_INTERN_INVALID_ID` on OOM.
+ */
+EV_INTERN_API u32
+ev_intern_impl(
+  ev_intern_t *t,
+  const char *data,
+  u64 len);
+
+EV_INTERN_API u32
+ev_intern_str(
+  ev_intern_t *t,
+  const char *str);
+
+EV_INTERN_API u32
+ev_intern_view(
+  ev_intern_t *t,
+  evstring_view v);
+
+/*!
+ * \brief Looks up a string without interning it.
+ *
+ * \returns The string's ID, or `EV_INTERN_INVALID_ID` if it was never interned.
+ */
+EV_INTERN_API u32
+ev_intern_find(
+  ev_intern_t *t,
+  const char *data,
+  u64 len);
+
+/*!
+ * \brief Returns the canonical string of an ID. The string must not be
+ * modified or freed; it lives as long as the table. This call takes no lock.
+ */
+EV_INTERN_API evstring
+ev_intern_get(
+  ev_intern_t *t,
+  u32 id);
+
+/*!
+ * \returns The hash that was computed for the string when it was interned
+ */
+EV_INTERN_API u64
+ev_intern_hash(
+  ev_intern_t *t,
+  u32 id);
+
+/*!
+ * \returns Number of strings in the table
+ */
+EV_INTERN_API u64
+ev_intern_count(
+  ev_intern_t *t);
+
+#ifdef EV_INTERN_IMPLEMENTATION
+#undef EV_INTERN_IMPLEMENTATION
+
+#include "ev_sync.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define __EV_INTERN_SHARD_COUNT (1u << EV_INTERN_SHARD_BITS)
+#define __EV_INTERN_SHARD_MASK (__EV_INTERN_SHARD_COUNT - 1)
+// IDs store the shard in their low bits, and the index within the shard in
+// the remaining ones.
+#define __EV_INTERN_MAX_INDEX (EV_INTERN_INVALID_ID >> EV_INTERN_SHARD_BITS)
+
+// Entry pages grow geometrically so that they never have to move, which is
+// what allows `ev_intern_get` to skip locking.
+#define __EV_INTERN_PAGE_BASE_BITS 8
+#define __EV_INTERN_MAX_PAGES (32 - EV_INTERN_SHARD_BITS - __EV_INTERN_PAGE_BASE_BITS + 1)
+#define __EV_INTERN_INIT_TABLE_CAP 64
+
+struct __ev_intern_block_t {
+  struct __ev_intern_block_t *next;
+  u64 used;
+  u64 size;
+  EV_ALIGNAS(8) u8 data[];
+};
+
+struct __ev_intern_entry_t {
+  u64 hash;
+  evstring str;
+};
+
+struct __ev_intern_slot_t {
+  u64 hash;
+  u32 index;
+};
+
+struct __ev_intern_shard_t {
+  ev_rwlock_t lock;
+
+  u64 count;
+  struct __ev_intern_entry_t *pages[__EV_INTERN_MAX_PAGES];
+
+  // Open-addressing table of indices into `pages`
+  struct __ev_intern_slot_t *table;
+  u64 table_cap;
+
+  struct __ev_intern_block_t *blocks;
+};
+
+struct ev_intern_t {
+  struct __ev_intern_shard_t shards[__EV_INTERN_SHARD_COUNT];
+};
+
+static inline u32
+__ev_intern_log2(
+  u64 x)
+{
+#if EV_CC_MSVC
+  unsigned long idx;
+  _BitScanReverse64(&idx, x);
+  return (u32)idx;
+#else
+  return 63 - (u32)__builtin_clzll(x);
+#endif
+}
+
+static inline struct __ev_intern_entry_t *
+__ev_intern_entry(
+  struct __ev_intern_shard_t *shard,
+  u64 index)
+{
+  u32 page = __ev_intern_log2((index >> __EV_INTERN_PAGE_BASE_BITS) + 1);
+  u64 page_begin = ((1ull << page) - 1) << __EV_INTERN_PAGE_BASE_BITS;
+  return &shard->pages[page][index - page_begin];
+}
+
+static inline struct __ev_intern_shard_t *
+__ev_intern_shard(
+  ev_intern_t *t,
+  u64 hash)
+{
+  return &t->shards[(hash >> (64 - EV_INTERN_SHARD_BITS)) & __EV_INTERN_SHARD_MASK];
+}
+
+// Must be called with at least a read lock on the shard
+static u32
+__ev_intern_lookup(
+  struct __ev_intern_shard_t *shard,
+  const char *data,
+  u64 len,
+  u64 hash)
+{
+  u64 mask = shard->table_cap - 1;
+  for(u64 i = hash & mask;; i = (i + 1) & mask) {
+    struct __ev_intern_slot_t *slot = &shard->table[i];
+    if(slot->index == EV_INTERN_INVALID_ID) {
+      return EV_INTERN_INVALID_ID;
+    }
+    if(slot->hash == hash) {
+      evstring s = __ev_intern_entry(shard, slot->index)->str;
+      if(evstring_getLength(s) == len && memcmp(s, data, len) == 0) {
+        return slot->index;
+      }
+    }
+  }
+}
+
+static bool
+__ev_intern_table_grow(
+  struct __ev_intern_shard_t *shard)
+{
+  u64 new_cap = shard->table_cap ? shard->table_cap * 2 : __EV_INTERN_INIT_TABLE_CAP;
+  struct __ev_intern_slot_t *new_table = malloc(new_cap * sizeof(struct __ev_intern_slot_t));
+  if(!new_table) {
+    return false;
+  }
+  for(u64 i = 0; i < new_cap; i++) {
+    new_table[i].index = EV_INTERN_INVALID_ID;
+  }
+
+  u64 mask = new_cap - 1;
+  for(u64 i = 0; i < shard->table_cap; i++) {
+    struct __ev_intern_slot_t slot = shard->table[i];
+    if(slot.index != EV_INTERN_INVALID_ID) {
+      u64 j = slot.hash & mask;
+      while(new_table[j].index != EV_INTERN_INVALID_ID) {
+        j = (j + 1) & mask;
+      }
+      new_table[j] = slot;
+    }
+  }
+
+  free(shard->table);
+  shard->table = new_table;
+  shard->table_cap = new_cap;
+  return true;
+}
+
+// Copies the string into the shard's current block, preceded by an evstring
+// header. The header is marked as stack-allocated so that evstring functions
+// never try to resize or free it.
+static evstring
+__ev_intern_store(
+  struct __ev_intern_shard_t *shard,
+  const char *data,
+  u64 len,
+  u64 hash)
+{
+  u64 needed = (sizeof(struct evstr_meta_t) + len + 1 + 7) & ~7ull;
+  struct __ev_intern_block_t *block = shard->blocks;
+
+  if(!block || block->used + needed > block->size) {
+    u64 block_size = EV_INTERN_BLOCK_SIZE - sizeof(struct __ev_intern_block_t);
+    if(needed > block_size / 4) {
+      // Large strings get a block of their own, so that the current block's
+      // free space is not wasted.
+      block_size = needed;
+    }
+    struct __ev_intern_block_t *new_block = malloc(sizeof(struct __ev_intern_block_t) + block_size);
+    if(!new_block) {
+      return NULL;
+    }
+    new_block->used = 0;
+    new_block->size = block_size;
+    if(block && block_size == needed) {
+      new_block->next = block->next;
+      block->next = new_block;
+    } else {
+      new_block->next = block;
+      shard->blocks = new_block;
+    }
+    block = new_block;
+  }
+
+  struct evstr_meta_t *meta = (struct evstr_meta_t *)(block->data + block->used);
+  block->used += needed;
+  *meta = (struct evstr_meta_t) {
+    EV_DEBUG(.magic = EV_STR_evstring_MAGIC,)
+    .length = len,
+    .size = sizeof(struct evstr_meta_t) + len + 1,
+    .allocationType = EV_STR_ALLOCATION_TYPE_STACK,
+  };
+#if EV_STR_CACHE_HASH
+  if(EV_INTERN_HASH_SEED == EV_STR_HASH_SEED) {
+    meta->hash = hash;
+    meta->hashValid = true;
+  }
+#endif
+
+  evstring s = (evstring)(meta + 1);
+  memcpy(s, data, len);
+  s[len] = '\0';
+  return s;
+}
+
+// Must be called with a write lock on the shard
+static u32
+__ev_intern_insert(
+  struct __ev_intern_shard_t *shard,
+  const char *data,
+  u64 len,
+  u64 hash)
+{
+  if(shard->count >= __EV_INTERN_MAX_INDEX) {
+    return EV_INTERN_INVALID_ID;
+  }
+  if((shard->count + 1) * 4 > shard->table_cap * 3) {
+    if(!__ev_intern_table_grow(shard)) {
+      return EV_INTERN_INVALID_ID;
+    }
+  }
+
+  u64 index = shard->count;
+  u32 page = __ev_intern_log2((index >> __EV_INTERN_PAGE_BASE_BITS) + 1);
+  if(!shard->pages[page]) {
+    shard->pages[page] = malloc((sizeof(struct __ev_intern_entry_t) << __EV_INTERN_PAGE_BASE_BITS) << page);
+    if(!shard->pages[page]) {
+      return EV_INTERN_INVALID_ID;
+    }
+  }
+
+  evstring s = __ev_intern_store(shard, data, len, hash);
+  if(!s) {
+    return EV_INTERN_INVALID_ID;
+  }
+  *__ev_intern_entry(shard, index) = (struct __ev_intern_entry_t) {
+    .hash = hash,
+    .str = s
+  };
+
+  u64 mask = shard->table_cap - 1;
+  u64 i = hash & mask;
+  while(shard->table[i].index != EV_INTERN_INVALID_ID) {
+    i = (i + 1) & mask;
+  }
+  shard->table[i] = (struct __ev_intern_slot_t) {
+    .hash = hash,
+    .index = (u32)index
+  };
+  shard->count++;
+
+  return (u32)index;
+}
+
+ev_intern_t *
+ev_intern_init(void)
+{
+  ev_intern_t *t = calloc(1, sizeof(ev_intern_t));
+  if(!t) {
+    return NULL;
+  }
+  for(u32 i = 0; i < __EV_INTERN_SHARD_COUNT; i++) {
+    ev_rwlock_init(&t->shards[i].lock);
+    if(!__ev_intern_table_grow(&t->shards[i])) {
+      ev_intern_fini(t);
+      return NULL;
+    }
+  }
+  return t;
+}
+
+void
+ev_intern_fini(
+  ev_intern_t *t)
+{
+  for(u32 i = 0; i < __EV_INTERN_SHARD_COUNT; i++) {
+    struct __ev_intern_shard_t *shard = &t->shards[i];
+    for(u32 p = 0; p < __EV_INTERN_MAX_PAGES; p++) {
+      free(shard->pages[p]);
+    }
+    for(struct __ev_intern_block_t *b = shard->blocks; b;) {
+      struct __ev_intern_block_t *next = b->next;
+      free(b);
+      b = next;
+    }
+    free(shard->table);
+    ev_rwlock_fini(&shard->lock);
+  }
+  free(t);
+}
+
+u32
+ev_intern_impl(
+  ev_intern_t *t,
+  const char *data,
+  u64 len)
+{
+  u64 hash = ev_hash_murmur3(data, (u32)len, EV_INTERN_HASH_SEED);
+  struct __ev_intern_shard_t *shard = __ev_intern_shard(t, hash);
+  u32 shard_idx = (u32)(shard - t->shards);
+
+  ev_rwlock_read_lock(&shard->lock);
+  u32 index = __ev_intern_lookup(shard, data, len, hash);
+  ev_rwlock_read_unlock(&shard->lock);
+
+  if(index == EV_INTERN_INVALID_ID) {
+    ev_rwlock_write_lock(&shard->lock);
+    // Another thread might have inserted it between the two locks
+    index = __ev_intern_lookup(shard, data, len, hash);
+    if(index == EV_INTERN_INVALID_ID) {
+      index = __ev_intern_insert(shard, data, len, hash);
+    }
+    ev_rwlock_write_unlock(&shard->lock);
+    if(index == EV_INTERN_INVALID_ID) {
+      return EV_INTERN_INVALID_ID;
+    }
+  }
+
+  return (index << EV_INTERN_SHARD_BITS) | shard_idx;
+}
+
+u32
+ev_intern_str(
+  ev_intern_t *t,
+  const char *str)
+{
+  return ev_intern_impl(t, str, strlen(str));
+}
+
+u32
+ev_intern_view(
+  ev_intern_t *t,
+  evstring_view v)
+{
+  return ev_intern_impl(t, v.data + v.offset, v.len);
+}
+
+u32
+ev_intern_find(
+  ev_intern_t *t,
+  const char *data,
+  u64 len)
+{
+  u64 hash = ev_hash_murmur3(data, (u32)len, EV_INTERN_HASH_SEED);
+  struct __ev_intern_shard_t *shard = __ev_intern_shard(t, hash);
+
+  ev_rwlock_read_lock(&shard->lock);
+  u32 index = __ev_intern_lookup(shard, data, len, hash);
+  ev_rwlock_read_unlock(&shard->lock);
+
+  if(index == EV_INTERN_INVALID_ID) {
+    return EV_INTERN_INVALID_ID;
+  }
+  return (index << EV_INTERN_SHARD_BITS) | (u32)(shard - t->shards);
+}
+
+evstring
+ev_intern_get(
+  ev_intern_t *t,
+  u32 id)
+{
+  assert(id != EV_INTERN_INVALID_ID);
+  return __ev_intern_entry(&t->shards[id & __EV_INTERN_SHARD_MASK], id >> EV_INTERN_SHARD_BITS)->str;
+}
+
+u64
+ev_intern_hash(
+  ev_intern_t *t,
+  u32 id)
+{
+  assert(id != EV_INTERN_INVALID_ID);
+  return __ev_intern_entry(&t->shards[id & __EV_INTERN_SHARD_MASK], id >> EV_INTERN_SHARD_BITS)->hash;
+}
+
+u64
+ev_intern_count(
+  ev_intern_t *t)
+{
+  u64 count = 0;
+  for(u32 i = 0; i < __EV_INTERN_SHARD_COUNT; i++) {
+    ev_rwlock_read_lock(&t->shards[i].lock);
+    count += t->shards[i].count;
+    ev_rwlock_read_unlock(&t->shards[i].lock);
+  }
+  return count;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,1436 @@
+/*!
+ * \file ev_json.h
+ * \brief JSON parser that does not copy: strings and numbers are
+ * `evstring_view`s into the parsed evstring, and escapes are only decoded
+ * when a string is read. A document can be parsed into a tape, or read token
+ * by token with an iterator that keeps no state proportional to its size.
+ */
+#ifndef EV_JSON_HEADER
+#define EV_JSON_HEADER
+
+#include "ev_str.h"
+
+#if defined(EV_JSON_SHARED)
+# if defined (EV_JSON_IMPL)
+#  define EV_JSON_API EV_EXPORT
+# else
+#  define EV_JSON_API EV_IMPORT
+# endif
+#else
+# define EV_JSON_API
+#endif
+
+#ifndef EV_JSON_MAX_DEPTH
+/*!
+ * \brief Deepest nesting of arrays and objects that a document can have
+ */
+#define EV_JSON_MAX_DEPTH 1024
+#endif
+
+typedef enum {
+  EV_JSON_INVALID = 0,
+  EV_JSON_NULL,
+  EV_JSON_FALSE,
+  EV_JSON_TRUE,
+  EV_JSON_NUMBER,
+  EV_JSON_STRING,
+  EV_JSON_ARRAY,
+  EV_JSON_OBJECT,
+  //! The key of an object member, which is followed by its value
+  EV_JSON_KEY,
+  //! The end of an array or an object
+  EV_JSON_END,
+} ev_json_type;
+
+// Number of positions that the structural index buffers, plus room for one
+// more block
+#define __EV_JSON_INDEX_CAPACITY (512 + 64)
+
+// Finds the structural characters of a document 64 bytes at a time: brackets,
+// colons and commas outside of strings, the quotes around strings, and the
+// first character of other values. The positions are produced in batches
+// into a fixed buffer, so that indexing never needs more memory.
+typedef struct {
+  const u8 *src;
+  u64 len;
+  //! Offset of the next block to index
+  u64 block;
+  //! All ones if the previous block ended inside a string
+  u64 prev_in_string;
+  //! 1 if the previous block ended with an odd number of backslashes
+  u64 prev_odd_backslash;
+  //! 1 if the previous block ended inside a number or literal
+  u64 prev_scalar;
+  //! Set when a string contains a control character, at `error_offset`
+  bool failed;
+  u64 error_offset;
+  u32 pos;
+  u32 count;
+  u64 positions[__EV_JSON_INDEX_CAPACITY];
+} __ev_json_index;
+
+/*!
+ * \brief Forward-only reader of a document, one token at a time. It does not
+ * allocate: its memory does not depend on the size of the document, which
+ * makes it the way to read documents too large for `ev_json_parse`.
+ *
+ * \details Sample usage:
+ * ```
+ * ev_json_iter it;
+ * ev_json_iter_init(&it, scene);
+ * ev_json_token tok;
+ * while(ev_json_iter_next(&it, &tok)) {
+ *   if(tok.type == EV_JSON_KEY && ev_json_keyEquals(tok.view, "meshes")) {
+ *     ev_json_iter_next(&it, &tok);
+ *     ev_json_iter_skip(&it);
+ *   }
+ * }
+ * if(it.error != EV_STR_ERR_NONE) { ... }
+ * ```
+ */
+typedef struct {
+  evstring json;
+  __ev_json_index index;
+  u32 depth;
+  u32 state;
+  //! Set if `ev_json_iter_next` returned false because of an error
+  evstring_error_t error;
+  //! Offset in the document of the error
+  u64 error_offset;
+  //! Whether each open container is an object
+  u8 stack[EV_JSON_MAX_DEPTH];
+} ev_json_iter;
+
+typedef struct {
+  ev_json_type type;
+  //! The text of the token: the bytes between the quotes of strings and keys,
+  //! with their escapes still encoded, numbers and literals as written, and
+  //! the bracket of arrays, objects and ends
+  evstring_view view;
+  //! Number of arrays and objects that the token is in
+  u32 depth;
+} ev_json_token;
+
+typedef struct {
+  u64 offset;
+  //! Length of scalars, index of the end of arrays and objects, element or
+  //! member count of ends
+  u32 value;
+  u32 type;
+} __ev_json_node;
+
+/*!
+ * \brief A parsed document: the tokens of the document in order, with each
+ * array and object linked to its end. `json` has to outlive it. Zero
+ * initialize it before its first parse; it can be parsed into again to reuse
+ * its memory.
+ */
+typedef struct {
+  evstring json;
+  __ev_json_node *nodes;
+  u32 node_count;
+  u32 node_capacity;
+  //! Offset in the document of the error that `ev_json_parse` returned
+  u64 error_offset;
+} ev_json_doc;
+
+/*!
+ * \brief A value of a document. Accessing a value that does not exist, like
+ * a missing member, returns a value of type `EV_JSON_INVALID`, which every
+ * function accepts.
+ */
+typedef struct {
+  const ev_json_doc *doc;
+  u32 index;
+} ev_json_value;
+
+/*!
+ * \brief Parses a document. Escapes, the UTF-8 of strings and numbers beyond
+ * their syntax are not checked until they are read.
+ *
+ * \details Sample usage:
+ * ```
+ * evstring text = evstring_readFile(path);
+ * ev_json_doc doc = {0};
+ * if(ev_json_parse(text, &doc) == EV_STR_ERR_NONE) {
+ *   ev_json_value entities = ev_json_get(ev_json_root(&doc), "entities");
+ *   for(ev_json_value e = ev_json_first(entities); ev_json_getType(e); e = ev_json_next(e)) {
+ *     ...
+ *   }
+ * }
+ * ev_json_fini(&doc);
+ * ```
+ *
+ * \returns `EV_STR_ERR_PARSE` if the document is not valid JSON,
+ * `EV_STR_ERR_RANGE` if it is nested deeper than `EV_JSON_MAX_DEPTH` or has a
+ * string of 4GiB or more, or `EV_STR_ERR_OOM`. `doc->error_offset` is then
+ * set to where the error was found.
+ */
+EV_JSON_API evstring_error_t
+ev_json_parse(
+  const evstring json,
+  ev_json_doc *doc);
+
+EV_JSON_API void
+ev_json_fini(
+  ev_json_doc *doc);
+
+EV_JSON_API ev_json_value
+ev_json_root(
+  const ev_json_doc *doc);
+
+EV_JSON_API ev_json_type
+ev_json_getType(
+  ev_json_value v);
+
+/*!
+ * \returns The text of a value: the bytes between the quotes of a string,
+ * escapes included, a number or literal as written, or an array or object
+ * from its opening to its closing bracket
+ */
+EV_JSON_API evstring_view
+ev_json_getView(
+  ev_json_value v);
+
+/*!
+ * \returns The number of elements of an array or members of an object, 0 for
+ * other values
+ */
+EV_JSON_API u32
+ev_json_getCount(
+  ev_json_value v);
+
+/*!
+ * \returns The first element of an array or value of the first member of an
+ * object
+ */
+EV_JSON_API ev_json_value
+ev_json_first(
+  ev_json_value v);
+
+/*!
+ * \returns The element or member value after `v` in its array or object
+ */
+EV_JSON_API ev_json_value
+ev_json_next(
+  ev_json_value v);
+
+/*!
+ * \returns The element at `i` of an array, or the value of the member at `i`
+ * of an object. This is linear in `i`: use `ev_json_first` and
+ * `ev_json_next` to go through all of them.
+ */
+EV_JSON_API ev_json_value
+ev_json_at(
+  ev_json_value v,
+  u32 i);
+
+/*!
+ * \returns The key of an object member, given its value, with its escapes
+ * still encoded. The view is empty if `v` is not a member value.
+ */
+EV_JSON_API evstring_view
+ev_json_getKey(
+  ev_json_value v);
+
+/*!
+ * \brief Finds an object member by key. The key is compared to the decoded
+ * member keys.
+ */
+#define ev_json_get(v, key) _Generic((key), \
+        evstring_view: ev_json_get_view, \
+        ev_strview: ev_json_get_strview, \
+        default: ev_json_get_str \
+        )(v, key)
+
+EV_JSON_API ev_json_value
+ev_json_get_strview(
+  ev_json_value v,
+  ev_strview key);
+
+EV_JSON_API ev_json_value
+ev_json_get_view(
+  ev_json_value v,
+  evstring_view key);
+
+EV_JSON_API ev_json_value
+ev_json_get_str(
+  ev_json_value v,
+  const char *key);
+
+/*!
+ * \brief Decodes a string and appends it to `out`
+ *
+ * \returns `EV_STR_ERR_PARSE` if `v` is not a string or has an invalid
+ * escape, in which case `out` is left unchanged
+ */
+EV_JSON_API evstring_error_t
+ev_json_getString(
+  ev_json_value v,
+  evstring *out);
+
+/*!
+ * \returns `EV_STR_ERR_PARSE` if `v` is not a number or not an integer, or
+ * `EV_STR_ERR_RANGE` if it does not fit
+ */
+EV_JSON_API evstring_error_t
+ev_json_getI64(
+  ev_json_value v,
+  i64 *out);
+
+EV_JSON_API evstring_error_t
+ev_json_getU64(
+  ev_json_value v,
+  u64 *out);
+
+/*!
+ * \returns `EV_STR_ERR_PARSE` if `v` is not a number
+ */
+EV_JSON_API evstring_error_t
+ev_json_getF64(
+  ev_json_value v,
+  f64 *out);
+
+/*!
+ * \returns `EV_STR_ERR_PARSE` if `v` is not `true` or `false`
+ */
+EV_JSON_API evstring_error_t
+ev_json_getBool(
+  ev_json_value v,
+  bool *out);
+
+/*!
+ * \brief Decodes the escapes of the text of a string or key, as found in
+ * `ev_json_token::view` or returned by `ev_json_getView`, and appends the
+ * result to `out`. Escaped UTF-16 surrogate pairs are decoded to a single
+ * UTF-8 sequence.
+ *
+ * \returns `EV_STR_ERR_PARSE` if an escape is not valid, in which case `out`
+ * is left unchanged
+ */
+EV_JSON_API evstring_error_t
+ev_json_unescape(
+  evstring *out,
+  evstring_view raw);
+
+/*!
+ * \brief Compares the text of a string or key, as in `ev_json_unescape`, to
+ * `key` without decoding it into a buffer
+ */
+#define ev_json_keyEquals(raw, key) _Generic((key), \
+        ev_strview: ev_json_keyEquals_strview, \
+        default: ev_json_keyEquals_str \
+        )(raw, key)
+
+EV_JSON_API bool
+ev_json_keyEquals_strview(
+  evstring_view raw,
+  ev_strview key);
+
+EV_JSON_API bool
+ev_json_keyEquals_str(
+  evstring_view raw,
+  const char *key);
+
+EV_JSON_API void
+ev_json_iter_init(
+  ev_json_iter *it,
+  const evstring json);
+
+/*!
+ * \brief Reads the next token. Strings and numbers are validated as in
+ * `ev_json_parse`, and an object key is always followed by its value.
+ *
+ * \returns false once the document has been read, or on an error, in which
+ * case `it->error` and `it->error_offset` are set
+ */
+EV_JSON_API bool
+ev_json_iter_next(
+  ev_json_iter *it,
+  ev_json_token *tok);
+
+/*!
+ * \brief Skips the rest of the innermost open array or object, its end
+ * included, so that the next token is the one after it. The skipped tokens
+ * are only checked for balanced brackets, which makes skipping much faster
+ * than reading.
+ *
+ * \returns false if there is no open array or object, or on an error
+ */
+EV_JSON_API bool
+ev_json_iter_skip(
+  ev_json_iter *it);
+
+#ifdef EV_JSON_IMPLEMENTATION
+#undef EV_JSON_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+
+#if EV_SIMD_AVX2
+#include <immintrin.h>
+#elif EV_SIMD_SSSE3
+#include <tmmintrin.h>
+#elif EV_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#if EV_CC_MSVC
+#include <intrin.h>
+#endif
+
+// Byte classes
+#define __EV_JSON_QUOTE     (1 << 0)
+#define __EV_JSON_BACKSLASH (1 << 1)
+#define __EV_JSON_OP        (1 << 2)
+#define __EV_JSON_WS        (1 << 3)
+#define __EV_JSON_CTRL      (1 << 4)
+
+static const u8 __ev_json_classes[256] = {
+  0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x18, 0x18, 0x10, 0x10, 0x18, 0x10, 0x10,
+  0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+  0x08, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x02, 0x04, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x04, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+// Iterator states: what the next structural character can be
+#define __EV_JSON_VALUE        0
+#define __EV_JSON_VALUE_OR_END 1
+#define __EV_JSON_KEY          2
+#define __EV_JSON_KEY_OR_END   3
+#define __EV_JSON_COMMA_OR_END 4
+#define __EV_JSON_DONE         5
+#define __EV_JSON_FAILED       6
+
+typedef struct {
+  u64 quote;
+  u64 backslash;
+  u64 op;
+  u64 ws;
+  u64 ctrl;
+} __ev_json_masks;
+
+static inline u32
+__ev_json_ctz64(
+  u64 x)
+{
+#if EV_CC_MSVC
+  unsigned long idx;
+  _BitScanForward64(&idx, x);
+  return (u32)idx;
+#else
+  return (u32)__builtin_ctzll(x);
+#endif
+}
+
+static inline u32
+__ev_json_popcount64(
+  u64 x)
+{
+#if EV_CC_MSVC
+  return (u32)__popcnt64(x);
+#else
+  return (u32)__builtin_popcountll(x);
+#endif
+}
+
+#if EV_SIMD_AVX2
+static EV_FORCEINLINE void
+__ev_json_classify32(
+  const u8 *src,
+  u32 *quote,
+  u32 *backslash,
+  u32 *op,
+  u32 *ws,
+  u32 *ctrl)
+{
+  // A byte is whitespace if the table entry for its low nibble is the byte
+  // itself. Operators are found the same way after setting bit 5, which
+  // folds '[' and ']' onto '{' and '}'.
+  const __m256i ws_table = _mm256_setr_epi8(
+      ' ', 0, 0, 0, 0, 0, 0, 0, 0, '\t', '\n', 0, 0, '\r', 0, 0,
+      ' ', 0, 0, 0, 0, 0, 0, 0, 0, '\t', '\n', 0, 0, '\r', 0, 0);
+  const __m256i op_table = _mm256_setr_epi8(
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0,
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0);
+  __m256i x = _mm256_loadu_si256((const __m256i *)src);
+  __m256i folded = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+  *quote = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')));
+  *backslash = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\')));
+  *ws = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_shuffle_epi8(ws_table, x), x));
+  *op = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_shuffle_epi8(op_table, folded), folded));
+  // Unsigned `x <= 0x1F`
+  *ctrl = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(x, _mm256_set1_epi8(0x1F)), _mm256_set1_epi8(0x1F)));
+}
+#elif EV_SIMD_SSE2
+static EV_FORCEINLINE void
+__ev_json_classify16(
+  const u8 *src,
+  u32 *quote,
+  u32 *backslash,
+  u32 *op,
+  u32 *ws,
+  u32 *ctrl)
+{
+  __m128i x = _mm_loadu_si128((const __m128i *)src);
+  __m128i folded = _mm_or_si128(x, _mm_set1_epi8(0x20));
+  *quote = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')));
+  *backslash = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\\')));
+#if EV_SIMD_SSSE3
+  const __m128i ws_table = _mm_setr_epi8(' ', 0, 0, 0, 0, 0, 0, 0, 0, '\t', '\n', 0, 0, '\r', 0, 0);
+  const __m128i op_table = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0);
+  *ws = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_shuffle_epi8(ws_table, x), x));
+  *op = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_shuffle_epi8(op_table, folded), folded));
+#else
+  __m128i ws_bytes = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\t'))),
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\r'))));
+  __m128i op_bytes = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(':')), _mm_cmpeq_epi8(x, _mm_set1_epi8(','))));
+  *ws = (u32)_mm_movemask_epi8(ws_bytes);
+  *op = (u32)_mm_movemask_epi8(op_bytes);
+#endif
+  *ctrl = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(x, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F)));
+}
+#endif
+
+// Some control characters are classified as operators by the SIMD paths.
+// They are invalid outside of strings, and caught inside of them, so the
+// iterator rejects them either way.
+static EV_FORCEINLINE __ev_json_masks
+__ev_json_classify(
+  const u8 *src)
+{
+  __ev_json_masks m;
+#if EV_SIMD_AVX2
+  u32 quote0, backslash0, op0, ws0, ctrl0;
+  u32 quote1, backslash1, op1, ws1, ctrl1;
+  __ev_json_classify32(src, &quote0, &backslash0, &op0, &ws0, &ctrl0);
+  __ev_json_classify32(src + 32, &quote1, &backslash1, &op1, &ws1, &ctrl1);
+  m.quote = quote0 | (u64)quote1 << 32;
+  m.backslash = backslash0 | (u64)backslash1 << 32;
+  m.op = op0 | (u64)op1 << 32;
+  m.ws = ws0 | (u64)ws1 << 32;
+  m.ctrl = ctrl0 | (u64)ctrl1 << 32;
+#elif EV_SIMD_SSE2
+  m = (__ev_json_masks){0};
+  for(u32 i = 0; i < 4; i++) {
+    u32 quote, backslash, op, ws, ctrl;
+    __ev_json_classify16(src + i * 16, &quote, &backslash, &op, &ws, &ctrl);
+    m.quote |= (u64)quote << (i * 16);
+    m.backslash |= (u64)backslash << (i * 16);
+    m.op |= (u64)op << (i * 16);
+    m.ws |= (u64)ws << (i * 16);
+    m.ctrl |= (u64)ctrl << (i * 16);
+  }
+#else
+  m = (__ev_json_masks){0};
+  for(u32 i = 0; i < 64; i++) {
+    u64 c = __ev_json_classes[src[i]];
+    m.quote |= (c & 1) << i;
+    m.backslash |= (c >> 1 & 1) << i;
+    m.op |= (c >> 2 & 1) << i;
+    m.ws |= (c >> 3 & 1) << i;
+    m.ctrl |= (c >> 4 & 1) << i;
+  }
+#endif
+  return m;
+}
+
+// Characters escaped by a backslash: those after a run of backslashes of odd
+// length. Runs are told apart by the parity of the position they start at,
+// and ended by adding their start to them (Langdale and Lemire, "Parsing
+// Gigabytes of JSON per Second").
+static EV_FORCEINLINE u64
+__ev_json_escaped(
+  u64 backslash,
+  u64 *prev_odd_backslash)
+{
+  const u64 even_bits = 0x5555555555555555ull;
+  u64 starts = backslash & ~(backslash << 1);
+  u64 even_start_mask = even_bits ^ *prev_odd_backslash;
+  u64 even_starts = starts & even_start_mask;
+  u64 odd_starts = starts & ~even_start_mask;
+  u64 even_carries = backslash + even_starts;
+  u64 odd_carries = backslash + odd_starts;
+  u64 ends_odd = odd_carries < backslash;
+  odd_carries |= *prev_odd_backslash;
+  *prev_odd_backslash = ends_odd;
+  u64 even_carry_ends = even_carries & ~backslash;
+  u64 odd_carry_ends = odd_carries & ~backslash;
+  return (even_carry_ends & ~even_bits) | (odd_carry_ends & even_bits);
+}
+
+// Bit `i` of the result is the xor of the bits up to `i`
+static EV_FORCEINLINE u64
+__ev_json_prefixXor(
+  u64 x)
+{
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+// Writes the positions of the next 8 bits of `*bits`. Setting the top bit
+// keeps the count of trailing zeros defined once all of them are written.
+static EV_FORCEINLINE void
+__ev_json_write8(
+  u64 *out,
+  u64 *bits,
+  u64 base)
+{
+  u64 b = *bits;
+  out[0] = base + __ev_json_ctz64(b | 1ull << 63); b &= b - 1;
+  out[1] = base + __ev_json_ctz64(b | 1ull << 63); b &= b - 1;
+  out[2] = base + __ev_json_ctz64(b | 1ull << 63); b &= b - 1;
+  out[3] = base + __ev_json_ctz64(b | 1ull << 63); b &= b - 1;
+  out[4] = base + __ev_json_ctz64(b | 1ull << 63); b &= b - 1;
+  out[5] = base + __ev_json_ctz64(b | 1ull << 63); b &= b - 1;
+  out[6] = base + __ev_json_ctz64(b | 1ull << 63); b &= b - 1;
+  out[7] = base + __ev_json_ctz64(b | 1ull << 63); b &= b - 1;
+  *bits = b;
+}
+
+static EV_FORCEINLINE void
+__ev_json_indexBlock(
+  __ev_json_index *ix,
+  const u8 *block,
+  u64 base)
+{
+  __ev_json_masks m = __ev_json_classify(block);
+  u64 escaped = m.backslash | ix->prev_odd_backslash ? __ev_json_escaped(m.backslash, &ix->prev_odd_backslash) : 0;
+  u64 quote = m.quote & ~escaped;
+  // Set from each opening quote up to its closing quote, excluded
+  u64 in_string = __ev_json_prefixXor(quote) ^ ix->prev_in_string;
+  ix->prev_in_string = (u64)((i64)in_string >> 63);
+
+  u64 scalar = ~(m.op | m.ws | quote | in_string);
+  u64 follows_scalar = scalar << 1 | ix->prev_scalar;
+  ix->prev_scalar = scalar >> 63;
+  u64 structurals = (m.op & ~in_string) | quote | (scalar & ~follows_scalar);
+
+  u64 invalid = m.ctrl & in_string;
+  if(invalid) {
+    u32 first = __ev_json_ctz64(invalid);
+    structurals &= (1ull << first) - 1;
+    ix->failed = true;
+    ix->error_offset = base + first;
+  }
+
+  // Positions are written eight at a time, past the last one if needed,
+  // which trades a few wasted writes for fewer mispredicted branches
+  u64 *out = ix->positions + ix->count;
+  u32 count = __ev_json_popcount64(structurals);
+  for(u32 i = 0; i < count; i += 8) {
+    __ev_json_write8(out + i, &structurals, base);
+  }
+  ix->count += count;
+}
+
+static void
+__ev_json_refill(
+  __ev_json_index *ix)
+{
+  ix->pos = 0;
+  ix->count = 0;
+  while(ix->count + 64 <= __EV_JSON_INDEX_CAPACITY && ix->block < ix->len && !ix->failed) {
+    if(ix->block + 64 <= ix->len) {
+      __ev_json_indexBlock(ix, ix->src + ix->block, ix->block);
+    } else {
+      // Pad the last block with whitespace
+      u8 tail[64];
+      memset(tail, ' ', sizeof(tail));
+      memcpy(tail, ix->src + ix->block, ix->len - ix->block);
+      __ev_json_indexBlock(ix, tail, ix->block);
+    }
+    ix->block += 64;
+  }
+}
+
+static EV_FORCEINLINE bool
+__ev_json_nextPosition(
+  __ev_json_index *ix,
+  u64 *p)
+{
+  if(ix->pos == ix->count) {
+    __ev_json_refill(ix);
+    if(ix->count == 0) {
+      return false;
+    }
+  }
+  *p = ix->positions[ix->pos++];
+  return true;
+}
+
+static bool
+__ev_json_fail(
+  ev_json_iter *it,
+  u64 offset,
+  evstring_error_t error)
+{
+  it->state = __EV_JSON_FAILED;
+  it->error = error;
+  it->error_offset = offset;
+  return false;
+}
+
+// Fails at the end of the structural positions: the document is either
+// truncated, or has an invalid string
+static bool
+__ev_json_failAtEnd(
+  ev_json_iter *it)
+{
+  return __ev_json_fail(it, it->index.failed ? it->index.error_offset : it->index.len, EV_STR_ERR_PARSE);
+}
+
+// Skips the digits at `p`, 8 bytes at a time while they are before `limit`,
+// which saves a mispredicted branch per run of digits
+static EV_FORCEINLINE const u8 *
+__ev_json_skipDigits(
+  const u8 *p,
+  const u8 *limit)
+{
+  while(p + 8 <= limit) {
+    u64 w;
+    memcpy(&w, p, 8);
+    // A byte is a digit if its high nibble is 3, and still is once 6 is
+    // added to it
+    u64 high = w & 0xF0F0F0F0F0F0F0F0ull;
+    u64 shifted = (w + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull;
+    u64 non_digits = (high ^ 0x3030303030303030ull) | (shifted ^ 0x3030303030303030ull);
+    if(non_digits) {
+      return p + (__ev_json_ctz64(non_digits) >> 3);
+    }
+    p += 8;
+  }
+  while((u8)(*p - '0') < 10) {
+    p++;
+  }
+  return p;
+}
+
+// \returns The length of the number at `p`, or 0 if there is no valid number.
+// The document is null-terminated, so nothing reads past its end, and `limit`
+// is right after the terminator.
+static EV_FORCEINLINE u64
+__ev_json_numberLength(
+  const u8 *p,
+  const u8 *limit)
+{
+  const u8 *start = p;
+  p += *p == '-';
+  if(*p == '0') {
+    p++;
+  } else if((u8)(*p - '1') < 9) {
+    p = __ev_json_skipDigits(p + 1, limit);
+  } else {
+    return 0;
+  }
+  if(*p == '.') {
+    const u8 *digits = ++p;
+    p = __ev_json_skipDigits(p, limit);
+    if(p == digits) {
+      return 0;
+    }
+  }
+  if((*p | 0x20) == 'e') {
+    p++;
+    p += *p == '+' || *p == '-';
+    const u8 *digits = p;
+    p = __ev_json_skipDigits(p, limit);
+    if(p == digits) {
+      return 0;
+    }
+  }
+  return (u64)(p - start);
+}
+
+static EV_FORCEINLINE bool
+__ev_json_token(
+  ev_json_iter *it,
+  ev_json_type type,
+  u64 offset,
+  u64 len,
+  ev_json_token *tok)
+{
+  tok->type = type;
+  tok->view = (evstring_view) { .data = it->json, .offset = offset, .len = len };
+  tok->depth = it->depth;
+  return true;
+}
+
+static EV_FORCEINLINE bool
+__ev_json_close(
+  ev_json_iter *it,
+  u64 p,
+  ev_json_token *tok)
+{
+  it->depth--;
+  it->state = it->depth ? __EV_JSON_COMMA_OR_END : __EV_JSON_DONE;
+  return __ev_json_token(it, EV_JSON_END, p, 1, tok);
+}
+
+static EV_FORCEINLINE bool
+__ev_json_value(
+  ev_json_iter *it,
+  u64 p,
+  ev_json_token *tok)
+{
+  const u8 *src = (const u8 *)it->json;
+  ev_json_type type;
+  u64 len;
+  switch(src[p]) {
+  case '{':
+  case '[': {
+    if(it->depth == EV_JSON_MAX_DEPTH) {
+      return __ev_json_fail(it, p, EV_STR_ERR_RANGE);
+    }
+    bool object = src[p] == '{';
+    it->stack[it->depth] = object;
+    __ev_json_token(it, object ? EV_JSON_OBJECT : EV_JSON_ARRAY, p, 1, tok);
+    it->depth++;
+    it->state = object ? __EV_JSON_KEY_OR_END : __EV_JSON_VALUE_OR_END;
+    return true;
+  }
+  case '"': {
+    // Nothing inside of a string is structural, so the next position is its
+    // closing quote
+    u64 close;
+    if(!__ev_json_nextPosition(&it->index, &close)) {
+      return __ev_json_failAtEnd(it);
+    }
+    it->state = it->depth ? __EV_JSON_COMMA_OR_END : __EV_JSON_DONE;
+    return __ev_json_token(it, EV_JSON_STRING, p + 1, close - p - 1, tok);
+  }
+  case 't':
+    type = EV_JSON_TRUE;
+    len = p + 4 <= it->index.len && memcmp(src + p, "true", 4) == 0 ? 4 : 0;
+    break;
+  case 'f':
+    type = EV_JSON_FALSE;
+    len = p + 5 <= it->index.len && memcmp(src + p, "false", 5) == 0 ? 5 : 0;
+    break;
+  case 'n':
+    type = EV_JSON_NULL;
+    len = p + 4 <= it->index.len && memcmp(src + p, "null", 4) == 0 ? 4 : 0;
+    break;
+  default:
+    type = EV_JSON_NUMBER;
+    len = __ev_json_numberLength(src + p, src + it->index.len + 1);
+    break;
+  }
+  // Scalars end at the end of the document, whitespace or an operator
+  if(len == 0 || (p + len < it->index.len && !(__ev_json_classes[src[p + len]] & (__EV_JSON_OP | __EV_JSON_WS)))) {
+    return __ev_json_fail(it, p + len, EV_STR_ERR_PARSE);
+  }
+  it->state = it->depth ? __EV_JSON_COMMA_OR_END : __EV_JSON_DONE;
+  return __ev_json_token(it, type, p, len, tok);
+}
+
+static EV_FORCEINLINE bool
+__ev_json_step(
+  ev_json_iter *it,
+  ev_json_token *tok)
+{
+  const u8 *src = (const u8 *)it->json;
+  u64 p;
+  for(;;) {
+    if(!__ev_json_nextPosition(&it->index, &p)) {
+      if(it->state == __EV_JSON_DONE && !it->index.failed) {
+        return false;
+      }
+      return it->state == __EV_JSON_FAILED ? false : __ev_json_failAtEnd(it);
+    }
+    u8 c = src[p];
+    switch(it->state) {
+    case __EV_JSON_COMMA_OR_END: {
+      bool object = it->stack[it->depth - 1];
+      if(c == ',') {
+        it->state = object ? __EV_JSON_KEY : __EV_JSON_VALUE;
+        continue;
+      }
+      if(c == (object ? '}' : ']')) {
+        return __ev_json_close(it, p, tok);
+      }
+      return __ev_json_fail(it, p, EV_STR_ERR_PARSE);
+    }
+    case __EV_JSON_KEY_OR_END:
+      if(c == '}') {
+        return __ev_json_close(it, p, tok);
+      }
+      // fallthrough
+    case __EV_JSON_KEY: {
+      u64 close, colon;
+      if(c != '"') {
+        return __ev_json_fail(it, p, EV_STR_ERR_PARSE);
+      }
+      if(!__ev_json_nextPosition(&it->index, &close)) {
+        return __ev_json_failAtEnd(it);
+      }
+      if(!__ev_json_nextPosition(&it->index, &colon)) {
+        return __ev_json_failAtEnd(it);
+      }
+      if(src[colon] != ':') {
+        return __ev_json_fail(it, colon, EV_STR_ERR_PARSE);
+      }
+      it->state = __EV_JSON_VALUE;
+      return __ev_json_token(it, EV_JSON_KEY, p + 1, close - p - 1, tok);
+    }
+    case __EV_JSON_VALUE_OR_END:
+      if(c == ']') {
+        return __ev_json_close(it, p, tok);
+      }
+      // fallthrough
+    case __EV_JSON_VALUE:
+      return __ev_json_value(it, p, tok);
+    case __EV_JSON_DONE:
+      // Content after the root value
+      return __ev_json_fail(it, p, EV_STR_ERR_PARSE);
+    default:
+      return false;
+    }
+  }
+}
+
+void
+ev_json_iter_init(
+  ev_json_iter *it,
+  const evstring json)
+{
+  it->json = json;
+  it->index.src = (const u8 *)json;
+  it->index.len = evstring_getLength(json);
+  it->index.block = 0;
+  it->index.prev_in_string = 0;
+  it->index.prev_odd_backslash = 0;
+  it->index.prev_scalar = 0;
+  it->index.failed = false;
+  it->index.error_offset = 0;
+  it->index.pos = 0;
+  it->index.count = 0;
+  it->depth = 0;
+  it->state = __EV_JSON_VALUE;
+  it->error = EV_STR_ERR_NONE;
+  it->error_offset = 0;
+}
+
+bool
+ev_json_iter_next(
+  ev_json_iter *it,
+  ev_json_token *tok)
+{
+  return __ev_json_step(it, tok);
+}
+
+bool
+ev_json_iter_skip(
+  ev_json_iter *it)
+{
+  if(it->state == __EV_JSON_FAILED || it->depth == 0) {
+    return false;
+  }
+  const u8 *src = (const u8 *)it->json;
+  u32 depth = 0;
+  u64 p;
+  while(__ev_json_nextPosition(&it->index, &p)) {
+    switch(src[p]) {
+    case '"':
+      // Skip the closing quote too
+      if(!__ev_json_nextPosition(&it->index, &p)) {
+        return __ev_json_failAtEnd(it);
+      }
+      break;
+    case '{':
+    case '[':
+      depth++;
+      break;
+    case '}':
+    case ']':
+      if(depth == 0) {
+        if(src[p] != (it->stack[it->depth - 1] ? '}' : ']')) {
+          return __ev_json_fail(it, p, EV_STR_ERR_PARSE);
+        }
+        it->depth--;
+        it->state = it->depth ? __EV_JSON_COMMA_OR_END : __EV_JSON_DONE;
+        return true;
+      }
+      depth--;
+      break;
+    }
+  }
+  return __ev_json_failAtEnd(it);
+}
+
+evstring_error_t
+ev_json_parse(
+  const evstring json,
+  ev_json_doc *doc)
+{
+  doc->json = json;
+  doc->node_count = 0;
+  doc->error_offset = 0;
+
+  ev_json_iter it;
+  ev_json_iter_init(&it, json);
+  // Node of each open container, and the number of values at each depth so
+  // far, from the root's depth: values at depth `d` belong to the container
+  // opened at depth `d - 1`
+  u32 open[EV_JSON_MAX_DEPTH];
+  u32 counts[EV_JSON_MAX_DEPTH + 1];
+  counts[0] = 0;
+  // Kept out of `doc` while parsing, which the node writes could alias
+  __ev_json_node *nodes = doc->nodes;
+  u32 count = 0;
+  u32 capacity = doc->node_capacity;
+  evstring_error_t err = EV_STR_ERR_NONE;
+
+  ev_json_token tok;
+  while(__ev_json_step(&it, &tok)) {
+    if(count == capacity) {
+      // Scene files average a token every 8 bytes or so
+      u64 grown = capacity ? (u64)capacity * 2 : it.index.len / 8 + 64;
+      grown = grown > ~0u ? ~0u : grown;
+      __ev_json_node *grown_nodes = grown > count ? realloc(nodes, grown * sizeof(__ev_json_node)) : NULL;
+      if(!grown_nodes) {
+        err = EV_STR_ERR_OOM;
+        break;
+      }
+      nodes = grown_nodes;
+      capacity = (u32)grown;
+    }
+
+    __ev_json_node *node = &nodes[count];
+    node->type = tok.type;
+    node->offset = tok.view.offset;
+    node->value = (u32)tok.view.len;
+    counts[tok.depth] += tok.type < EV_JSON_KEY;
+    switch(tok.type) {
+    case EV_JSON_ARRAY:
+    case EV_JSON_OBJECT:
+      open[tok.depth] = count;
+      counts[tok.depth + 1] = 0;
+      break;
+    case EV_JSON_END:
+      nodes[open[tok.depth]].value = count;
+      node->value = counts[tok.depth + 1];
+      break;
+    default:
+      if(tok.view.len > ~0u) {
+        err = EV_STR_ERR_RANGE;
+      }
+      break;
+    }
+    if(err != EV_STR_ERR_NONE) {
+      break;
+    }
+    count++;
+  }
+  doc->nodes = nodes;
+  doc->node_capacity = capacity;
+  if(err == EV_STR_ERR_NONE && it.error != EV_STR_ERR_NONE) {
+    err = it.error;
+    tok.view.offset = it.error_offset;
+  }
+  if(err != EV_STR_ERR_NONE) {
+    doc->node_count = 0;
+    doc->error_offset = tok.view.offset;
+    return err;
+  }
+  doc->node_count = count;
+  return EV_STR_ERR_NONE;
+}
+
+void
+ev_json_fini(
+  ev_json_doc *doc)
+{
+  free(doc->nodes);
+  doc->nodes = NULL;
+  doc->node_count = 0;
+  doc->node_capacity = 0;
+}
+
+static inline ev_json_value
+__ev_json_at(
+  const ev_json_doc *doc,
+  u32 index)
+{
+  return (ev_json_value) { .doc = doc, .index = index };
+}
+
+ev_json_value
+ev_json_root(
+  const ev_json_doc *doc)
+{
+  return __ev_json_at(doc->node_count ? doc : NULL, 0);
+}
+
+ev_json_type
+ev_json_getType(
+  ev_json_value v)
+{
+  return v.doc ? (ev_json_type)v.doc->nodes[v.index].type : EV_JSON_INVALID;
+}
+
+evstring_view
+ev_json_getView(
+  ev_json_value v)
+{
+  if(!v.doc) {
+    return (evstring_view) {0};
+  }
+  const __ev_json_node *node = &v.doc->nodes[v.index];
+  u64 len = node->value;
+  if(node->type == EV_JSON_ARRAY || node->type == EV_JSON_OBJECT) {
+    len = v.doc->nodes[node->value].offset + 1 - node->offset;
+  }
+  return (evstring_view) { .data = v.doc->json, .offset = node->offset, .len = len };
+}
+
+u32
+ev_json_getCount(
+  ev_json_value v)
+{
+  ev_json_type type = ev_json_getType(v);
+  if(type != EV_JSON_ARRAY && type != EV_JSON_OBJECT) {
+    return 0;
+  }
+  return v.doc->nodes[v.doc->nodes[v.index].value].value;
+}
+
+// \returns The value at node `i`, which is an element, a member key or an end
+static inline ev_json_value
+__ev_json_member(
+  const ev_json_doc *doc,
+  u32 i)
+{
+  switch(doc->nodes[i].type) {
+  case EV_JSON_END:
+    return __ev_json_at(NULL, 0);
+  case EV_JSON_KEY:
+    return __ev_json_at(doc, i + 1);
+  default:
+    return __ev_json_at(doc, i);
+  }
+}
+
+ev_json_value
+ev_json_first(
+  ev_json_value v)
+{
+  ev_json_type type = ev_json_getType(v);
+  if(type != EV_JSON_ARRAY && type != EV_JSON_OBJECT) {
+    return __ev_json_at(NULL, 0);
+  }
+  return __ev_json_member(v.doc, v.index + 1);
+}
+
+ev_json_value
+ev_json_next(
+  ev_json_value v)
+{
+  if(!v.doc || v.index == 0) {
+    return __ev_json_at(NULL, 0);
+  }
+  const __ev_json_node *node = &v.doc->nodes[v.index];
+  bool container = node->type == EV_JSON_ARRAY || node->type == EV_JSON_OBJECT;
+  return __ev_json_member(v.doc, (container ? node->value : v.index) + 1);
+}
+
+ev_json_value
+ev_json_at(
+  ev_json_value v,
+  u32 i)
+{
+  v = ev_json_first(v);
+  for(; i > 0 && v.doc; i--) {
+    v = ev_json_next(v);
+  }
+  return v;
+}
+
+evstring_view
+ev_json_getKey(
+  ev_json_value v)
+{
+  if(!v.doc || v.index == 0 || v.doc->nodes[v.index - 1].type != EV_JSON_KEY) {
+    return (evstring_view) {0};
+  }
+  return ev_json_getView(__ev_json_at(v.doc, v.index - 1));
+}
+
+ev_json_value
+ev_json_get_strview(
+  ev_json_value v,
+  ev_strview key)
+{
+  if(ev_json_getType(v) != EV_JSON_OBJECT) {
+    return __ev_json_at(NULL, 0);
+  }
+  const ev_json_doc *doc = v.doc;
+  for(u32 i = v.index + 1; doc->nodes[i].type == EV_JSON_KEY;) {
+    if(ev_json_keyEquals_strview(ev_json_getView(__ev_json_at(doc, i)), key)) {
+      return __ev_json_at(doc, i + 1);
+    }
+    const __ev_json_node *value = &doc->nodes[i + 1];
+    bool container = value->type == EV_JSON_ARRAY || value->type == EV_JSON_OBJECT;
+    i = (container ? value->value : i + 1) + 1;
+  }
+  return __ev_json_at(NULL, 0);
+}
+
+ev_json_value
+ev_json_get_view(
+  ev_json_value v,
+  evstring_view key)
+{
+  return ev_json_get_strview(v, evstring_view_toStrview(key));
+}
+
+ev_json_value
+ev_json_get_str(
+  ev_json_value v,
+  const char *key)
+{
+  return ev_json_get_strview(v, ev_strview_fromStr(key));
+}
+
+evstring_error_t
+ev_json_getString(
+  ev_json_value v,
+  evstring *out)
+{
+  if(ev_json_getType(v) != EV_JSON_STRING) {
+    return EV_STR_ERR_PARSE;
+  }
+  return ev_json_unescape(out, ev_json_getView(v));
+}
+
+evstring_error_t
+ev_json_getI64(
+  ev_json_value v,
+  i64 *out)
+{
+  if(ev_json_getType(v) != EV_JSON_NUMBER) {
+    return EV_STR_ERR_PARSE;
+  }
+  return evstring_view_parseI64(ev_json_getView(v), out);
+}
+
+evstring_error_t
+ev_json_getU64(
+  ev_json_value v,
+  u64 *out)
+{
+  if(ev_json_getType(v) != EV_JSON_NUMBER) {
+    return EV_STR_ERR_PARSE;
+  }
+  return evstring_view_parseU64(ev_json_getView(v), out);
+}
+
+evstring_error_t
+ev_json_getF64(
+  ev_json_value v,
+  f64 *out)
+{
+  if(ev_json_getType(v) != EV_JSON_NUMBER) {
+    return EV_STR_ERR_PARSE;
+  }
+  return evstring_view_parseF64(ev_json_getView(v), out);
+}
+
+evstring_error_t
+ev_json_getBool(
+  ev_json_value v,
+  bool *out)
+{
+  ev_json_type type = ev_json_getType(v);
+  if(type != EV_JSON_TRUE && type != EV_JSON_FALSE) {
+    return EV_STR_ERR_PARSE;
+  }
+  *out = type == EV_JSON_TRUE;
+  return EV_STR_ERR_NONE;
+}
+
+static inline u32
+__ev_json_hex4(
+  const u8 *p)
+{
+  u32 cp = 0;
+  for(u32 i = 0; i < 4; i++) {
+    u32 digit = (u32)p[i] - '0';
+    u32 letter = ((u32)p[i] | 0x20) - 'a';
+    if(digit >= 10 && letter >= 6) {
+      return ~0u;
+    }
+    cp = cp << 4 | (digit < 10 ? digit : letter + 10);
+  }
+  return cp;
+}
+
+// Decodes the escape that `*p` points to, after its backslash, into `out` and
+// advances `*p` past it
+// \returns The number of bytes written, up to 4, or 0 if the escape is not
+// valid
+static u32
+__ev_json_decodeEscape(
+  const u8 **p,
+  const u8 *end,
+  u8 *out)
+{
+  const u8 *s = *p;
+  if(s == end) {
+    return 0;
+  }
+  u8 c = *s++;
+  *p = s;
+  switch(c) {
+  case '"': case '\\': case '/': out[0] = c; return 1;
+  case 'b': out[0] = '\b'; return 1;
+  case 'f': out[0] = '\f'; return 1;
+  case 'n': out[0] = '\n'; return 1;
+  case 'r': out[0] = '\r'; return 1;
+  case 't': out[0] = '\t'; return 1;
+  case 'u': break;
+  default: return 0;
+  }
+
+  if(end - s < 4) {
+    return 0;
+  }
+  u32 cp = __ev_json_hex4(s);
+  s += 4;
+  if(cp == ~0u || (cp >= 0xDC00 && cp <= 0xDFFF)) {
+    return 0;
+  }
+  if(cp >= 0xD800 && cp <= 0xDBFF) {
+    // A high surrogate has to be followed by an escaped low surrogate
+    if(end - s < 6 || s[0] != '\\' || s[1] != 'u') {
+      return 0;
+    }
+    u32 low = __ev_json_hex4(s + 2);
+    if(low < 0xDC00 || low > 0xDFFF) {
+      return 0;
+    }
+    s += 6;
+    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+  }
+  *p = s;
+
+  if(cp < 0x80) {
+    out[0] = (u8)cp;
+    return 1;
+  }
+  if(cp < 0x800) {
+    out[0] = (u8)(0xC0 | cp >> 6);
+    out[1] = (u8)(0x80 | (cp & 0x3F));
+    return 2;
+  }
+  if(cp < 0x10000) {
+    out[0] = (u8)(0xE0 | cp >> 12);
+    out[1] = (u8)(0x80 | (cp >> 6 & 0x3F));
+    out[2] = (u8)(0x80 | (cp & 0x3F));
+    return 3;
+  }
+  out[0] = (u8)(0xF0 | cp >> 18);
+  out[1] = (u8)(0x80 | (cp >> 12 & 0x3F));
+  out[2] = (u8)(0x80 | (cp >> 6 & 0x3F));
+  out[3] = (u8)(0x80 | (cp & 0x3F));
+  return 4;
+}
+
+evstring_error_t
+ev_json_unescape(
+  evstring *out,
+  evstring_view raw)
+{
+  const u8 *p = (const u8 *)raw.data + raw.offset;
+  const u8 *end = p + raw.len;
+  u64 old_len = evstring_getLength(*out);
+  // Escapes never decode to more bytes than they are written with
+  evstring_error_t err = evstring_setLength(out, old_len + raw.len);
+  if(err != EV_STR_ERR_NONE) {
+    return err;
+  }
+  u8 *dst = (u8 *)*out + old_len;
+  while(p < end) {
+    const u8 *backslash = memchr(p, '\\', (size_t)(end - p));
+    u64 run = (u64)((backslash ? backslash : end) - p);
+    memcpy(dst, p, run);
+    dst += run;
+    p += run;
+    if(!backslash) {
+      break;
+    }
+    p++;
+    u32 n = __ev_json_decodeEscape(&p, end, dst);
+    if(n == 0) {
+      evstring_setLength(out, old_len);
+      return EV_STR_ERR_PARSE;
+    }
+    dst += n;
+  }
+  return evstring_setLength(out, (u64)(dst - (u8 *)*out));
+}
+
+bool
+ev_json_keyEquals_strview(
+  evstring_view raw,
+  ev_strview key)
+{
+  const u8 *p = (const u8 *)raw.data + raw.offset;
+  const u8 *end = p + raw.len;
+  const u8 *k = (const u8 *)key.ptr;
+  const u8 *kend = k + key.len;
+  if(raw.len == 0) {
+    return key.len == 0;
+  }
+  if(!memchr(p, '\\', raw.len)) {
+    return raw.len == key.len && (key.len == 0 || memcmp(p, k, key.len) == 0);
+  }
+  while(p < end) {
+    if(*p != '\\') {
+      if(k == kend || *k++ != *p++) {
+        return false;
+      }
+      continue;
+    }
+    p++;
+    u8 decoded[4];
+    u32 n = __ev_json_decodeEscape(&p, end, decoded);
+    if(n == 0 || (u64)(kend - k) < n || memcmp(k, decoded, n) != 0) {
+      return false;
+    }
+    k += n;
+  }
+  return k == kend;
+}
+
+bool
+ev_json_keyEquals_str(
+  evstring_view raw,
+  const char *key)
+{
+  return ev_json_keyEquals_strview(raw, ev_strview_fromStr(key));
+}
+
+#endif
+
+#endif
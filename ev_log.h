@@ -4,10 +4,13 @@
 #define EV_LOG_USE_COLOR
 
 #include "ev_internal.h"
+#include "ev_sync.h"
 
 #include "stdarg.h"
 #include "stdbool.h"
 #include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
 #include "time.h"
 
 typedef struct {
@@ -32,6 +35,22 @@ typedef enum {
   EV_LOG_FATAL,
 } ev_log_level;
 
+typedef enum {
+  EV_LOG_OVERFLOW_BLOCK,
+  EV_LOG_OVERFLOW_DROP_NEWEST,
+  EV_LOG_OVERFLOW_DROP_OLDEST,
+} ev_log_overflow_policy;
+
+// Longer messages are truncated in asynchronous mode
+#ifndef EV_LOG_ASYNC_MESSAGE_SIZE
+#define EV_LOG_ASYNC_MESSAGE_SIZE 256
+#endif
+
+// Size of the buffer each stderr/file sink's lines are batched in
+#ifndef EV_LOG_ASYNC_BATCH_SIZE
+#define EV_LOG_ASYNC_BATCH_SIZE 16384
+#endif
+
 #define ev_log_trace(...) ev_log(EV_LOG_TRACE, __FILE__, __LINE__, __VA_ARGS__)
 #define ev_log_debug(...) ev_log(EV_LOG_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
 #define ev_log_info(...)  ev_log(EV_LOG_INFO , __FILE__, __LINE__, __VA_ARGS__)
@@ -48,6 +67,136 @@ i32 ev_log_add_fp(FILE *fp, ev_log_level level);
 
 void ev_log(ev_log_level level, const char* file, u32 line, const char* fmt, ...);
 
+// Asynchronous mode: ev_log formats the message into a queue of `capacity`
+// records (rounded up to a power of two) and returns, and a writer thread
+// writes the records to the sinks in batches, with one write per stderr/file
+// sink per batch. `policy` decides what happens to a message when the queue
+// is full. Sinks must be set up before, and ev_log_stop_async must not be
+// called while other threads are logging.
+bool ev_log_start_async(u32 capacity, ev_log_overflow_policy policy);
+// Writes the queued messages and stops the writer thread
+void ev_log_stop_async(void);
+// Waits until the messages logged before the call are written and flushed
+void ev_log_flush(void);
+// Number of messages dropped because the queue was full
+u64 ev_log_dropped_count(void);
+
+// Binary logging: ev_binlog_* calls write the id of their call site, a
+// timestamp and the raw bytes of their arguments to a buffer of the calling
+// thread, and a writer thread copies the buffers to a file. Nothing is
+// formatted until the file is decoded with ev_binlog_decode (or the
+// ev_binlog_decode tool). The format has to be a string literal, and the
+// arguments are integers, floating point numbers, strings or pointers.
+// `*` widths and precisions are supported, `%n` is not.
+
+// Size of each thread's buffer, a power of two. A thread waits for the writer
+// when its buffer is full. The buffer of a thread that exits is reused by the
+// threads that start logging later, so there are as many buffers as threads
+// that logged at the same time.
+#ifndef EV_BINLOG_BUFFER_SIZE
+#define EV_BINLOG_BUFFER_SIZE (1 << 20)
+#endif
+
+// Longer string arguments are truncated
+#ifndef EV_BINLOG_MAX_STRING
+#define EV_BINLOG_MAX_STRING 1024
+#endif
+
+typedef enum {
+  EV_BINLOG_I32,
+  EV_BINLOG_U32,
+  EV_BINLOG_I64,
+  EV_BINLOG_U64,
+  EV_BINLOG_F64,
+  EV_BINLOG_STR,
+  EV_BINLOG_PTR,
+} ev_binlog_type;
+
+// A call site, registered with an id on its first call
+typedef struct {
+  const char* fmt;
+  const char* file;
+  u32 line;
+  ev_log_level level;
+  u32 arg_count;
+  const u8* types;
+  u64 id;
+} ev_binlog_site_t;
+
+#define ev_binlog_trace(...) __ev_binlog(EV_LOG_TRACE, __VA_ARGS__)
+#define ev_binlog_debug(...) __ev_binlog(EV_LOG_DEBUG, __VA_ARGS__)
+#define ev_binlog_info(...)  __ev_binlog(EV_LOG_INFO , __VA_ARGS__)
+#define ev_binlog_warn(...)  __ev_binlog(EV_LOG_WARN , __VA_ARGS__)
+#define ev_binlog_error(...) __ev_binlog(EV_LOG_ERROR, __VA_ARGS__)
+#define ev_binlog_fatal(...) __ev_binlog(EV_LOG_FATAL, __VA_ARGS__)
+
+// The types are found at compile time, and the unevaluated printf call lets
+// the compiler check them against the format
+#define __ev_binlog(level, fmt, ...) do {                                                      \
+    static const u8 __ev_binlog_types[] = { EV_FOREACH(__EV_BINLOG_TYPE, __VA_ARGS__) 0 };    \
+    static ev_binlog_site_t __ev_binlog_site = {                                              \
+      fmt, __FILE__, __LINE__, level, sizeof(__ev_binlog_types) - 1, __ev_binlog_types, 0 };  \
+    if (0)                                                                                    \
+      printf(fmt, ##__VA_ARGS__);                                                             \
+    __ev_binlog_write(&__ev_binlog_site,                                                      \
+        (const u64[]) { EV_FOREACH(__EV_BINLOG_ARG, __VA_ARGS__) 0 });                        \
+  } while (0)
+
+#define __EV_BINLOG_TYPE(x) _Generic((x),                                             \
+    float: EV_BINLOG_F64, double: EV_BINLOG_F64,                                      \
+    char*: EV_BINLOG_STR, const char*: EV_BINLOG_STR,                                 \
+    _Bool: EV_BINLOG_I32, char: EV_BINLOG_I32, signed char: EV_BINLOG_I32,           \
+    short: EV_BINLOG_I32, int: EV_BINLOG_I32,                                         \
+    unsigned char: EV_BINLOG_U32, unsigned short: EV_BINLOG_U32,                      \
+    unsigned int: EV_BINLOG_U32,                                                      \
+    long: sizeof(long) == 8 ? EV_BINLOG_I64 : EV_BINLOG_I32,                          \
+    unsigned long: sizeof(long) == 8 ? EV_BINLOG_U64 : EV_BINLOG_U32,                 \
+    long long: EV_BINLOG_I64, unsigned long long: EV_BINLOG_U64,                      \
+    default: EV_BINLOG_PTR),
+
+#define __EV_BINLOG_ARG(x) _Generic((x),                                              \
+    float: __ev_binlog_f64, double: __ev_binlog_f64,                                  \
+    char*: __ev_binlog_ptr, const char*: __ev_binlog_ptr,                             \
+    _Bool: __ev_binlog_int, char: __ev_binlog_int, signed char: __ev_binlog_int,      \
+    short: __ev_binlog_int, int: __ev_binlog_int,                                     \
+    unsigned char: __ev_binlog_int, unsigned short: __ev_binlog_int,                  \
+    unsigned int: __ev_binlog_int, long: __ev_binlog_int,                             \
+    unsigned long: __ev_binlog_int, long long: __ev_binlog_int,                       \
+    unsigned long long: __ev_binlog_int,                                              \
+    default: __ev_binlog_ptr)(x),
+
+static inline u64 __ev_binlog_int(u64 v)
+{
+  return v;
+}
+
+static inline u64 __ev_binlog_f64(f64 v)
+{
+  u64 bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+
+static inline u64 __ev_binlog_ptr(const void* v)
+{
+  return (u64)(size_t)v;
+}
+
+void __ev_binlog_write(ev_binlog_site_t* site, const u64* args);
+
+// Starts writing binary logs to `out`, which should be opened in binary mode
+bool ev_binlog_start(FILE* out);
+// Writes what is left in the threads' buffers and stops the writer thread.
+// Must not be called while other threads are logging.
+void ev_binlog_stop(void);
+// Waits until the messages logged before the call are written and flushed
+void ev_binlog_flush(void);
+// Formats a binary log into text lines like those of ev_log_add_fp, in the
+// order the messages were logged in. The messages are held in memory until
+// they are sorted.
+// \returns false if `in` is not a binary log, is truncated or is corrupt.
+bool ev_binlog_decode(FILE* in, FILE* out);
+
 #ifdef EV_LOG_IMPLEMENTATION
 #undef EV_LOG_IMPLEMENTATION
 
@@ -59,12 +208,67 @@ typedef struct {
   ev_log_level level;
 } ev_log_callback_t;
 
+// A message in the asynchronous queue. `sequence` is its position in the
+// queue plus one once it is written, and the position it is free for once it
+// has been read.
+typedef struct {
+  u64 sequence;
+  const char* file;
+  time_t time;
+  u32 line;
+  u32 length;
+  ev_log_level level;
+  char message[EV_LOG_ASYNC_MESSAGE_SIZE];
+} ev_log_record_t;
+
 struct {
   void* udata;
   ev_log_lock_fn lock;
   ev_log_level level;
   bool quiet;
   ev_log_callback_t callbacks[MAX_CALLBACKS];
+
+  // Asynchronous mode
+  bool async;
+  bool stopping;
+  ev_log_overflow_policy policy;
+  ev_log_record_t* ring;
+  u64 mask;
+  EV_ALIGN(64) u64 enqueue_pos;
+  EV_ALIGN(64) u64 dequeue_pos;
+  EV_ALIGN(64) u64 dropped;
+  u64 writer_sleeping;
+  u64 writer_busy;
+  ev_mutex_t mutex;
+  // Signaled when the writer is sleeping and a message is queued
+  ev_cond_t wake;
+  // Broadcast when the writer or a dropping thread frees space
+  ev_cond_t progress;
+  ev_thread_t writer;
+  // Batch buffer of stderr, then of each callback
+  char* buffers[MAX_CALLBACKS + 1];
+  u32 buffer_lengths[MAX_CALLBACKS + 1];
+
+  // Binary logging
+  bool binlog;
+  FILE* binlog_out;
+  u64 binlog_generation;
+  u64 binlog_stopping;
+  u64 binlog_passes;
+  ev_thread_t binlog_writer;
+  // Guards the buffer lists and the call sites
+  ev_mutex_t binlog_mutex;
+  struct ev_binlog_buffer_t* binlog_buffers;
+  // Drained buffers of threads that exited
+  struct ev_binlog_buffer_t* binlog_free_buffers;
+  // Releases a thread's buffer when it exits
+  ev_tls_key_t binlog_key;
+  bool binlog_key_created;
+  // Call sites by id - 1. They are kept when logging stops, as their ids are.
+  ev_binlog_site_t** binlog_sites;
+  u32 binlog_site_count;
+  u32 binlog_site_capacity;
+  u32 binlog_sites_written;
 } G;
 
 static const char* level_strings[] = {
@@ -152,7 +356,7 @@ i32 ev_log_add_callback(ev_log_log_fn fn, void* udata, ev_log_level level)
 }
 
 
-i32 log_add_fp(FILE *fp, ev_log_level level) 
+i32 ev_log_add_fp(FILE *fp, ev_log_level level) 
 {
   return ev_log_add_callback(ev_log_file_callback, fp, level);
 }
@@ -167,8 +371,21 @@ static void init_event(ev_log_event_t* ev, void* udata)
   ev->udata = udata;
 }
 
+static bool async_wanted(ev_log_level level);
+static void async_enqueue(ev_log_level level, const char* file, u32 line, const char* fmt, va_list ap);
+
 void ev_log(ev_log_level level, const char* file, u32 line, const char* fmt, ...) 
 {
+  if (G.async) {
+    if (async_wanted(level)) {
+      va_list ap;
+      va_start(ap, fmt);
+      async_enqueue(level, file, line, fmt, ap);
+      va_end(ap);
+    }
+    return;
+  }
+
   ev_log_event_t ev = {
     .fmt   = fmt,
     .file  = file,
@@ -198,5 +415,1138 @@ void ev_log(ev_log_level level, const char* file, u32 line, const char* fmt, ...
   unlock();
 }
 
+// Atomics on the queue positions. The ordering is acquire/release;
+// ev_fence is used where a store has to be visible before a later load.
+static inline u64 async_load(u64* p)
+{
+#if EV_CC_MSVC
+  return (u64)_InterlockedOr64((volatile long long*)p, 0);
+#else
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void async_store(u64* p, u64 v)
+{
+#if EV_CC_MSVC
+  _InterlockedExchange64((volatile long long*)p, (long long)v);
+#else
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#endif
+}
+
+static inline bool async_cas(u64* p, u64 expected, u64 desired)
+{
+#if EV_CC_MSVC
+  return (u64)_InterlockedCompareExchange64((volatile long long*)p, (long long)desired, (long long)expected) == expected;
+#else
+  return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void async_add(u64* p, u64 v)
+{
+#if EV_CC_MSVC
+  _InterlockedExchangeAdd64((volatile long long*)p, (long long)v);
+#else
+  __atomic_fetch_add(p, v, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static inline u64 async_exchange(u64* p, u64 v)
+{
+#if EV_CC_MSVC
+  return (u64)_InterlockedExchange64((volatile long long*)p, (long long)v);
+#else
+  return __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static bool async_wanted(ev_log_level level)
+{
+  if (!G.quiet && level >= G.level)
+    return true;
+  for (i32 i = 0; i < MAX_CALLBACKS && G.callbacks[i].fn; i++) {
+    if (level >= G.callbacks[i].level)
+      return true;
+  }
+  return false;
+}
+
+// Takes the oldest written record off the queue, or returns NULL if there is
+// none. The record has to be released once it is read.
+static ev_log_record_t* async_dequeue(void)
+{
+  u64 pos = async_load(&G.dequeue_pos);
+  for (;;) {
+    ev_log_record_t* record = &G.ring[pos & G.mask];
+    i64 diff = (i64)(async_load(&record->sequence) - (pos + 1));
+    if (diff < 0)
+      return NULL;
+    if (diff == 0 && async_cas(&G.dequeue_pos, pos, pos + 1))
+      return record;
+    pos = async_load(&G.dequeue_pos);
+  }
+}
+
+static void async_release(ev_log_record_t* record)
+{
+  async_store(&record->sequence, record->sequence + G.mask);
+}
+
+static bool async_pending(void)
+{
+  u64 pos = async_load(&G.dequeue_pos);
+  return (i64)(async_load(&G.ring[pos & G.mask].sequence) - (pos + 1)) >= 0;
+}
+
+static void async_progress(void)
+{
+  ev_mutex_lock(&G.mutex);
+  ev_cond_broadcast(&G.progress);
+  ev_mutex_unlock(&G.mutex);
+}
+
+// Called when the queue is full. \returns Whether to retry queueing the message.
+static bool async_overflow(void)
+{
+  switch (G.policy) {
+  case EV_LOG_OVERFLOW_DROP_NEWEST:
+    async_add(&G.dropped, 1);
+    return false;
+  case EV_LOG_OVERFLOW_DROP_OLDEST: {
+    ev_log_record_t* record = async_dequeue();
+    if (record) {
+      async_release(record);
+      async_add(&G.dropped, 1);
+      async_progress();
+    } else {
+      // The oldest record is still being written by its thread
+      ev_thread_yield();
+    }
+    return true;
+  }
+  default: {
+    ev_mutex_lock(&G.mutex);
+    u64 pos = async_load(&G.enqueue_pos);
+    while ((i64)(async_load(&G.ring[pos & G.mask].sequence) - pos) < 0) {
+      ev_cond_wait(&G.progress, &G.mutex);
+      pos = async_load(&G.enqueue_pos);
+    }
+    ev_mutex_unlock(&G.mutex);
+    return true;
+  }
+  }
+}
+
+static void async_enqueue(ev_log_level level, const char* file, u32 line, const char* fmt, va_list ap)
+{
+  ev_log_record_t* record;
+  u64 pos = async_load(&G.enqueue_pos);
+  for (;;) {
+    record = &G.ring[pos & G.mask];
+    i64 diff = (i64)(async_load(&record->sequence) - pos);
+    if (diff == 0 && async_cas(&G.enqueue_pos, pos, pos + 1))
+      break;
+    if (diff < 0 && !async_overflow())
+      return;
+    pos = async_load(&G.enqueue_pos);
+  }
+
+  record->file = file;
+  record->time = time(NULL);
+  record->line = line;
+  record->level = level;
+  i32 length = vsnprintf(record->message, EV_LOG_ASYNC_MESSAGE_SIZE, fmt, ap);
+  record->length = length < 0 ? 0 : length < EV_LOG_ASYNC_MESSAGE_SIZE ? (u32)length : EV_LOG_ASYNC_MESSAGE_SIZE - 1;
+  async_store(&record->sequence, pos + 1);
+
+  // Pairs with the fence in async_writer, so that either the writer sees the
+  // record or this sees the writer sleeping
+  ev_fence();
+  if (async_load(&G.writer_sleeping)) {
+    ev_mutex_lock(&G.mutex);
+    ev_cond_signal(&G.wake);
+    ev_mutex_unlock(&G.mutex);
+  }
+}
+
+static FILE* async_buffer_file(i32 sink)
+{
+  return sink == 0 ? stderr : G.callbacks[sink - 1].udata;
+}
+
+static void async_flush_buffer(i32 sink)
+{
+  if (G.buffer_lengths[sink]) {
+    fwrite(G.buffers[sink], 1, G.buffer_lengths[sink], async_buffer_file(sink));
+    G.buffer_lengths[sink] = 0;
+  }
+}
+
+// Formats a record the way ev_log_stdout_callback (for stderr) or
+// ev_log_file_callback would, and adds it to the sink's batch
+static void async_append(i32 sink, struct tm* time, ev_log_record_t* record)
+{
+  char line[EV_LOG_ASYNC_MESSAGE_SIZE + 512];
+  char buf[64];
+  i32 length;
+  if (sink == 0) {
+    buf[strftime(buf, sizeof(buf), "%H:%M:%S", time)] = '\0';
+#ifdef EV_LOG_USE_COLOR
+    length = snprintf(
+      line, sizeof(line), "%s %s%-5s\x1b[0m \x1b[90m%s:%d:\x1b[0m %s\n",
+      buf, level_colors[record->level], level_strings[record->level],
+      record->file, record->line, record->message);
+#else
+    length = snprintf(
+      line, sizeof(line), "%s %-5s %s:%d: %s\n",
+      buf, level_strings[record->level], record->file, record->line, record->message);
+#endif
+  } else {
+    buf[strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", time)] = '\0';
+    length = snprintf(
+      line, sizeof(line), "%s %-5s %s:%d: %s\n",
+      buf, level_strings[record->level], record->file, record->line, record->message);
+  }
+  if (length < 0)
+    return;
+  if (length >= (i32)sizeof(line)) {
+    length = sizeof(line) - 1;
+    line[length - 1] = '\n';
+  }
+
+  if (!G.buffers[sink])
+    G.buffers[sink] = malloc(EV_LOG_ASYNC_BATCH_SIZE);
+  if (!G.buffers[sink]) {
+    fwrite(line, 1, length, async_buffer_file(sink));
+    return;
+  }
+  if (G.buffer_lengths[sink] + length > EV_LOG_ASYNC_BATCH_SIZE)
+    async_flush_buffer(sink);
+  memcpy(G.buffers[sink] + G.buffer_lengths[sink], line, length);
+  G.buffer_lengths[sink] += length;
+}
+
+static void async_dispatch(ev_log_callback_t* cb, struct tm* time, ev_log_record_t* record, const char* fmt, ...)
+{
+  ev_log_event_t ev = {
+    .fmt   = fmt,
+    .file  = record->file,
+    .time  = time,
+    .udata = cb->udata,
+    .line  = record->line,
+    .level = record->level,
+  };
+  va_start(ev.ap, fmt);
+  cb->fn(&ev);
+  va_end(ev.ap);
+}
+
+static void async_write(ev_log_record_t* record)
+{
+  // Only the writer thread calls localtime in asynchronous mode
+  static time_t last_time = -1;
+  static struct tm* time;
+  if (record->time != last_time) {
+    last_time = record->time;
+    time = localtime(&last_time);
+  }
+
+  if (!G.quiet && record->level >= G.level)
+    async_append(0, time, record);
+  for (i32 i = 0; i < MAX_CALLBACKS && G.callbacks[i].fn; i++) {
+    ev_log_callback_t* cb = &G.callbacks[i];
+    if (record->level < cb->level)
+      continue;
+    if (cb->fn == ev_log_file_callback)
+      async_append(i + 1, time, record);
+    else
+      async_dispatch(cb, time, record, "%s", record->message);
+  }
+}
+
+static void async_writer(void* arg)
+{
+  (void)arg;
+  for (;;) {
+    // Set before taking records, so that ev_log_flush knows they may not be
+    // written yet
+    async_store(&G.writer_busy, 1);
+    u64 count = 0;
+    ev_log_record_t* record;
+    while (count <= G.mask && (record = async_dequeue())) {
+      async_write(record);
+      async_release(record);
+      count++;
+    }
+    for (i32 i = 0; i <= MAX_CALLBACKS; i++) {
+      if (G.buffer_lengths[i]) {
+        async_flush_buffer(i);
+        fflush(async_buffer_file(i));
+      }
+    }
+
+    ev_mutex_lock(&G.mutex);
+    async_store(&G.writer_busy, 0);
+    ev_cond_broadcast(&G.progress);
+    if (count == 0) {
+      if (G.stopping) {
+        ev_mutex_unlock(&G.mutex);
+        return;
+      }
+      async_store(&G.writer_sleeping, 1);
+      ev_fence();
+      if (!async_pending())
+        ev_cond_wait(&G.wake, &G.mutex);
+      async_store(&G.writer_sleeping, 0);
+    }
+    ev_mutex_unlock(&G.mutex);
+  }
+}
+
+bool ev_log_start_async(u32 capacity, ev_log_overflow_policy policy)
+{
+  if (G.async)
+    return false;
+  u64 size = 2;
+  while (size < capacity)
+    size <<= 1;
+  G.ring = malloc(sizeof(ev_log_record_t) * size);
+  if (!G.ring)
+    return false;
+  for (u64 i = 0; i < size; i++)
+    G.ring[i].sequence = i;
+  G.mask = size - 1;
+  G.policy = policy;
+  G.enqueue_pos = 0;
+  G.dequeue_pos = 0;
+  G.dropped = 0;
+  G.writer_sleeping = 0;
+  G.writer_busy = 0;
+  G.stopping = false;
+  ev_mutex_init(&G.mutex);
+  ev_cond_init(&G.wake);
+  ev_cond_init(&G.progress);
+  if (!ev_thread_create(&G.writer, async_writer, NULL)) {
+    ev_cond_fini(&G.progress);
+    ev_cond_fini(&G.wake);
+    ev_mutex_fini(&G.mutex);
+    free(G.ring);
+    G.ring = NULL;
+    return false;
+  }
+  G.async = true;
+  return true;
+}
+
+void ev_log_stop_async(void)
+{
+  if (!G.async)
+    return;
+  ev_mutex_lock(&G.mutex);
+  G.stopping = true;
+  ev_cond_signal(&G.wake);
+  ev_mutex_unlock(&G.mutex);
+  ev_thread_join(&G.writer);
+  G.async = false;
+
+  ev_cond_fini(&G.progress);
+  ev_cond_fini(&G.wake);
+  ev_mutex_fini(&G.mutex);
+  free(G.ring);
+  G.ring = NULL;
+  for (i32 i = 0; i <= MAX_CALLBACKS; i++) {
+    free(G.buffers[i]);
+    G.buffers[i] = NULL;
+  }
+}
+
+void ev_log_flush(void)
+{
+  // Synchronous sinks flush every message
+  if (!G.async)
+    return;
+  u64 target = async_load(&G.enqueue_pos);
+  ev_mutex_lock(&G.mutex);
+  ev_cond_signal(&G.wake);
+  while (async_load(&G.dequeue_pos) < target || async_load(&G.writer_busy))
+    ev_cond_wait(&G.progress, &G.mutex);
+  ev_mutex_unlock(&G.mutex);
+}
+
+u64 ev_log_dropped_count(void)
+{
+  return async_load(&G.dropped);
+}
+
+// Binary log layout: a header, then records of 8-byte aligned sizes that start
+// with their size and an id. Id 0 is padding, BINLOG_DEFINITION defines a
+// call site, and other ids are messages of the call site with that id:
+//   u32 size, u32 id, u64 ticks, then 4 bytes for 32-bit integers, 8 bytes
+//   for other numbers and pointers, and a u32 length and the bytes for strings
+#define BINLOG_MAGIC "EVBINLOG"
+#define BINLOG_DEFINITION 0xFFFFFFFFu
+
+typedef struct {
+  char magic[8];
+  u64 start_ticks;
+  i64 start_ns;
+  f64 ticks_per_ns;
+} ev_binlog_header_t;
+
+// Buffer states. A thread retires its buffer when it exits, and the writer
+// then moves it to the free list once it is drained. Stopping orphans the
+// buffers of the threads that are still alive, which free them later.
+#define BINLOG_ACTIVE 0
+#define BINLOG_RETIRED 1
+#define BINLOG_ORPHANED 2
+
+// A thread's buffer. Records never wrap around its end, the space left before
+// the end is filled with padding instead.
+typedef struct ev_binlog_buffer_t {
+  u8* data;
+  struct ev_binlog_buffer_t* next;
+  // Position up to which the writer copies in its current pass
+  u64 snapshot;
+  u64 state;
+  EV_ALIGN(64) u64 head;
+  EV_ALIGN(64) u64 tail;
+} ev_binlog_buffer_t;
+
+static EV_THREAD_LOCAL ev_binlog_buffer_t* binlog_buffer;
+static EV_THREAD_LOCAL u64 binlog_generation;
+// Set once the thread has released its buffer on exit. Messages that other
+// thread-exit destructors log after that are dropped.
+static EV_THREAD_LOCAL bool binlog_exited;
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+# if EV_CC_MSVC
+#  include <intrin.h>
+# else
+#  include <x86intrin.h>
+# endif
+# define BINLOG_TSC 1
+#endif
+
+static inline i64 binlog_now_ns(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (i64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline u64 binlog_ticks(void)
+{
+#ifdef BINLOG_TSC
+  return __rdtsc();
+#else
+  return (u64)binlog_now_ns();
+#endif
+}
+
+static bool binlog_register(ev_binlog_site_t* site)
+{
+  bool registered = true;
+  ev_mutex_lock(&G.binlog_mutex);
+  if (!site->id) {
+    if (G.binlog_site_count == G.binlog_site_capacity) {
+      u32 capacity = G.binlog_site_capacity ? G.binlog_site_capacity * 2 : 64;
+      ev_binlog_site_t** sites = realloc(G.binlog_sites, capacity * sizeof(ev_binlog_site_t*));
+      if (sites) {
+        G.binlog_sites = sites;
+        G.binlog_site_capacity = capacity;
+      }
+    }
+    if (G.binlog_site_count < G.binlog_site_capacity) {
+      G.binlog_sites[G.binlog_site_count++] = site;
+      async_store(&site->id, G.binlog_site_count);
+    } else {
+      registered = false;
+    }
+  }
+  ev_mutex_unlock(&G.binlog_mutex);
+  return registered;
+}
+
+// Gives up the calling thread's buffer, when it exits or when the buffer is
+// from before logging was restarted
+static void binlog_release(ev_binlog_buffer_t* buffer)
+{
+  // The data of an orphaned buffer is already freed
+  if (async_exchange(&buffer->state, BINLOG_RETIRED) == BINLOG_ORPHANED)
+    free(buffer);
+}
+
+// The writer may hand a retired buffer to another thread, so the exiting
+// thread must not write to it anymore
+static void EV_TLS_CALLBACK binlog_thread_exit(void* buffer)
+{
+  binlog_release(buffer);
+  binlog_buffer = NULL;
+  binlog_exited = true;
+}
+
+static ev_binlog_buffer_t* binlog_acquire(void)
+{
+  if (binlog_exited)
+    return NULL;
+  if (binlog_buffer) {
+    binlog_release(binlog_buffer);
+    binlog_buffer = NULL;
+    ev_tls_set(G.binlog_key, NULL);
+  }
+
+  ev_mutex_lock(&G.binlog_mutex);
+  ev_binlog_buffer_t* buffer = G.binlog_free_buffers;
+  if (buffer)
+    G.binlog_free_buffers = buffer->next;
+  ev_mutex_unlock(&G.binlog_mutex);
+  if (!buffer) {
+    buffer = malloc(sizeof(ev_binlog_buffer_t));
+    u8* data = malloc(EV_BINLOG_BUFFER_SIZE);
+    if (!buffer || !data) {
+      free(buffer);
+      free(data);
+      return NULL;
+    }
+    buffer->data = data;
+  }
+  buffer->snapshot = 0;
+  buffer->state = BINLOG_ACTIVE;
+  buffer->head = 0;
+  buffer->tail = 0;
+  ev_mutex_lock(&G.binlog_mutex);
+  buffer->next = G.binlog_buffers;
+  G.binlog_buffers = buffer;
+  ev_mutex_unlock(&G.binlog_mutex);
+  binlog_buffer = buffer;
+  binlog_generation = G.binlog_generation;
+  ev_tls_set(G.binlog_key, buffer);
+  return buffer;
+}
+
+void __ev_binlog_write(ev_binlog_site_t* site, const u64* args)
+{
+  if (!G.binlog || site->level < G.level)
+    return;
+  u64 ticks = binlog_ticks();
+  if (!async_load(&site->id) && !binlog_register(site))
+    return;
+  ev_binlog_buffer_t* buffer = binlog_buffer;
+  if (!buffer || binlog_generation != G.binlog_generation) {
+    buffer = binlog_acquire();
+    if (!buffer)
+      return;
+  }
+
+  u32 lengths[64];
+  u64 size = 16;
+  for (u32 i = 0; i < site->arg_count; i++) {
+    switch (site->types[i]) {
+    case EV_BINLOG_I32:
+    case EV_BINLOG_U32:
+      size += 4;
+      break;
+    case EV_BINLOG_STR: {
+      const char* str = (const char*)(size_t)args[i];
+      size_t length = str ? strlen(str) : 6;
+      lengths[i] = length < EV_BINLOG_MAX_STRING ? (u32)length : EV_BINLOG_MAX_STRING;
+      size += 4 + lengths[i];
+      break;
+    }
+    default:
+      size += 8;
+      break;
+    }
+  }
+  size = (size + 7) & ~(u64)7;
+
+  // The writer is the only one to move the tail, and frees space unless the
+  // logging is being stopped
+  u64 head = buffer->head;
+  u64 to_end = EV_BINLOG_BUFFER_SIZE - (head & (EV_BINLOG_BUFFER_SIZE - 1));
+  u64 needed = size <= to_end ? size : size + to_end;
+  while (EV_BINLOG_BUFFER_SIZE - (head - async_load(&buffer->tail)) < needed)
+    ev_thread_yield();
+  u8* p = buffer->data + (head & (EV_BINLOG_BUFFER_SIZE - 1));
+  if (size > to_end) {
+    u32 padding[2] = { (u32)to_end, 0 };
+    memcpy(p, padding, sizeof(padding));
+    head += to_end;
+    p = buffer->data;
+  }
+
+  u32 record[2] = { (u32)size, (u32)site->id };
+  memcpy(p, record, sizeof(record));
+  memcpy(p + 8, &ticks, 8);
+  p += 16;
+  for (u32 i = 0; i < site->arg_count; i++) {
+    switch (site->types[i]) {
+    case EV_BINLOG_I32:
+    case EV_BINLOG_U32: {
+      u32 v = (u32)args[i];
+      memcpy(p, &v, 4);
+      p += 4;
+      break;
+    }
+    case EV_BINLOG_STR: {
+      const char* str = (const char*)(size_t)args[i];
+      memcpy(p, &lengths[i], 4);
+      memcpy(p + 4, str ? str : "(null)", lengths[i]);
+      p += 4 + lengths[i];
+      break;
+    }
+    default:
+      memcpy(p, &args[i], 8);
+      p += 8;
+      break;
+    }
+  }
+  async_store(&buffer->head, head + size);
+}
+
+// \returns The number of bytes written
+static u64 binlog_write_definitions(void)
+{
+  u64 written = 0;
+  for (; G.binlog_sites_written < G.binlog_site_count; G.binlog_sites_written++) {
+    ev_binlog_site_t* site = G.binlog_sites[G.binlog_sites_written];
+    u32 file_length = (u32)strlen(site->file);
+    u32 fmt_length = (u32)strlen(site->fmt);
+    u32 fields[8] = {
+      0, BINLOG_DEFINITION, (u32)site->id, site->line, site->level, site->arg_count, file_length, fmt_length
+    };
+    u64 size = sizeof(fields) + site->arg_count + file_length + fmt_length;
+    u64 padded = (size + 7) & ~(u64)7;
+    fields[0] = (u32)padded;
+    static const u8 zeros[8] = { 0 };
+    fwrite(fields, 1, sizeof(fields), G.binlog_out);
+    fwrite(site->types, 1, site->arg_count, G.binlog_out);
+    fwrite(site->file, 1, file_length, G.binlog_out);
+    fwrite(site->fmt, 1, fmt_length, G.binlog_out);
+    fwrite(zeros, 1, padded - size, G.binlog_out);
+    written += padded;
+  }
+  return written;
+}
+
+static void binlog_writer(void* arg)
+{
+  (void)arg;
+  for (;;) {
+    bool stopping = async_load(&G.binlog_stopping);
+
+    // The heads are read before the call sites, so that the sites of every
+    // message that is copied are defined first. Only the writer removes
+    // buffers from the list, so it can be walked without the lock.
+    ev_mutex_lock(&G.binlog_mutex);
+    ev_binlog_buffer_t** link = &G.binlog_buffers;
+    while (*link) {
+      ev_binlog_buffer_t* b = *link;
+      // The head of a retired buffer no longer moves
+      if (async_load(&b->state) == BINLOG_RETIRED && b->tail == async_load(&b->head)) {
+        *link = b->next;
+        b->next = G.binlog_free_buffers;
+        G.binlog_free_buffers = b;
+        continue;
+      }
+      b->snapshot = async_load(&b->head);
+      link = &b->next;
+    }
+    ev_binlog_buffer_t* buffers = G.binlog_buffers;
+    u64 written = binlog_write_definitions();
+    ev_mutex_unlock(&G.binlog_mutex);
+
+    for (ev_binlog_buffer_t* b = buffers; b; b = b->next) {
+      u64 tail = b->tail;
+      while (tail != b->snapshot) {
+        u64 offset = tail & (EV_BINLOG_BUFFER_SIZE - 1);
+        u64 n = b->snapshot - tail;
+        if (n > EV_BINLOG_BUFFER_SIZE - offset)
+          n = EV_BINLOG_BUFFER_SIZE - offset;
+        fwrite(b->data + offset, 1, n, G.binlog_out);
+        tail += n;
+        written += n;
+      }
+      async_store(&b->tail, tail);
+    }
+
+    if (written)
+      fflush(G.binlog_out);
+    async_add(&G.binlog_passes, 1);
+    if (!written) {
+      if (stopping)
+        return;
+      ev_thread_sleep(1);
+    }
+  }
+}
+
+bool ev_binlog_start(FILE* out)
+{
+  if (G.binlog)
+    return false;
+  if (!G.binlog_key_created && !(G.binlog_key_created = ev_tls_create(&G.binlog_key, binlog_thread_exit)))
+    return false;
+
+  // Measures the tick rate against the wall clock
+  ev_binlog_header_t header;
+  memcpy(header.magic, BINLOG_MAGIC, sizeof(header.magic));
+  i64 start = binlog_now_ns();
+  u64 start_ticks = binlog_ticks();
+  i64 now;
+  while ((now = binlog_now_ns()) < start + 10000000)
+    ;
+  header.start_ticks = binlog_ticks();
+  header.start_ns = now;
+  header.ticks_per_ns = (f64)(header.start_ticks - start_ticks) / (f64)(now - start);
+  if (fwrite(&header, sizeof(header), 1, out) != 1)
+    return false;
+
+  G.binlog_out = out;
+  G.binlog_stopping = 0;
+  G.binlog_sites_written = 0;
+  G.binlog_buffers = NULL;
+  G.binlog_free_buffers = NULL;
+  // Threads drop the buffers they had from before
+  G.binlog_generation++;
+  ev_mutex_init(&G.binlog_mutex);
+  if (!ev_thread_create(&G.binlog_writer, binlog_writer, NULL)) {
+    ev_mutex_fini(&G.binlog_mutex);
+    return false;
+  }
+  G.binlog = true;
+  return true;
+}
+
+void ev_binlog_stop(void)
+{
+  if (!G.binlog)
+    return;
+  G.binlog = false;
+  async_store(&G.binlog_stopping, 1);
+  ev_thread_join(&G.binlog_writer);
+  fflush(G.binlog_out);
+  ev_mutex_fini(&G.binlog_mutex);
+  while (G.binlog_buffers) {
+    ev_binlog_buffer_t* b = G.binlog_buffers;
+    G.binlog_buffers = b->next;
+    free(b->data);
+    if (async_exchange(&b->state, BINLOG_ORPHANED) == BINLOG_RETIRED)
+      free(b);
+  }
+  while (G.binlog_free_buffers) {
+    ev_binlog_buffer_t* b = G.binlog_free_buffers;
+    G.binlog_free_buffers = b->next;
+    free(b->data);
+    free(b);
+  }
+}
+
+void ev_binlog_flush(void)
+{
+  if (!G.binlog)
+    return;
+  // Waits for the writer to start a pass after the call, and to finish it
+  u64 passes = async_load(&G.binlog_passes);
+  while (async_load(&G.binlog_passes) < passes + 2)
+    ev_thread_sleep(1);
+}
+
+typedef struct {
+  u32 line;
+  ev_log_level level;
+  u32 arg_count;
+  // The types, then the null-terminated file and format
+  u8* data;
+  const char* file;
+  const char* fmt;
+} binlog_decoded_site_t;
+
+typedef struct {
+  ev_binlog_type type;
+  union {
+    u64 u;
+    f64 f;
+    const char* s;
+  };
+} binlog_value_t;
+
+// Formats the `*` arguments and the value of one conversion
+#define BINLOG_PRINT(v) (star_count == 0 ? fprintf(out, spec, v) :           \
+                         star_count == 1 ? fprintf(out, spec, stars[0], v) : \
+                         fprintf(out, spec, stars[0], stars[1], v))
+
+// Prints the conversions of `fmt` with the arguments. A conversion whose
+// argument is missing or of another kind is printed as it is written.
+static void binlog_print(FILE* out, const char* fmt, const binlog_value_t* values, u32 count)
+{
+  u32 next = 0;
+  const char* f = fmt;
+  while (*f) {
+    if (*f != '%') {
+      const char* literal = f;
+      while (*f && *f != '%')
+        f++;
+      fwrite(literal, 1, f - literal, out);
+      continue;
+    }
+    if (f[1] == '%') {
+      fputc('%', out);
+      f += 2;
+      continue;
+    }
+
+    const char* start = f++;
+    char spec[32] = "%";
+    u32 n = 1;
+    i32 stars[2];
+    u32 star_count = 0;
+    bool valid = true;
+    while (*f && strchr("-+ #0'", *f) && n < 8)
+      spec[n++] = *f++;
+    for (u32 part = 0; part < 2; part++) {
+      if (part == 1) {
+        if (*f != '.')
+          break;
+        spec[n++] = *f++;
+      }
+      if (*f == '*') {
+        spec[n++] = *f++;
+        valid = valid && next < count && values[next].type <= EV_BINLOG_U32;
+        stars[star_count++] = valid ? (i32)values[next++].u : 0;
+      }
+      while (*f >= '0' && *f <= '9' && n < 24)
+        spec[n++] = *f++;
+    }
+    // The length modifier is chosen from the argument's type
+    while (*f && strchr("hljztLq", *f))
+      f++;
+    char conversion = *f;
+    if (conversion)
+      f++;
+
+    const binlog_value_t* v = next < count ? &values[next] : NULL;
+    if (!conversion || !valid || !v) {
+      valid = false;
+    } else if (strchr("diouxXc", conversion)) {
+      valid = v->type <= EV_BINLOG_U64;
+    } else if (strchr("eEfFgGaA", conversion)) {
+      valid = v->type == EV_BINLOG_F64;
+    } else if (conversion == 's') {
+      valid = v->type == EV_BINLOG_STR;
+    } else if (conversion == 'p') {
+      valid = v->type == EV_BINLOG_PTR;
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      fwrite(start, 1, f - start, out);
+      continue;
+    }
+    next++;
+    if (v->type == EV_BINLOG_I64 || v->type == EV_BINLOG_U64) {
+      spec[n++] = 'l';
+      spec[n++] = 'l';
+    }
+    spec[n++] = conversion;
+    spec[n] = '\0';
+
+    switch (v->type) {
+    case EV_BINLOG_I32:
+      BINLOG_PRINT((i32)v->u);
+      break;
+    case EV_BINLOG_U32:
+      BINLOG_PRINT((u32)v->u);
+      break;
+    case EV_BINLOG_I64:
+      BINLOG_PRINT((long long)v->u);
+      break;
+    case EV_BINLOG_U64:
+      BINLOG_PRINT((unsigned long long)v->u);
+      break;
+    case EV_BINLOG_F64:
+      BINLOG_PRINT(v->f);
+      break;
+    case EV_BINLOG_STR:
+      BINLOG_PRINT(v->s);
+      break;
+    case EV_BINLOG_PTR:
+      BINLOG_PRINT((void*)(size_t)v->u);
+      break;
+    }
+  }
+}
+
+#undef BINLOG_PRINT
+
+// Formats a message record, without its size and id. `strings` has room for
+// the record's strings and their terminators.
+static bool binlog_format(FILE* out, const ev_binlog_header_t* header, const binlog_decoded_site_t* site,
+    const u8* p, const u8* end, char* strings)
+{
+  binlog_value_t values[64];
+  u64 ticks;
+  memcpy(&ticks, p, 8);
+  p += 8;
+  for (u32 i = 0; i < site->arg_count; i++) {
+    values[i].type = site->data[i];
+    values[i].u = 0;
+    switch (values[i].type) {
+    case EV_BINLOG_I32:
+    case EV_BINLOG_U32:
+      if (end - p < 4)
+        return false;
+      memcpy(&values[i].u, p, 4);
+      if (values[i].type == EV_BINLOG_I32)
+        values[i].u = (u64)(i64)(i32)values[i].u;
+      p += 4;
+      break;
+    case EV_BINLOG_STR: {
+      u32 length;
+      if (end - p < 4)
+        return false;
+      memcpy(&length, p, 4);
+      if ((u64)(end - p - 4) < length)
+        return false;
+      memcpy(strings, p + 4, length);
+      strings[length] = '\0';
+      values[i].s = strings;
+      strings += length + 1;
+      p += 4 + length;
+      break;
+    }
+    case EV_BINLOG_I64:
+    case EV_BINLOG_U64:
+    case EV_BINLOG_F64:
+    case EV_BINLOG_PTR:
+      if (end - p < 8)
+        return false;
+      memcpy(&values[i].u, p, 8);
+      p += 8;
+      break;
+    default:
+      return false;
+    }
+  }
+
+  i64 ns = header->start_ns + (i64)((f64)(i64)(ticks - header->start_ticks) / header->ticks_per_ns);
+  time_t seconds = (time_t)(ns / 1000000000);
+  char buf[64];
+  buf[strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime(&seconds))] = '\0';
+  fprintf(out, "%s.%06u %-5s %s:%u: ", buf, (u32)(ns % 1000000000 / 1000), level_strings[site->level], site->file,
+      site->line);
+  binlog_print(out, site->fmt, values, site->arg_count);
+  fputc('\n', out);
+  return true;
+}
+
+// A run of message records in increasing tick order, as copied from one
+// thread's buffer
+typedef struct {
+  u64 ticks;
+  u64 next;
+  u64 end;
+} binlog_run_t;
+
+// Equal ticks keep the order of the file
+static inline bool binlog_run_before(const binlog_run_t* runs, u32 a, u32 b)
+{
+  return runs[a].ticks < runs[b].ticks || (runs[a].ticks == runs[b].ticks && a < b);
+}
+
+static void binlog_sift_down(const binlog_run_t* runs, u32* heap, u32 count, u32 i)
+{
+  for (;;) {
+    u32 first = i;
+    u32 left = 2 * i + 1;
+    if (left < count && binlog_run_before(runs, heap[left], heap[first]))
+      first = left;
+    if (left + 1 < count && binlog_run_before(runs, heap[left + 1], heap[first]))
+      first = left + 1;
+    if (first == i)
+      return;
+    u32 swap = heap[i];
+    heap[i] = heap[first];
+    heap[first] = swap;
+    i = first;
+  }
+}
+
+static inline u64 binlog_record_ticks(const u8* data, u64 offset)
+{
+  u64 ticks;
+  memcpy(&ticks, data + offset + 8, 8);
+  return ticks;
+}
+
+// Makes room for `n` more elements of `size` bytes in a growing array
+static bool binlog_reserve(void** array, u64* capacity, u64 count, u64 n, u64 size)
+{
+  if (count + n <= *capacity)
+    return true;
+  u64 grown = *capacity ? *capacity * 2 : 4096;
+  while (grown < count + n)
+    grown *= 2;
+  void* p = realloc(*array, grown * size);
+  if (!p)
+    return false;
+  *array = p;
+  *capacity = grown;
+  return true;
+}
+
+bool ev_binlog_decode(FILE* in, FILE* out)
+{
+  ev_binlog_header_t header;
+  if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, BINLOG_MAGIC, 8) != 0)
+    return false;
+
+  // The writer copies the threads' buffers one after the other, so the
+  // records are read first, then the runs of increasing ticks are merged
+  binlog_decoded_site_t* sites = NULL;
+  u32 site_count = 0;
+  u32 site_capacity = 0;
+  u8* data = NULL;
+  u64 data_length = 0;
+  u64 data_capacity = 0;
+  u64* offsets = NULL;
+  u64 offset_count = 0;
+  u64 offset_capacity = 0;
+  binlog_run_t* runs = NULL;
+  u64 run_count = 0;
+  u64 run_capacity = 0;
+  u32 max_size = 0;
+  bool ok = true;
+  u32 fields[2];
+  size_t read;
+  while ((read = fread(fields, 4, 2, in)) == 2) {
+    u32 size = fields[0] - 8;
+    u32 id = fields[1];
+    if (fields[0] < 8 || fields[0] % 8) {
+      ok = false;
+      break;
+    }
+    // Definitions and padding are read past the end of the kept records
+    if (!binlog_reserve((void**)&data, &data_capacity, data_length, fields[0], 1)) {
+      ok = false;
+      break;
+    }
+    u8* record = data + data_length + 8;
+    memcpy(record - 8, fields, 8);
+    if (fread(record, 1, size, in) != size) {
+      ok = false;
+      break;
+    }
+
+    if (id == 0) {
+      continue;
+    }
+    if (id == BINLOG_DEFINITION) {
+      // Site id, line, level, argument count, file length, format length
+      u32 d[6];
+      if (size < sizeof(d)) {
+        ok = false;
+        break;
+      }
+      memcpy(d, record, sizeof(d));
+      // A log defines each call site once, in the order of their ids
+      if (d[0] != site_count + 1 || d[2] > EV_LOG_FATAL || d[3] > 64
+          || (u64)sizeof(d) + d[3] + d[4] + d[5] > size) {
+        ok = false;
+        break;
+      }
+      if (site_count == site_capacity) {
+        u32 grown_capacity = site_capacity ? site_capacity * 2 : 64;
+        binlog_decoded_site_t* grown = realloc(sites, grown_capacity * sizeof(binlog_decoded_site_t));
+        if (!grown) {
+          ok = false;
+          break;
+        }
+        sites = grown;
+        site_capacity = grown_capacity;
+      }
+      binlog_decoded_site_t* site = &sites[site_count];
+      site->data = malloc(d[3] + d[4] + d[5] + 2);
+      if (!site->data) {
+        ok = false;
+        break;
+      }
+      site_count++;
+      memcpy(site->data, record + sizeof(d), d[3] + d[4]);
+      site->data[d[3] + d[4]] = '\0';
+      memcpy(site->data + d[3] + d[4] + 1, record + sizeof(d) + d[3] + d[4], d[5]);
+      site->data[d[3] + d[4] + 1 + d[5]] = '\0';
+      site->line = d[1];
+      site->level = d[2];
+      site->arg_count = d[3];
+      site->file = (const char*)site->data + d[3];
+      site->fmt = site->file + d[4] + 1;
+      continue;
+    }
+    if (id > site_count || size < 8) {
+      ok = false;
+      break;
+    }
+
+    if (!binlog_reserve((void**)&offsets, &offset_capacity, offset_count, 1, sizeof(u64))) {
+      ok = false;
+      break;
+    }
+    u64 ticks = binlog_record_ticks(data, data_length);
+    if (run_count == 0 || ticks < binlog_record_ticks(data, offsets[offset_count - 1])) {
+      if (!binlog_reserve((void**)&runs, &run_capacity, run_count, 1, sizeof(binlog_run_t))) {
+        ok = false;
+        break;
+      }
+      runs[run_count++] = (binlog_run_t) { ticks, offset_count, offset_count };
+    }
+    runs[run_count - 1].end++;
+    offsets[offset_count++] = data_length;
+    data_length += fields[0];
+    max_size = size > max_size ? size : max_size;
+  }
+  if (read != 0 && ok)
+    ok = false;
+
+  char* strings = ok ? malloc(max_size + 1) : NULL;
+  u32* heap = ok ? malloc((run_count + 1) * sizeof(u32)) : NULL;
+  if (!strings || !heap)
+    ok = false;
+  if (ok) {
+    u32 heap_count = (u32)run_count;
+    for (u32 i = 0; i < heap_count; i++)
+      heap[i] = i;
+    for (u32 i = heap_count / 2; i-- > 0;)
+      binlog_sift_down(runs, heap, heap_count, i);
+    while (heap_count) {
+      binlog_run_t* run = &runs[heap[0]];
+      const u8* record = data + offsets[run->next];
+      u32 header_fields[2];
+      memcpy(header_fields, record, 8);
+      if (!binlog_format(out, &header, &sites[header_fields[1] - 1], record + 8, record + header_fields[0], strings)) {
+        ok = false;
+        break;
+      }
+      if (++run->next == run->end)
+        heap[0] = heap[--heap_count];
+      else
+        run->ticks = binlog_record_ticks(data, offsets[run->next]);
+      binlog_sift_down(runs, heap, heap_count, 0);
+    }
+  }
+
+  for (u32 i = 0; i < site_count; i++)
+    free(sites[i].data);
+  free(sites);
+  free(data);
+  free(offsets);
+  free(runs);
+  free(strings);
+  free(heap);
+  return ok;
+}
+
 #endif
 #endif
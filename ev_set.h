@@ -0,0 +1,787 @@
+/*!
+ * \file ev_set.h
+ */
+#ifndef EV_SET_HEADER
+#define EV_SET_HEADER
+#include "ev_types.h"
+#include "ev_numeric.h"
+
+#if defined(EV_SET_SHARED)
+# if defined (EV_SET_IMPL)
+#  define EV_SET_API EV_EXPORT
+# else
+#  define EV_SET_API EV_IMPORT
+# endif
+#else
+# define EV_SET_API
+#endif
+
+#ifndef EV_SET_INIT_CAP
+/*!
+ * \brief Initial number of slots that is reserved when a set is initialized.
+ * Must be a power of two.
+ */
+#define EV_SET_INIT_CAP 16
+#endif
+
+#ifndef EV_SET_MAX_LOAD
+/*!
+ * \brief Maximum ratio of occupied (including deleted) slots before a rehash
+ */
+#define EV_SET_MAX_LOAD 7 / 8
+#endif
+
+#ifndef EV_SET_HASH_SEED
+/*!
+ * \brief Seed that is passed to the element type's hash function
+ */
+#define EV_SET_HASH_SEED 0
+#endif
+
+typedef void *ev_set_t;
+
+typedef enum {
+  EV_SET_ERR_NONE = 0,
+  EV_SET_ERR_OOM = 1,
+  //! Not a failure; returned by `ev_set_insert` when the value was already in the set.
+  EV_SET_ERR_EXISTS = 2
+} ev_set_error_t;
+TYPEDATA_GEN(ev_set_error_t, DEFAULT(EV_SET_ERR_NONE));
+
+#if defined(EV_SET_SHORTNAMES)
+# define set_t ev_set_t
+
+# define set_error_t ev_set_error_t
+
+# define set(T) ev_set(T)
+
+# define set_init         ev_set_init
+# define set_fini         ev_set_fini
+# define set_insert       ev_set_insert
+# define set_contains     ev_set_contains
+# define set_remove       ev_set_remove
+# define set_reserve      ev_set_reserve
+# define set_len          ev_set_len
+# define set_clear        ev_set_clear
+# define set_dup          ev_set_dup
+# define set_iter_begin   ev_set_iter_begin
+# define set_iter_end     ev_set_iter_end
+# define set_iter_next    ev_set_iter_next
+# define set_union        ev_set_union
+# define set_intersection ev_set_intersection
+# define set_difference   ev_set_difference
+#endif
+
+/*!
+ * \brief For the sake of readability
+ * \details Sample usage:
+ * ```
+ * ev_set(evstring) s = ev_set_init(evstring);
+ * ```
+ */
+#define ev_set(T) T*
+
+#define EV_SET_MAGIC (0x65765F7365745F74)
+
+//! Metadata that is stored with a set. Unique to each set.
+struct ev_set_meta_t {
+  u64 _magic;
+
+  //! The number of elements in the set.
+  u64 length;
+  //! The number of slots in the set. Always a power of two.
+  u64 capacity;
+  //! The number of slots that are marked as deleted.
+  u64 tombstones;
+
+  /*!
+   * One control byte per slot. Empty and deleted slots have their high bit
+   * set, occupied slots store the low 7 bits of the element's hash.
+   */
+  u8 *ctrl;
+  /*!
+   * The full hash of every occupied slot. Used to filter out mismatches
+   * before calling the equality function, and to relocate elements on rehash
+   * without calling the hash function again.
+   */
+  u64 *hashes;
+
+  //! The type data of the elements
+  EvTypeData typeData;
+};
+
+/*!
+ * \param typeData The EvTypeData for the element that the set will contain.
+ * `hash_fn` and `equal_fn` are used if they exist. Otherwise, the bytes of the
+ * element are hashed and compared.
+ *
+ * \returns A set object. NULL on OOM.
+ */
+EV_SET_API ev_set_t
+ev_set_init_impl(
+  EvTypeData typeData);
+
+/*!
+ * \brief Syntactic sugar for `ev_set_init_impl()`
+ * \details Sample usage:
+ * ```
+ * ev_set_init(i32);                   // ev_set_init_impl(TypeData(i32));
+ * ```
+ */
+#define ev_set_init(T) ev_set_init_impl(TypeData(T))
+
+/*!
+ * \brief A function that destroys a set object. If the element type has a
+ * destructor function, then this function is called on every element before
+ * all reserved memory is freed.
+ *
+ * \param set_p A pointer to the set that is being destroyed
+ */
+EV_SET_API void
+ev_set_fini(
+  void *set_p);
+
+/*!
+ * \brief A function that copies a value into the set if no equal value is
+ * already present. If the element type has a copy function, then it is used
+ * to copy the value. Otherwise, memcpy is used.
+ *
+ * \param set_p Reference to the set object
+ * \param val A pointer to the value that is to be inserted
+ *
+ * \returns `EV_SET_ERR_NONE` if the value was inserted, `EV_SET_ERR_EXISTS` if
+ * an equal value was already present, `EV_SET_ERR_OOM` if a needed rehash
+ * failed (the set is left unchanged).
+ */
+EV_SET_API ev_set_error_t
+ev_set_insert(
+  void *set_p,
+  void *val);
+
+/*!
+ * \param set_p A pointer to the set object
+ * \param val A pointer to the value that is looked up
+ *
+ * \returns `true` if an equal value is in the set
+ */
+EV_SET_API bool
+ev_set_contains(
+  const void *set_p,
+  void *val);
+
+/*!
+ * \brief A function that removes the value equal to `val` from the set. If
+ * the element type has a destructor function, it is called on the removed
+ * element.
+ *
+ * \param set_p Reference to the set object
+ * \param val A pointer to the value that is to be removed
+ *
+ * \returns `true` if a value was removed
+ */
+EV_SET_API bool
+ev_set_remove(
+  void *set_p,
+  void *val);
+
+/*!
+ * \brief Makes sure that `count` elements fit in the set without any rehash.
+ *
+ * \param set_p Reference to the set object
+ * \param count The number of elements to reserve space for
+ *
+ * \returns `EV_SET_ERR_NONE` on success, `EV_SET_ERR_OOM` on OOM
+ */
+EV_SET_API ev_set_error_t
+ev_set_reserve(
+  void *set_p,
+  u64 count);
+
+/*!
+ * \param set_p A pointer to the set object
+ *
+ * \returns Number of elements in the set
+ */
+EV_SET_API u64
+ev_set_len(
+  const void *set_p);
+
+/*!
+ * \brief Calls the free operation (if exists) on every element, then empties
+ * the set. The reserved slots are kept.
+ *
+ * \param set_p A pointer to the set object
+ */
+EV_SET_API void
+ev_set_clear(
+  void *set_p);
+
+/*!
+ * \brief A function that duplicates the passed set into a new one and
+ * returns it. Elements are copied with the type's copy function if it
+ * exists.
+ *
+ * \param set_p A pointer to the set object
+ *
+ * \returns The newly created set. NULL on OOM.
+ */
+EV_SET_API ev_set_t
+ev_set_dup(
+  const void *set_p);
+
+/*!
+ * \param set_p A pointer to the set that we want an iterator for
+ *
+ * \returns A pointer to the first element in the set, or `ev_set_iter_end()`
+ * if the set is empty.
+ */
+EV_SET_API void *
+ev_set_iter_begin(
+  const void *set_p);
+
+/*!
+ * \param set_p A pointer to the set that we want an iterator for
+ *
+ * \returns A pointer to the memory block right after the last slot in the set
+ */
+EV_SET_API void *
+ev_set_iter_end(
+  const void *set_p);
+
+/*!
+ * \brief A function that moves an iterator to the next element in the set.
+ * Iteration order is unspecified, and the set must not be modified while it
+ * is being iterated over.
+ *
+ * \param set_p A pointer to the set that is being iterated over
+ * \param iter Reference to the iterator that is being incremented
+ */
+EV_SET_API void
+ev_set_iter_next(
+  const void *set_p,
+  void **iter);
+
+/*!
+ * \brief Creates a new set with the elements that are in either `a` or `b`.
+ * The larger set is duplicated and the elements of the smaller one are
+ * inserted into it. Both sets must hold the same type.
+ *
+ * \returns The newly created set. NULL on OOM.
+ */
+EV_SET_API ev_set_t
+ev_set_union(
+  const void *a_p,
+  const void *b_p);
+
+/*!
+ * \brief Creates a new set with the elements that are in both `a` and `b`.
+ * The smaller set is iterated and looked up in the larger one. Both sets must
+ * hold the same type.
+ *
+ * \returns The newly created set. NULL on OOM.
+ */
+EV_SET_API ev_set_t
+ev_set_intersection(
+  const void *a_p,
+  const void *b_p);
+
+/*!
+ * \brief Creates a new set with the elements of `a` that are not in `b`.
+ * If `a` is the smaller set, it is filtered against `b`. Otherwise, `a` is
+ * duplicated and the elements of `b` are removed from it. Both sets must hold
+ * the same type.
+ *
+ * \returns The newly created set. NULL on OOM.
+ */
+EV_SET_API ev_set_t
+ev_set_difference(
+  const void *a_p,
+  const void *b_p);
+
+#ifdef EV_SET_IMPLEMENTATION
+#undef EV_SET_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define __EV_SET_CTRL_EMPTY   ((u8)0x80)
+#define __EV_SET_CTRL_DELETED ((u8)0xFE)
+#define __EV_SET_CTRL_ISFULL(c) (((c) & 0x80) == 0)
+#define __EV_SET_NOT_FOUND (~0ull)
+
+#define __ev_set_getmeta(s) \
+  struct ev_set_meta_t *metadata = ((struct ev_set_meta_t *)(s)) - 1; \
+  assert(metadata->_magic == EV_SET_MAGIC);
+
+#define __ev_set_slot(s, i) \
+  (((u8 *)(s)) + ((i) * metadata->typeData.size))
+
+static inline u64
+__ev_set_hash(
+  const struct ev_set_meta_t *metadata,
+  void *val)
+{
+  if(metadata->typeData.hash_fn) {
+    return metadata->typeData.hash_fn(val, EV_SET_HASH_SEED);
+  }
+  return ev_hash_murmur3(val, metadata->typeData.size, EV_SET_HASH_SEED);
+}
+
+static inline bool
+__ev_set_equal(
+  const struct ev_set_meta_t *metadata,
+  void *a,
+  void *b)
+{
+  if(metadata->typeData.equal_fn) {
+    return metadata->typeData.equal_fn(a, b);
+  }
+  return memcmp(a, b, metadata->typeData.size) == 0;
+}
+
+static ev_set_t
+__ev_set_alloc(
+  EvTypeData typeData,
+  u64 capacity)
+{
+  u64 slots_size = (capacity * typeData.size + 7) & ~7ull;
+  u8 *p = malloc(sizeof(struct ev_set_meta_t) + slots_size
+                 + (capacity * sizeof(u64)) + capacity);
+  if(!p) {
+    return NULL;
+  }
+
+  struct ev_set_meta_t *metadata = (struct ev_set_meta_t *)p;
+  u8 *slots = (u8 *)(metadata + 1);
+  *metadata = (struct ev_set_meta_t){
+    ._magic = EV_SET_MAGIC,
+    .length = 0,
+    .capacity = capacity,
+    .tombstones = 0,
+    .hashes = (u64 *)(slots + slots_size),
+    .typeData = typeData
+  };
+  metadata->ctrl = (u8 *)(metadata->hashes + capacity);
+  memset(metadata->ctrl, __EV_SET_CTRL_EMPTY, capacity);
+
+  return slots;
+}
+
+static u64
+__ev_set_find(
+  const void *s,
+  void *val,
+  u64 hash)
+{
+  __ev_set_getmeta(s)
+  u64 mask = metadata->capacity - 1;
+  u8 h2 = (u8)(hash & 0x7F);
+
+  for(u64 i = (hash >> 7) & mask;; i = (i + 1) & mask) {
+    u8 c = metadata->ctrl[i];
+    if(c == __EV_SET_CTRL_EMPTY) {
+      return __EV_SET_NOT_FOUND;
+    }
+    if(c == h2 && metadata->hashes[i] == hash &&
+       __ev_set_equal(metadata, __ev_set_slot(s, i), val)) {
+      return i;
+    }
+  }
+}
+
+// Returns the first empty or deleted slot in the probe sequence of `hash`
+static u64
+__ev_set_find_free(
+  const struct ev_set_meta_t *metadata,
+  u64 hash)
+{
+  u64 mask = metadata->capacity - 1;
+  u64 i = (hash >> 7) & mask;
+  while(__EV_SET_CTRL_ISFULL(metadata->ctrl[i])) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+// Moves all elements into a new block of `capacity` slots. Elements are
+// memcpy'd and placed using their stored hash.
+static ev_set_error_t
+__ev_set_rehash(
+  ev_set_t *s,
+  u64 capacity)
+{
+  __ev_set_getmeta(*s)
+  ev_set_t new_s = __ev_set_alloc(metadata->typeData, capacity);
+  if(!new_s) {
+    return EV_SET_ERR_OOM;
+  }
+  struct ev_set_meta_t *new_meta = ((struct ev_set_meta_t *)new_s) - 1;
+  u32 elem_size = metadata->typeData.size;
+
+  for(u64 i = 0; i < metadata->capacity; i++) {
+    if(__EV_SET_CTRL_ISFULL(metadata->ctrl[i])) {
+      u64 hash = metadata->hashes[i];
+      u64 dst = __ev_set_find_free(new_meta, hash);
+      new_meta->ctrl[dst] = metadata->ctrl[i];
+      new_meta->hashes[dst] = hash;
+      memcpy((u8 *)new_s + dst * elem_size, __ev_set_slot(*s, i), elem_size);
+    }
+  }
+  new_meta->length = metadata->length;
+
+  free(metadata);
+  *s = new_s;
+  return EV_SET_ERR_NONE;
+}
+
+static inline u64
+__ev_set_capacity_for(
+  u64 count)
+{
+  u64 cap = EV_SET_INIT_CAP;
+  while(cap * EV_SET_MAX_LOAD < count) {
+    cap *= 2;
+  }
+  return cap;
+}
+
+// Inserts an element whose hash is already known. `val` is assumed to not
+// be in the set.
+static ev_set_error_t
+__ev_set_insert_new(
+  ev_set_t *s,
+  void *val,
+  u64 hash)
+{
+  __ev_set_getmeta(*s)
+  if(metadata->length + metadata->tombstones + 1 > metadata->capacity * EV_SET_MAX_LOAD) {
+    // Only grow if live elements need it, otherwise just purge tombstones
+    u64 new_cap = __ev_set_capacity_for(metadata->length + 1);
+    if(new_cap < metadata->capacity) {
+      new_cap = metadata->capacity;
+    }
+    ev_set_error_t err = __ev_set_rehash(s, new_cap);
+    if(err) {
+      return err;
+    }
+    metadata = ((struct ev_set_meta_t *)(*s)) - 1;
+  }
+
+  u64 i = __ev_set_find_free(metadata, hash);
+  if(metadata->ctrl[i] == __EV_SET_CTRL_DELETED) {
+    metadata->tombstones--;
+  }
+  metadata->ctrl[i] = (u8)(hash & 0x7F);
+  metadata->hashes[i] = hash;
+
+  void *dst = __ev_set_slot(*s, i);
+  if(metadata->typeData.copy_fn) {
+    metadata->typeData.copy_fn(dst, val);
+  } else {
+    memcpy(dst, val, metadata->typeData.size);
+  }
+  metadata->length++;
+
+  return EV_SET_ERR_NONE;
+}
+
+static void
+__ev_set_erase_at(
+  ev_set_t s,
+  u64 i)
+{
+  __ev_set_getmeta(s)
+  if(metadata->typeData.free_fn) {
+    metadata->typeData.free_fn(__ev_set_slot(s, i));
+  }
+  // With linear probing, a slot that is followed by an empty one can never be
+  // in the middle of another element's probe sequence.
+  u64 next = (i + 1) & (metadata->capacity - 1);
+  if(metadata->ctrl[next] == __EV_SET_CTRL_EMPTY) {
+    metadata->ctrl[i] = __EV_SET_CTRL_EMPTY;
+  } else {
+    metadata->ctrl[i] = __EV_SET_CTRL_DELETED;
+    metadata->tombstones++;
+  }
+  metadata->length--;
+}
+
+ev_set_t
+ev_set_init_impl(
+  EvTypeData typeData)
+{
+  return __ev_set_alloc(typeData, EV_SET_INIT_CAP);
+}
+
+void
+ev_set_fini(
+  void *set_p)
+{
+  ev_set_t *s = (ev_set_t *)set_p;
+  __ev_set_getmeta(*s)
+
+  if(metadata->typeData.free_fn) {
+    for(void *elem = ev_set_iter_begin(s); elem != ev_set_iter_end(s); ev_set_iter_next(s, &elem)) {
+      metadata->typeData.free_fn(elem);
+    }
+  }
+  free(metadata);
+
+  *s = NULL;
+}
+
+ev_set_error_t
+ev_set_insert(
+  void *set_p,
+  void *val)
+{
+  ev_set_t *s = (ev_set_t *)set_p;
+  __ev_set_getmeta(*s)
+  u64 hash = __ev_set_hash(metadata, val);
+  if(__ev_set_find(*s, val, hash) != __EV_SET_NOT_FOUND) {
+    return EV_SET_ERR_EXISTS;
+  }
+  return __ev_set_insert_new(s, val, hash);
+}
+
+bool
+ev_set_contains(
+  const void *set_p,
+  void *val)
+{
+  ev_set_t s = *(ev_set_t *)set_p;
+  __ev_set_getmeta(s)
+  return __ev_set_find(s, val, __ev_set_hash(metadata, val)) != __EV_SET_NOT_FOUND;
+}
+
+bool
+ev_set_remove(
+  void *set_p,
+  void *val)
+{
+  ev_set_t s = *(ev_set_t *)set_p;
+  __ev_set_getmeta(s)
+  u64 i = __ev_set_find(s, val, __ev_set_hash(metadata, val));
+  if(i == __EV_SET_NOT_FOUND) {
+    return false;
+  }
+  __ev_set_erase_at(s, i);
+  return true;
+}
+
+ev_set_error_t
+ev_set_reserve(
+  void *set_p,
+  u64 count)
+{
+  ev_set_t *s = (ev_set_t *)set_p;
+  __ev_set_getmeta(*s)
+  if(count + metadata->tombstones <= metadata->capacity * EV_SET_MAX_LOAD) {
+    return EV_SET_ERR_NONE;
+  }
+  u64 new_cap = __ev_set_capacity_for(count);
+  if(new_cap < metadata->capacity) {
+    new_cap = metadata->capacity;
+  }
+  return __ev_set_rehash(s, new_cap);
+}
+
+u64
+ev_set_len(
+  const void *set_p)
+{
+  ev_set_t s = *(ev_set_t *)set_p;
+  __ev_set_getmeta(s)
+  return metadata->length;
+}
+
+void
+ev_set_clear(
+  void *set_p)
+{
+  ev_set_t *s = (ev_set_t *)set_p;
+  __ev_set_getmeta(*s)
+
+  if(metadata->typeData.free_fn) {
+    for(void *elem = ev_set_iter_begin(s); elem != ev_set_iter_end(s); ev_set_iter_next(s, &elem)) {
+      metadata->typeData.free_fn(elem);
+    }
+  }
+  memset(metadata->ctrl, __EV_SET_CTRL_EMPTY, metadata->capacity);
+  metadata->length = 0;
+  metadata->tombstones = 0;
+}
+
+ev_set_t
+ev_set_dup(
+  const void *set_p)
+{
+  ev_set_t s = *(ev_set_t *)set_p;
+  __ev_set_getmeta(s)
+  ev_set_t new_s = __ev_set_alloc(metadata->typeData, metadata->capacity);
+  if(!new_s) {
+    return NULL;
+  }
+  struct ev_set_meta_t *new_meta = ((struct ev_set_meta_t *)new_s) - 1;
+
+  // Same capacity means that every element keeps its slot
+  memcpy(new_meta->ctrl, metadata->ctrl, metadata->capacity);
+  memcpy(new_meta->hashes, metadata->hashes, metadata->capacity * sizeof(u64));
+  if(metadata->typeData.copy_fn) {
+    for(u64 i = 0; i < metadata->capacity; i++) {
+      if(__EV_SET_CTRL_ISFULL(metadata->ctrl[i])) {
+        metadata->typeData.copy_fn(__ev_set_slot(new_s, i), __ev_set_slot(s, i));
+      }
+    }
+  } else {
+    memcpy(new_s, s, metadata->capacity * metadata->typeData.size);
+  }
+  new_meta->length = metadata->length;
+  new_meta->tombstones = metadata->tombstones;
+
+  return new_s;
+}
+
+void *
+ev_set_iter_begin(
+  const void *set_p)
+{
+  ev_set_t s = *(ev_set_t *)set_p;
+  __ev_set_getmeta(s)
+  u64 i = 0;
+  while(i < metadata->capacity && !__EV_SET_CTRL_ISFULL(metadata->ctrl[i])) {
+    i++;
+  }
+  return __ev_set_slot(s, i);
+}
+
+void *
+ev_set_iter_end(
+  const void *set_p)
+{
+  ev_set_t s = *(ev_set_t *)set_p;
+  __ev_set_getmeta(s)
+  return __ev_set_slot(s, metadata->capacity);
+}
+
+void
+ev_set_iter_next(
+  const void *set_p,
+  void **iter)
+{
+  ev_set_t s = *(ev_set_t *)set_p;
+  __ev_set_getmeta(s)
+  u64 i = ((u8 *)*iter - (u8 *)s) / metadata->typeData.size + 1;
+  while(i < metadata->capacity && !__EV_SET_CTRL_ISFULL(metadata->ctrl[i])) {
+    i++;
+  }
+  *iter = __ev_set_slot(s, i);
+}
+
+ev_set_t
+ev_set_union(
+  const void *a_p,
+  const void *b_p)
+{
+  ev_set_t large = *(ev_set_t *)a_p;
+  ev_set_t small = *(ev_set_t *)b_p;
+  if(ev_set_len(&large) < ev_set_len(&small)) {
+    ev_set_t tmp = large; large = small; small = tmp;
+  }
+
+  ev_set_t res = ev_set_dup(&large);
+  if(!res || ev_set_reserve(&res, ev_set_len(&large) + ev_set_len(&small))) {
+    if(res) {
+      ev_set_fini(&res);
+    }
+    return NULL;
+  }
+
+  __ev_set_getmeta(small)
+  for(u64 i = 0; i < metadata->capacity; i++) {
+    if(__EV_SET_CTRL_ISFULL(metadata->ctrl[i])) {
+      void *elem = __ev_set_slot(small, i);
+      u64 hash = metadata->hashes[i];
+      if(__ev_set_find(res, elem, hash) == __EV_SET_NOT_FOUND) {
+        __ev_set_insert_new(&res, elem, hash);
+      }
+    }
+  }
+  return res;
+}
+
+ev_set_t
+ev_set_intersection(
+  const void *a_p,
+  const void *b_p)
+{
+  ev_set_t large = *(ev_set_t *)a_p;
+  ev_set_t small = *(ev_set_t *)b_p;
+  if(ev_set_len(&large) < ev_set_len(&small)) {
+    ev_set_t tmp = large; large = small; small = tmp;
+  }
+
+  __ev_set_getmeta(small)
+  ev_set_t res = __ev_set_alloc(metadata->typeData, __ev_set_capacity_for(metadata->length));
+  if(!res) {
+    return NULL;
+  }
+
+  for(u64 i = 0; i < metadata->capacity; i++) {
+    if(__EV_SET_CTRL_ISFULL(metadata->ctrl[i])) {
+      void *elem = __ev_set_slot(small, i);
+      u64 hash = metadata->hashes[i];
+      if(__ev_set_find(large, elem, hash) != __EV_SET_NOT_FOUND) {
+        __ev_set_insert_new(&res, elem, hash);
+      }
+    }
+  }
+  return res;
+}
+
+ev_set_t
+ev_set_difference(
+  const void *a_p,
+  const void *b_p)
+{
+  ev_set_t a = *(ev_set_t *)a_p;
+  ev_set_t b = *(ev_set_t *)b_p;
+  ev_set_t res = NULL;
+
+  if(ev_set_len(&a) <= ev_set_len(&b)) {
+    __ev_set_getmeta(a)
+    res = __ev_set_alloc(metadata->typeData, __ev_set_capacity_for(metadata->length));
+    if(!res) {
+      return NULL;
+    }
+    for(u64 i = 0; i < metadata->capacity; i++) {
+      if(__EV_SET_CTRL_ISFULL(metadata->ctrl[i])) {
+        void *elem = __ev_set_slot(a, i);
+        u64 hash = metadata->hashes[i];
+        if(__ev_set_find(b, elem, hash) == __EV_SET_NOT_FOUND) {
+          __ev_set_insert_new(&res, elem, hash);
+        }
+      }
+    }
+  } else {
+    res = ev_set_dup(&a);
+    if(!res) {
+      return NULL;
+    }
+    __ev_set_getmeta(b)
+    for(u64 i = 0; i < metadata->capacity; i++) {
+      if(__EV_SET_CTRL_ISFULL(metadata->ctrl[i])) {
+        u64 idx = __ev_set_find(res, __ev_set_slot(b, i), metadata->hashes[i]);
+        if(idx != __EV_SET_NOT_FOUND) {
+          __ev_set_erase_at(res, idx);
+        }
+      }
+    }
+  }
+  return res;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,675 @@
+/*!
+ * \file ev_sketch.h
+ * \brief Fixed-memory stream sketches: HyperLogLog for distinct counts and
+ * count-min for frequencies
+ */
+#ifndef EV_SKETCH_HEADER
+#define EV_SKETCH_HEADER
+
+#include "ev_types.h"
+
+#if defined(EV_SKETCH_SHARED)
+# if defined (EV_SKETCH_IMPL)
+#  define EV_SKETCH_API EV_EXPORT
+# else
+#  define EV_SKETCH_API EV_IMPORT
+# endif
+#else
+# define EV_SKETCH_API
+#endif
+
+#ifndef EV_SKETCH_HASH_SEED
+/*!
+ * \brief Seed used when hashing raw buffers and types without a hash hook.
+ * Matches the other evol headers so that precomputed hashes (for example
+ * `evstring_hash`) can be passed directly.
+ */
+#define EV_SKETCH_HASH_SEED 0
+#endif
+
+//! Smallest and largest supported HyperLogLog precisions
+#define EV_HLL_MIN_PRECISION 4
+#define EV_HLL_MAX_PRECISION 16
+
+typedef enum {
+  EV_SKETCH_ERR_NONE = 0,
+  EV_SKETCH_ERR_OOM = 1,
+  //! Sketches that are merged must have been created with the same parameters
+  EV_SKETCH_ERR_MISMATCH = 2,
+  EV_SKETCH_ERR_INVALID_PARAMS = 3
+} ev_sketch_error_t;
+TYPEDATA_GEN(ev_sketch_error_t, DEFAULT(EV_SKETCH_ERR_NONE));
+
+/*!
+ * \brief HyperLogLog distinct counter. Starts with a sparse list of the
+ * registers that were touched, and switches to a dense array of `2^p` one-byte
+ * registers once the list would take more memory than that. The standard
+ * error of the estimate is about `1.04 / sqrt(2^p)`.
+ */
+typedef struct {
+  u8 p;
+  bool sparse;
+  u32 sparse_len;
+  u32 sparse_cap;
+  //! Sorted `(index << 8) | rank` entries; only used in sparse mode
+  u32 *sparse_list;
+  //! `2^p` registers; only used in dense mode
+  u8 *registers;
+} ev_hll_t;
+
+/*!
+ * \brief Count-min sketch with conservative update. Estimates never
+ * undercount, and overcount by at most `e / width` of the total count with
+ * probability `1 - e^-depth`.
+ */
+typedef struct {
+  u32 width;
+  u32 depth;
+  //! Sum of all the counts that were added
+  u64 total;
+  //! `depth` rows of `width` saturating counters
+  u32 *counters;
+} ev_cms_t;
+
+/*!
+ * \brief Creates an empty HyperLogLog sketch with `2^p` registers. `p = 12`
+ * gives a ~1.6% standard error in 4KB.
+ *
+ * \returns `EV_SKETCH_ERR_INVALID_PARAMS` if `p` is out of range
+ */
+EV_SKETCH_API ev_sketch_error_t
+ev_hll_init(
+  ev_hll_t *h,
+  u8 p);
+
+EV_SKETCH_API void
+ev_hll_fini(
+  ev_hll_t *h);
+
+/*!
+ * \brief Adds an element by its 64-bit hash
+ *
+ * \returns `EV_SKETCH_ERR_OOM` if the sketch needed memory and could not get it
+ */
+EV_SKETCH_API ev_sketch_error_t
+ev_hll_add_hash(
+  ev_hll_t *h,
+  u64 hash);
+
+/*!
+ * \brief Adds `len` bytes at `data` as one element
+ */
+EV_SKETCH_API ev_sketch_error_t
+ev_hll_add(
+  ev_hll_t *h,
+  const void *data,
+  u64 len);
+
+/*!
+ * \brief Adds a value through its type's hash hook. Types without one are
+ * hashed bytewise.
+ */
+EV_SKETCH_API ev_sketch_error_t
+ev_hll_add_typed(
+  ev_hll_t *h,
+  EvTypeData typeData,
+  void *val);
+
+/*!
+ * \brief Syntactic sugar for `ev_hll_add_typed()`
+ * \details Sample usage:
+ * ```
+ * ev_hll_add_value(&h, evstring, &name);
+ * ```
+ */
+#define ev_hll_add_value(h, T, val_p) ev_hll_add_typed(h, TypeData(T), val_p)
+
+/*!
+ * \returns The estimated number of distinct elements that were added
+ */
+EV_SKETCH_API f64
+ev_hll_estimate(
+  const ev_hll_t *h);
+
+/*!
+ * \brief Merges `src` into `dst`. The result is identical to a sketch that
+ * saw both streams, so per-thread sketches can be combined without loss.
+ *
+ * \returns `EV_SKETCH_ERR_MISMATCH` if the precisions differ
+ */
+EV_SKETCH_API ev_sketch_error_t
+ev_hll_merge(
+  ev_hll_t *dst,
+  const ev_hll_t *src);
+
+EV_SKETCH_API void
+ev_hll_clear(
+  ev_hll_t *h);
+
+/*!
+ * \brief Creates a count-min sketch with `depth` rows of `width` counters.
+ */
+EV_SKETCH_API ev_sketch_error_t
+ev_cms_init(
+  ev_cms_t *c,
+  u32 width,
+  u32 depth);
+
+/*!
+ * \brief Creates a count-min sketch whose estimates exceed the true count by
+ * at most `epsilon * total` with probability `1 - delta`.
+ *
+ * \returns `EV_SKETCH_ERR_INVALID_PARAMS` if `epsilon` is not positive,
+ * `delta` is not in (0, 1), or the sketch would be more than 2^32 - 1
+ * counters wide
+ */
+EV_SKETCH_API ev_sketch_error_t
+ev_cms_init_error(
+  ev_cms_t *c,
+  f64 epsilon,
+  f64 delta);
+
+EV_SKETCH_API void
+ev_cms_fini(
+  ev_cms_t *c);
+
+/*!
+ * \brief Adds `count` occurrences of the element with the given 64-bit hash.
+ * Only the counters that are at the current minimum are increased
+ * (conservative update).
+ */
+EV_SKETCH_API void
+ev_cms_add_hash(
+  ev_cms_t *c,
+  u64 hash,
+  u32 count);
+
+EV_SKETCH_API void
+ev_cms_add(
+  ev_cms_t *c,
+  const void *data,
+  u64 len,
+  u32 count);
+
+EV_SKETCH_API void
+ev_cms_add_typed(
+  ev_cms_t *c,
+  EvTypeData typeData,
+  void *val,
+  u32 count);
+
+#define ev_cms_add_value(c, T, val_p, count) ev_cms_add_typed(c, TypeData(T), val_p, count)
+
+/*!
+ * \returns An upper bound on how many times the element was added
+ */
+EV_SKETCH_API u32
+ev_cms_estimate_hash(
+  const ev_cms_t *c,
+  u64 hash);
+
+EV_SKETCH_API u32
+ev_cms_estimate(
+  const ev_cms_t *c,
+  const void *data,
+  u64 len);
+
+EV_SKETCH_API u32
+ev_cms_estimate_typed(
+  const ev_cms_t *c,
+  EvTypeData typeData,
+  void *val);
+
+#define ev_cms_estimate_value(c, T, val_p) ev_cms_estimate_typed(c, TypeData(T), val_p)
+
+/*!
+ * \brief Adds the counters of `src` to `dst`. Estimates of the merged sketch
+ * are still upper bounds of the combined counts.
+ *
+ * \returns `EV_SKETCH_ERR_MISMATCH` if the dimensions differ
+ */
+EV_SKETCH_API ev_sketch_error_t
+ev_cms_merge(
+  ev_cms_t *dst,
+  const ev_cms_t *src);
+
+EV_SKETCH_API void
+ev_cms_clear(
+  ev_cms_t *c);
+
+#ifdef EV_SKETCH_IMPLEMENTATION
+#undef EV_SKETCH_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define __EV_HLL_ENTRY(idx, rank) (((u32)(idx) << 8) | (rank))
+#define __EV_HLL_ENTRY_IDX(e) ((e) >> 8)
+#define __EV_HLL_ENTRY_RANK(e) ((u8)((e) & 0xFF))
+#define __EV_HLL_INIT_SPARSE_CAP 16
+
+static inline u32
+__ev_sketch_clz64(
+  u64 x)
+{
+#if EV_CC_MSVC
+  unsigned long idx;
+  _BitScanReverse64(&idx, x);
+  return 63 - (u32)idx;
+#else
+  return (u32)__builtin_clzll(x);
+#endif
+}
+
+static inline u64
+__ev_sketch_hash_typed(
+  EvTypeData typeData,
+  void *val)
+{
+  if(typeData.hash_fn) {
+    return typeData.hash_fn(val, EV_SKETCH_HASH_SEED);
+  }
+  return ev_hash_murmur3(val, typeData.size, EV_SKETCH_HASH_SEED);
+}
+
+ev_sketch_error_t
+ev_hll_init(
+  ev_hll_t *h,
+  u8 p)
+{
+  if(p < EV_HLL_MIN_PRECISION || p > EV_HLL_MAX_PRECISION) {
+    return EV_SKETCH_ERR_INVALID_PARAMS;
+  }
+  *h = (ev_hll_t) {
+    .p = p,
+    .sparse = true,
+  };
+  return EV_SKETCH_ERR_NONE;
+}
+
+void
+ev_hll_fini(
+  ev_hll_t *h)
+{
+  free(h->sparse_list);
+  free(h->registers);
+  h->sparse_list = NULL;
+  h->registers = NULL;
+}
+
+static ev_sketch_error_t
+__ev_hll_to_dense(
+  ev_hll_t *h)
+{
+  u8 *registers = calloc(1ull << h->p, 1);
+  if(!registers) {
+    return EV_SKETCH_ERR_OOM;
+  }
+  for(u32 i = 0; i < h->sparse_len; i++) {
+    u32 e = h->sparse_list[i];
+    registers[__EV_HLL_ENTRY_IDX(e)] = __EV_HLL_ENTRY_RANK(e);
+  }
+  free(h->sparse_list);
+  h->sparse_list = NULL;
+  h->sparse_len = 0;
+  h->sparse_cap = 0;
+  h->registers = registers;
+  h->sparse = false;
+  return EV_SKETCH_ERR_NONE;
+}
+
+static ev_sketch_error_t
+__ev_hll_set_register(
+  ev_hll_t *h,
+  u32 idx,
+  u8 rank)
+{
+  if(!h->sparse) {
+    if(h->registers[idx] < rank) {
+      h->registers[idx] = rank;
+    }
+    return EV_SKETCH_ERR_NONE;
+  }
+
+  // Binary search for the register's entry
+  u32 lo = 0, hi = h->sparse_len;
+  while(lo < hi) {
+    u32 mid = (lo + hi) / 2;
+    if(__EV_HLL_ENTRY_IDX(h->sparse_list[mid]) < idx) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if(lo < h->sparse_len && __EV_HLL_ENTRY_IDX(h->sparse_list[lo]) == idx) {
+    if(__EV_HLL_ENTRY_RANK(h->sparse_list[lo]) < rank) {
+      h->sparse_list[lo] = __EV_HLL_ENTRY(idx, rank);
+    }
+    return EV_SKETCH_ERR_NONE;
+  }
+
+  if(h->sparse_len == h->sparse_cap) {
+    // The sparse list stops paying off once it is as large as the registers
+    u32 max_entries = (1u << h->p) / sizeof(u32);
+    if(h->sparse_cap >= max_entries) {
+      ev_sketch_error_t err = __ev_hll_to_dense(h);
+      if(err) {
+        return err;
+      }
+      return __ev_hll_set_register(h, idx, rank);
+    }
+    u32 new_cap = h->sparse_cap ? h->sparse_cap * 2 : __EV_HLL_INIT_SPARSE_CAP;
+    if(new_cap > max_entries) {
+      new_cap = max_entries;
+    }
+    u32 *new_list = realloc(h->sparse_list, new_cap * sizeof(u32));
+    if(!new_list) {
+      return EV_SKETCH_ERR_OOM;
+    }
+    h->sparse_list = new_list;
+    h->sparse_cap = new_cap;
+  }
+
+  memmove(&h->sparse_list[lo + 1], &h->sparse_list[lo], (h->sparse_len - lo) * sizeof(u32));
+  h->sparse_list[lo] = __EV_HLL_ENTRY(idx, rank);
+  h->sparse_len++;
+  return EV_SKETCH_ERR_NONE;
+}
+
+ev_sketch_error_t
+ev_hll_add_hash(
+  ev_hll_t *h,
+  u64 hash)
+{
+  u32 idx = (u32)(hash >> (64 - h->p));
+  u64 rest = hash << h->p;
+  u8 rank = rest ? (u8)(__ev_sketch_clz64(rest) + 1) : (u8)(64 - h->p + 1);
+  return __ev_hll_set_register(h, idx, rank);
+}
+
+ev_sketch_error_t
+ev_hll_add(
+  ev_hll_t *h,
+  const void *data,
+  u64 len)
+{
+  return ev_hll_add_hash(h, ev_hash_murmur3(data, (u32)len, EV_SKETCH_HASH_SEED));
+}
+
+ev_sketch_error_t
+ev_hll_add_typed(
+  ev_hll_t *h,
+  EvTypeData typeData,
+  void *val)
+{
+  return ev_hll_add_hash(h, __ev_sketch_hash_typed(typeData, val));
+}
+
+static f64
+__ev_hll_sigma(
+  f64 x)
+{
+  if(x == 1.0) {
+    return INFINITY;
+  }
+  f64 y = 1.0;
+  f64 z = x;
+  f64 z_prev;
+  do {
+    x *= x;
+    z_prev = z;
+    z += x * y;
+    y += y;
+  } while(z != z_prev);
+  return z;
+}
+
+static f64
+__ev_hll_tau(
+  f64 x)
+{
+  if(x == 0.0 || x == 1.0) {
+    return 0.0;
+  }
+  f64 y = 1.0;
+  f64 z = 1.0 - x;
+  f64 z_prev;
+  do {
+    x = sqrt(x);
+    z_prev = z;
+    y *= 0.5;
+    z -= (1.0 - x) * (1.0 - x) * y;
+  } while(z != z_prev);
+  return z / 3.0;
+}
+
+// Uses the estimator from Ertl's "New cardinality estimation algorithms for
+// HyperLogLog sketches", which is unbiased over the whole range without
+// empirical correction tables or a switch to linear counting.
+f64
+ev_hll_estimate(
+  const ev_hll_t *h)
+{
+  u32 m = 1u << h->p;
+  u32 q = 64 - h->p;
+  u32 histogram[64 + 2] = { 0 };
+
+  if(h->sparse) {
+    histogram[0] = m - h->sparse_len;
+    for(u32 i = 0; i < h->sparse_len; i++) {
+      histogram[__EV_HLL_ENTRY_RANK(h->sparse_list[i])]++;
+    }
+  } else {
+    for(u32 i = 0; i < m; i++) {
+      histogram[h->registers[i]]++;
+    }
+  }
+
+  f64 z = m * __ev_hll_tau(1.0 - (f64)histogram[q + 1] / m);
+  for(u32 k = q; k >= 1; k--) {
+    z = 0.5 * (z + histogram[k]);
+  }
+  z += m * __ev_hll_sigma((f64)histogram[0] / m);
+
+  const f64 alpha_inf = 0.5 / 0.69314718055994530942;
+  return alpha_inf * (f64)m * (f64)m / z;
+}
+
+ev_sketch_error_t
+ev_hll_merge(
+  ev_hll_t *dst,
+  const ev_hll_t *src)
+{
+  if(dst->p != src->p) {
+    return EV_SKETCH_ERR_MISMATCH;
+  }
+
+  if(src->sparse) {
+    for(u32 i = 0; i < src->sparse_len; i++) {
+      u32 e = src->sparse_list[i];
+      ev_sketch_error_t err = __ev_hll_set_register(dst, __EV_HLL_ENTRY_IDX(e), __EV_HLL_ENTRY_RANK(e));
+      if(err) {
+        return err;
+      }
+    }
+    return EV_SKETCH_ERR_NONE;
+  }
+
+  if(dst->sparse) {
+    ev_sketch_error_t err = __ev_hll_to_dense(dst);
+    if(err) {
+      return err;
+    }
+  }
+  for(u32 i = 0; i < (1u << dst->p); i++) {
+    if(dst->registers[i] < src->registers[i]) {
+      dst->registers[i] = src->registers[i];
+    }
+  }
+  return EV_SKETCH_ERR_NONE;
+}
+
+void
+ev_hll_clear(
+  ev_hll_t *h)
+{
+  u8 p = h->p;
+  ev_hll_fini(h);
+  ev_hll_init(h, p);
+}
+
+ev_sketch_error_t
+ev_cms_init(
+  ev_cms_t *c,
+  u32 width,
+  u32 depth)
+{
+  if(width == 0 || depth == 0) {
+    return EV_SKETCH_ERR_INVALID_PARAMS;
+  }
+  u32 *counters = calloc((u64)width * depth, sizeof(u32));
+  if(!counters) {
+    return EV_SKETCH_ERR_OOM;
+  }
+  *c = (ev_cms_t) {
+    .width = width,
+    .depth = depth,
+    .total = 0,
+    .counters = counters
+  };
+  return EV_SKETCH_ERR_NONE;
+}
+
+ev_sketch_error_t
+ev_cms_init_error(
+  ev_cms_t *c,
+  f64 epsilon,
+  f64 delta)
+{
+  // Also rejects NaN
+  if(!(epsilon > 0.0) || !(delta > 0.0 && delta < 1.0)) {
+    return EV_SKETCH_ERR_INVALID_PARAMS;
+  }
+  const f64 e = 2.71828182845904523536;
+  f64 width = ceil(e / epsilon);
+  f64 depth = ceil(-log(delta));
+  // Dimensions that do not fit in a u32 could never be allocated anyway
+  if(!(width <= (f64)0xFFFFFFFFu) || !(depth <= (f64)0xFFFFFFFFu)) {
+    return EV_SKETCH_ERR_INVALID_PARAMS;
+  }
+  return ev_cms_init(c, (u32)width, (u32)depth);
+}
+
+void
+ev_cms_fini(
+  ev_cms_t *c)
+{
+  free(c->counters);
+  c->counters = NULL;
+}
+
+// Row i uses counter `(h1 + i * h2) % width`, with h1 and h2 being the two
+// 32-bit halves of the element's hash.
+#define __ev_cms_index(c, hash, row) \
+  ((u64)(row) * (c)->width + ((u32)(hash) + (row) * ((u32)((hash) >> 32) | 1)) % (c)->width)
+
+void
+ev_cms_add_hash(
+  ev_cms_t *c,
+  u64 hash,
+  u32 count)
+{
+  u32 current = ev_cms_estimate_hash(c, hash);
+  u32 target = (current > ~0u - count) ? ~0u : current + count;
+  for(u32 row = 0; row < c->depth; row++) {
+    u32 *counter = &c->counters[__ev_cms_index(c, hash, row)];
+    if(*counter < target) {
+      *counter = target;
+    }
+  }
+  c->total += count;
+}
+
+void
+ev_cms_add(
+  ev_cms_t *c,
+  const void *data,
+  u64 len,
+  u32 count)
+{
+  ev_cms_add_hash(c, ev_hash_murmur3(data, (u32)len, EV_SKETCH_HASH_SEED), count);
+}
+
+void
+ev_cms_add_typed(
+  ev_cms_t *c,
+  EvTypeData typeData,
+  void *val,
+  u32 count)
+{
+  ev_cms_add_hash(c, __ev_sketch_hash_typed(typeData, val), count);
+}
+
+u32
+ev_cms_estimate_hash(
+  const ev_cms_t *c,
+  u64 hash)
+{
+  u32 min = ~0u;
+  for(u32 row = 0; row < c->depth; row++) {
+    u32 v = c->counters[__ev_cms_index(c, hash, row)];
+    if(v < min) {
+      min = v;
+    }
+  }
+  return min;
+}
+
+u32
+ev_cms_estimate(
+  const ev_cms_t *c,
+  const void *data,
+  u64 len)
+{
+  return ev_cms_estimate_hash(c, ev_hash_murmur3(data, (u32)len, EV_SKETCH_HASH_SEED));
+}
+
+u32
+ev_cms_estimate_typed(
+  const ev_cms_t *c,
+  EvTypeData typeData,
+  void *val)
+{
+  return ev_cms_estimate_hash(c, __ev_sketch_hash_typed(typeData, val));
+}
+
+ev_sketch_error_t
+ev_cms_merge(
+  ev_cms_t *dst,
+  const ev_cms_t *src)
+{
+  if(dst->width != src->width || dst->depth != src->depth) {
+    return EV_SKETCH_ERR_MISMATCH;
+  }
+  u64 n = (u64)dst->width * dst->depth;
+  for(u64 i = 0; i < n; i++) {
+    u32 a = dst->counters[i];
+    u32 b = src->counters[i];
+    dst->counters[i] = (a > ~0u - b) ? ~0u : a + b;
+  }
+  dst->total += src->total;
+  return EV_SKETCH_ERR_NONE;
+}
+
+void
+ev_cms_clear(
+  ev_cms_t *c)
+{
+  memset(c->counters, 0, (u64)c->width * c->depth * sizeof(u32));
+  c->total = 0;
+}
+
+#endif
+
+#endif
@@ -43,22 +43,119 @@
 #define EV_STR_GROWTH_FACTOR 3 / 2
 #endif
 
+#ifndef EV_STR_CACHE_HASH
+/*!
+ * \brief Whether evstrings keep their hash in their header once it is
+ * computed. Define as 0 to save 8 bytes per string.
+ */
+#define EV_STR_CACHE_HASH 1
+#endif
+
+#ifndef EV_STR_HASH_SEED
+/*!
+ * \brief Seed that is used by `evstring_hash`
+ */
+#define EV_STR_HASH_SEED 0
+#endif
+
+#ifndef EV_STR_ARENA_BLOCK_SIZE
+/*!
+ * \brief Size of the blocks that an `evstring_arena` allocates when it is
+ * initialized with a block size of 0
+ */
+#define EV_STR_ARENA_BLOCK_SIZE (64 * 1024)
+#endif
+
+#ifndef EV_STR_SMALL_CAPACITY
+/*!
+ * \brief Number of characters (excluding the null terminator) that an
+ * `evstring_small` can hold before it is moved to the heap
+ */
+#define EV_STR_SMALL_CAPACITY 23
+#endif
+
 typedef char *evstring;
 
 typedef enum {
     EV_STR_ERR_NONE = 0,
     EV_STR_ERR_OOM = -1,
+    //! The format string could not be processed by `vsnprintf`
+    EV_STR_ERR_FORMAT = -2,
+    //! The text is not a valid number
+    EV_STR_ERR_PARSE = -3,
+    //! The number does not fit in the requested type
+    EV_STR_ERR_RANGE = -4,
+    //! Writing the string to a file or descriptor failed
+    EV_STR_ERR_IO = -5,
+    //! Loaded data is not in the expected format
+    EV_STR_ERR_CORRUPT = -6,
 } evstring_error_t;
 TYPEDATA_GEN(evstring_error_t, DEFAULT(EV_STR_ERR_NONE));
 
+/*!
+ * \brief Memory callbacks that evstrings can be allocated with instead of
+ * `ev_str_malloc`. `free` can be NULL for allocators that release all of
+ * their memory at once, like `evstring_arena`.
+ */
+typedef struct evstring_allocator {
+    void *(*alloc)(void *ctx, u64 size);
+    //! The first `used` bytes at `ptr` must be kept
+    void *(*realloc)(void *ctx, void *ptr, u64 used, u64 new_size);
+    void (*free)(void *ctx, void *ptr);
+    void *ctx;
+} evstring_allocator;
+
+struct evstring_arena_block;
+
+/*!
+ * \brief Bump allocator for short-lived strings. Freeing one of its strings
+ * does nothing, and they are all released by `evstring_arena_reset` or
+ * `evstring_arena_fini`. The last string that was allocated grows in place
+ * while its block has room.
+ * \details Sample usage:
+ * ```
+ * evstring_arena arena;
+ * evstring_arena_init(&arena, 0);
+ *
+ * const evstring_allocator *prev = evstring_allocator_set(&arena.allocator);
+ * evstring path = evstring_new("%s/%s", dir, name); // Allocated in the arena
+ * evstring_push(&path, ".png");                     // Grows in place
+ * evstring_allocator_set(prev);
+ *
+ * evstring_arena_reset(&arena); // path is released
+ * ```
+ */
+typedef struct evstring_arena {
+    //! Passed to `evstring_allocator_set`
+    evstring_allocator allocator;
+    struct evstring_arena_block *blocks;
+    //! Start of the last allocation, which can grow in place
+    char *last;
+    u64 block_size;
+} evstring_arena;
+
+enum {
+    EV_STR_ALLOCATION_TYPE_STACK,
+    EV_STR_ALLOCATION_TYPE_HEAP,
+    EV_STR_ALLOCATION_TYPE_INLINE,
+    //! Allocated by an `evstring_allocator`, which is stored before the header
+    EV_STR_ALLOCATION_TYPE_CUSTOM
+};
+
 struct evstr_meta_t {
     EV_DEBUG(u64 magic;)
     u64 length;
     u64 size;
-    enum {
-        EV_STR_ALLOCATION_TYPE_STACK,
-        EV_STR_ALLOCATION_TYPE_HEAP
-    } allocationType;
+    //! Number of owners besides the first one. Strings with other owners are
+    //! shared, and are copied before they are modified.
+    u32 refcount;
+    //! One of `EV_STR_ALLOCATION_TYPE_*`, in a byte so that it fits next to
+    //! `refcount`
+    u8 allocationType;
+#if EV_STR_CACHE_HASH
+    bool hashValid;
+    u64 hash;
+#endif
 };
 
 #define __ev_strlen_const sizeof
@@ -72,14 +169,69 @@ struct evstr_meta_t {
         .data = str \
     }).data
 
+/*!
+ * \brief Fixed-size storage for a short evstring. Strings that are
+ * initialized in it need no heap allocation, and are moved to the heap
+ * automatically when a push needs more than `EV_STR_SMALL_CAPACITY`
+ * characters. The storage must outlive the string while it is inline.
+ * \details Sample usage:
+ * ```
+ * struct Component { evstring_small nameStorage; evstring name; };
+ * c->name = evstring_initSmall(&c->nameStorage, "Transform");
+ *
+ * evstring tmp = evstring_newSmall("tmp"); // Storage lives until the end of the block
+ * ```
+ */
+typedef struct {
+    struct evstr_meta_t meta;
+    char data[EV_STR_SMALL_CAPACITY + 1];
+} evstring_small;
+
+#define evstring_newSmall(str) evstring_initSmall(&(evstring_small){0}, str)
+
 typedef struct evstring_view {
   evstring data;
   u64 offset;
   u64 len;
 } evstring_view;
+TYPEDATA_GEN(evstring_view);
+
+/*!
+ * \brief Non-owning view over `len` bytes at `ptr`. Unlike `evstring_view`,
+ * the bytes do not need to belong to an evstring: they can be a string
+ * literal, a `mmap`ed file or a network buffer. They are not required to be
+ * null-terminated, and must outlive the view.
+ * \details Sample usage:
+ * ```
+ * ev_strview line = ev_strview_from(buf, received);
+ * ev_strview key, value;
+ * if(ev_strview_cut(line, '=', &key, &value)) {
+ *     i64 n;
+ *     ev_strview_parseI64(ev_strview_trim(value), &n);
+ * }
+ * ```
+ */
+typedef struct {
+    const char *ptr;
+    u64 len;
+} ev_strview;
+TYPEDATA_GEN(ev_strview);
+
+#define ev_strview_from(p, l) ((ev_strview) { .ptr = (p), .len = (l) })
+
+/*!
+ * \brief Set of bytes, as a 256-bit bitmap that SIMD code can index with byte
+ * shuffles: bit `c >> 4` of `low[c & 15]` is set if `c` (below 0x80) is in
+ * the set, and the same in `high` for the bytes from 0x80.
+ */
+typedef struct {
+    u8 low[16];
+    u8 high[16];
+} ev_str_charset;
 
 #define evstring_newGeneric(str) _Generic((str), \
         evstring_view: evstring_newFromView, \
+        ev_strview: evstring_newFromStrview, \
         default: evstring_newFromStr\
         )(str)
 
@@ -88,12 +240,63 @@ typedef struct evstring_view {
 #define evstring_pushGeneric(str, push) _Generic((push), \
         char: evstring_pushChar, \
         evstring_view: evstring_pushView, \
+        ev_strview: evstring_pushStrview, \
         default: evstring_pushStr \
         )(str, push)
 
 #define evstring_push(str, push, ...) \
     EV_VA_OPT_ELSE(__VA_ARGS__)(evstring_pushFmt(str, push, __VA_ARGS__))(evstring_pushGeneric(str, push))
 
+/*!
+ * \brief Allocates a string of length `len` and copies `data` into it. If
+ * `data` is NULL, the content is left uninitialized for the caller to fill.
+ */
+EV_STR_API evstring
+evstring_new_impl(
+    const char *data,
+    u64 len);
+
+/*!
+ * \brief Sets the allocator that new evstrings are allocated with on the
+ * calling thread, or restores the default heap allocator if `allocator` is
+ * NULL. Strings keep using the allocator that created them when they grow or
+ * are freed, after it is no longer the current one.
+ *
+ * \returns The previous allocator, to be restored when the scope ends
+ */
+EV_STR_API const evstring_allocator *
+evstring_allocator_set(
+    const evstring_allocator *allocator);
+
+/*!
+ * \returns The allocator that new evstrings are allocated with on the calling
+ * thread, or NULL for the default heap allocator
+ */
+EV_STR_API const evstring_allocator *
+evstring_allocator_get(void);
+
+/*!
+ * \brief Initializes an empty arena. Blocks are `block_size` bytes, or
+ * `EV_STR_ARENA_BLOCK_SIZE` if it is 0. Larger strings get blocks of their
+ * own.
+ */
+EV_STR_API void
+evstring_arena_init(
+    evstring_arena *arena,
+    u64 block_size);
+
+/*!
+ * \brief Releases every string of the arena at once. The most recent block is
+ * kept for the next allocations.
+ */
+EV_STR_API void
+evstring_arena_reset(
+    evstring_arena *arena);
+
+EV_STR_API void
+evstring_arena_fini(
+    evstring_arena *arena);
+
 EV_STR_API evstring 
 evstring_newFromStr(
     const char *str);
@@ -102,14 +305,73 @@ EV_STR_API evstring
 evstring_newFromView(
     evstring_view v);
 
+/*!
+ * \brief Initializes a string in `storage` if it fits, otherwise allocates it
+ * on the heap. Either way, the result is freed with `evstring_free`.
+ */
+EV_STR_API evstring
+evstring_initSmall(
+    evstring_small *storage,
+    const char *str);
+
+EV_STR_API evstring
+evstring_initSmall_impl(
+    evstring_small *storage,
+    const char *data,
+    u64 len);
+
+/*!
+ * \brief Releases the string. A shared string is only freed once all of its
+ * owners released it.
+ */
 EV_STR_API void
 evstring_free(
     evstring s);
 
+/*!
+ * \brief Adds an owner to the string's characters instead of copying them,
+ * which turns it into a shared, immutable string. Every owner frees it with
+ * `evstring_free`, and an evstring function that modifies a shared string
+ * first gives the calling owner a private copy. Characters must not be written
+ * through the pointer while the string is shared; `evstring_detach` makes it
+ * private first.
+ *
+ * Strings that do not own their memory (`evstr` literals and strings in an
+ * `evstring_small`) are copied.
+ * \details Sample usage:
+ * ```
+ * evstring config = load_config();
+ * evstring for_renderer = evstring_share(config); // Refcount increment
+ * evstring_push(&for_renderer, "\n# local");      // Copies it first
+ * evstring_free(config);
+ * ```
+ *
+ * \returns The new owner
+ */
+EV_STR_API evstring
+evstring_share(
+    const evstring s);
+
+EV_STR_API bool
+evstring_isShared(
+    const evstring s);
+
+/*!
+ * \brief Replaces a shared string with a private copy that only `*s` owns.
+ * Does nothing if the string is not shared.
+ */
+EV_STR_API evstring_error_t
+evstring_detach(
+    evstring *s);
+
 EV_STR_API u64
 evstring_getLength(
     const evstring s);
 
+/*!
+ * \brief Sets the length and writes the null terminator after it. Characters
+ * that a longer length adds are uninitialized.
+ */
 EV_STR_API evstring_error_t
 evstring_setLength(
     evstring *s,
@@ -120,6 +382,15 @@ evstring_cmp(
     const evstring s1,
     const evstring s2);
 
+/*!
+ * \brief Hashes the string's content with `EV_STR_HASH_SEED`. If
+ * `EV_STR_CACHE_HASH` is enabled, the hash is computed on the first call and
+ * kept until the string is modified through an evstring function.
+ */
+EV_STR_API u64
+evstring_hash(
+    const evstring s);
+
 EV_STR_API evstring_error_t
 evstring_pushChar(
     evstring *s,
@@ -136,6 +407,91 @@ evstring_pushFmt(
     const char *fmt,
     ...);
 
+/*!
+ * \brief Appends the decimal representation of a number, picking the push
+ * function from the number's type
+ * \details Sample usage:
+ * ```
+ * evstring_pushNum(&s, (u32)42);   // "42"
+ * evstring_pushNum(&s, 0.1);       // "0.1"
+ * evstring_pushNum(&s, 1e100);     // "1e+100"
+ * ```
+ */
+#define evstring_pushNum(s, n) _Generic((n), \
+        f32: evstring_pushF32, \
+        f64: evstring_pushF64, \
+        u8: evstring_pushU64, \
+        u16: evstring_pushU64, \
+        u32: evstring_pushU64, \
+        u64: evstring_pushU64, \
+        unsigned long: evstring_pushU64, \
+        default: evstring_pushI64 \
+        )(s, n)
+
+EV_STR_API evstring_error_t
+evstring_pushI64(
+    evstring *s,
+    i64 v);
+
+EV_STR_API evstring_error_t
+evstring_pushU64(
+    evstring *s,
+    u64 v);
+
+/*!
+ * \brief Appends the shortest decimal representation that reads back as
+ * exactly `v`, computed with the Ryu algorithm. Does not depend on the locale.
+ * Numbers in `[1e-6, 1e21)` are written in fixed notation ("0.001",
+ * "123.5"), and others in scientific notation ("1e+21", "2.5e-7"). Special
+ * values are written as "nan", "inf" and "-inf".
+ */
+EV_STR_API evstring_error_t
+evstring_pushF64(
+    evstring *s,
+    f64 v);
+
+/*!
+ * \brief Same as `evstring_pushF64`, with the shortest representation that
+ * reads back as the same `f32`
+ */
+EV_STR_API evstring_error_t
+evstring_pushF32(
+    evstring *s,
+    f32 v);
+
+/*!
+ * \brief Parses a whole view as a decimal integer with an optional sign.
+ *
+ * \returns `EV_STR_ERR_PARSE` if the view is not a number, or
+ * `EV_STR_ERR_RANGE` if it does not fit in `*out`. `*out` is only written on
+ * success.
+ */
+EV_STR_API evstring_error_t
+evstring_view_parseI64(
+    evstring_view v,
+    i64 *out);
+
+EV_STR_API evstring_error_t
+evstring_view_parseU64(
+    evstring_view v,
+    u64 *out);
+
+/*!
+ * \brief Parses a whole view as a decimal floating-point number ("1", "-2.5",
+ * ".5e-3", "inf", "nan"), rounded to the nearest `f64`. Numbers with up to 19
+ * significant digits are converted with the Eisel-Lemire algorithm; the rare
+ * inputs that it can not decide, such as longer mantissas and subnormals, are
+ * converted exactly from their decimal digits. The decimal separator is always
+ * '.', whatever the locale.
+ *
+ * \returns `EV_STR_ERR_PARSE` if the view is not a number. Values out of range
+ * become infinity or zero, like with `strtod`.
+ */
+EV_STR_API evstring_error_t
+evstring_view_parseF64(
+    evstring_view v,
+    f64 *out);
+
 EV_STR_API evstring
 evstring_newFromView(
     evstring_view view);
@@ -155,6 +511,23 @@ EV_STR_API void
 evstring_clear(
     evstring *s);
 
+/*!
+ * \returns The number of characters that can be pushed to the string before
+ * it needs to be reallocated
+ */
+EV_STR_API u64
+evstring_getSpace(
+    const evstring s);
+
+/*!
+ * \brief Makes sure that the string can hold `capacity` characters without
+ * being reallocated. Never shrinks the string.
+ */
+EV_STR_API evstring_error_t
+evstring_reserve(
+    evstring *s,
+    u64 capacity);
+
 EV_STR_API evstring
 evstring_newFmt(
     const char *fmt,
@@ -171,17 +544,133 @@ evstring_findFirst(
     const evstring text,
     const evstring query);
 
-evstring_view
+EV_STR_API evstring_view
 __evstring_findFirst_impl(
     evstring_view text,
     evstring_view query);
 
+/*!
+ * \brief A query and the string that replaces it
+ */
+typedef struct {
+    evstring query;
+    evstring replacement;
+} evstring_replace_pair;
+
+/*!
+ * \returns A copy of `text` where the first occurrence of `query` is replaced
+ * by `replacement`. The result is allocated once, with its exact length.
+ */
 EV_STR_API evstring
 evstring_replaceFirst(
     const evstring text,
     const evstring query,
     const evstring replacement);
 
+/*!
+ * \returns A copy of `text` where every non-overlapping occurrence of `query`,
+ * from left to right, is replaced by `replacement`. All matches are found
+ * before the result is allocated once, with its exact length.
+ */
+EV_STR_API evstring
+evstring_replaceAll(
+    const evstring text,
+    const evstring query,
+    const evstring replacement);
+
+/*!
+ * \brief Same as `evstring_replaceAll`, for several queries in a single pass.
+ * At every position, the query that matches first wins; when two queries
+ * match at the same position, the one that comes first in `pairs` wins.
+ * Replaced text is not searched again.
+ * \details Sample usage:
+ * ```
+ * evstring escaped = evstring_replaceMany(text, (evstring_replace_pair[]) {
+ *     { evstr("&"), evstr("&amp;") },
+ *     { evstr("<"), evstr("&lt;") },
+ *     { evstr(">"), evstr("&gt;") },
+ * }, 3);
+ * ```
+ */
+EV_STR_API evstring
+evstring_replaceMany(
+    const evstring text,
+    const evstring_replace_pair *pairs,
+    u32 count);
+
+/*!
+ * \brief Replaces every occurrence of `query` in `*s`. When the replacement is
+ * not longer than the query, the string is rewritten in place without any
+ * allocation. Otherwise, `*s` is grown to its final length first, which may
+ * reallocate it.
+ *
+ * \returns `EV_STR_ERR_OOM` if `*s` could not be grown or detached from a
+ * shared buffer, in which case it is left unchanged
+ */
+EV_STR_API evstring_error_t
+evstring_replaceAllInPlace(
+    evstring *s,
+    const evstring query,
+    const evstring replacement);
+
+/*!
+ * \brief Converts the ASCII letters of the string to lowercase (uppercase) in
+ * place. Other bytes, including UTF-8 sequences, are left as they are.
+ */
+EV_STR_API evstring_error_t
+evstring_toLower(
+    evstring *s);
+
+EV_STR_API evstring_error_t
+evstring_toUpper(
+    evstring *s);
+
+/*!
+ * \brief Replaces every `from` byte of the string with `to` in place. A
+ * shared string is only copied if it contains `from`.
+ * \details Sample usage:
+ * ```
+ * evstring_replaceChar(&path, '\\', '/');
+ * evstring_toLower(&path);
+ * ```
+ */
+EV_STR_API evstring_error_t
+evstring_replaceChar(
+    evstring *s,
+    char from,
+    char to);
+
+/*!
+ * \brief Removes the leading and trailing ASCII whitespace of the string in
+ * place. `evstring_view_trim` returns a view instead.
+ */
+EV_STR_API evstring_error_t
+evstring_trim(
+    evstring *s);
+
+EV_STR_API evstring_error_t
+evstring_trimLeft(
+    evstring *s);
+
+EV_STR_API evstring_error_t
+evstring_trimRight(
+    evstring *s);
+
+/*!
+ * \returns `v` without its leading and trailing ASCII whitespace
+ */
+EV_STR_API evstring_view
+evstring_view_trim(
+    evstring_view v);
+
+EV_STR_API evstring_view
+evstring_view_trimLeft(
+    evstring_view v);
+
+EV_STR_API evstring_view
+evstring_view_trimRight(
+    evstring_view v);
+
 EV_STR_API i64
 evstring_findFirstChar(
     const evstring text,
@@ -192,51 +681,561 @@ evstring_findLastChar(
     const evstring text,
     const char c);
 
-DEFINE_EQUAL_FUNCTION(evstring, Default)
-{
-  return evstring_cmp(*(evstring*)self, *(evstring*)other) == 0;
-}
+/*!
+ * \brief Value returned by the raw search functions when nothing is found
+ */
+#define EV_STR_NPOS (~0ull)
 
-DEFINE_COPY_FUNCTION(evstring, Default)
-{
-  *(evstring*)dst = evstring_newFromStr(*src);
-}
+/*!
+ * \brief Finds the first occurrence of `c` in `len` bytes of `data`, 16/32
+ * bytes at a time when SSE2/AVX2 are available.
+ *
+ * \returns Index of the match, or `EV_STR_NPOS`
+ */
+EV_STR_API u64
+ev_str_memchr(
+    const char *data,
+    u64 len,
+    char c);
 
-DEFINE_FREE_FUNCTION(evstring, Default)
-{
-  evstring_free(*self);
-}
+/*!
+ * \brief Same as `ev_str_memchr`, but scans backwards from the end.
+ *
+ * \returns Index of the last match, or `EV_STR_NPOS`
+ */
+EV_STR_API u64
+ev_str_memrchr(
+    const char *data,
+    u64 len,
+    char c);
 
-TYPEDATA_GEN(evstring,
-    EQUAL(Default),
-    COPY(Default),
-    FREE(Default)
-);
+/*!
+ * \brief Finds the first occurrence of `needle` in `data`. Candidates are
+ * filtered by comparing a vector of positions against the needle's first and
+ * last bytes at once, and only the positions where both match are verified.
+ * Inputs that produce too many false candidates (and builds without SIMD)
+ * fall back to the Two-Way algorithm, so the search is linear in the worst
+ * case.
+ *
+ * \returns Index of the match, or `EV_STR_NPOS`. An empty needle matches at 0.
+ */
+EV_STR_API u64
+ev_str_memmem(
+    const char *data,
+    u64 len,
+    const char *needle,
+    u64 needle_len);
 
+/*!
+ * \brief Compares `len` bytes of `a` and `b`, 32 bytes at a time when SSE2 or
+ * AVX2 are available.
+ *
+ * \returns Index of the first byte that differs, or `EV_STR_NPOS`
+ */
+EV_STR_API u64
+ev_str_mismatch(
+    const char *a,
+    const char *b,
+    u64 len);
 
-#if defined(EV_STR_IMPLEMENTATION)
+/*!
+ * \brief Same as `ev_str_mismatch`, but ASCII letters match regardless of
+ * case. Other bytes are compared as they are.
+ */
+EV_STR_API u64
+ev_str_mismatch_icase(
+    const char *a,
+    const char *b,
+    u64 len);
 
-#if EV_OS_WINDOWS
-#pragma comment(lib, "legacy_stdio_definitions.lib")
-#endif
+/*!
+ * \brief Writes `len` bytes of `src` to `dst` with their ASCII letters in
+ * lowercase, 32 bytes at a time when SSE2 or AVX2 are available. `dst` is
+ * either `src`, to convert in place, or a buffer that does not overlap it.
+ */
+EV_STR_API void
+ev_str_toLower(
+    char *dst,
+    const char *src,
+    u64 len);
 
-#include <string.h>
-#include <assert.h>
-#include <stdlib.h>
+EV_STR_API void
+ev_str_toUpper(
+    char *dst,
+    const char *src,
+    u64 len);
 
-#define META(s) (((struct evstr_meta_t *)(s)) - 1)
+/*!
+ * \brief Replaces every `from` in `len` bytes of `data` with `to`
+ */
+EV_STR_API void
+ev_str_replaceChar(
+    char *data,
+    u64 len,
+    char from,
+    char to);
 
-#if EV_BUILDTYPE_DEBUG || EV_BUILDTYPE_DEBUGOPT
-#define evstr_asserttype(str) \
-    assert(META(str)->magic == EV_STR_evstring_MAGIC)
-#else
-#define evstr_asserttype(str)
-#endif
+/*!
+ * \returns A set of the `len` bytes at `chars`
+ */
+EV_STR_API ev_str_charset
+ev_str_charset_from(
+    const char *chars,
+    u64 len);
 
-evstring_error_t
-evstring_addSpace(
-    evstring *s,
-    u64 space);
+/*!
+ * \returns A set of the characters of a null-terminated string
+ * \details Sample usage:
+ * ```
+ * const ev_str_charset separators = ev_str_charset_fromStr("/\\:");
+ * u64 end = ev_strview_findFirstOf(path, &separators);
+ * ```
+ */
+EV_STR_API ev_str_charset
+ev_str_charset_fromStr(
+    const char *chars);
+
+EV_STR_API bool
+ev_str_charset_has(
+    const ev_str_charset *set,
+    char c);
+
+/*!
+ * \brief Finds the first byte in `len` bytes of `data` that is in `set`.
+ * Bytes are classified 32 at a time with two table lookups through byte
+ * shuffles when SSSE3 or AVX2 are available.
+ *
+ * \returns Index of the match, or `EV_STR_NPOS`
+ */
+EV_STR_API u64
+ev_str_findFirstOf(
+    const char *data,
+    u64 len,
+    const ev_str_charset *set);
+
+/*!
+ * \brief Same as `ev_str_findFirstOf`, for the first byte that is not in
+ * `set`
+ */
+EV_STR_API u64
+ev_str_findFirstNotOf(
+    const char *data,
+    u64 len,
+    const ev_str_charset *set);
+
+EV_STR_API evstring
+evstring_newFromStrview(
+    ev_strview v);
+
+EV_STR_API evstring_error_t
+evstring_pushStrview(
+    evstring *s,
+    ev_strview v);
+
+/*!
+ * \returns A view over the whole string
+ */
+EV_STR_API ev_strview
+evstring_toStrview(
+    const evstring s);
+
+EV_STR_API ev_strview
+evstring_view_toStrview(
+    evstring_view v);
+
+/*!
+ * \returns A view over a null-terminated string, without the terminator
+ */
+EV_STR_API ev_strview
+ev_strview_fromStr(
+    const char *str);
+
+/*!
+ * \returns The bytes of `v` in `[begin, end)`
+ */
+EV_STR_API ev_strview
+ev_strview_slice(
+    ev_strview v,
+    u64 begin,
+    u64 end);
+
+EV_STR_API bool
+ev_strview_eq(
+    ev_strview a,
+    ev_strview b);
+
+/*!
+ * \brief Compares the bytes of two views as unsigned characters. A view that
+ * is a prefix of the other orders first.
+ *
+ * \returns A negative value, zero or a positive value if `a` orders before,
+ * equal to or after `b`
+ */
+EV_STR_API i32
+ev_strview_cmp(
+    ev_strview a,
+    ev_strview b);
+
+/*!
+ * \brief Same as `ev_strview_eq`, with ASCII letters folded to lowercase
+ */
+EV_STR_API bool
+ev_strview_eq_icase(
+    ev_strview a,
+    ev_strview b);
+
+/*!
+ * \brief Same as `ev_strview_cmp`, with ASCII letters folded to lowercase
+ * before they are compared
+ */
+EV_STR_API i32
+ev_strview_cmp_icase(
+    ev_strview a,
+    ev_strview b);
+
+EV_STR_API bool
+ev_strview_startsWith(
+    ev_strview v,
+    ev_strview prefix);
+
+EV_STR_API bool
+ev_strview_endsWith(
+    ev_strview v,
+    ev_strview suffix);
+
+/*!
+ * \brief Same as `ev_str_memmem`, on views
+ *
+ * \returns Index of the first occurrence of `query`, or `EV_STR_NPOS`
+ */
+EV_STR_API u64
+ev_strview_find(
+    ev_strview text,
+    ev_strview query);
+
+EV_STR_API u64
+ev_strview_findChar(
+    ev_strview v,
+    char c);
+
+EV_STR_API u64
+ev_strview_findLastChar(
+    ev_strview v,
+    char c);
+
+/*!
+ * \brief Splits `v` around the first `delim`. If there is none, `*before` is
+ * the whole view and `*after` is empty.
+ *
+ * \returns Whether `delim` was found
+ */
+EV_STR_API bool
+ev_strview_cut(
+    ev_strview v,
+    char delim,
+    ev_strview *before,
+    ev_strview *after);
+
+/*!
+ * \brief Moves the text before the next `delim` in `*rest` to `*token`, and
+ * skips the delimiter. A view with n delimiters yields n+1 tokens, some of
+ * which may be empty. After the last token, `*rest` is set to a NULL view.
+ * \details Sample usage:
+ * ```
+ * ev_strview rest = ev_strview_fromStr("a,b,,c"), field;
+ * while(ev_strview_split(&rest, ',', &field)) {
+ *     // "a", "b", "", "c"
+ * }
+ * ```
+ *
+ * \returns false once every token was returned
+ */
+EV_STR_API bool
+ev_strview_split(
+    ev_strview *rest,
+    char delim,
+    ev_strview *token);
+
+/*!
+ * \returns `v` without its leading and trailing ASCII whitespace
+ */
+EV_STR_API ev_strview
+ev_strview_trim(
+    ev_strview v);
+
+EV_STR_API ev_strview
+ev_strview_trimLeft(
+    ev_strview v);
+
+EV_STR_API ev_strview
+ev_strview_trimRight(
+    ev_strview v);
+
+EV_STR_API u64
+ev_strview_findFirstOf(
+    ev_strview v,
+    const ev_str_charset *set);
+
+EV_STR_API u64
+ev_strview_findFirstNotOf(
+    ev_strview v,
+    const ev_str_charset *set);
+
+/*!
+ * \brief Same as `evstring_view_parseI64`, on any bytes
+ */
+EV_STR_API evstring_error_t
+ev_strview_parseI64(
+    ev_strview v,
+    i64 *out);
+
+EV_STR_API evstring_error_t
+ev_strview_parseU64(
+    ev_strview v,
+    u64 *out);
+
+EV_STR_API evstring_error_t
+ev_strview_parseF64(
+    ev_strview v,
+    f64 *out);
+
+/*!
+ * \brief Orders two evstrings as `ev_strview_cmp` does, unlike `evstring_cmp`
+ * which only tells whether they are equal. Its arguments have the same type as
+ * `qsort`'s comparator, and point to evstrings.
+ * \details Sample usage:
+ * ```
+ * qsort(paths, ev_vec_len(&paths), sizeof(evstring), evstring_order_qsort);
+ * ```
+ */
+EV_STR_API int
+evstring_order_qsort(
+    const void *a,
+    const void *b);
+
+static inline ev_strview
+__ev_strview_id(
+    ev_strview v)
+{
+    return v;
+}
+
+// Arguments that are not views are evstrings
+#define __evstring_asStrview(s) _Generic((s), \
+        evstring_view: evstring_view_toStrview, \
+        ev_strview: __ev_strview_id, \
+        default: evstring_toStrview \
+        )(s)
+
+// The prefix or suffix argument is a null-terminated string by default, as
+// with `evstring_push`
+#define __evstring_affixAsStrview(s) _Generic((s), \
+        evstring_view: evstring_view_toStrview, \
+        ev_strview: __ev_strview_id, \
+        default: ev_strview_fromStr \
+        )(s)
+
+/*!
+ * \brief Lexicographic comparison of two evstrings, `evstring_view`s or
+ * `ev_strview`s, in any combination. Bytes are compared as unsigned
+ * characters, and a string orders before the strings that it is a prefix of.
+ * \details Sample usage:
+ * ```
+ * if(evstring_order(a, evstring_slice(b, 0, 4)) < 0) { ... }
+ * if(evstring_eq_icase(ext, ev_strview_fromStr(".PNG"))) { ... }
+ * ```
+ *
+ * \returns A negative value, zero or a positive value
+ */
+#define evstring_order(a, b) ev_strview_cmp(__evstring_asStrview(a), __evstring_asStrview(b))
+
+/*!
+ * \brief Same as `evstring_order`, ignoring the case of ASCII letters
+ */
+#define evstring_order_icase(a, b) ev_strview_cmp_icase(__evstring_asStrview(a), __evstring_asStrview(b))
+
+#define evstring_eq_icase(a, b) ev_strview_eq_icase(__evstring_asStrview(a), __evstring_asStrview(b))
+
+/*!
+ * \brief Checks whether an evstring or view starts (ends) with a prefix
+ * (suffix). The prefix is a view or a null-terminated string.
+ * \details Sample usage:
+ * ```
+ * if(evstring_startsWith(path, "assets/") && evstring_endsWith(path, ".png")) { ... }
+ * ```
+ */
+#define evstring_startsWith(s, prefix) ev_strview_startsWith(__evstring_asStrview(s), __evstring_affixAsStrview(prefix))
+
+#define evstring_endsWith(s, suffix) ev_strview_endsWith(__evstring_asStrview(s), __evstring_affixAsStrview(suffix))
+
+/*!
+ * \brief Finds the first byte of an evstring or view that is (is not) in a
+ * `ev_str_charset`
+ * \details Sample usage:
+ * ```
+ * const ev_str_charset special = ev_str_charset_fromStr("<>&\"'");
+ * if(evstring_findFirstOf(text, &special) == EV_STR_NPOS) { ... }
+ * ```
+ *
+ * \returns Index of the match, or `EV_STR_NPOS`
+ */
+#define evstring_findFirstOf(s, set) ev_strview_findFirstOf(__evstring_asStrview(s), set)
+
+#define evstring_findFirstNotOf(s, set) ev_strview_findFirstNotOf(__evstring_asStrview(s), set)
+
+DEFINE_EQUAL_FUNCTION(evstring, Default)
+{
+  return evstring_cmp(*(evstring*)self, *(evstring*)other) == 0;
+}
+
+DEFINE_COPY_FUNCTION(evstring, Default)
+{
+  *(evstring*)dst = evstring_share(*src);
+}
+
+DEFINE_FREE_FUNCTION(evstring, Default)
+{
+  evstring_free(*self);
+}
+
+DEFINE_HASH_FUNCTION(evstring, Default)
+{
+  if(seed == EV_STR_HASH_SEED) {
+    return evstring_hash(*self);
+  }
+  return ev_hash_murmur3(*self, (u32)evstring_getLength(*self), seed);
+}
+
+TYPEDATA_GEN(evstring,
+    EQUAL(Default),
+    HASH(Default),
+    COPY(Default),
+    FREE(Default)
+);
+
+
+#if defined(EV_STR_IMPLEMENTATION)
+
+#if EV_OS_WINDOWS
+#pragma comment(lib, "legacy_stdio_definitions.lib")
+#endif
+
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+
+#include <math.h>
+
+#include "ev_str_tables.h"
+
+#if EV_CC_MSVC
+#include <intrin.h>
+#endif
+#if EV_SIMD_AVX2
+#include <immintrin.h>
+#elif EV_SIMD_SSSE3
+#include <tmmintrin.h>
+#elif EV_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#define META(s) (((struct evstr_meta_t *)(s)) - 1)
+
+#if EV_BUILDTYPE_DEBUG || EV_BUILDTYPE_DEBUGOPT
+#define evstr_asserttype(str) \
+    assert(META(str)->magic == EV_STR_evstring_MAGIC)
+#else
+#define evstr_asserttype(str)
+#endif
+
+#if EV_STR_CACHE_HASH
+#define evstr_invalidatehash(str) \
+    META(str)->hashValid = false
+#else
+#define evstr_invalidatehash(str)
+#endif
+
+// Custom allocations start with their allocator, followed by the header
+#define __EVSTR_CUSTOM_PREFIX sizeof(const evstring_allocator *)
+#define __evstr_allocator(s) (((const evstring_allocator **)META(s))[-1])
+
+static EV_THREAD_LOCAL const evstring_allocator *__evstr_current_allocator = NULL;
+
+// Allocates a header and its characters, `size` bytes in total, with
+// `allocator`, or on the heap if it is NULL
+static struct evstr_meta_t *
+__evstr_allocWith(
+    const evstring_allocator *allocator,
+    u64 size)
+{
+    if(!allocator) {
+        return ev_str_malloc(size);
+    }
+    const evstring_allocator **p = allocator->alloc(allocator->ctx, __EVSTR_CUSTOM_PREFIX + size);
+    if(!p) {
+        return NULL;
+    }
+    *p = allocator;
+    return (struct evstr_meta_t *)(p + 1);
+}
+
+// Allocates a header and its characters with the current allocator
+static inline struct evstr_meta_t *
+__evstr_alloc(
+    u64 size)
+{
+    return __evstr_allocWith(__evstr_current_allocator, size);
+}
+
+static inline u32
+__evstr_refcount_load(
+    struct evstr_meta_t *meta)
+{
+#if EV_CC_MSVC
+    return (u32)_InterlockedOr((volatile long *)&meta->refcount, 0);
+#else
+    return __atomic_load_n(&meta->refcount, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void
+__evstr_refcount_inc(
+    struct evstr_meta_t *meta)
+{
+#if EV_CC_MSVC
+    _InterlockedIncrement((volatile long *)&meta->refcount);
+#else
+    __atomic_fetch_add(&meta->refcount, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+// \returns The count before the decrement
+static inline u32
+__evstr_refcount_dec(
+    struct evstr_meta_t *meta)
+{
+#if EV_CC_MSVC
+    return (u32)_InterlockedDecrement((volatile long *)&meta->refcount) + 1;
+#else
+    return __atomic_fetch_sub(&meta->refcount, 1, __ATOMIC_ACQ_REL);
+#endif
+}
+
+// Called first by the functions that modify a string
+#define __evstr_detach(s) \
+    do { \
+        if(__evstr_refcount_load(META(*(s))) != 0) { \
+            evstring_error_t __detach_err = evstring_detach(s); \
+            if(__detach_err != EV_STR_ERR_NONE) { \
+                return __detach_err; \
+            } \
+        } \
+    } while(0)
+
+evstring_error_t
+evstring_addSpace(
+    evstring *s,
+    u64 space);
 
 evstring_error_t
 evstring_pushFmt_v(
@@ -251,20 +1250,18 @@ evstring_new_impl(
 {
     u64 size = sizeof(struct evstr_meta_t) + len + 1;
 
-    void *p = ev_str_malloc(size);
-    assert(p); // Raised if malloc fails
+    struct evstr_meta_t *meta = __evstr_alloc(size);
+    assert(meta); // Raised if malloc fails
 
-    struct evstr_meta_t *meta = (struct evstr_meta_t *)p;
-EV_DEBUG
-(
-    meta->magic = EV_STR_evstring_MAGIC;
-)
-    meta->length = len;
-    meta->size = size;
-    meta->allocationType = EV_STR_ALLOCATION_TYPE_HEAP;
+    *meta = (struct evstr_meta_t) {
+        EV_DEBUG(.magic = EV_STR_evstring_MAGIC,)
+        .length = len,
+        .size = size,
+        .allocationType = __evstr_current_allocator ? EV_STR_ALLOCATION_TYPE_CUSTOM : EV_STR_ALLOCATION_TYPE_HEAP,
+    };
 
     evstring s = (evstring)(meta + 1);
-    if(len > 0) {
+    if(data && len > 0) {
         memcpy(s, data, len);
     }
     s[len] = '\0';
@@ -274,23 +1271,33 @@ EV_DEBUG
 
 #include <stdio.h>
 
+#ifndef EV_STR_FMT_STACK_SIZE
+// Size of the stack buffer that `evstring_newFmt` formats into first, so that
+// short strings are formatted once and allocated with their exact length
+#define EV_STR_FMT_STACK_SIZE 256
+#endif
+
 evstring
 evstring_newFmt_v(
     const char *fmt,
     va_list args)
 {
-    va_list test;
-    va_copy(test, args);
-    i32 len = vsnprintf(NULL, 0, fmt, test);
+    va_list retry;
+    va_copy(retry, args);
+
+    char buf[EV_STR_FMT_STACK_SIZE];
+    i32 len = vsnprintf(buf, sizeof(buf), fmt, args);
+    evstring res;
     if(len < 0) {
-        return EV_INVALID(evstring);
+        res = EV_INVALID(evstring);
+    } else if(len < (i32)sizeof(buf)) {
+        res = evstring_new_impl(buf, len);
+    } else {
+        res = evstring_new_impl(NULL, len);
+        vsnprintf(res, len + 1, fmt, retry);
     }
-    evstring res = evstring_new_impl(NULL, 0);
-    evstring_setLength(&res, len);
-    vsnprintf(res, len + 1, fmt, args);
-
-    va_end(test);
 
+    va_end(retry);
     return res;
 }
 
@@ -309,6 +1316,37 @@ evstring_newFmt(
     return res;
 }
 
+evstring
+evstring_initSmall_impl(
+    evstring_small *storage,
+    const char *data,
+    u64 len)
+{
+    if(len > EV_STR_SMALL_CAPACITY) {
+        return evstring_new_impl(data, len);
+    }
+
+    storage->meta = (struct evstr_meta_t) {
+        EV_DEBUG(.magic = EV_STR_evstring_MAGIC,)
+        .length = len,
+        .size = sizeof(struct evstr_meta_t) + EV_STR_SMALL_CAPACITY + 1,
+        .allocationType = EV_STR_ALLOCATION_TYPE_INLINE,
+    };
+    if(len > 0) {
+        memcpy(storage->data, data, len);
+    }
+    storage->data[len] = '\0';
+    return storage->data;
+}
+
+evstring
+evstring_initSmall(
+    evstring_small *storage,
+    const char *str)
+{
+    return evstring_initSmall_impl(storage, str, strlen(str));
+}
+
 evstring
 evstring_newFromStr(
     const char *str)
@@ -329,9 +1367,64 @@ evstring_free(
     evstring s)
 {
     evstr_asserttype(s);
-    if(META(s)->allocationType == EV_STR_ALLOCATION_TYPE_HEAP) {
-        free(META(s));
+    struct evstr_meta_t *meta = META(s);
+    // Private strings are freed without an atomic operation
+    if(__evstr_refcount_load(meta) != 0 && __evstr_refcount_dec(meta) != 0) {
+        return;
+    }
+    if(meta->allocationType == EV_STR_ALLOCATION_TYPE_HEAP) {
+        ev_str_free(meta);
+    } else if(meta->allocationType == EV_STR_ALLOCATION_TYPE_CUSTOM) {
+        const evstring_allocator *allocator = __evstr_allocator(s);
+        if(allocator->free) {
+            allocator->free(allocator->ctx, (char *)meta - __EVSTR_CUSTOM_PREFIX);
+        }
+    }
+}
+
+evstring
+evstring_share(
+    const evstring s)
+{
+    evstr_asserttype(s);
+    struct evstr_meta_t *meta = META(s);
+    if(meta->allocationType != EV_STR_ALLOCATION_TYPE_HEAP && meta->allocationType != EV_STR_ALLOCATION_TYPE_CUSTOM) {
+        return evstring_new_impl(s, meta->length);
+    }
+    __evstr_refcount_inc(meta);
+    return s;
+}
+
+bool
+evstring_isShared(
+    const evstring s)
+{
+    evstr_asserttype(s);
+    return __evstr_refcount_load(META(s)) != 0;
+}
+
+evstring_error_t
+evstring_detach(
+    evstring *s)
+{
+    evstr_asserttype(*s);
+    struct evstr_meta_t *meta = META(*s);
+    if(__evstr_refcount_load(meta) == 0) {
+        return EV_STR_ERR_NONE;
+    }
+
+    // The copy keeps the capacity, since it is usually about to be modified
+    struct evstr_meta_t *copy = __evstr_alloc(meta->size);
+    if(!copy) {
+        return EV_STR_ERR_OOM;
     }
+    memcpy(copy, meta, sizeof(struct evstr_meta_t) + meta->length + 1);
+    copy->refcount = 0;
+    copy->allocationType = __evstr_current_allocator ? EV_STR_ALLOCATION_TYPE_CUSTOM : EV_STR_ALLOCATION_TYPE_HEAP;
+
+    evstring_free(*s);
+    *s = (evstring)(copy + 1);
+    return EV_STR_ERR_NONE;
 }
 
 u64
@@ -348,6 +1441,7 @@ evstring_setSize(
     size_t newsize)
 {
     evstr_asserttype(*s);
+    __evstr_detach(s);
     struct evstr_meta_t *meta = META(*s);
     if(meta->allocationType == EV_STR_ALLOCATION_TYPE_STACK) {
         return EV_STR_ERR_OOM;
@@ -357,6 +1451,37 @@ evstring_setSize(
         return EV_STR_ERR_NONE;
     }
 
+    if(meta->allocationType == EV_STR_ALLOCATION_TYPE_INLINE) {
+        if(newsize <= meta->size) {
+            return EV_STR_ERR_NONE;
+        }
+        // Promote to the heap, or to the current allocator. The inline storage
+        // is left untouched.
+        struct evstr_meta_t *heap_meta = __evstr_alloc(sizeof(struct evstr_meta_t) + newsize);
+        if(!heap_meta) {
+            return EV_STR_ERR_OOM;
+        }
+        memcpy(heap_meta, meta, sizeof(struct evstr_meta_t) + meta->length + 1);
+        heap_meta->allocationType = __evstr_current_allocator ? EV_STR_ALLOCATION_TYPE_CUSTOM : EV_STR_ALLOCATION_TYPE_HEAP;
+        heap_meta->size = newsize;
+        *s = (evstring)(heap_meta + 1);
+        return EV_STR_ERR_NONE;
+    }
+
+    if(meta->allocationType == EV_STR_ALLOCATION_TYPE_CUSTOM) {
+        const evstring_allocator *allocator = __evstr_allocator(*s);
+        char *base = (char *)meta - __EVSTR_CUSTOM_PREFIX;
+        u64 used = __EVSTR_CUSTOM_PREFIX + sizeof(struct evstr_meta_t) + meta->length + 1;
+        char *moved = allocator->realloc(allocator->ctx, base, used, __EVSTR_CUSTOM_PREFIX + sizeof(struct evstr_meta_t) + newsize);
+        if(!moved) {
+            return EV_STR_ERR_OOM;
+        }
+        meta = (struct evstr_meta_t *)(moved + __EVSTR_CUSTOM_PREFIX);
+        *s = (evstring)(meta + 1);
+        meta->size = newsize;
+        return EV_STR_ERR_NONE;
+    }
+
     void *buf = (void*)meta;
     void *tmp = ev_str_realloc(buf, sizeof(struct evstr_meta_t) + newsize);
 
@@ -382,6 +1507,21 @@ evstring_grow(
     return evstring_setSize(s, META(*s)->size * EV_STR_GROWTH_FACTOR);
 }
 
+// Grows the string geometrically, but at least to `required_size`, with a
+// single reallocation
+static inline evstring_error_t
+__evstring_growTo(
+    evstring *s,
+    u64 required_size)
+{
+    u64 size = META(*s)->size;
+    if(required_size <= size) {
+        return EV_STR_ERR_NONE;
+    }
+    u64 grown = size * EV_STR_GROWTH_FACTOR;
+    return evstring_setSize(s, grown > required_size ? grown : required_size);
+}
+
 evstring_error_t
 evstring_setLength(
     evstring *s,
@@ -392,16 +1532,17 @@ evstring_setLength(
     if(newlen == meta->length) {
         return EV_STR_ERR_NONE;
     }
+    __evstr_detach(s);
+    meta = META(*s);
+    evstr_invalidatehash(*s);
 
-    u64 required_size = sizeof(struct evstr_meta_t) + newlen + 1;
-    while(required_size > meta->size) {
-        evstring_error_t grow_err = evstring_grow(s);
-        if(grow_err) {
-            return grow_err;
-        }
-        meta = META(*s);
+    evstring_error_t grow_err = __evstring_growTo(s, sizeof(struct evstr_meta_t) + newlen + 1);
+    if(grow_err) {
+        return grow_err;
     }
+    meta = META(*s);
     meta->length = newlen;
+    (*s)[newlen] = '\0';
 
     return EV_STR_ERR_NONE;
 }
@@ -411,8 +1552,32 @@ evstring_clear(
     evstring *s)
 {
     evstr_asserttype(*s);
-    evstring_setLength(s, 0);
-}
+    struct evstr_meta_t *meta = META(*s);
+    if(__evstr_refcount_load(meta) == 0) {
+        evstr_invalidatehash(*s);
+        evstring_setLength(s, 0);
+        return;
+    }
+
+    // Copying a shared string only to empty it would be wasted, so this
+    // reference is replaced by a new empty string from the same allocator
+    const evstring_allocator *allocator =
+        meta->allocationType == EV_STR_ALLOCATION_TYPE_CUSTOM ? __evstr_allocator(*s) : NULL;
+    u64 size = sizeof(struct evstr_meta_t) + 1;
+    struct evstr_meta_t *empty = __evstr_allocWith(allocator, size);
+    if(!empty) {
+        return;
+    }
+    *empty = (struct evstr_meta_t) {
+        EV_DEBUG(.magic = EV_STR_evstring_MAGIC,)
+        .length = 0,
+        .size = size,
+        .allocationType = meta->allocationType,
+    };
+    evstring_free(*s);
+    *s = (evstring)(empty + 1);
+    (*s)[0] = '\0';
+}
 
 i32
 evstring_cmp(
@@ -426,9 +1591,37 @@ evstring_cmp(
     if(len1 != len2) {
         return 1;
     }
+#if EV_STR_CACHE_HASH
+    if(META(s1)->hashValid && META(s2)->hashValid &&
+       META(s1)->hash != META(s2)->hash) {
+        return 1;
+    }
+#endif
     return memcmp(s1, s2, len1);
 }
 
+u64
+evstring_hash(
+    const evstring s)
+{
+    evstr_asserttype(s);
+#if EV_STR_CACHE_HASH
+    struct evstr_meta_t *meta = META(s);
+    if(!meta->hashValid) {
+        u64 hash = ev_hash_murmur3(s, (u32)meta->length, EV_STR_HASH_SEED);
+        // Other owners of a shared string might be reading it concurrently
+        if(__evstr_refcount_load(meta) != 0) {
+            return hash;
+        }
+        meta->hash = hash;
+        meta->hashValid = true;
+    }
+    return meta->hash;
+#else
+    return ev_hash_murmur3(s, (u32)evstring_getLength(s), EV_STR_HASH_SEED);
+#endif
+}
+
 
 evstring_error_t
 evstring_push_impl(
@@ -437,17 +1630,15 @@ evstring_push_impl(
     const char *data)
 {
     evstr_asserttype(*s);
+    __evstr_detach(s);
+    evstr_invalidatehash(*s);
     struct evstr_meta_t *meta = META(*s);
 
-    // TODO Find a more efficient approach?
-    u64 required_size = sizeof(struct evstr_meta_t) + meta->length + sz + 1;
-    while(required_size > meta->size) { // `<=` because of the null terminator
-        evstring_error_t grow_err = evstring_grow(s);
-        if(grow_err != EV_STR_ERR_NONE) {
-            return grow_err;
-        }
-        meta = META(*s);
+    evstring_error_t grow_err = __evstring_growTo(s, sizeof(struct evstr_meta_t) + meta->length + sz + 1);
+    if(grow_err != EV_STR_ERR_NONE) {
+        return grow_err;
     }
+    meta = META(*s);
 
     memcpy((*s) + meta->length, data, sz);
     // printf("Memcpy: dst = (*s {%p}) + meta->length {%llu}, src = data {%p}, size = sz {%llu}\n", *s, meta->length, data, sz);
@@ -516,9 +1707,27 @@ evstring_getSpace(
 {
     evstr_asserttype(s);
     struct evstr_meta_t *meta = META(s);
+    // Literals from `evstr` do not count their header in their size, and can
+    // not grow anyway
+    if(meta->allocationType == EV_STR_ALLOCATION_TYPE_STACK) {
+        return 0;
+    }
     return meta->size - meta->length - 1 - sizeof(struct evstr_meta_t);
 }
 
+evstring_error_t
+evstring_reserve(
+    evstring *s,
+    u64 capacity)
+{
+    evstr_asserttype(*s);
+    u64 required_size = sizeof(struct evstr_meta_t) + capacity + 1;
+    if(required_size <= META(*s)->size) {
+        return EV_STR_ERR_NONE;
+    }
+    return evstring_setSize(s, required_size);
+}
+
 evstring_error_t
 evstring_addSpace(
     evstring *s,
@@ -528,170 +1737,2556 @@ evstring_addSpace(
     return evstring_setSize(s, META(*s)->size + space);
 }
 
-evstring_view
-__evstring_findFirst_impl(
-    evstring_view text,
-    evstring_view query)
+static inline u32
+__ev_str_ctz32(
+    u32 x)
 {
-    u64 found_progress = 0;
+#if EV_CC_MSVC
+    unsigned long idx;
+    _BitScanForward(&idx, x);
+    return (u32)idx;
+#else
+    return (u32)__builtin_ctz(x);
+#endif
+}
 
-    evstring_view result = {
-        .data = text.data,
-        .len = 0,
-        .offset = ~0ull
-    };
+static inline u32
+__ev_str_clz64(
+    u64 x)
+{
+#if EV_CC_MSVC
+    unsigned long idx;
+    _BitScanReverse64(&idx, x);
+    return 63 - (u32)idx;
+#else
+    return (u32)__builtin_clzll(x);
+#endif
+}
+
+static inline u32
+__ev_str_msb32(
+    u32 x)
+{
+#if EV_CC_MSVC
+    unsigned long idx;
+    _BitScanReverse(&idx, x);
+    return (u32)idx;
+#else
+    return 31 - (u32)__builtin_clz(x);
+#endif
+}
 
-    for(u64 i = text.offset; i < text.offset + text.len; i++) {
-        if(text.data[i] == query.data[query.offset + found_progress]) {
-            found_progress++;
+u64
+ev_str_memchr(
+    const char *data,
+    u64 len,
+    char c)
+{
+    u64 i = 0;
+#if EV_SIMD_AVX2
+    __m256i c32 = _mm256_set1_epi8(c);
+    for(; i + 32 <= len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(data + i));
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, c32));
+        if(mask) {
+            return i + __ev_str_ctz32(mask);
         }
-        if(found_progress == query.len) {
-            result.offset = (i+1) - query.len;
-            result.len = query.len;
-            break;
+    }
+#endif
+#if EV_SIMD_SSE2
+    __m128i c16 = _mm_set1_epi8(c);
+    for(; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, c16));
+        if(mask) {
+            return i + __ev_str_ctz32(mask);
         }
     }
-    return result;
+#endif
+    for(; i < len; i++) {
+        if(data[i] == c) {
+            return i;
+        }
+    }
+    return EV_STR_NPOS;
 }
 
-evstring_view
-evstring_findFirst(
-    const evstring text,
-    const evstring query)
+u64
+ev_str_memrchr(
+    const char *data,
+    u64 len,
+    char c)
 {
-    evstr_asserttype(text);
-    evstr_asserttype(query);
-    return __evstring_findFirst_impl(evstring_slice(text, 0, -1), evstring_slice(query, 0, -1));
+    u64 end = len;
+#if EV_SIMD_AVX2
+    __m256i c32 = _mm256_set1_epi8(c);
+    for(; end >= 32; end -= 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(data + end - 32));
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, c32));
+        if(mask) {
+            return end - 32 + __ev_str_msb32(mask);
+        }
+    }
+#endif
+#if EV_SIMD_SSE2
+    __m128i c16 = _mm_set1_epi8(c);
+    for(; end >= 16; end -= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(data + end - 16));
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, c16));
+        if(mask) {
+            return end - 16 + __ev_str_msb32(mask);
+        }
+    }
+#endif
+    while(end > 0) {
+        end--;
+        if(data[end] == c) {
+            return end;
+        }
+    }
+    return EV_STR_NPOS;
 }
 
-evstring
-evstring_replaceFirst(
-    const evstring text,
-    const evstring query,
-    const evstring replacement)
+static inline char
+__ev_str_tolower(
+    char c)
 {
-    evstr_asserttype(text);
-    evstr_asserttype(query);
-    evstr_asserttype(replacement);
-    evstring result = NULL;
-
-    evstring_view query_slice = evstring_findFirst(text, query);
+    return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
 
-    // If the query doesn't actually exist, then we're returning a clone of
-    // the original string.
-    if(query_slice.len == 0) {
-        result = evstring_new_impl(text, evstring_getLength(text));
-    } else {
-        result = evstring_new_impl(NULL,0);
+// Folds the ASCII letters of 8 bytes to lowercase
+static inline u64
+__ev_str_tolower64(
+    u64 x)
+{
+    const u64 high = 0x8080808080808080ull;
+    u64 low7 = x & ~high;
+    u64 ge_a = low7 + 0x0101010101010101ull * (0x80 - 'A');
+    u64 gt_z = low7 + 0x0101010101010101ull * (0x7F - 'Z');
+    u64 upper = (ge_a ^ gt_z) & ~x & high;
+    return x | (upper >> 2);
+}
 
-        // If the query doesn't match at the beginning of the string,
-        // then we need to copy the data before it first.
-        if(query_slice.offset != 0) {
-            evstring_push(&result, evstring_slice(text, 0, query_slice.offset));
+// Compares 8 bytes at a time, and finds the byte inside the first word that
+// differs
+static EV_FORCEINLINE u64
+__ev_str_mismatchScalar(
+    const char *a,
+    const char *b,
+    u64 len,
+    bool icase)
+{
+    u64 i = 0;
+    for(; i + 8 <= len; i += 8) {
+        u64 x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        if(icase ? __ev_str_tolower64(x) != __ev_str_tolower64(y) : x != y) {
+            break;
+        }
+    }
+    if(i < len && i + 8 > len && len >= 8) {
+        // The last word overlaps bytes that already matched
+        u64 x, y;
+        memcpy(&x, a + len - 8, 8);
+        memcpy(&y, b + len - 8, 8);
+        if(icase ? __ev_str_tolower64(x) == __ev_str_tolower64(y) : x == y) {
+            return EV_STR_NPOS;
+        }
+        i = len - 8;
+    }
+    for(; i < len; i++) {
+        if(icase ? __ev_str_tolower(a[i]) != __ev_str_tolower(b[i]) : a[i] != b[i]) {
+            return i;
         }
+    }
+    return EV_STR_NPOS;
+}
 
-        // Then, we simply push the replacement
-        evstring_push_impl(&result, evstring_getLength(replacement), replacement);
+#if EV_SIMD_AVX2
+static inline __m256i
+__ev_str_tolower32(
+    __m256i x)
+{
+    // 'A'..'Z' are moved to the bottom of the signed range, where one compare
+    // selects them
+    __m256i shifted = _mm256_add_epi8(x, _mm256_set1_epi8((char)(0x80 - 'A')));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + 26)), shifted);
+    return _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
 
-        // Followed by the rest of the string
-        evstring_push(&result,
-            evstring_slice(text, query_slice.offset + query_slice.len, -1));
+// \returns A bit for every byte of the 32-byte blocks that differs
+static EV_FORCEINLINE u32
+__ev_str_diff32(
+    const char *a,
+    const char *b,
+    bool icase)
+{
+    __m256i x = _mm256_loadu_si256((const __m256i *)a);
+    __m256i y = _mm256_loadu_si256((const __m256i *)b);
+    if(icase) {
+        x = __ev_str_tolower32(x);
+        y = __ev_str_tolower32(y);
     }
-    return result;
+    return ~(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
 }
+#endif
 
-evstring_error_t
-evstring_pushFmt(
-    evstring *s,
-    const char *fmt,
-    ...)
+#if EV_SIMD_SSE2
+static inline __m128i
+__ev_str_tolower16(
+    __m128i x)
 {
-    evstr_asserttype(*s);
-    va_list ap;
-    va_start(ap, fmt);
-    evstring_error_t res = evstring_pushFmt_v(s, fmt, ap);
-    va_end(ap);
-    return res;
+    __m128i shifted = _mm_add_epi8(x, _mm_set1_epi8((char)(0x80 - 'A')));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8((char)(0x80 + 26)), shifted);
+    return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
 }
 
-evstring_error_t
-evstring_pushFmt_v(
-    evstring *s,
-    const char *fmt,
-    va_list args)
+static EV_FORCEINLINE u32
+__ev_str_diff16(
+    const char *a,
+    const char *b,
+    bool icase)
 {
-    evstr_asserttype(*s);
-    va_list test;
-    va_copy(test, args);
-    int fmt_len = vsnprintf(NULL, 0, fmt, test);
-    size_t old_len = evstring_getLength(*s);
-    evstring_error_t res = evstring_setLength(s, old_len + fmt_len);
-    if(res == EV_STR_ERR_NONE) {
-        int write_res = vsnprintf((*s) + old_len, fmt_len+1, fmt, args);
-        assert(write_res > 0);
-        assert(write_res == fmt_len);
+    __m128i x = _mm_loadu_si128((const __m128i *)a);
+    __m128i y = _mm_loadu_si128((const __m128i *)b);
+    if(icase) {
+        x = __ev_str_tolower16(x);
+        y = __ev_str_tolower16(y);
     }
-    va_end(test);
-    return res;
+    return ~(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xFFFF;
 }
 
-i64
-evstring_findFirstChar(
-    const evstring text,
-    const char c)
+#if !EV_SIMD_AVX2
+static EV_FORCEINLINE u32
+__ev_str_diff32(
+    const char *a,
+    const char *b,
+    bool icase)
 {
-    evstr_asserttype(text);
-    struct evstr_meta_t *meta = META(text);
-    for(int i = 0; i < meta->length; i++) {
-        if(text[i] == c) {
-            return i;
+    return __ev_str_diff16(a, b, icase) | (__ev_str_diff16(a + 16, b + 16, icase) << 16);
+}
+#endif
+#endif
+
+// Shared by the exact and case-insensitive comparisons. The tails of the
+// inputs are compared with one more block that ends at `len`, and overlaps
+// bytes that are already known to match.
+static EV_FORCEINLINE u64
+__ev_str_mismatch_impl(
+    const char *a,
+    const char *b,
+    u64 len,
+    bool icase)
+{
+#if EV_SIMD_SSE2
+    u32 mask;
+    if(len >= 32) {
+        u64 i = 0;
+        for(; i + 32 <= len; i += 32) {
+            if((mask = __ev_str_diff32(a + i, b + i, icase))) {
+                return i + __ev_str_ctz32(mask);
+            }
+        }
+        if(i < len && (mask = __ev_str_diff32(a + len - 32, b + len - 32, icase))) {
+            return len - 32 + __ev_str_ctz32(mask);
+        }
+        return EV_STR_NPOS;
+    }
+    if(len >= 16) {
+        if((mask = __ev_str_diff16(a, b, icase))) {
+            return __ev_str_ctz32(mask);
         }
+        if((mask = __ev_str_diff16(a + len - 16, b + len - 16, icase))) {
+            return len - 16 + __ev_str_ctz32(mask);
+        }
+        return EV_STR_NPOS;
     }
-    return -1;
+#endif
+    return __ev_str_mismatchScalar(a, b, len, icase);
 }
 
-i64
-evstring_findLastChar(
-    const evstring text,
-    const char c)
+u64
+ev_str_mismatch(
+    const char *a,
+    const char *b,
+    u64 len)
 {
-    evstr_asserttype(text);
-    struct evstr_meta_t *meta = META(text);
-    int i;
-    for(i = meta->length - 1; i >= 0; i--) {
-        if(text[i] == c) {
-            break;
+    return __ev_str_mismatch_impl(a, b, len, false);
+}
+
+u64
+ev_str_mismatch_icase(
+    const char *a,
+    const char *b,
+    u64 len)
+{
+    return __ev_str_mismatch_impl(a, b, len, true);
+}
+
+static inline char
+__ev_str_toupper(
+    char c)
+{
+    return (c >= 'a' && c <= 'z') ? (char)(c - ('a' - 'A')) : c;
+}
+
+static inline u64
+__ev_str_toupper64(
+    u64 x)
+{
+    const u64 high = 0x8080808080808080ull;
+    u64 low7 = x & ~high;
+    u64 ge_a = low7 + 0x0101010101010101ull * (0x80 - 'a');
+    u64 gt_z = low7 + 0x0101010101010101ull * (0x7F - 'z');
+    u64 lower = (ge_a ^ gt_z) & ~x & high;
+    return x & ~(lower >> 2);
+}
+
+#if EV_SIMD_AVX2
+static inline __m256i
+__ev_str_toupper32(
+    __m256i x)
+{
+    __m256i shifted = _mm256_add_epi8(x, _mm256_set1_epi8((char)(0x80 - 'a')));
+    __m256i lower = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + 26)), shifted);
+    return _mm256_andnot_si256(_mm256_and_si256(lower, _mm256_set1_epi8(0x20)), x);
+}
+#endif
+
+#if EV_SIMD_SSE2
+static inline __m128i
+__ev_str_toupper16(
+    __m128i x)
+{
+    __m128i shifted = _mm_add_epi8(x, _mm_set1_epi8((char)(0x80 - 'a')));
+    __m128i lower = _mm_cmpgt_epi8(_mm_set1_epi8((char)(0x80 + 26)), shifted);
+    return _mm_andnot_si128(_mm_and_si128(lower, _mm_set1_epi8(0x20)), x);
+}
+#endif
+
+// Shared by both directions. Mapping a byte twice gives the same result, so
+// the tail is handled by one more block that ends at `len`.
+static EV_FORCEINLINE void
+__ev_str_caseMap(
+    char *dst,
+    const char *src,
+    u64 len,
+    bool upper)
+{
+    u64 i = 0;
+#if EV_SIMD_AVX2
+    if(len >= 32) {
+        for(; i + 32 <= len; i += 32) {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+            _mm256_storeu_si256((__m256i *)(dst + i), upper ? __ev_str_toupper32(x) : __ev_str_tolower32(x));
+        }
+        if(i < len) {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(src + len - 32));
+            _mm256_storeu_si256((__m256i *)(dst + len - 32), upper ? __ev_str_toupper32(x) : __ev_str_tolower32(x));
+        }
+        return;
+    }
+#endif
+#if EV_SIMD_SSE2
+    if(len >= 16) {
+        for(; i + 16 <= len; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+            _mm_storeu_si128((__m128i *)(dst + i), upper ? __ev_str_toupper16(x) : __ev_str_tolower16(x));
+        }
+        if(i < len) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(src + len - 16));
+            _mm_storeu_si128((__m128i *)(dst + len - 16), upper ? __ev_str_toupper16(x) : __ev_str_tolower16(x));
         }
+        return;
+    }
+#endif
+    for(; i + 8 <= len; i += 8) {
+        u64 x;
+        memcpy(&x, src + i, 8);
+        x = upper ? __ev_str_toupper64(x) : __ev_str_tolower64(x);
+        memcpy(dst + i, &x, 8);
+    }
+    for(; i < len; i++) {
+        dst[i] = upper ? __ev_str_toupper(src[i]) : __ev_str_tolower(src[i]);
     }
-    return i; 
 }
 
-u64
-evstring_findAll(
-    const evstring text,
-    const evstring query,
-    evstring_view *results)
+void
+ev_str_toLower(
+    char *dst,
+    const char *src,
+    u64 len)
 {
-    evstr_asserttype(text);
-    evstr_asserttype(query);
+    __ev_str_caseMap(dst, src, len, false);
+}
 
-    u64 text_len = evstring_getLength(text);
-    u64 query_len = evstring_getLength(query);
-    if(text_len == 0 || query_len == 0 || query_len > text_len) {
-        return 0;
+void
+ev_str_toUpper(
+    char *dst,
+    const char *src,
+    u64 len)
+{
+    __ev_str_caseMap(dst, src, len, true);
+}
+
+void
+ev_str_replaceChar(
+    char *data,
+    u64 len,
+    char from,
+    char to)
+{
+    u64 i = 0;
+    // Blocks without `from` are not written back
+#if EV_SIMD_AVX2
+    __m256i from32 = _mm256_set1_epi8(from);
+    __m256i to32 = _mm256_set1_epi8(to);
+    for(; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i eq = _mm256_cmpeq_epi8(x, from32);
+        if(_mm256_movemask_epi8(eq)) {
+            _mm256_storeu_si256((__m256i *)(data + i), _mm256_blendv_epi8(x, to32, eq));
+        }
     }
-    bool check_run = (results == NULL);
-    u64 count = 0;
-    for(evstring_view v = evstring_findFirst(text, query); 
-            v.len != 0; 
-            v = __evstring_findFirst_impl(
-                evstring_slice(text, v.offset + v.len, -1), 
-                evstring_slice(query, 0, -1))) {
-        if(!check_run) {
-            results[count++] = v;
+#endif
+#if EV_SIMD_SSE2
+    __m128i from16 = _mm_set1_epi8(from);
+    __m128i to16 = _mm_set1_epi8(to);
+    for(; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i eq = _mm_cmpeq_epi8(x, from16);
+        if(_mm_movemask_epi8(eq)) {
+            _mm_storeu_si128((__m128i *)(data + i), _mm_or_si128(_mm_and_si128(eq, to16), _mm_andnot_si128(eq, x)));
         }
     }
-    return count;
+#endif
+    for(; i < len; i++) {
+        if(data[i] == from) {
+            data[i] = to;
+        }
+    }
+}
+
+ev_str_charset
+ev_str_charset_from(
+    const char *chars,
+    u64 len)
+{
+    ev_str_charset set;
+    memset(&set, 0, sizeof(set));
+    for(u64 i = 0; i < len; i++) {
+        u8 c = (u8)chars[i];
+        (c < 0x80 ? set.low : set.high)[c & 15] |= (u8)(1u << ((c >> 4) & 7));
+    }
+    return set;
+}
+
+ev_str_charset
+ev_str_charset_fromStr(
+    const char *chars)
+{
+    return ev_str_charset_from(chars, strlen(chars));
+}
+
+bool
+ev_str_charset_has(
+    const ev_str_charset *set,
+    char c)
+{
+    u8 b = (u8)c;
+    return ((b < 0x80 ? set->low : set->high)[b & 15] >> ((b >> 4) & 7)) & 1;
+}
+
+// Bytes are classified by looking their low nibble up in both bitmaps, and
+// testing the bit that their high nibble selects. Shuffles write zero where
+// the index has its top bit set, so each bitmap only answers for its half of
+// the byte values.
+#if EV_SIMD_AVX2
+static EV_FORCEINLINE u32
+__ev_str_classify32(
+    __m256i x,
+    __m256i low,
+    __m256i high,
+    __m256i bits)
+{
+    __m256i idx = _mm256_and_si256(x, _mm256_set1_epi8((char)0x8F));
+    __m256i row = _mm256_or_si256(_mm256_shuffle_epi8(low, idx),
+            _mm256_shuffle_epi8(high, _mm256_xor_si256(idx, _mm256_set1_epi8((char)0x80))));
+    __m256i bit = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(x, 4), _mm256_set1_epi8(0x0F)));
+    return (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit));
+}
+#endif
+
+#if EV_SIMD_SSSE3
+static EV_FORCEINLINE u32
+__ev_str_classify16(
+    __m128i x,
+    __m128i low,
+    __m128i high,
+    __m128i bits)
+{
+    __m128i idx = _mm_and_si128(x, _mm_set1_epi8((char)0x8F));
+    __m128i row = _mm_or_si128(_mm_shuffle_epi8(low, idx),
+            _mm_shuffle_epi8(high, _mm_xor_si128(idx, _mm_set1_epi8((char)0x80))));
+    __m128i bit = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi8(0x0F)));
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), bit));
+}
+#endif
+
+static EV_FORCEINLINE u64
+__ev_str_findFirstOf_impl(
+    const char *data,
+    u64 len,
+    const ev_str_charset *set,
+    bool negate)
+{
+    u64 i = 0;
+#if EV_SIMD_SSSE3
+    __m128i low16 = _mm_loadu_si128((const __m128i *)set->low);
+    __m128i high16 = _mm_loadu_si128((const __m128i *)set->high);
+    __m128i bits16 = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128);
+#if EV_SIMD_AVX2
+    __m256i low32 = _mm256_broadcastsi128_si256(low16);
+    __m256i high32 = _mm256_broadcastsi128_si256(high16);
+    __m256i bits32 = _mm256_broadcastsi128_si256(bits16);
+    for(; i + 32 <= len; i += 32) {
+        u32 mask = __ev_str_classify32(_mm256_loadu_si256((const __m256i *)(data + i)), low32, high32, bits32);
+        mask = negate ? ~mask : mask;
+        if(mask) {
+            return i + __ev_str_ctz32(mask);
+        }
+    }
+#else
+    for(; i + 32 <= len; i += 32) {
+        u32 mask = __ev_str_classify16(_mm_loadu_si128((const __m128i *)(data + i)), low16, high16, bits16) |
+            (__ev_str_classify16(_mm_loadu_si128((const __m128i *)(data + i + 16)), low16, high16, bits16) << 16);
+        mask = negate ? ~mask : mask;
+        if(mask) {
+            return i + __ev_str_ctz32(mask);
+        }
+    }
+#endif
+    for(; i + 16 <= len; i += 16) {
+        u32 mask = __ev_str_classify16(_mm_loadu_si128((const __m128i *)(data + i)), low16, high16, bits16);
+        mask = negate ? ~mask & 0xFFFF : mask;
+        if(mask) {
+            return i + __ev_str_ctz32(mask);
+        }
+    }
+#endif
+    for(; i < len; i++) {
+        if(ev_str_charset_has(set, data[i]) != negate) {
+            return i;
+        }
+    }
+    return EV_STR_NPOS;
+}
+
+u64
+ev_str_findFirstOf(
+    const char *data,
+    u64 len,
+    const ev_str_charset *set)
+{
+    return __ev_str_findFirstOf_impl(data, len, set, false);
+}
+
+u64
+ev_str_findFirstNotOf(
+    const char *data,
+    u64 len,
+    const ev_str_charset *set)
+{
+    return __ev_str_findFirstOf_impl(data, len, set, true);
+}
+
+// Two-Way string matching (Crochemore & Perrin). Linear in `len` with
+// constant extra space, which is what the vectorized filter below falls back
+// on when it stops paying for itself.
+static u64
+__ev_str_twoway(
+    const u8 *h,
+    u64 len,
+    const u8 *n,
+    u64 n_len)
+{
+    // Maximal suffix of the needle under `<`, then under `>`. The critical
+    // factorization is the one of the two that starts later.
+    u64 ip = ~0ull, jp = 0, k = 1, p = 1;
+    while(jp + k < n_len) {
+        if(n[ip + k] == n[jp + k]) {
+            if(k == p) {
+                jp += p;
+                k = 1;
+            } else {
+                k++;
+            }
+        } else if(n[ip + k] > n[jp + k]) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+    u64 ms = ip;
+    u64 p0 = p;
+
+    ip = ~0ull; jp = 0; k = p = 1;
+    while(jp + k < n_len) {
+        if(n[ip + k] == n[jp + k]) {
+            if(k == p) {
+                jp += p;
+                k = 1;
+            } else {
+                k++;
+            }
+        } else if(n[ip + k] < n[jp + k]) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+    if(ip + 1 > ms + 1) {
+        ms = ip;
+    } else {
+        p = p0;
+    }
+
+    // `mem0` is how much of the left half is known to match after a period
+    // shift. It is only non-zero when the needle is periodic.
+    u64 mem0;
+    if(memcmp(n, n + p, ms + 1) != 0) {
+        mem0 = 0;
+        p = (ms > n_len - ms - 1 ? ms : n_len - ms - 1) + 1;
+    } else {
+        mem0 = n_len - p;
+    }
+
+    u64 mem = 0;
+    u64 j = 0;
+    while(j + n_len <= len) {
+        // Right half, left to right
+        k = ms + 1 > mem ? ms + 1 : mem;
+        while(k < n_len && n[k] == h[j + k]) {
+            k++;
+        }
+        if(k < n_len) {
+            j += k - ms;
+            mem = 0;
+            continue;
+        }
+        // Left half, right to left
+        k = ms + 1;
+        while(k > mem && n[k - 1] == h[j + k - 1]) {
+            k--;
+        }
+        if(k <= mem) {
+            return j;
+        }
+        j += p;
+        mem = mem0;
+    }
+    return EV_STR_NPOS;
+}
+
+#ifndef EV_STR_MEMMEM_VERIFY_BUDGET
+// Number of verified bytes per scanned byte after which the vectorized
+// search hands over to Two-Way
+#define EV_STR_MEMMEM_VERIFY_BUDGET 8
+#endif
+
+u64
+ev_str_memmem(
+    const char *data,
+    u64 len,
+    const char *needle,
+    u64 needle_len)
+{
+    if(needle_len == 0) {
+        return 0;
+    }
+    if(needle_len > len) {
+        return EV_STR_NPOS;
+    }
+    if(needle_len == 1) {
+        return ev_str_memchr(data, len, needle[0]);
+    }
+
+    u64 i = 0;
+#if EV_SIMD_SSE2
+    // Every position `i` is a candidate only if `data[i]` matches the first
+    // byte and `data[i + needle_len - 1]` matches the last one. Comparing both
+    // for a whole vector of positions rejects almost everything at the cost
+    // of two loads and compares.
+    const u64 last = needle_len - 1;
+    const u64 positions = len - last;
+    u64 verified = 0;
+
+#if EV_SIMD_AVX2
+    const __m256i first32 = _mm256_set1_epi8(needle[0]);
+    const __m256i last32 = _mm256_set1_epi8(needle[last]);
+    for(; i + 32 <= positions; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *)(data + i + last));
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_and_si256(
+                    _mm256_cmpeq_epi8(block_first, first32),
+                    _mm256_cmpeq_epi8(block_last, last32)));
+        while(mask) {
+            u64 pos = i + __ev_str_ctz32(mask);
+            if(memcmp(data + pos + 1, needle + 1, needle_len - 2) == 0) {
+                return pos;
+            }
+            verified += needle_len;
+            mask &= mask - 1;
+        }
+        if(verified > (i + 32) * EV_STR_MEMMEM_VERIFY_BUDGET) {
+            goto twoway;
+        }
+    }
+#endif
+
+    const __m128i first16 = _mm_set1_epi8(needle[0]);
+    const __m128i last16 = _mm_set1_epi8(needle[last]);
+    for(; i + 16 <= positions; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(data + i + last));
+        u32 mask = (u32)_mm_movemask_epi8(_mm_and_si128(
+                    _mm_cmpeq_epi8(block_first, first16),
+                    _mm_cmpeq_epi8(block_last, last16)));
+        while(mask) {
+            u64 pos = i + __ev_str_ctz32(mask);
+            if(memcmp(data + pos + 1, needle + 1, needle_len - 2) == 0) {
+                return pos;
+            }
+            verified += needle_len;
+            mask &= mask - 1;
+        }
+        if(verified > (i + 16) * EV_STR_MEMMEM_VERIFY_BUDGET) {
+            goto twoway;
+        }
+    }
+
+    // Fewer than 16 positions are left; check them one by one
+    for(; i < positions; i++) {
+        if(data[i] == needle[0] && data[i + last] == needle[last] &&
+                memcmp(data + i + 1, needle + 1, needle_len - 2) == 0) {
+            return i;
+        }
+    }
+    return EV_STR_NPOS;
+
+twoway:
+#endif
+    {
+        u64 res = __ev_str_twoway((const u8 *)data + i, len - i, (const u8 *)needle, needle_len);
+        return res == EV_STR_NPOS ? EV_STR_NPOS : i + res;
+    }
+}
+
+evstring_view
+__evstring_findFirst_impl(
+    evstring_view text,
+    evstring_view query)
+{
+    u64 idx = ev_str_memmem(text.data + text.offset, text.len,
+            query.data + query.offset, query.len);
+
+    if(idx == EV_STR_NPOS || query.len == 0) {
+        return (evstring_view) {
+            .data = text.data,
+            .offset = ~0ull,
+            .len = 0
+        };
+    }
+    return (evstring_view) {
+        .data = text.data,
+        .offset = text.offset + idx,
+        .len = query.len
+    };
+}
+
+evstring_view
+evstring_findFirst(
+    const evstring text,
+    const evstring query)
+{
+    evstr_asserttype(text);
+    evstr_asserttype(query);
+    return __evstring_findFirst_impl(
+            (evstring_view) { .data = text, .offset = 0, .len = evstring_getLength(text) },
+            (evstring_view) { .data = query, .offset = 0, .len = evstring_getLength(query) });
+}
+
+#define __EV_STR_REPLACE_CACHED 64
+#define __EV_STR_REPLACE_RECORDED 128
+
+// Left-to-right search for the earliest match of any of the queries. The
+// position of the next match of each query is cached, and only searched for
+// again once the cursor moves past it.
+struct __evstring_replace_scan {
+    const char *text;
+    u64 len;
+    const evstring_replace_pair *pairs;
+    u32 count;
+    u64 next[__EV_STR_REPLACE_CACHED];
+};
+
+static inline u64
+__evstring_replace_search(
+    struct __evstring_replace_scan *sc,
+    u32 pair,
+    u64 cursor)
+{
+    evstring q = sc->pairs[pair].query;
+    u64 idx = ev_str_memmem(sc->text + cursor, sc->len - cursor, q, evstring_getLength(q));
+    return idx == EV_STR_NPOS ? EV_STR_NPOS : cursor + idx;
+}
+
+static void
+__evstring_replace_scan_init(
+    struct __evstring_replace_scan *sc,
+    u64 cursor)
+{
+    for(u32 i = 0; i < sc->count && i < __EV_STR_REPLACE_CACHED; i++) {
+        sc->next[i] = evstring_getLength(sc->pairs[i].query) == 0 ? EV_STR_NPOS : __evstring_replace_search(sc, i, cursor);
+    }
+}
+
+static u64
+__evstring_replace_scan_next(
+    struct __evstring_replace_scan *sc,
+    u64 cursor,
+    u32 *pair)
+{
+    u64 best = EV_STR_NPOS;
+    for(u32 i = 0; i < sc->count; i++) {
+        u64 pos;
+        if(i < __EV_STR_REPLACE_CACHED) {
+            if(sc->next[i] != EV_STR_NPOS && sc->next[i] < cursor) {
+                sc->next[i] = __evstring_replace_search(sc, i, cursor);
+            }
+            pos = sc->next[i];
+        } else if(evstring_getLength(sc->pairs[i].query) != 0) {
+            pos = __evstring_replace_search(sc, i, cursor);
+        } else {
+            continue;
+        }
+        if(pos < best) {
+            best = pos;
+            *pair = i;
+        }
+    }
+    return best;
+}
+
+static evstring
+__evstring_replace_impl(
+    const evstring text,
+    const evstring_replace_pair *pairs,
+    u32 count,
+    u64 max_matches)
+{
+    u64 len = evstring_getLength(text);
+    struct __evstring_replace_scan sc = {
+        .text = text,
+        .len = len,
+        .pairs = pairs,
+        .count = count,
+    };
+
+    // The first matches are remembered so that the output can be assembled
+    // without searching again. Past that, the search is resumed after the
+    // last remembered match.
+    struct {
+        u64 pos;
+        u32 pair;
+    } recorded[__EV_STR_REPLACE_RECORDED];
+    u64 recorded_count = 0;
+    u64 total = 0;
+    u64 out_len = len;
+
+    __evstring_replace_scan_init(&sc, 0);
+    u64 cursor = 0;
+    while(total < max_matches) {
+        u32 pair;
+        u64 pos = __evstring_replace_scan_next(&sc, cursor, &pair);
+        if(pos == EV_STR_NPOS) {
+            break;
+        }
+        if(recorded_count < __EV_STR_REPLACE_RECORDED) {
+            recorded[recorded_count].pos = pos;
+            recorded[recorded_count].pair = pair;
+            recorded_count++;
+        }
+        total++;
+        u64 query_len = evstring_getLength(pairs[pair].query);
+        out_len = out_len - query_len + evstring_getLength(pairs[pair].replacement);
+        cursor = pos + query_len;
+    }
+
+    evstring result = evstring_new_impl(NULL, out_len);
+    char *dst = result;
+    u64 src = 0;
+    for(u64 i = 0; i < total; i++) {
+        u64 pos;
+        u32 pair;
+        if(i < recorded_count) {
+            pos = recorded[i].pos;
+            pair = recorded[i].pair;
+        } else {
+            if(i == recorded_count) {
+                __evstring_replace_scan_init(&sc, src);
+            }
+            pos = __evstring_replace_scan_next(&sc, src, &pair);
+        }
+        u64 replacement_len = evstring_getLength(pairs[pair].replacement);
+        memcpy(dst, text + src, pos - src);
+        dst += pos - src;
+        memcpy(dst, pairs[pair].replacement, replacement_len);
+        dst += replacement_len;
+        src = pos + evstring_getLength(pairs[pair].query);
+    }
+    memcpy(dst, text + src, len - src);
+    assert(dst + (len - src) == result + out_len);
+
+    return result;
+}
+
+evstring
+evstring_replaceFirst(
+    const evstring text,
+    const evstring query,
+    const evstring replacement)
+{
+    evstr_asserttype(text);
+    evstr_asserttype(query);
+    evstr_asserttype(replacement);
+    evstring_replace_pair pair = { query, replacement };
+    return __evstring_replace_impl(text, &pair, 1, 1);
+}
+
+evstring
+evstring_replaceAll(
+    const evstring text,
+    const evstring query,
+    const evstring replacement)
+{
+    evstr_asserttype(text);
+    evstr_asserttype(query);
+    evstr_asserttype(replacement);
+    evstring_replace_pair pair = { query, replacement };
+    return __evstring_replace_impl(text, &pair, 1, EV_STR_NPOS);
+}
+
+evstring
+evstring_replaceMany(
+    const evstring text,
+    const evstring_replace_pair *pairs,
+    u32 count)
+{
+    evstr_asserttype(text);
+    return __evstring_replace_impl(text, pairs, count, EV_STR_NPOS);
+}
+
+// \returns Whether `p` points into the buffer of `s`
+static inline bool
+__evstring_pointsInto(
+    const evstring s,
+    const char *p)
+{
+    return (size_t)p >= (size_t)s && (size_t)p <= (size_t)(s + evstring_getLength(s));
+}
+
+static evstring_error_t
+__evstring_replaceAllInPlace_impl(
+    evstring *s,
+    const char *query,
+    u64 query_len,
+    const char *replacement,
+    u64 replacement_len)
+{
+    u64 len = evstring_getLength(*s);
+
+    // A shared string is only copied if it has a match
+    u64 first = ev_str_memmem(*s, len, query, query_len);
+    if(first == EV_STR_NPOS) {
+        return EV_STR_ERR_NONE;
+    }
+
+    // A longer replacement grows the string to its final length first, then
+    // moves the original text to the end of the buffer so that it can be
+    // scanned from there while the result is written from the start.
+    u64 shift = 0;
+    if(replacement_len > query_len) {
+        u64 matches = 1;
+        for(u64 pos = first + query_len;;) {
+            u64 idx = ev_str_memmem(*s + pos, len - pos, query, query_len);
+            if(idx == EV_STR_NPOS) {
+                break;
+            }
+            matches++;
+            pos += idx + query_len;
+        }
+        shift = matches * (replacement_len - query_len);
+    }
+    __evstr_detach(s);
+    if(shift != 0) {
+        evstring_error_t grow_err = __evstring_growTo(s, sizeof(struct evstr_meta_t) + len + shift + 1);
+        if(grow_err != EV_STR_ERR_NONE) {
+            return grow_err;
+        }
+        memmove(*s + shift, *s, len);
+    }
+
+    // The write cursor never overtakes the read cursor, so the string can be
+    // rewritten as it is scanned.
+    char *str = *s + shift;
+    u64 src = 0;
+    u64 dst = 0;
+    for(u64 idx = first; idx != EV_STR_NPOS; idx = ev_str_memmem(str + src, len - src, query, query_len)) {
+        if(dst != src + shift) {
+            memmove(*s + dst, str + src, idx);
+        }
+        dst += idx;
+        memcpy(*s + dst, replacement, replacement_len);
+        dst += replacement_len;
+        src += idx + query_len;
+    }
+    if(dst != src + shift) {
+        memmove(*s + dst, str + src, len - src);
+    }
+    evstr_invalidatehash(*s);
+    META(*s)->length = dst + (len - src);
+    (*s)[META(*s)->length] = '\0';
+    return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+evstring_replaceAllInPlace(
+    evstring *s,
+    const evstring query,
+    const evstring replacement)
+{
+    evstr_asserttype(*s);
+    evstr_asserttype(query);
+    evstr_asserttype(replacement);
+
+    u64 query_len = evstring_getLength(query);
+    u64 replacement_len = evstring_getLength(replacement);
+    if(query_len == 0) {
+        return EV_STR_ERR_NONE;
+    }
+    if(!__evstring_pointsInto(*s, query) && !__evstring_pointsInto(*s, replacement)) {
+        return __evstring_replaceAllInPlace_impl(s, query, query_len, replacement, replacement_len);
+    }
+
+    // Arguments that alias `*s` would be moved or overwritten as it is
+    // rewritten, so they are copied first
+    char *copy = ev_str_malloc(query_len + replacement_len);
+    if(!copy) {
+        return EV_STR_ERR_OOM;
+    }
+    memcpy(copy, query, query_len);
+    memcpy(copy + query_len, replacement, replacement_len);
+    evstring_error_t err = __evstring_replaceAllInPlace_impl(s, copy, query_len, copy + query_len, replacement_len);
+    ev_str_free(copy);
+    return err;
+}
+
+evstring_error_t
+evstring_pushFmt(
+    evstring *s,
+    const char *fmt,
+    ...)
+{
+    evstr_asserttype(*s);
+    va_list ap;
+    va_start(ap, fmt);
+    evstring_error_t res = evstring_pushFmt_v(s, fmt, ap);
+    va_end(ap);
+    return res;
+}
+
+evstring_error_t
+evstring_pushFmt_v(
+    evstring *s,
+    const char *fmt,
+    va_list args)
+{
+    evstr_asserttype(*s);
+    __evstr_detach(s);
+    va_list retry;
+    va_copy(retry, args);
+
+    // Format straight into the spare capacity. Only if the output turns out
+    // not to fit is the string grown and the format string processed again.
+    u64 old_len = evstring_getLength(*s);
+    u64 space = evstring_getSpace(*s);
+    i32 fmt_len = vsnprintf((*s) + old_len, space + 1, fmt, args);
+
+    evstring_error_t res = EV_STR_ERR_NONE;
+    if(fmt_len < 0) {
+        (*s)[old_len] = '\0';
+        res = EV_STR_ERR_FORMAT;
+    } else if((u64)fmt_len > space) {
+        (*s)[old_len] = '\0';
+        res = __evstring_growTo(s, sizeof(struct evstr_meta_t) + old_len + fmt_len + 1);
+        if(res == EV_STR_ERR_NONE) {
+            vsnprintf((*s) + old_len, fmt_len + 1, fmt, retry);
+        }
+    }
+
+    if(res == EV_STR_ERR_NONE) {
+        evstr_invalidatehash(*s);
+        META(*s)->length = old_len + fmt_len;
+    }
+    va_end(retry);
+    return res;
+}
+
+i64
+evstring_findFirstChar(
+    const evstring text,
+    const char c)
+{
+    evstr_asserttype(text);
+    u64 idx = ev_str_memchr(text, evstring_getLength(text), c);
+    return idx == EV_STR_NPOS ? -1 : (i64)idx;
+}
+
+i64
+evstring_findLastChar(
+    const evstring text,
+    const char c)
+{
+    evstr_asserttype(text);
+    u64 idx = ev_str_memrchr(text, evstring_getLength(text), c);
+    return idx == EV_STR_NPOS ? -1 : (i64)idx;
+}
+
+u64
+evstring_findAll(
+    const evstring text,
+    const evstring query,
+    evstring_view *results)
+{
+    evstr_asserttype(text);
+    evstr_asserttype(query);
+
+    u64 text_len = evstring_getLength(text);
+    u64 query_len = evstring_getLength(query);
+    if(text_len == 0 || query_len == 0 || query_len > text_len) {
+        return 0;
+    }
+    u64 count = 0;
+    u64 pos = 0;
+    while(pos + query_len <= text_len) {
+        u64 idx = ev_str_memmem(text + pos, text_len - pos, query, query_len);
+        if(idx == EV_STR_NPOS) {
+            break;
+        }
+        if(results) {
+            results[count] = (evstring_view) {
+                .data = text,
+                .offset = pos + idx,
+                .len = query_len
+            };
+        }
+        count++;
+        pos += idx + query_len;
+    }
+    return count;
+}
+
+static const char __ev_str_digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes the digits of `v` so that they end right before `end`, two at a time
+// \returns A pointer to the first digit
+static inline char *
+__ev_str_writeDigits(
+    char *end,
+    u64 v)
+{
+    while(v >= 100) {
+        u64 q = v / 100;
+        u32 r = (u32)(v - q * 100);
+        end -= 2;
+        memcpy(end, __ev_str_digit_pairs + r * 2, 2);
+        v = q;
+    }
+    if(v >= 10) {
+        end -= 2;
+        memcpy(end, __ev_str_digit_pairs + v * 2, 2);
+    } else {
+        *--end = (char)('0' + v);
+    }
+    return end;
+}
+
+evstring_error_t
+evstring_pushU64(
+    evstring *s,
+    u64 v)
+{
+    char buf[20];
+    char *start = __ev_str_writeDigits(buf + sizeof(buf), v);
+    return evstring_push_impl(s, buf + sizeof(buf) - start, start);
+}
+
+evstring_error_t
+evstring_pushI64(
+    evstring *s,
+    i64 v)
+{
+    char buf[21];
+    u64 magnitude = v < 0 ? 0 - (u64)v : (u64)v;
+    char *start = __ev_str_writeDigits(buf + sizeof(buf), magnitude);
+    if(v < 0) {
+        *--start = '-';
+    }
+    return evstring_push_impl(s, buf + sizeof(buf) - start, start);
+}
+
+// High 64 bits of a 64x64 bit product
+static inline u64
+__ev_str_mulhi64(
+    u64 a,
+    u64 b,
+    u64 *lo)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 p = (unsigned __int128)a * b;
+    *lo = (u64)p;
+    return (u64)(p >> 64);
+#else
+    u64 hi;
+    *lo = _umul128(a, b, &hi);
+    return hi;
+#endif
+}
+
+// (m * mul) >> j, where `mul` is a 128-bit { low, high } pair and
+// 64 <= j < 128
+static inline u64
+__ev_str_mulShift64(
+    u64 m,
+    const u64 *mul,
+    i32 j)
+{
+    u64 lo0, lo1;
+    u64 hi0 = __ev_str_mulhi64(m, mul[0], &lo0);
+    u64 hi1 = __ev_str_mulhi64(m, mul[1], &lo1);
+    u64 mid = hi0 + lo1;
+    hi1 += mid < hi0;
+    u32 shift = (u32)(j - 64);
+    return shift == 0 ? mid : (mid >> shift) | (hi1 << (64 - shift));
+}
+
+static inline u32
+__ev_str_pow5bits(
+    i32 e)
+{
+    // ceil(log2(5^e)) for 0 <= e <= 3528
+    return (u32)(((e * 1217359) >> 19) + 1);
+}
+
+static inline u32
+__ev_str_log10Pow2(
+    i32 e)
+{
+    // floor(log10(2^e)) for 0 <= e <= 1650
+    return (u32)((e * 78913) >> 18);
+}
+
+static inline u32
+__ev_str_log10Pow5(
+    i32 e)
+{
+    // floor(log10(5^e)) for 0 <= e <= 2620
+    return (u32)((e * 732923) >> 20);
+}
+
+static inline bool
+__ev_str_multipleOfPow5(
+    u64 v,
+    u32 p)
+{
+    u32 count = 0;
+    while(v % 5 == 0) {
+        v /= 5;
+        count++;
+    }
+    return count >= p;
+}
+
+// Shortest decimal `mantissa * 10^exponent` that rounds to the binary
+// floating-point number `m2 * 2^e2`, following Ulf Adams' Ryu. Works for both
+// f32 and f64 inputs, since the tables are precise enough for 55-bit
+// mantissas.
+static void
+__ev_str_ryu(
+    u64 m2,
+    i32 e2,
+    bool mm_shift,
+    u64 *mantissa,
+    i32 *exponent)
+{
+    // The interval of decimals that round to the input is [mm, mp] around
+    // mv, all multiplied by 4 to stay integral. Bounds are included when the
+    // mantissa is even (round-half-to-even).
+    const bool accept_bounds = (m2 & 1) == 0;
+    const u64 mv = 4 * m2;
+    const u32 mm_sub = 1 + (u32)mm_shift;
+    e2 -= 2;
+
+    u64 vr, vp, vm;
+    i32 e10;
+    bool vm_trailing_zeros = false;
+    bool vr_trailing_zeros = false;
+    if(e2 >= 0) {
+        const u32 q = __ev_str_log10Pow2(e2) - (e2 > 3);
+        e10 = (i32)q;
+        const i32 k = __EV_STR_POW5_INV_BITCOUNT + __ev_str_pow5bits((i32)q) - 1;
+        const i32 i = -e2 + (i32)q + k;
+        vr = __ev_str_mulShift64(mv, __EV_STR_POW5_INV_SPLIT[q], i);
+        vp = __ev_str_mulShift64(mv + 2, __EV_STR_POW5_INV_SPLIT[q], i);
+        vm = __ev_str_mulShift64(mv - mm_sub, __EV_STR_POW5_INV_SPLIT[q], i);
+        if(q <= 21) {
+            // Only one of mp, mv and mm can be a multiple of 5, if any
+            if(mv % 5 == 0) {
+                vr_trailing_zeros = __ev_str_multipleOfPow5(mv, q);
+            } else if(accept_bounds) {
+                vm_trailing_zeros = __ev_str_multipleOfPow5(mv - mm_sub, q);
+            } else {
+                vp -= __ev_str_multipleOfPow5(mv + 2, q);
+            }
+        }
+    } else {
+        const u32 q = __ev_str_log10Pow5(-e2) - (-e2 > 1);
+        e10 = (i32)q + e2;
+        const i32 i = -e2 - (i32)q;
+        const i32 k = (i32)__ev_str_pow5bits(i) - __EV_STR_POW5_BITCOUNT;
+        const i32 j = (i32)q - k;
+        vr = __ev_str_mulShift64(mv, __EV_STR_POW5_SPLIT[i], j);
+        vp = __ev_str_mulShift64(mv + 2, __EV_STR_POW5_SPLIT[i], j);
+        vm = __ev_str_mulShift64(mv - mm_sub, __EV_STR_POW5_SPLIT[i], j);
+        if(q <= 1) {
+            // mv has at least q trailing 0 bits, and so do mp and mm if the
+            // bounds are accepted
+            vr_trailing_zeros = true;
+            if(accept_bounds) {
+                vm_trailing_zeros = mm_shift;
+            } else {
+                vp--;
+            }
+        } else if(q < 63) {
+            vr_trailing_zeros = (mv & ((1ull << q) - 1)) == 0;
+        }
+    }
+
+    // Remove digits while the interval still contains a shorter decimal
+    i32 removed = 0;
+    u64 output;
+    if(vm_trailing_zeros || vr_trailing_zeros) {
+        // Exact ties are possible; track whether everything that was removed
+        // is zero
+        u32 last_removed = 0;
+        while(vp / 10 > vm / 10) {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed == 0;
+            last_removed = (u32)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if(vm_trailing_zeros) {
+            while(vm % 10 == 0) {
+                vr_trailing_zeros &= last_removed == 0;
+                last_removed = (u32)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if(vr_trailing_zeros && last_removed == 5 && vr % 2 == 0) {
+            // Round half to even
+            last_removed = 4;
+        }
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+    } else {
+        bool round_up = false;
+        if(vp / 100 > vm / 100) {
+            round_up = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while(vp / 10 > vm / 10) {
+            round_up = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+
+    *mantissa = output;
+    *exponent = e10 + removed;
+}
+
+// Writes `digits * 10^exponent` in fixed notation when its magnitude is in
+// [1e-6, 1e21), and in scientific notation otherwise
+// \returns The number of characters written; at most 25
+static u32
+__ev_str_writeDecimal(
+    char *out,
+    bool negative,
+    u64 digits,
+    i32 exponent)
+{
+    char *p = out;
+    if(negative) {
+        *p++ = '-';
+    }
+    if(digits == 0) {
+        *p++ = '0';
+        return (u32)(p - out);
+    }
+    while(digits % 10 == 0) {
+        digits /= 10;
+        exponent++;
+    }
+
+    char buf[20];
+    char *d = __ev_str_writeDigits(buf + sizeof(buf), digits);
+    i32 k = (i32)(buf + sizeof(buf) - d);
+    // Position of the decimal point relative to the first digit
+    i32 n = exponent + k;
+
+    if(k <= n && n <= 21) {
+        memcpy(p, d, k);
+        p += k;
+        memset(p, '0', n - k);
+        p += n - k;
+    } else if(0 < n && n <= 21) {
+        memcpy(p, d, n);
+        p += n;
+        *p++ = '.';
+        memcpy(p, d + n, k - n);
+        p += k - n;
+    } else if(-6 < n && n <= 0) {
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -n);
+        p += -n;
+        memcpy(p, d, k);
+        p += k;
+    } else {
+        *p++ = d[0];
+        if(k > 1) {
+            *p++ = '.';
+            memcpy(p, d + 1, k - 1);
+            p += k - 1;
+        }
+        *p++ = 'e';
+        i32 e = n - 1;
+        *p++ = e < 0 ? '-' : '+';
+        e = e < 0 ? -e : e;
+        char ebuf[4];
+        char *estart = __ev_str_writeDigits(ebuf + sizeof(ebuf), (u64)e);
+        memcpy(p, estart, ebuf + sizeof(ebuf) - estart);
+        p += ebuf + sizeof(ebuf) - estart;
+    }
+    return (u32)(p - out);
+}
+
+static evstring_error_t
+__ev_str_pushSpecial(
+    evstring *s,
+    bool negative,
+    bool nan)
+{
+    if(nan) {
+        return evstring_push_impl(s, 3, "nan");
+    }
+    return negative ? evstring_push_impl(s, 4, "-inf") : evstring_push_impl(s, 3, "inf");
+}
+
+evstring_error_t
+evstring_pushF64(
+    evstring *s,
+    f64 v)
+{
+    u64 bits;
+    memcpy(&bits, &v, sizeof(bits));
+    const bool negative = bits >> 63;
+    const u64 ieee_mantissa = bits & ((1ull << 52) - 1);
+    const u32 ieee_exponent = (u32)((bits >> 52) & 0x7FF);
+
+    if(ieee_exponent == 0x7FF) {
+        return __ev_str_pushSpecial(s, negative, ieee_mantissa != 0);
+    }
+
+    u64 digits = 0;
+    i32 exponent = 0;
+    if(ieee_exponent != 0 || ieee_mantissa != 0) {
+        if(ieee_exponent == 0) {
+            __ev_str_ryu(ieee_mantissa, 1 - 1023 - 52, true, &digits, &exponent);
+        } else {
+            __ev_str_ryu((1ull << 52) | ieee_mantissa, (i32)ieee_exponent - 1023 - 52,
+                    ieee_mantissa != 0 || ieee_exponent <= 1, &digits, &exponent);
+        }
+    }
+
+    char buf[32];
+    u32 len = __ev_str_writeDecimal(buf, negative, digits, exponent);
+    return evstring_push_impl(s, len, buf);
+}
+
+evstring_error_t
+evstring_pushF32(
+    evstring *s,
+    f32 v)
+{
+    u32 bits;
+    memcpy(&bits, &v, sizeof(bits));
+    const bool negative = bits >> 31;
+    const u32 ieee_mantissa = bits & ((1u << 23) - 1);
+    const u32 ieee_exponent = (bits >> 23) & 0xFF;
+
+    if(ieee_exponent == 0xFF) {
+        return __ev_str_pushSpecial(s, negative, ieee_mantissa != 0);
+    }
+
+    u64 digits = 0;
+    i32 exponent = 0;
+    if(ieee_exponent != 0 || ieee_mantissa != 0) {
+        if(ieee_exponent == 0) {
+            __ev_str_ryu(ieee_mantissa, 1 - 127 - 23, true, &digits, &exponent);
+        } else {
+            __ev_str_ryu((1u << 23) | ieee_mantissa, (i32)ieee_exponent - 127 - 23,
+                    ieee_mantissa != 0 || ieee_exponent <= 1, &digits, &exponent);
+        }
+    }
+
+    char buf[32];
+    u32 len = __ev_str_writeDecimal(buf, negative, digits, exponent);
+    return evstring_push_impl(s, len, buf);
+}
+
+evstring_error_t
+ev_strview_parseU64(
+    ev_strview v,
+    u64 *out)
+{
+    const char *p = v.ptr;
+    const char *end = p + v.len;
+    if(p < end && *p == '+') {
+        p++;
+    }
+    if(p == end) {
+        return EV_STR_ERR_PARSE;
+    }
+
+    u64 value = 0;
+    for(; p < end; p++) {
+        u32 d = (u32)(*p - '0');
+        if(d > 9) {
+            return EV_STR_ERR_PARSE;
+        }
+        if(value > (~0ull - d) / 10) {
+            // Keep validating the rest; a malformed number is a parse error
+            // even if it is also too long
+            for(p++; p < end; p++) {
+                if((u32)(*p - '0') > 9) {
+                    return EV_STR_ERR_PARSE;
+                }
+            }
+            return EV_STR_ERR_RANGE;
+        }
+        value = value * 10 + d;
+    }
+    *out = value;
+    return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+ev_strview_parseI64(
+    ev_strview v,
+    i64 *out)
+{
+    bool negative = v.len > 0 && v.ptr[0] == '-';
+    if(negative) {
+        v.ptr++;
+        v.len--;
+        // "--1" and "-+1" are not numbers
+        if(v.len > 0 && v.ptr[0] == '+') {
+            return EV_STR_ERR_PARSE;
+        }
+    }
+
+    u64 magnitude;
+    evstring_error_t res = ev_strview_parseU64(v, &magnitude);
+    if(res != EV_STR_ERR_NONE) {
+        return res;
+    }
+    if(magnitude > (u64)Int64.MAX + negative) {
+        return EV_STR_ERR_RANGE;
+    }
+    *out = negative ? (i64)(0 - magnitude) : (i64)magnitude;
+    return EV_STR_ERR_NONE;
+}
+
+static const f64 __ev_str_exact_pow10[23] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Converts `w * 10^q` to the nearest f64 with a 128-bit approximation of
+// 5^q (Eisel-Lemire). `w` must be non-zero.
+// \returns false when the approximation can not decide the rounding, or the
+// result is subnormal; the caller then needs an exact algorithm.
+static bool
+__ev_str_eiselLemire(
+    u64 w,
+    i64 q,
+    bool negative,
+    f64 *out)
+{
+    if(q < __EV_STR_POW5_128_MIN) {
+        *out = negative ? -0.0 : 0.0;
+        return true;
+    }
+    if(q > __EV_STR_POW5_128_MAX) {
+        *out = negative ? -(f64)INFINITY : (f64)INFINITY;
+        return true;
+    }
+
+    const u64 *pow5 = __EV_STR_POW5_128[q - __EV_STR_POW5_128_MIN];
+    // floor(log2(10^q)) + 1024 + 63
+    i64 exponent = (((152170 + 65536) * q) >> 16) + 1024 + 63;
+    u32 lz = __ev_str_clz64(w);
+    w <<= lz;
+
+    u64 lower;
+    u64 upper = __ev_str_mulhi64(w, pow5[0], &lower);
+    if((upper & 0x1FF) == 0x1FF && lower + w < lower) {
+        // The truncated product might be off in the bits that decide the
+        // rounding; bring in the next 64 bits of 5^q
+        u64 product_low;
+        u64 product_middle2 = __ev_str_mulhi64(w, pow5[1], &product_low);
+        u64 product_middle = lower + product_middle2;
+        u64 product_high = upper + (product_middle < lower);
+        if(product_middle + 1 == 0 && (product_high & 0x1FF) == 0x1FF && product_low + w < product_low) {
+            return false;
+        }
+        upper = product_high;
+        lower = product_middle;
+    }
+
+    u64 upper_bit = upper >> 63;
+    u64 mantissa = upper >> (upper_bit + 9);
+    lz += (u32)(1 ^ upper_bit);
+
+    // Exactly halfway between two floats; needs an exact comparison
+    if(lower == 0 && (upper & 0x1FF) == 0 && (mantissa & 3) == 1) {
+        return false;
+    }
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if(mantissa >= (1ull << 53)) {
+        // Rounding overflowed into the next binade
+        mantissa = 1ull << 52;
+        lz--;
+    }
+    mantissa &= ~(1ull << 52);
+    i64 real_exponent = exponent - lz;
+    if(real_exponent < 1 || real_exponent > 2046) {
+        return false;
+    }
+
+    u64 bits = mantissa | ((u64)real_exponent << 52) | ((u64)negative << 63);
+    memcpy(out, &bits, sizeof(bits));
+    return true;
+}
+
+// Decimal digits with the decimal point before `digits[dp]`, for the inputs
+// that Eisel-Lemire can not decide. The number is shifted by powers of two
+// until it is in [1/2, 1), then its 53 leading bits are rounded (simple
+// decimal conversion). Nothing depends on the locale.
+#define __EV_STR_DECIMAL_DIGITS 800
+#define __EV_STR_DECIMAL_MAX_SHIFT 60
+
+typedef struct {
+    u8 digits[__EV_STR_DECIMAL_DIGITS];
+    u32 nd;
+    i64 dp;
+    // Non-zero digits were dropped past the end of `digits`
+    bool truncated;
+} __ev_str_decimal;
+
+static void
+__ev_str_decimal_trim(
+    __ev_str_decimal *d)
+{
+    while(d->nd > 0 && d->digits[d->nd - 1] == 0) {
+        d->nd--;
+    }
+    if(d->nd == 0) {
+        d->dp = 0;
+    }
+}
+
+// Multiplies by 2^k, with k <= __EV_STR_DECIMAL_MAX_SHIFT
+static void
+__ev_str_decimal_leftShift(
+    __ev_str_decimal *d,
+    u32 k)
+{
+    // The product is written backwards from the end of `out`
+    u8 out[__EV_STR_DECIMAL_DIGITS + 20];
+    u32 w = sizeof(out);
+    u64 n = 0;
+    for(u32 r = d->nd; r-- > 0;) {
+        n += (u64)d->digits[r] << k;
+        out[--w] = (u8)(n % 10);
+        n /= 10;
+    }
+    while(n > 0) {
+        out[--w] = (u8)(n % 10);
+        n /= 10;
+    }
+    u32 len = (u32)sizeof(out) - w;
+    d->dp += len - d->nd;
+    if(len > __EV_STR_DECIMAL_DIGITS) {
+        for(u32 i = __EV_STR_DECIMAL_DIGITS; i < len; i++) {
+            d->truncated |= out[w + i] != 0;
+        }
+        len = __EV_STR_DECIMAL_DIGITS;
+    }
+    memcpy(d->digits, out + w, len);
+    d->nd = len;
+    __ev_str_decimal_trim(d);
+}
+
+// Divides by 2^k, with k <= __EV_STR_DECIMAL_MAX_SHIFT
+static void
+__ev_str_decimal_rightShift(
+    __ev_str_decimal *d,
+    u32 k)
+{
+    u32 r = 0;
+    u32 w = 0;
+    u64 n = 0;
+    for(; (n >> k) == 0; r++) {
+        if(r >= d->nd) {
+            if(n == 0) {
+                d->nd = 0;
+                d->dp = 0;
+                return;
+            }
+            while((n >> k) == 0) {
+                n *= 10;
+                r++;
+            }
+            break;
+        }
+        n = n * 10 + d->digits[r];
+    }
+    d->dp -= (i64)r - 1;
+
+    u64 mask = (1ull << k) - 1;
+    for(; r < d->nd; r++) {
+        u8 digit = (u8)(n >> k);
+        n &= mask;
+        d->digits[w++] = digit;
+        n = n * 10 + d->digits[r];
+    }
+    while(n > 0) {
+        u8 digit = (u8)(n >> k);
+        n &= mask;
+        if(w < __EV_STR_DECIMAL_DIGITS) {
+            d->digits[w++] = digit;
+        } else if(digit > 0) {
+            d->truncated = true;
+        }
+        n *= 10;
+    }
+    d->nd = w;
+    __ev_str_decimal_trim(d);
+}
+
+static void
+__ev_str_decimal_shift(
+    __ev_str_decimal *d,
+    i32 k)
+{
+    if(d->nd == 0) {
+        return;
+    }
+    for(; k > __EV_STR_DECIMAL_MAX_SHIFT; k -= __EV_STR_DECIMAL_MAX_SHIFT) {
+        __ev_str_decimal_leftShift(d, __EV_STR_DECIMAL_MAX_SHIFT);
+    }
+    for(; k < -__EV_STR_DECIMAL_MAX_SHIFT; k += __EV_STR_DECIMAL_MAX_SHIFT) {
+        __ev_str_decimal_rightShift(d, __EV_STR_DECIMAL_MAX_SHIFT);
+    }
+    if(k > 0) {
+        __ev_str_decimal_leftShift(d, (u32)k);
+    } else if(k < 0) {
+        __ev_str_decimal_rightShift(d, (u32)-k);
+    }
+}
+
+// \returns The integer part, rounded half to even. Must be below 2^64.
+static u64
+__ev_str_decimal_roundedInteger(
+    const __ev_str_decimal *d)
+{
+    u64 n = 0;
+    i64 i = 0;
+    for(; i < d->dp && i < d->nd; i++) {
+        n = n * 10 + d->digits[i];
+    }
+    for(; i < d->dp; i++) {
+        n *= 10;
+    }
+    if(d->dp >= 0 && d->dp < d->nd) {
+        u8 next = d->digits[d->dp];
+        bool up = next > 5;
+        if(next == 5) {
+            // Exactly halfway only if nothing follows
+            up = d->dp + 1 < d->nd || d->truncated || (d->dp > 0 && (d->digits[d->dp - 1] & 1));
+        }
+        n += up;
+    }
+    return n;
+}
+
+// Converts the digits of `[p, end)`, which have been validated, times
+// `10^exponent`
+static f64
+__ev_str_decimalToF64(
+    const char *p,
+    const char *end,
+    i64 exponent,
+    bool negative)
+{
+    __ev_str_decimal d;
+    d.nd = 0;
+    d.dp = 0;
+    d.truncated = false;
+    bool fraction = false;
+    for(; p < end; p++) {
+        if(*p == '.') {
+            fraction = true;
+            continue;
+        }
+        u8 digit = (u8)(*p - '0');
+        if(d.nd == 0 && digit == 0) {
+            d.dp -= fraction;
+            continue;
+        }
+        if(d.nd < __EV_STR_DECIMAL_DIGITS) {
+            d.digits[d.nd++] = digit;
+        } else {
+            d.truncated |= digit != 0;
+        }
+        d.dp += !fraction;
+    }
+    d.dp += exponent;
+    __ev_str_decimal_trim(&d);
+
+    u64 bits;
+    if(d.nd == 0 || d.dp < -330) {
+        bits = 0;
+    } else if(d.dp > 310) {
+        bits = 0x7FFull << 52;
+    } else {
+        // Powers of two that move the decimal point by at most one digit
+        static const u8 powers[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+        i32 e = 0;
+        while(d.dp > 0) {
+            i32 n = d.dp >= 9 ? 27 : powers[d.dp];
+            __ev_str_decimal_shift(&d, -n);
+            e += n;
+        }
+        while(d.dp < 0 || (d.dp == 0 && d.digits[0] < 5)) {
+            i32 n = -d.dp >= 9 ? 27 : powers[-d.dp];
+            __ev_str_decimal_shift(&d, n);
+            e -= n;
+        }
+        // From [1/2, 1) to [1, 2)
+        e--;
+        if(e < -1022) {
+            // Subnormal: the exponent stays at its minimum
+            __ev_str_decimal_shift(&d, e + 1022);
+            e = -1022;
+        }
+        if(e + 1023 >= 0x7FF) {
+            bits = 0x7FFull << 52;
+        } else {
+            __ev_str_decimal_shift(&d, 53);
+            u64 mantissa = __ev_str_decimal_roundedInteger(&d);
+            if(mantissa == 2ull << 52) {
+                mantissa >>= 1;
+                e++;
+            }
+            if(e + 1023 >= 0x7FF) {
+                bits = 0x7FFull << 52;
+            } else {
+                u64 biased = (mantissa & (1ull << 52)) ? (u64)(e + 1023) : 0;
+                bits = (mantissa & ((1ull << 52) - 1)) | (biased << 52);
+            }
+        }
+    }
+    bits |= (u64)negative << 63;
+    f64 out;
+    memcpy(&out, &bits, sizeof(out));
+    return out;
+}
+
+static bool
+__ev_str_matchWord(
+    const char *p,
+    const char *end,
+    const char *word)
+{
+    u64 len = strlen(word);
+    if((u64)(end - p) != len) {
+        return false;
+    }
+    for(u64 i = 0; i < len; i++) {
+        if((p[i] | 0x20) != word[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+evstring_error_t
+ev_strview_parseF64(
+    ev_strview v,
+    f64 *out)
+{
+    const char *begin = v.ptr;
+    const char *end = begin + v.len;
+    const char *p = begin;
+
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    if(p == end) {
+        return EV_STR_ERR_PARSE;
+    }
+
+    if(*p != '.' && (u32)(*p - '0') > 9) {
+        if(__ev_str_matchWord(p, end, "inf") || __ev_str_matchWord(p, end, "infinity")) {
+            *out = negative ? -(f64)INFINITY : (f64)INFINITY;
+            return EV_STR_ERR_NONE;
+        }
+        if(__ev_str_matchWord(p, end, "nan")) {
+            *out = negative ? -(f64)NAN : (f64)NAN;
+            return EV_STR_ERR_NONE;
+        }
+        return EV_STR_ERR_PARSE;
+    }
+
+    // Up to 19 significant digits are accumulated in `w`; later ones only
+    // move the exponent, and mark the mantissa as truncated if non-zero.
+    const char *digits = p;
+    u64 w = 0;
+    u32 significant = 0;
+    i64 q = 0;
+    bool any_digit = false;
+    bool truncated = false;
+    for(; p < end && (u32)(*p - '0') <= 9; p++) {
+        any_digit = true;
+        if(significant < 19) {
+            w = w * 10 + (u32)(*p - '0');
+            significant += w != 0;
+        } else {
+            q++;
+            truncated |= *p != '0';
+        }
+    }
+    if(p < end && *p == '.') {
+        for(p++; p < end && (u32)(*p - '0') <= 9; p++) {
+            any_digit = true;
+            if(significant < 19) {
+                w = w * 10 + (u32)(*p - '0');
+                significant += w != 0;
+                q--;
+            } else {
+                truncated |= *p != '0';
+            }
+        }
+    }
+    if(!any_digit) {
+        return EV_STR_ERR_PARSE;
+    }
+
+    const char *digits_end = p;
+    i64 exponent = 0;
+    if(p < end && (*p | 0x20) == 'e') {
+        p++;
+        bool exp_negative = false;
+        if(p < end && (*p == '-' || *p == '+')) {
+            exp_negative = *p == '-';
+            p++;
+        }
+        if(p == end || (u32)(*p - '0') > 9) {
+            return EV_STR_ERR_PARSE;
+        }
+        i64 e = 0;
+        for(; p < end && (u32)(*p - '0') <= 9; p++) {
+            // Anything this large is already zero or infinity
+            if(e < 100000) {
+                e = e * 10 + (*p - '0');
+            }
+        }
+        exponent = exp_negative ? -e : e;
+        q += exponent;
+    }
+    if(p != end) {
+        return EV_STR_ERR_PARSE;
+    }
+
+    if(w == 0) {
+        *out = negative ? -0.0 : 0.0;
+        return EV_STR_ERR_NONE;
+    }
+
+    if(!truncated) {
+        // Both the mantissa and the power of ten are exact doubles, so a
+        // single correctly rounded operation gives the right result
+        if(q >= -22 && q <= 22 && w <= (1ull << 53)) {
+            f64 d = (f64)w;
+            d = q < 0 ? d / __ev_str_exact_pow10[-q] : d * __ev_str_exact_pow10[q];
+            *out = negative ? -d : d;
+            return EV_STR_ERR_NONE;
+        }
+        if(__ev_str_eiselLemire(w, q, negative, out)) {
+            return EV_STR_ERR_NONE;
+        }
+    } else {
+        // The exact value is between w and w+1; if both round to the same
+        // double, so does the exact value
+        f64 lo, hi;
+        if(__ev_str_eiselLemire(w, q, negative, &lo) &&
+                __ev_str_eiselLemire(w + 1, q, negative, &hi) && lo == hi) {
+            *out = lo;
+            return EV_STR_ERR_NONE;
+        }
+    }
+
+    *out = __ev_str_decimalToF64(digits, digits_end, exponent, negative);
+    return EV_STR_ERR_NONE;
+}
+
+
+evstring_error_t
+evstring_view_parseI64(
+    evstring_view v,
+    i64 *out)
+{
+    return ev_strview_parseI64(evstring_view_toStrview(v), out);
+}
+
+evstring_error_t
+evstring_view_parseU64(
+    evstring_view v,
+    u64 *out)
+{
+    return ev_strview_parseU64(evstring_view_toStrview(v), out);
+}
+
+evstring_error_t
+evstring_view_parseF64(
+    evstring_view v,
+    f64 *out)
+{
+    return ev_strview_parseF64(evstring_view_toStrview(v), out);
+}
+
+evstring
+evstring_newFromStrview(
+    ev_strview v)
+{
+    return evstring_new_impl(v.ptr, v.len);
+}
+
+evstring_error_t
+evstring_pushStrview(
+    evstring *s,
+    ev_strview v)
+{
+    evstr_asserttype(*s);
+    assert((v.ptr < *s || v.ptr > *s + evstring_getLength(*s)) && " *s might be realloc'ed in a push operation. This would lead to the view pointing to a free'd block of memory.");
+    return evstring_push_impl(s, v.len, v.ptr);
+}
+
+ev_strview
+evstring_toStrview(
+    const evstring s)
+{
+    evstr_asserttype(s);
+    return ev_strview_from(s, evstring_getLength(s));
+}
+
+ev_strview
+evstring_view_toStrview(
+    evstring_view v)
+{
+    return ev_strview_from(v.data + v.offset, v.len);
+}
+
+ev_strview
+ev_strview_fromStr(
+    const char *str)
+{
+    return ev_strview_from(str, strlen(str));
+}
+
+ev_strview
+ev_strview_slice(
+    ev_strview v,
+    u64 begin,
+    u64 end)
+{
+    assert(begin <= end && end <= v.len);
+    return ev_strview_from(v.ptr + begin, end - begin);
+}
+
+bool
+ev_strview_eq(
+    ev_strview a,
+    ev_strview b)
+{
+    return a.len == b.len && (a.len == 0 || memcmp(a.ptr, b.ptr, a.len) == 0);
+}
+
+i32
+ev_strview_cmp(
+    ev_strview a,
+    ev_strview b)
+{
+    u64 common = a.len < b.len ? a.len : b.len;
+    u64 idx = ev_str_mismatch(a.ptr, b.ptr, common);
+    if(idx != EV_STR_NPOS) {
+        return (i32)(u8)a.ptr[idx] - (i32)(u8)b.ptr[idx];
+    }
+    return (a.len > b.len) - (a.len < b.len);
+}
+
+bool
+ev_strview_eq_icase(
+    ev_strview a,
+    ev_strview b)
+{
+    return a.len == b.len && ev_str_mismatch_icase(a.ptr, b.ptr, a.len) == EV_STR_NPOS;
+}
+
+i32
+ev_strview_cmp_icase(
+    ev_strview a,
+    ev_strview b)
+{
+    u64 common = a.len < b.len ? a.len : b.len;
+    u64 idx = ev_str_mismatch_icase(a.ptr, b.ptr, common);
+    if(idx != EV_STR_NPOS) {
+        return (i32)(u8)__ev_str_tolower(a.ptr[idx]) - (i32)(u8)__ev_str_tolower(b.ptr[idx]);
+    }
+    return (a.len > b.len) - (a.len < b.len);
+}
+
+bool
+ev_strview_startsWith(
+    ev_strview v,
+    ev_strview prefix)
+{
+    return prefix.len <= v.len && ev_str_mismatch(v.ptr, prefix.ptr, prefix.len) == EV_STR_NPOS;
+}
+
+bool
+ev_strview_endsWith(
+    ev_strview v,
+    ev_strview suffix)
+{
+    return suffix.len <= v.len && ev_str_mismatch(v.ptr + v.len - suffix.len, suffix.ptr, suffix.len) == EV_STR_NPOS;
+}
+
+int
+evstring_order_qsort(
+    const void *a,
+    const void *b)
+{
+    return ev_strview_cmp(evstring_toStrview(*(const evstring *)a), evstring_toStrview(*(const evstring *)b));
+}
+
+u64
+ev_strview_find(
+    ev_strview text,
+    ev_strview query)
+{
+    return ev_str_memmem(text.ptr, text.len, query.ptr, query.len);
+}
+
+u64
+ev_strview_findChar(
+    ev_strview v,
+    char c)
+{
+    return ev_str_memchr(v.ptr, v.len, c);
+}
+
+u64
+ev_strview_findLastChar(
+    ev_strview v,
+    char c)
+{
+    return ev_str_memrchr(v.ptr, v.len, c);
+}
+
+bool
+ev_strview_cut(
+    ev_strview v,
+    char delim,
+    ev_strview *before,
+    ev_strview *after)
+{
+    u64 idx = ev_str_memchr(v.ptr, v.len, delim);
+    if(idx == EV_STR_NPOS) {
+        *before = v;
+        *after = ev_strview_from(v.ptr + v.len, 0);
+        return false;
+    }
+    *before = ev_strview_from(v.ptr, idx);
+    *after = ev_strview_from(v.ptr + idx + 1, v.len - idx - 1);
+    return true;
+}
+
+bool
+ev_strview_split(
+    ev_strview *rest,
+    char delim,
+    ev_strview *token)
+{
+    if(!rest->ptr) {
+        return false;
+    }
+    if(!ev_strview_cut(*rest, delim, token, rest)) {
+        *rest = ev_strview_from(NULL, 0);
+    }
+    return true;
+}
+
+static inline bool
+__ev_str_isspace(
+    char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+ev_strview
+ev_strview_trimLeft(
+    ev_strview v)
+{
+    while(v.len > 0 && __ev_str_isspace(v.ptr[0])) {
+        v.ptr++;
+        v.len--;
+    }
+    return v;
+}
+
+ev_strview
+ev_strview_trimRight(
+    ev_strview v)
+{
+    while(v.len > 0 && __ev_str_isspace(v.ptr[v.len - 1])) {
+        v.len--;
+    }
+    return v;
+}
+
+ev_strview
+ev_strview_trim(
+    ev_strview v)
+{
+    return ev_strview_trimRight(ev_strview_trimLeft(v));
+}
+
+u64
+ev_strview_findFirstOf(
+    ev_strview v,
+    const ev_str_charset *set)
+{
+    return ev_str_findFirstOf(v.ptr, v.len, set);
+}
+
+u64
+ev_strview_findFirstNotOf(
+    ev_strview v,
+    const ev_str_charset *set)
+{
+    return ev_str_findFirstNotOf(v.ptr, v.len, set);
+}
+
+static inline evstring_view
+__evstring_view_fromStrview(
+    evstring_view base,
+    ev_strview v)
+{
+    base.offset = (u64)(v.ptr - base.data);
+    base.len = v.len;
+    return base;
+}
+
+evstring_view
+evstring_view_trim(
+    evstring_view v)
+{
+    return __evstring_view_fromStrview(v, ev_strview_trim(evstring_view_toStrview(v)));
+}
+
+evstring_view
+evstring_view_trimLeft(
+    evstring_view v)
+{
+    return __evstring_view_fromStrview(v, ev_strview_trimLeft(evstring_view_toStrview(v)));
+}
+
+evstring_view
+evstring_view_trimRight(
+    evstring_view v)
+{
+    return __evstring_view_fromStrview(v, ev_strview_trimRight(evstring_view_toStrview(v)));
+}
+
+evstring_error_t
+evstring_toLower(
+    evstring *s)
+{
+    evstr_asserttype(*s);
+    __evstr_detach(s);
+    evstr_invalidatehash(*s);
+    ev_str_toLower(*s, *s, evstring_getLength(*s));
+    return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+evstring_toUpper(
+    evstring *s)
+{
+    evstr_asserttype(*s);
+    __evstr_detach(s);
+    evstr_invalidatehash(*s);
+    ev_str_toUpper(*s, *s, evstring_getLength(*s));
+    return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+evstring_replaceChar(
+    evstring *s,
+    char from,
+    char to)
+{
+    evstr_asserttype(*s);
+    u64 len = evstring_getLength(*s);
+    u64 first = ev_str_memchr(*s, len, from);
+    if(first == EV_STR_NPOS || from == to) {
+        return EV_STR_ERR_NONE;
+    }
+    __evstr_detach(s);
+    evstr_invalidatehash(*s);
+    ev_str_replaceChar(*s + first, len - first, from, to);
+    return EV_STR_ERR_NONE;
+}
+
+// Keeps the part of the string that `kept` points to, by moving it to the
+// front and shrinking the length
+static evstring_error_t
+__evstring_trimTo(
+    evstring *s,
+    ev_strview kept)
+{
+    if(kept.len == evstring_getLength(*s)) {
+        return EV_STR_ERR_NONE;
+    }
+    u64 offset = (u64)(kept.ptr - *s);
+    __evstr_detach(s);
+    if(offset) {
+        memmove(*s, *s + offset, kept.len);
+    }
+    return evstring_setLength(s, kept.len);
+}
+
+evstring_error_t
+evstring_trim(
+    evstring *s)
+{
+    evstr_asserttype(*s);
+    return __evstring_trimTo(s, ev_strview_trim(evstring_toStrview(*s)));
+}
+
+evstring_error_t
+evstring_trimLeft(
+    evstring *s)
+{
+    evstr_asserttype(*s);
+    return __evstring_trimTo(s, ev_strview_trimLeft(evstring_toStrview(*s)));
+}
+
+evstring_error_t
+evstring_trimRight(
+    evstring *s)
+{
+    evstr_asserttype(*s);
+    return __evstring_trimTo(s, ev_strview_trimRight(evstring_toStrview(*s)));
+}
+
+const evstring_allocator *
+evstring_allocator_set(
+    const evstring_allocator *allocator)
+{
+    const evstring_allocator *prev = __evstr_current_allocator;
+    __evstr_current_allocator = allocator;
+    return prev;
+}
+
+const evstring_allocator *
+evstring_allocator_get(void)
+{
+    return __evstr_current_allocator;
+}
+
+struct evstring_arena_block {
+    struct evstring_arena_block *next;
+    u64 size;
+    u64 used;
+    char data[];
+};
+
+#define __EVSTR_ARENA_ALIGN(n) (((n) + 7) & ~7ull)
+
+static void *
+__evstring_arena_alloc(
+    void *ctx,
+    u64 size)
+{
+    evstring_arena *arena = ctx;
+    u64 needed = __EVSTR_ARENA_ALIGN(size);
+    struct evstring_arena_block *block = arena->blocks;
+    if(!block || block->size - block->used < needed) {
+        u64 block_size = needed > arena->block_size ? needed : arena->block_size;
+        block = ev_str_malloc(sizeof(struct evstring_arena_block) + block_size);
+        if(!block) {
+            return NULL;
+        }
+        block->size = block_size;
+        block->used = 0;
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+    char *p = block->data + block->used;
+    block->used += needed;
+    arena->last = p;
+    return p;
+}
+
+static void *
+__evstring_arena_realloc(
+    void *ctx,
+    void *ptr,
+    u64 used,
+    u64 new_size)
+{
+    evstring_arena *arena = ctx;
+    // The last allocation is at the top of the first block, and can move the
+    // top instead of being copied
+    if(ptr == arena->last) {
+        struct evstring_arena_block *block = arena->blocks;
+        u64 start = (u64)(arena->last - block->data);
+        u64 needed = __EVSTR_ARENA_ALIGN(new_size);
+        if(block->size - start >= needed) {
+            block->used = start + needed;
+            return ptr;
+        }
+    }
+    void *moved = __evstring_arena_alloc(ctx, new_size);
+    if(moved) {
+        memcpy(moved, ptr, used < new_size ? used : new_size);
+    }
+    return moved;
+}
+
+void
+evstring_arena_init(
+    evstring_arena *arena,
+    u64 block_size)
+{
+    *arena = (evstring_arena) {
+        .allocator = {
+            .alloc = __evstring_arena_alloc,
+            .realloc = __evstring_arena_realloc,
+            .free = NULL,
+            .ctx = arena,
+        },
+        .blocks = NULL,
+        .last = NULL,
+        .block_size = block_size ? block_size : EV_STR_ARENA_BLOCK_SIZE,
+    };
+}
+
+void
+evstring_arena_reset(
+    evstring_arena *arena)
+{
+    struct evstring_arena_block *block = arena->blocks;
+    if(block) {
+        struct evstring_arena_block *next = block->next;
+        while(next) {
+            struct evstring_arena_block *tmp = next->next;
+            ev_str_free(next);
+            next = tmp;
+        }
+        block->next = NULL;
+        block->used = 0;
+    }
+    arena->last = NULL;
+}
+
+void
+evstring_arena_fini(
+    evstring_arena *arena)
+{
+    evstring_arena_reset(arena);
+    if(arena->blocks) {
+        ev_str_free(arena->blocks);
+        arena->blocks = NULL;
+    }
 }
 
 #endif
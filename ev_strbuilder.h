@@ -0,0 +1,482 @@
+/*!
+ * \file ev_strbuilder.h
+ * \brief Builder that assembles large strings in a list of chunks instead of
+ * reallocating one buffer
+ */
+#ifndef EV_STRBUILDER_HEADER
+#define EV_STRBUILDER_HEADER
+
+#include "ev_str.h"
+
+#include <stdio.h>
+
+#if defined(EV_STRBUILDER_SHARED)
+# if defined (EV_STRBUILDER_IMPL)
+#  define EV_STRBUILDER_API EV_EXPORT
+# else
+#  define EV_STRBUILDER_API EV_IMPORT
+# endif
+#else
+# define EV_STRBUILDER_API
+#endif
+
+#ifndef EV_STRBUILDER_INIT_CHUNK
+/*!
+ * \brief Capacity of the first chunk that a builder allocates. Every new
+ * chunk is twice as large as the previous one.
+ */
+#define EV_STRBUILDER_INIT_CHUNK 256
+#endif
+
+#ifndef EV_STRBUILDER_MAX_CHUNK
+/*!
+ * \brief Capacity after which chunks stop growing. Larger pushes still get a
+ * chunk of their own size.
+ */
+#define EV_STRBUILDER_MAX_CHUNK (16 * 1024 * 1024)
+#endif
+
+struct evstring_builder_chunk {
+    struct evstring_builder_chunk *next;
+    u64 len;
+    u64 cap;
+    char data[];
+};
+
+/*!
+ * \brief Appends go to the last chunk while it has room, and to a new, larger
+ * chunk after that, so the accumulated text is never moved. The final string
+ * is allocated once, with its exact length.
+ * \details Sample usage:
+ * ```
+ * evstring_builder b;
+ * evstring_builder_init(&b);
+ * for(...) {
+ *     evstring_builder_push(&b, "<item id=\"%u\">", id);
+ *     evstring_builder_push(&b, name);
+ *     evstring_builder_push(&b, "</item>\n");
+ * }
+ * evstring doc = evstring_builder_build(&b);   // Or evstring_builder_writeFile(&b, f)
+ * evstring_builder_fini(&b);
+ * ```
+ */
+typedef struct {
+    struct evstring_builder_chunk *head;
+    struct evstring_builder_chunk *tail;
+    u64 length;
+    u64 next_cap;
+} evstring_builder;
+
+#define evstring_builder_pushGeneric(b, push) _Generic((push), \
+        char: evstring_builder_pushChar, \
+        evstring_view: evstring_builder_pushView, \
+        ev_strview: evstring_builder_pushStrview, \
+        default: evstring_builder_pushStr \
+        )(b, push)
+
+#define evstring_builder_push(b, push, ...) \
+    EV_VA_OPT_ELSE(__VA_ARGS__)(evstring_builder_pushFmt(b, push, __VA_ARGS__))(evstring_builder_pushGeneric(b, push))
+
+/*!
+ * \brief Initializes an empty builder. Nothing is allocated until the first
+ * push.
+ */
+EV_STRBUILDER_API void
+evstring_builder_init(
+    evstring_builder *b);
+
+/*!
+ * \brief Frees all of the builder's chunks
+ */
+EV_STRBUILDER_API void
+evstring_builder_fini(
+    evstring_builder *b);
+
+/*!
+ * \brief Empties the builder. The first chunk is kept for the next pushes.
+ */
+EV_STRBUILDER_API void
+evstring_builder_clear(
+    evstring_builder *b);
+
+/*!
+ * \returns The total number of characters that were pushed
+ */
+EV_STRBUILDER_API u64
+evstring_builder_getLength(
+    const evstring_builder *b);
+
+EV_STRBUILDER_API evstring_error_t
+evstring_builder_pushImpl(
+    evstring_builder *b,
+    const char *data,
+    u64 len);
+
+EV_STRBUILDER_API evstring_error_t
+evstring_builder_pushStr(
+    evstring_builder *b,
+    const char *str);
+
+EV_STRBUILDER_API evstring_error_t
+evstring_builder_pushView(
+    evstring_builder *b,
+    evstring_view v);
+
+EV_STRBUILDER_API evstring_error_t
+evstring_builder_pushStrview(
+    evstring_builder *b,
+    ev_strview v);
+
+EV_STRBUILDER_API evstring_error_t
+evstring_builder_pushChar(
+    evstring_builder *b,
+    char c);
+
+/*!
+ * \brief Formats directly into the free space of the last chunk, or into a
+ * new chunk if the output does not fit.
+ */
+EV_STRBUILDER_API evstring_error_t
+evstring_builder_pushFmt(
+    evstring_builder *b,
+    const char *fmt,
+    ...);
+
+EV_STRBUILDER_API evstring_error_t
+evstring_builder_pushFmt_v(
+    evstring_builder *b,
+    const char *fmt,
+    va_list args);
+
+/*!
+ * \returns A new evstring with the builder's content. The builder is left
+ * unchanged.
+ */
+EV_STRBUILDER_API evstring
+evstring_builder_build(
+    const evstring_builder *b);
+
+/*!
+ * \brief Writes the builder's content to `f`, one chunk at a time.
+ *
+ * \returns `EV_STR_ERR_IO` if a write fails
+ */
+EV_STRBUILDER_API evstring_error_t
+evstring_builder_writeFile(
+    const evstring_builder *b,
+    FILE *f);
+
+/*!
+ * \brief Writes the builder's content to a file descriptor. On POSIX, chunks
+ * are handed to `writev` in batches, so the content is never joined.
+ *
+ * \returns `EV_STR_ERR_IO` if a write fails
+ */
+EV_STRBUILDER_API evstring_error_t
+evstring_builder_writeFd(
+    const evstring_builder *b,
+    int fd);
+
+#ifdef EV_STRBUILDER_IMPLEMENTATION
+#undef EV_STRBUILDER_IMPLEMENTATION
+
+#include <string.h>
+#include <assert.h>
+
+#if EV_OS_WINDOWS
+# include <io.h>
+#else
+# include <sys/uio.h>
+# include <unistd.h>
+# include <errno.h>
+#endif
+
+// Number of chunks that are passed to a single `writev` call
+#define __EV_STRBUILDER_IOV_BATCH 64
+
+void
+evstring_builder_init(
+    evstring_builder *b)
+{
+    *b = (evstring_builder) {
+        .head = NULL,
+        .tail = NULL,
+        .length = 0,
+        .next_cap = EV_STRBUILDER_INIT_CHUNK,
+    };
+}
+
+void
+evstring_builder_fini(
+    evstring_builder *b)
+{
+    struct evstring_builder_chunk *c = b->head;
+    while(c) {
+        struct evstring_builder_chunk *next = c->next;
+        ev_str_free(c);
+        c = next;
+    }
+    evstring_builder_init(b);
+}
+
+void
+evstring_builder_clear(
+    evstring_builder *b)
+{
+    if(!b->head) {
+        return;
+    }
+    struct evstring_builder_chunk *c = b->head->next;
+    while(c) {
+        struct evstring_builder_chunk *next = c->next;
+        ev_str_free(c);
+        c = next;
+    }
+    b->head->next = NULL;
+    b->head->len = 0;
+    b->tail = b->head;
+    b->length = 0;
+    b->next_cap = b->head->cap * 2 > EV_STRBUILDER_MAX_CHUNK ? EV_STRBUILDER_MAX_CHUNK : b->head->cap * 2;
+}
+
+u64
+evstring_builder_getLength(
+    const evstring_builder *b)
+{
+    return b->length;
+}
+
+// Appends a new chunk that can hold at least `min_cap` characters
+static struct evstring_builder_chunk *
+__evstring_builder_addChunk(
+    evstring_builder *b,
+    u64 min_cap)
+{
+    u64 cap = b->next_cap > min_cap ? b->next_cap : min_cap;
+    struct evstring_builder_chunk *c = ev_str_malloc(sizeof(struct evstring_builder_chunk) + cap);
+    if(!c) {
+        return NULL;
+    }
+    c->next = NULL;
+    c->len = 0;
+    c->cap = cap;
+
+    if(b->tail) {
+        b->tail->next = c;
+    } else {
+        b->head = c;
+    }
+    b->tail = c;
+    b->next_cap = b->next_cap * 2 > EV_STRBUILDER_MAX_CHUNK ? EV_STRBUILDER_MAX_CHUNK : b->next_cap * 2;
+    return c;
+}
+
+evstring_error_t
+evstring_builder_pushImpl(
+    evstring_builder *b,
+    const char *data,
+    u64 len)
+{
+    struct evstring_builder_chunk *c = b->tail;
+    if(c) {
+        // Fill what is left of the last chunk first
+        u64 space = c->cap - c->len;
+        u64 n = space < len ? space : len;
+        memcpy(c->data + c->len, data, n);
+        c->len += n;
+        b->length += n;
+        data += n;
+        len -= n;
+    }
+    if(len > 0) {
+        c = __evstring_builder_addChunk(b, len);
+        if(!c) {
+            return EV_STR_ERR_OOM;
+        }
+        memcpy(c->data, data, len);
+        c->len = len;
+        b->length += len;
+    }
+    return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+evstring_builder_pushStr(
+    evstring_builder *b,
+    const char *str)
+{
+    return evstring_builder_pushImpl(b, str, strlen(str));
+}
+
+evstring_error_t
+evstring_builder_pushView(
+    evstring_builder *b,
+    evstring_view v)
+{
+    return evstring_builder_pushImpl(b, v.data + v.offset, v.len);
+}
+
+evstring_error_t
+evstring_builder_pushStrview(
+    evstring_builder *b,
+    ev_strview v)
+{
+    return evstring_builder_pushImpl(b, v.ptr, v.len);
+}
+
+evstring_error_t
+evstring_builder_pushChar(
+    evstring_builder *b,
+    char c)
+{
+    struct evstring_builder_chunk *tail = b->tail;
+    if(tail && tail->len < tail->cap) {
+        tail->data[tail->len++] = c;
+        b->length++;
+        return EV_STR_ERR_NONE;
+    }
+    return evstring_builder_pushImpl(b, &c, 1);
+}
+
+evstring_error_t
+evstring_builder_pushFmt(
+    evstring_builder *b,
+    const char *fmt,
+    ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    evstring_error_t res = evstring_builder_pushFmt_v(b, fmt, ap);
+    va_end(ap);
+    return res;
+}
+
+evstring_error_t
+evstring_builder_pushFmt_v(
+    evstring_builder *b,
+    const char *fmt,
+    va_list args)
+{
+    va_list retry;
+    va_copy(retry, args);
+
+    // vsnprintf always writes a terminator, which needs one extra byte of
+    // space that is not counted as part of the chunk.
+    struct evstring_builder_chunk *c = b->tail;
+    char empty[1];
+    u64 space = c ? c->cap - c->len : 0;
+    char *dst = space > 0 ? c->data + c->len : empty;
+    i32 len = vsnprintf(dst, space > 0 ? space : 1, fmt, args);
+
+    evstring_error_t res = EV_STR_ERR_NONE;
+    if(len < 0) {
+        res = EV_STR_ERR_FORMAT;
+    } else if((u64)len < space) {
+        c->len += len;
+        b->length += len;
+    } else {
+        // The output is kept contiguous in a new chunk; the rest of the
+        // current one stays unused.
+        c = __evstring_builder_addChunk(b, (u64)len + 1);
+        if(!c) {
+            res = EV_STR_ERR_OOM;
+        } else {
+            vsnprintf(c->data, (u64)len + 1, fmt, retry);
+            c->len = len;
+            b->length += len;
+        }
+    }
+
+    va_end(retry);
+    return res;
+}
+
+evstring
+evstring_builder_build(
+    const evstring_builder *b)
+{
+    evstring s = evstring_new_impl(NULL, b->length);
+    char *dst = s;
+    for(struct evstring_builder_chunk *c = b->head; c; c = c->next) {
+        memcpy(dst, c->data, c->len);
+        dst += c->len;
+    }
+    assert(dst == s + b->length);
+    return s;
+}
+
+evstring_error_t
+evstring_builder_writeFile(
+    const evstring_builder *b,
+    FILE *f)
+{
+    for(struct evstring_builder_chunk *c = b->head; c; c = c->next) {
+        if(c->len > 0 && fwrite(c->data, 1, c->len, f) != c->len) {
+            return EV_STR_ERR_IO;
+        }
+    }
+    return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+evstring_builder_writeFd(
+    const evstring_builder *b,
+    int fd)
+{
+#if EV_OS_WINDOWS
+    for(struct evstring_builder_chunk *c = b->head; c; c = c->next) {
+        u64 written = 0;
+        while(written < c->len) {
+            u64 remaining = c->len - written;
+            int n = _write(fd, c->data + written, remaining > 0x40000000 ? 0x40000000 : (unsigned int)remaining);
+            if(n <= 0) {
+                return EV_STR_ERR_IO;
+            }
+            written += n;
+        }
+    }
+    return EV_STR_ERR_NONE;
+#else
+    const struct evstring_builder_chunk *c = b->head;
+    u64 offset = 0; // Bytes of `c` that were already written
+    while(c) {
+        struct iovec iov[__EV_STRBUILDER_IOV_BATCH];
+        int count = 0;
+        const struct evstring_builder_chunk *it = c;
+        u64 it_offset = offset;
+        for(; it && count < __EV_STRBUILDER_IOV_BATCH; it = it->next) {
+            if(it->len > it_offset) {
+                iov[count].iov_base = (void *)(it->data + it_offset);
+                iov[count].iov_len = it->len - it_offset;
+                count++;
+            }
+            it_offset = 0;
+        }
+        if(count == 0) {
+            break;
+        }
+
+        ssize_t n = writev(fd, iov, count);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return EV_STR_ERR_IO;
+        }
+
+        // Skip what was written, which may end in the middle of a chunk
+        u64 written = (u64)n;
+        while(c && written >= c->len - offset) {
+            written -= c->len - offset;
+            c = c->next;
+            offset = 0;
+        }
+        offset += written;
+    }
+    return EV_STR_ERR_NONE;
+#endif
+}
+
+#endif
+
+#endif
@@ -0,0 +1,455 @@
+/*!
+ * \file ev_strmatcher.h
+ * \brief Multi-pattern string search (Aho-Corasick) that finds every
+ * occurrence of a set of patterns in a single pass over the text
+ */
+#ifndef EV_STRMATCHER_HEADER
+#define EV_STRMATCHER_HEADER
+
+#include "ev_str.h"
+#include "ev_vec.h"
+
+#if defined(EV_STRMATCHER_SHARED)
+# if defined (EV_STRMATCHER_IMPL)
+#  define EV_STRMATCHER_API EV_EXPORT
+# else
+#  define EV_STRMATCHER_API EV_IMPORT
+# endif
+#else
+# define EV_STRMATCHER_API
+#endif
+
+/*!
+ * \brief A compiled set of patterns. Building it is the only operation that
+ * writes to it, so a built matcher can be used by any number of threads at
+ * the same time.
+ */
+typedef struct ev_strmatcher_t ev_strmatcher_t;
+
+/*!
+ * \brief Called for every match that is found.
+ *
+ * \param pattern Index of the matching pattern in the array the matcher was
+ * built from
+ * \param match The matching part of the text
+ * \param udata The pointer that was passed to the scan
+ *
+ * \returns `true` to continue scanning, `false` to stop
+ */
+typedef bool (*ev_strmatcher_fn)(u32 pattern, evstring_view match, void *udata);
+
+/*!
+ * \brief Scans an `evstring` or an `evstring_view`
+ * \details Sample usage:
+ * ```
+ * ev_strmatcher_scan(m, line, on_match, &ctx);
+ * ev_strmatcher_scan(m, evstring_slice(line, 10, -1), on_match, &ctx);
+ * ```
+ */
+#define ev_strmatcher_scan(m, text, fn, udata) _Generic((text), \
+        evstring_view: ev_strmatcher_scan_view, \
+        default: ev_strmatcher_scan_str \
+        )(m, text, fn, udata)
+
+/*!
+ * \brief Same as `ev_strmatcher_scan`, but pushes the matches to an
+ * `ev_vec(evstring_view)`
+ */
+#define ev_strmatcher_find_all(m, text, results) _Generic((text), \
+        evstring_view: ev_strmatcher_find_all_view, \
+        default: ev_strmatcher_find_all_str \
+        )(m, text, results)
+
+/*!
+ * \brief Compiles `count` patterns into a matcher. Empty patterns never match.
+ *
+ * \returns The matcher, or NULL on OOM
+ */
+EV_STRMATCHER_API ev_strmatcher_t *
+ev_strmatcher_init(
+  const evstring_view *patterns,
+  u32 count);
+
+/*!
+ * \brief Same as `ev_strmatcher_init`, for an array of C strings (or evstrings)
+ */
+EV_STRMATCHER_API ev_strmatcher_t *
+ev_strmatcher_init_strs(
+  const char *const *patterns,
+  u32 count);
+
+EV_STRMATCHER_API void
+ev_strmatcher_fini(
+  ev_strmatcher_t *m);
+
+/*!
+ * \brief Reports every occurrence of every pattern in `text`, including
+ * overlapping ones. Matches are reported in the order in which they end;
+ * matches that end at the same position are reported longest first. The cost
+ * is one table lookup per byte of text plus the number of matches, regardless
+ * of how many patterns there are.
+ *
+ * \returns The number of matches that were reported
+ */
+EV_STRMATCHER_API u64
+ev_strmatcher_scan_view(
+  const ev_strmatcher_t *m,
+  evstring_view text,
+  ev_strmatcher_fn fn,
+  void *udata);
+
+EV_STRMATCHER_API u64
+ev_strmatcher_scan_str(
+  const ev_strmatcher_t *m,
+  const evstring text,
+  ev_strmatcher_fn fn,
+  void *udata);
+
+/*!
+ * \brief Pushes every match in `text` to `results`, which must be an
+ * initialized `ev_vec(evstring_view)`.
+ *
+ * \returns `EV_VEC_ERR_NONE`, or `EV_VEC_ERR_OOM` if a push failed. The matches
+ * that were pushed before the failure are kept.
+ */
+EV_STRMATCHER_API ev_vec_error_t
+ev_strmatcher_find_all_view(
+  const ev_strmatcher_t *m,
+  evstring_view text,
+  ev_vec(evstring_view) *results);
+
+EV_STRMATCHER_API ev_vec_error_t
+ev_strmatcher_find_all_str(
+  const ev_strmatcher_t *m,
+  const evstring text,
+  ev_vec(evstring_view) *results);
+
+/*!
+ * \returns The number of patterns the matcher was built from
+ */
+EV_STRMATCHER_API u32
+ev_strmatcher_pattern_count(
+  const ev_strmatcher_t *m);
+
+#ifdef EV_STRMATCHER_IMPLEMENTATION
+#undef EV_STRMATCHER_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+
+#define __EV_STRMATCHER_NONE (~0u)
+
+// All of the automaton's arrays live in one allocation right after this
+// struct. Bytes that appear in no pattern share one column of the transition
+// table, so a row is only as wide as the patterns' alphabet.
+struct ev_strmatcher_t {
+  u32 pattern_count;
+  u32 state_count;
+  u32 class_count;
+  u8 classes[256];
+
+  //! `state_count * class_count` transitions; never fail
+  u32 *transitions;
+  //! Closest state (the state itself included) on the failure chain that
+  //! completes a pattern
+  u32 *report;
+  //! Next state after `report[s]` on the failure chain that completes a
+  //! pattern; only meaningful for reporting states
+  u32 *dict;
+  //! First pattern that ends at a state
+  u32 *state_pattern;
+  //! Next pattern with the same content, for duplicated patterns
+  u32 *pattern_next;
+  u64 *pattern_len;
+};
+
+static ev_strmatcher_t *
+__ev_strmatcher_build(
+  const evstring_view *views,
+  const char *const *strs,
+  u32 count)
+{
+  u64 *lens = malloc(((u64)count + 1) * sizeof(u64));
+  if(!lens) {
+    return NULL;
+  }
+
+  bool used[256] = { 0 };
+  u64 total_len = 0;
+  for(u32 i = 0; i < count; i++) {
+    const u8 *p = views ? (const u8 *)views[i].data + views[i].offset : (const u8 *)strs[i];
+    lens[i] = views ? views[i].len : strlen(strs[i]);
+    total_len += lens[i];
+    for(u64 j = 0; j < lens[i]; j++) {
+      used[p[j]] = true;
+    }
+  }
+
+  u8 classes[256];
+  u32 class_count = 1;
+  for(u32 b = 0; b < 256; b++) {
+    classes[b] = used[b] ? (u8)class_count++ : 0;
+  }
+  // 255 distinct bytes plus the shared class would not fit in a u8; in that
+  // case every byte gets its own column.
+  if(class_count > 256) {
+    for(u32 b = 0; b < 256; b++) {
+      classes[b] = (u8)b;
+    }
+    class_count = 256;
+  }
+
+  // Trie with one dense row per state. 0 means "no child" during
+  // construction, since the root is never a child.
+  u64 max_states = total_len + 1;
+  u32 *goto_table = calloc(max_states * class_count, sizeof(u32));
+  u32 *state_pattern = malloc(max_states * sizeof(u32));
+  u32 *pattern_next = malloc(((u64)count + 1) * sizeof(u32));
+  if(!goto_table || !state_pattern || !pattern_next) {
+    free(goto_table);
+    free(state_pattern);
+    free(pattern_next);
+    free(lens);
+    return NULL;
+  }
+  state_pattern[0] = __EV_STRMATCHER_NONE;
+
+  u32 state_count = 1;
+  for(u32 i = 0; i < count; i++) {
+    pattern_next[i] = __EV_STRMATCHER_NONE;
+    if(lens[i] == 0) {
+      continue;
+    }
+    const u8 *p = views ? (const u8 *)views[i].data + views[i].offset : (const u8 *)strs[i];
+    u32 s = 0;
+    for(u64 j = 0; j < lens[i]; j++) {
+      u32 *slot = &goto_table[(u64)s * class_count + classes[p[j]]];
+      if(*slot == 0) {
+        state_pattern[state_count] = __EV_STRMATCHER_NONE;
+        *slot = state_count++;
+      }
+      s = *slot;
+    }
+    // Duplicates are chained so that each of them gets reported
+    if(state_pattern[s] == __EV_STRMATCHER_NONE) {
+      state_pattern[s] = i;
+    } else {
+      u32 last = state_pattern[s];
+      while(pattern_next[last] != __EV_STRMATCHER_NONE) {
+        last = pattern_next[last];
+      }
+      pattern_next[last] = i;
+    }
+  }
+
+  u64 transitions_size = (u64)state_count * class_count * sizeof(u32);
+  u64 states_size = (u64)state_count * sizeof(u32);
+  u64 patterns_size = ((u64)count + 1) * sizeof(u32);
+  ev_strmatcher_t *m = malloc(sizeof(ev_strmatcher_t) + transitions_size + 3 * states_size + patterns_size + ((u64)count + 1) * sizeof(u64));
+  u32 *fail = malloc(states_size);
+  u32 *queue = malloc(states_size);
+  if(!m || !fail || !queue) {
+    free(m);
+    free(fail);
+    free(queue);
+    free(goto_table);
+    free(state_pattern);
+    free(pattern_next);
+    free(lens);
+    return NULL;
+  }
+
+  // The u64 lengths go first so that they stay aligned
+  m->pattern_len = (u64 *)(m + 1);
+  m->transitions = (u32 *)(m->pattern_len + count + 1);
+  m->report = m->transitions + (u64)state_count * class_count;
+  m->dict = m->report + state_count;
+  m->state_pattern = m->dict + state_count;
+  m->pattern_next = m->state_pattern + state_count;
+  m->pattern_count = count;
+  m->state_count = state_count;
+  m->class_count = class_count;
+  memcpy(m->classes, classes, sizeof(classes));
+  memcpy(m->pattern_len, lens, count * sizeof(u64));
+  memcpy(m->transitions, goto_table, transitions_size);
+  memcpy(m->state_pattern, state_pattern, states_size);
+  memcpy(m->pattern_next, pattern_next, count * sizeof(u32));
+
+  // Breadth-first pass that computes the failure links and turns the trie
+  // into a complete DFA: a missing child takes the transition of the state's
+  // failure link, which is shallower and therefore already complete.
+  u32 *trans = m->transitions;
+  u32 head = 0, tail = 0;
+  fail[0] = 0;
+  m->report[0] = __EV_STRMATCHER_NONE;
+  m->dict[0] = __EV_STRMATCHER_NONE;
+  for(u32 c = 0; c < class_count; c++) {
+    u32 child = trans[c];
+    if(child) {
+      fail[child] = 0;
+      queue[tail++] = child;
+    }
+  }
+  while(head < tail) {
+    u32 s = queue[head++];
+    u32 f = fail[s];
+    m->dict[s] = m->report[f];
+    m->report[s] = m->state_pattern[s] != __EV_STRMATCHER_NONE ? s : m->report[f];
+
+    u32 *row = &trans[(u64)s * class_count];
+    const u32 *fail_row = &trans[(u64)f * class_count];
+    for(u32 c = 0; c < class_count; c++) {
+      if(row[c]) {
+        fail[row[c]] = fail_row[c];
+        queue[tail++] = row[c];
+      } else {
+        row[c] = fail_row[c];
+      }
+    }
+  }
+
+  free(queue);
+  free(fail);
+  free(goto_table);
+  free(state_pattern);
+  free(pattern_next);
+  free(lens);
+  return m;
+}
+
+ev_strmatcher_t *
+ev_strmatcher_init(
+  const evstring_view *patterns,
+  u32 count)
+{
+  return __ev_strmatcher_build(patterns, NULL, count);
+}
+
+ev_strmatcher_t *
+ev_strmatcher_init_strs(
+  const char *const *patterns,
+  u32 count)
+{
+  return __ev_strmatcher_build(NULL, patterns, count);
+}
+
+void
+ev_strmatcher_fini(
+  ev_strmatcher_t *m)
+{
+  free(m);
+}
+
+u64
+ev_strmatcher_scan_view(
+  const ev_strmatcher_t *m,
+  evstring_view text,
+  ev_strmatcher_fn fn,
+  void *udata)
+{
+  const u8 *data = (const u8 *)text.data + text.offset;
+  const u32 *trans = m->transitions;
+  const u32 *report = m->report;
+  const u8 *classes = m->classes;
+  const u64 class_count = m->class_count;
+  u64 count = 0;
+
+  u32 s = 0;
+  for(u64 i = 0; i < text.len; i++) {
+    s = trans[s * class_count + classes[data[i]]];
+    if(report[s] == __EV_STRMATCHER_NONE) {
+      continue;
+    }
+    for(u32 r = report[s]; r != __EV_STRMATCHER_NONE; r = m->dict[r]) {
+      for(u32 p = m->state_pattern[r]; p != __EV_STRMATCHER_NONE; p = m->pattern_next[p]) {
+        count++;
+        evstring_view match = {
+          .data = text.data,
+          .offset = text.offset + i + 1 - m->pattern_len[p],
+          .len = m->pattern_len[p]
+        };
+        if(!fn(p, match, udata)) {
+          return count;
+        }
+      }
+    }
+  }
+  return count;
+}
+
+u64
+ev_strmatcher_scan_str(
+  const ev_strmatcher_t *m,
+  const evstring text,
+  ev_strmatcher_fn fn,
+  void *udata)
+{
+  evstring_view v = {
+    .data = text,
+    .offset = 0,
+    .len = evstring_getLength(text)
+  };
+  return ev_strmatcher_scan_view(m, v, fn, udata);
+}
+
+struct __ev_strmatcher_collect_t {
+  ev_vec(evstring_view) *results;
+  ev_vec_error_t err;
+};
+
+static bool
+__ev_strmatcher_collect(
+  u32 pattern,
+  evstring_view match,
+  void *udata)
+{
+  (void)pattern;
+  struct __ev_strmatcher_collect_t *ctx = udata;
+  // A failed push leaves the vector unchanged
+  u64 len = ev_vec_len(ctx->results);
+  ev_vec_push_impl(ctx->results, &match);
+  if(ev_vec_len(ctx->results) == len) {
+    ctx->err = EV_VEC_ERR_OOM;
+    return false;
+  }
+  return true;
+}
+
+ev_vec_error_t
+ev_strmatcher_find_all_view(
+  const ev_strmatcher_t *m,
+  evstring_view text,
+  ev_vec(evstring_view) *results)
+{
+  struct __ev_strmatcher_collect_t ctx = {
+    .results = results,
+    .err = EV_VEC_ERR_NONE
+  };
+  ev_strmatcher_scan_view(m, text, __ev_strmatcher_collect, &ctx);
+  return ctx.err;
+}
+
+ev_vec_error_t
+ev_strmatcher_find_all_str(
+  const ev_strmatcher_t *m,
+  const evstring text,
+  ev_vec(evstring_view) *results)
+{
+  evstring_view v = {
+    .data = text,
+    .offset = 0,
+    .len = evstring_getLength(text)
+  };
+  return ev_strmatcher_find_all_view(m, v, results);
+}
+
+u32
+ev_strmatcher_pattern_count(
+  const ev_strmatcher_t *m)
+{
+  return m->pattern_count;
+}
+
+#endif
+
+#endif
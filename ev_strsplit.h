@@ -0,0 +1,524 @@
+/*!
+ * \file ev_strsplit.h
+ * \brief Iterators that split strings into tokens and lines without
+ * allocating
+ */
+#ifndef EV_STRSPLIT_HEADER
+#define EV_STRSPLIT_HEADER
+
+#include "ev_str.h"
+#include "ev_vec.h"
+
+#if defined(EV_STRSPLIT_SHARED)
+# if defined (EV_STRSPLIT_IMPL)
+#  define EV_STRSPLIT_API EV_EXPORT
+# else
+#  define EV_STRSPLIT_API EV_IMPORT
+# endif
+#else
+# define EV_STRSPLIT_API
+#endif
+
+/*!
+ * \brief Iterator over the tokens of a string. Tokens are `evstring_view`s
+ * into the original string, which must outlive the iterator. A string with n
+ * delimiters has n+1 tokens, some of which may be empty; set `skip_empty` to
+ * drop empty tokens (e.g. to split on runs of whitespace).
+ * \details Sample usage:
+ * ```
+ * evstring_split_iter it = evstring_split_char(line, ',');
+ * evstring_view field;
+ * while(evstring_split_next(&it, &field)) {
+ *   ...
+ * }
+ *
+ * evstring_split_iter words = evstring_split_any(text, " \t\r\n");
+ * words.skip_empty = true;
+ * ```
+ */
+typedef struct {
+  evstring data;
+  // Start of the next token, and end of the text, relative to `data`
+  u64 pos;
+  u64 end;
+  // Single-char and char-set delimiters: bit i of `mask` is set for every
+  // delimiter at `mask_base + i` that was not returned yet, and `scan` is
+  // where the next block of the text starts
+  u64 scan;
+  u64 mask;
+  u64 mask_base;
+  const char *delim_str;
+  u64 delim_len;
+  u8 kind;
+  char delim;
+  bool done;
+  bool skip_empty;
+  // Char-set delimiters: a bit per byte value, the same set as nibble lookup
+  // tables for bytes below and above 0x80, and the set's first characters
+  u8 set_bits[32];
+  u8 set_nibbles[2][16];
+  u32 set_count;
+  char set_chars[8];
+} evstring_split_iter;
+
+/*!
+ * \brief Iterator over the lines of a string. Lines end at '\n', which is not
+ * part of the line, and a '\r' before it is dropped as well. A final line
+ * without a terminator is returned too, as it is, including a trailing '\r'.
+ * Text that ends with '\n' has no empty last line.
+ * \details Sample usage:
+ * ```
+ * evstring_lines_iter it = evstring_lines(file_content);
+ * evstring_view line;
+ * while(evstring_lines_next(&it, &line)) {
+ *   ...
+ * }
+ * ```
+ */
+typedef struct {
+  evstring_split_iter split;
+} evstring_lines_iter;
+
+#define __evstring_split_asView(text) _Generic((text), \
+        evstring_view: __evstring_split_viewId, \
+        default: __evstring_split_strView \
+        )(text)
+
+/*!
+ * \brief Splits an `evstring` or an `evstring_view` on every occurrence of
+ * `delim`
+ */
+#define evstring_split_char(text, delim) evstring_split_char_view(__evstring_split_asView(text), delim)
+
+/*!
+ * \brief Splits on every character that appears in the null-terminated `set`
+ */
+#define evstring_split_any(text, set) evstring_split_any_view(__evstring_split_asView(text), set)
+
+/*!
+ * \brief Splits on every non-overlapping occurrence of the null-terminated,
+ * non-empty string `delim`. `delim` must outlive the iterator.
+ */
+#define evstring_split_str(text, delim) evstring_split_str_view(__evstring_split_asView(text), delim)
+
+#define evstring_lines(text) evstring_lines_view(__evstring_split_asView(text))
+
+EV_STRSPLIT_API evstring_view
+__evstring_split_viewId(
+  evstring_view v);
+
+EV_STRSPLIT_API evstring_view
+__evstring_split_strView(
+  const evstring s);
+
+/*!
+ * \brief Delimiters are found by comparing 64 bytes of text at a time with
+ * SSE2/AVX2 and keeping a bit mask of the matches, so each token costs a bit
+ * scan instead of a new search. Text without delimiters is skipped with
+ * `ev_str_memchr`.
+ */
+EV_STRSPLIT_API evstring_split_iter
+evstring_split_char_view(
+  evstring_view text,
+  char delim);
+
+/*!
+ * \brief Same as `evstring_split_char_view`. With SSSE3/AVX2, both nibbles of
+ * every byte are looked up in tables built from the set, so every set costs
+ * the same. With SSE2 only, sets of up to 8 characters are compared one
+ * character at a time, and larger sets are searched bytewise.
+ */
+EV_STRSPLIT_API evstring_split_iter
+evstring_split_any_view(
+  evstring_view text,
+  const char *set);
+
+/*!
+ * \brief Searches for the delimiter with `ev_str_memmem`
+ */
+EV_STRSPLIT_API evstring_split_iter
+evstring_split_str_view(
+  evstring_view text,
+  const char *delim);
+
+/*!
+ * \brief Moves to the next token
+ *
+ * \returns `false` once every token was returned
+ */
+EV_STRSPLIT_API bool
+evstring_split_next(
+  evstring_split_iter *it,
+  evstring_view *token);
+
+/*!
+ * \brief Pushes every remaining token of `it` to `out`, which must be an
+ * initialized `ev_vec(evstring_view)`.
+ * \details Sample usage:
+ * ```
+ * ev_vec(evstring_view) fields = ev_vec_init(evstring_view);
+ * evstring_split_into(evstring_split_char(line, ','), &fields);
+ * ```
+ *
+ * \returns `EV_VEC_ERR_NONE`, or `EV_VEC_ERR_OOM` if a push failed. The tokens
+ * that were pushed before the failure are kept.
+ */
+EV_STRSPLIT_API ev_vec_error_t
+evstring_split_into(
+  evstring_split_iter it,
+  ev_vec(evstring_view) *out);
+
+EV_STRSPLIT_API evstring_lines_iter
+evstring_lines_view(
+  evstring_view text);
+
+/*!
+ * \brief Moves to the next line
+ *
+ * \returns `false` once every line was returned
+ */
+EV_STRSPLIT_API bool
+evstring_lines_next(
+  evstring_lines_iter *it,
+  evstring_view *line);
+
+#ifdef EV_STRSPLIT_IMPLEMENTATION
+#undef EV_STRSPLIT_IMPLEMENTATION
+
+#include <string.h>
+#include <assert.h>
+
+#if EV_CC_MSVC
+#include <intrin.h>
+#endif
+#if EV_SIMD_AVX2
+#include <immintrin.h>
+#elif EV_SIMD_SSSE3
+#include <tmmintrin.h>
+#elif EV_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+enum {
+  __EV_STRSPLIT_CHAR,
+  __EV_STRSPLIT_ANY,
+  __EV_STRSPLIT_STR,
+};
+
+#if EV_SIMD_SSSE3
+// Bit of a high nibble in the nibble lookup tables, for bytes below and above
+// 0x80
+static const u8 __ev_strsplit_hi_bits[2][16] = {
+  { 1, 2, 4, 8, 16, 32, 64, 128, 0, 0, 0, 0, 0, 0, 0, 0 },
+  { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, 128 },
+};
+#endif
+
+static inline u32
+__ev_strsplit_ctz64(
+  u64 x)
+{
+#if EV_CC_MSVC
+  unsigned long idx;
+  _BitScanForward64(&idx, x);
+  return idx;
+#else
+  return __builtin_ctzll(x);
+#endif
+}
+
+evstring_view
+__evstring_split_viewId(
+  evstring_view v)
+{
+  return v;
+}
+
+evstring_view
+__evstring_split_strView(
+  const evstring s)
+{
+  return (evstring_view) {
+    .data = s,
+    .offset = 0,
+    .len = evstring_getLength(s)
+  };
+}
+
+static evstring_split_iter
+__evstring_split_init(
+  evstring_view text,
+  u8 kind)
+{
+  evstring_split_iter it;
+  memset(&it, 0, sizeof(it));
+  it.data = text.data;
+  it.pos = text.offset;
+  it.end = text.offset + text.len;
+  it.scan = text.offset;
+  it.kind = kind;
+  return it;
+}
+
+evstring_split_iter
+evstring_split_char_view(
+  evstring_view text,
+  char delim)
+{
+  evstring_split_iter it = __evstring_split_init(text, __EV_STRSPLIT_CHAR);
+  it.delim = delim;
+  return it;
+}
+
+evstring_split_iter
+evstring_split_any_view(
+  evstring_view text,
+  const char *set)
+{
+  evstring_split_iter it = __evstring_split_init(text, __EV_STRSPLIT_ANY);
+  for(const u8 *c = (const u8 *)set; *c; c++) {
+    if(it.set_bits[*c >> 3] & (1 << (*c & 7))) {
+      continue;
+    }
+    if(it.set_count < sizeof(it.set_chars)) {
+      it.set_chars[it.set_count] = (char)*c;
+    }
+    it.set_count++;
+    it.set_bits[*c >> 3] |= (u8)(1 << (*c & 7));
+    it.set_nibbles[*c >> 7][*c & 0x0F] |= (u8)(1 << ((*c >> 4) & 7));
+  }
+  return it;
+}
+
+evstring_split_iter
+evstring_split_str_view(
+  evstring_view text,
+  const char *delim)
+{
+  evstring_split_iter it = __evstring_split_init(text, __EV_STRSPLIT_STR);
+  it.delim_str = delim;
+  it.delim_len = strlen(delim);
+  assert(it.delim_len > 0);
+  return it;
+}
+
+// Bit i is set if `data[i]` is a delimiter, for `len` bytes (at most 64)
+static u64
+__evstring_split_maskScalar(
+  const evstring_split_iter *it,
+  const char *data,
+  u64 len)
+{
+  u64 mask = 0;
+  for(u64 i = 0; i < len; i++) {
+    u8 c = (u8)data[i];
+    bool hit = it->kind == __EV_STRSPLIT_CHAR
+      ? c == (u8)it->delim
+      : (it->set_bits[c >> 3] >> (c & 7)) & 1;
+    mask |= (u64)hit << i;
+  }
+  return mask;
+}
+
+// Same as `__evstring_split_maskScalar` for exactly 64 bytes, compared 16/32
+// bytes at a time
+static inline u64
+__evstring_split_mask64(
+  const evstring_split_iter *it,
+  const char *data)
+{
+#if EV_SIMD_AVX2
+  u64 mask = 0;
+  if(it->kind == __EV_STRSPLIT_CHAR) {
+    const __m256i delim = _mm256_set1_epi8(it->delim);
+    for(u32 i = 0; i < 64; i += 32) {
+      __m256i x = _mm256_loadu_si256((const __m256i *)(data + i));
+      mask |= (u64)(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, delim)) << i;
+    }
+    return mask;
+  }
+  const __m256i lo_a = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)it->set_nibbles[0]));
+  const __m256i lo_b = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)it->set_nibbles[1]));
+  const __m256i hi_a = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)__ev_strsplit_hi_bits[0]));
+  const __m256i hi_b = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)__ev_strsplit_hi_bits[1]));
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  for(u32 i = 0; i < 64; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(data + i));
+    __m256i lo = _mm256_and_si256(x, nibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble);
+    __m256i hits = _mm256_or_si256(
+        _mm256_and_si256(_mm256_shuffle_epi8(lo_a, lo), _mm256_shuffle_epi8(hi_a, hi)),
+        _mm256_and_si256(_mm256_shuffle_epi8(lo_b, lo), _mm256_shuffle_epi8(hi_b, hi)));
+    u32 misses = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hits, _mm256_setzero_si256()));
+    mask |= (u64)~misses << i;
+  }
+  return mask;
+#elif EV_SIMD_SSE2
+  u64 mask = 0;
+  if(it->kind == __EV_STRSPLIT_CHAR) {
+    const __m128i delim = _mm_set1_epi8(it->delim);
+    for(u32 i = 0; i < 64; i += 16) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(data + i));
+      mask |= (u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(x, delim)) << i;
+    }
+    return mask;
+  }
+#if EV_SIMD_SSSE3
+  const __m128i lo_a = _mm_loadu_si128((const __m128i *)it->set_nibbles[0]);
+  const __m128i lo_b = _mm_loadu_si128((const __m128i *)it->set_nibbles[1]);
+  const __m128i hi_a = _mm_loadu_si128((const __m128i *)__ev_strsplit_hi_bits[0]);
+  const __m128i hi_b = _mm_loadu_si128((const __m128i *)__ev_strsplit_hi_bits[1]);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  for(u32 i = 0; i < 64; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(data + i));
+    __m128i lo = _mm_and_si128(x, nibble);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), nibble);
+    __m128i hits = _mm_or_si128(
+        _mm_and_si128(_mm_shuffle_epi8(lo_a, lo), _mm_shuffle_epi8(hi_a, hi)),
+        _mm_and_si128(_mm_shuffle_epi8(lo_b, lo), _mm_shuffle_epi8(hi_b, hi)));
+    u32 misses = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(hits, _mm_setzero_si128()));
+    mask |= (u64)(~misses & 0xFFFF) << i;
+  }
+  return mask;
+#else
+  // Without a byte shuffle, small sets are compared one character at a time
+  if(it->set_count <= sizeof(it->set_chars)) {
+    for(u32 i = 0; i < 64; i += 16) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(data + i));
+      __m128i hits = _mm_setzero_si128();
+      for(u32 c = 0; c < it->set_count; c++) {
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(x, _mm_set1_epi8(it->set_chars[c])));
+      }
+      mask |= (u64)(u32)_mm_movemask_epi8(hits) << i;
+    }
+    return mask;
+  }
+  return __evstring_split_maskScalar(it, data, 64);
+#endif
+#else
+  return __evstring_split_maskScalar(it, data, 64);
+#endif
+}
+
+// Finds the next block of the text that contains delimiters, and sets the
+// iterator's mask to the delimiters in it. The mask stays empty if there are
+// no delimiters left.
+static void
+__evstring_split_refill(
+  evstring_split_iter *it)
+{
+  u64 scan = it->scan;
+  u64 mask = 0;
+  if(it->kind == __EV_STRSPLIT_CHAR && scan < it->end) {
+    // Long tokens are skipped with the memchr kernel, and the block starts at
+    // the delimiter that it finds
+    u64 found = ev_str_memchr(it->data + scan, it->end - scan, it->delim);
+    scan = found == EV_STR_NPOS ? it->end : scan + found;
+  }
+  while(mask == 0 && scan < it->end) {
+    u64 avail = it->end - scan;
+    it->mask_base = scan;
+    if(avail >= 64) {
+      mask = __evstring_split_mask64(it, it->data + scan);
+      scan += 64;
+    } else {
+      mask = __evstring_split_maskScalar(it, it->data + scan, avail);
+      scan = it->end;
+    }
+  }
+  it->scan = scan;
+  it->mask = mask;
+}
+
+bool
+evstring_split_next(
+  evstring_split_iter *it,
+  evstring_view *token)
+{
+  while(!it->done) {
+    u64 start = it->pos;
+    u64 idx;
+    if(it->kind == __EV_STRSPLIT_STR) {
+      u64 found = ev_str_memmem(it->data + start, it->end - start, it->delim_str, it->delim_len);
+      if(found == EV_STR_NPOS) {
+        idx = it->end;
+        it->done = true;
+      } else {
+        idx = start + found;
+        it->pos = idx + it->delim_len;
+      }
+    } else {
+      if(it->mask == 0) {
+        __evstring_split_refill(it);
+      }
+      if(it->mask == 0) {
+        idx = it->end;
+        it->done = true;
+      } else {
+        idx = it->mask_base + __ev_strsplit_ctz64(it->mask);
+        it->mask &= it->mask - 1;
+        it->pos = idx + 1;
+      }
+    }
+
+    if(idx == start && it->skip_empty) {
+      continue;
+    }
+    *token = (evstring_view) {
+      .data = it->data,
+      .offset = start,
+      .len = idx - start
+    };
+    return true;
+  }
+  return false;
+}
+
+ev_vec_error_t
+evstring_split_into(
+  evstring_split_iter it,
+  ev_vec(evstring_view) *out)
+{
+  evstring_view token;
+  while(evstring_split_next(&it, &token)) {
+    // A failed push leaves the vector unchanged
+    u64 len = ev_vec_len(out);
+    ev_vec_push_impl(out, &token);
+    if(ev_vec_len(out) == len) {
+      return EV_VEC_ERR_OOM;
+    }
+  }
+  return EV_VEC_ERR_NONE;
+}
+
+evstring_lines_iter
+evstring_lines_view(
+  evstring_view text)
+{
+  return (evstring_lines_iter) {
+    .split = evstring_split_char_view(text, '\n')
+  };
+}
+
+bool
+evstring_lines_next(
+  evstring_lines_iter *it,
+  evstring_view *line)
+{
+  if(!evstring_split_next(&it->split, line)) {
+    return false;
+  }
+  // Text that ends with a terminator has no empty line after it
+  if(it->split.done && line->len == 0) {
+    return false;
+  }
+  // A final line without a terminator keeps its '\r'
+  if(!it->split.done && line->len > 0 && line->data[line->offset + line->len - 1] == '\r') {
+    line->len--;
+  }
+  return true;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,662 @@
+/*!
+ * \file ev_strtable.h
+ * \brief Table that stores a large collection of strings in one contiguous
+ * buffer
+ */
+#ifndef EV_STRTABLE_HEADER
+#define EV_STRTABLE_HEADER
+
+#include "ev_str.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(EV_STRTABLE_SHARED)
+# if defined (EV_STRTABLE_IMPL)
+#  define EV_STRTABLE_API EV_EXPORT
+# else
+#  define EV_STRTABLE_API EV_IMPORT
+# endif
+#else
+# define EV_STRTABLE_API
+#endif
+
+#ifndef EV_STRTABLE_INIT_BYTES
+/*!
+ * \brief Capacity of the character buffer after the first push. It doubles
+ * whenever it fills up.
+ */
+#define EV_STRTABLE_INIT_BYTES 4096
+#endif
+
+/*!
+ * \brief Every string is stored in `data` as its `u32` length, its characters
+ * and a null terminator, so a string costs 5 bytes plus an 8-byte offset
+ * instead of a heap block with its own header. Strings can be appended, read
+ * back as views, sorted and deduplicated, and the table is saved and loaded as
+ * its two flat arrays.
+ * \details Sample usage:
+ * ```
+ * ev_strtable symbols;
+ * ev_strtable_init(&symbols);
+ * ev_strtable_push(&symbols, "main");
+ * ev_strtable_push(&symbols, evstring_slice(line, 4, 12));
+ * ev_strtable_sort(&symbols);
+ * for(u64 i = 0; i < ev_strtable_count(&symbols); i++) {
+ *     ev_strview name = ev_strtable_get(&symbols, i);
+ *     ...
+ * }
+ * ev_strtable_fini(&symbols);
+ * ```
+ */
+typedef struct {
+    char *data;
+    u64 data_len;
+    u64 data_cap;
+    //! Position of each string in `data`, in table order
+    u64 *offsets;
+    u64 count;
+    u64 offsets_cap;
+} ev_strtable;
+
+#define ev_strtable_push(t, str) _Generic((str), \
+        evstring_view: ev_strtable_pushView, \
+        ev_strview: ev_strtable_pushStrview, \
+        default: ev_strtable_pushStr \
+        )(t, str)
+
+/*!
+ * \brief Initializes an empty table. Nothing is allocated until the first
+ * push.
+ */
+EV_STRTABLE_API void
+ev_strtable_init(
+    ev_strtable *t);
+
+/*!
+ * \brief Frees the table's buffers. Views returned by `ev_strtable_get` are
+ * invalid after this call.
+ */
+EV_STRTABLE_API void
+ev_strtable_fini(
+    ev_strtable *t);
+
+/*!
+ * \brief Removes every string, keeping the buffers for reuse
+ */
+EV_STRTABLE_API void
+ev_strtable_clear(
+    ev_strtable *t);
+
+/*!
+ * \brief Makes room for `count` more strings with a total of `bytes`
+ * characters, so that pushing them does not reallocate
+ */
+EV_STRTABLE_API evstring_error_t
+ev_strtable_reserve(
+    ev_strtable *t,
+    u64 count,
+    u64 bytes);
+
+/*!
+ * \brief Appends a copy of `len` bytes at `data`. Growing the table moves the
+ * character buffer, which invalidates previously returned views.
+ *
+ * \returns `EV_STR_ERR_RANGE` if the string is 4GB or longer
+ */
+EV_STRTABLE_API evstring_error_t
+ev_strtable_pushImpl(
+    ev_strtable *t,
+    const char *data,
+    u64 len);
+
+EV_STRTABLE_API evstring_error_t
+ev_strtable_pushStr(
+    ev_strtable *t,
+    const char *str);
+
+EV_STRTABLE_API evstring_error_t
+ev_strtable_pushView(
+    ev_strtable *t,
+    evstring_view v);
+
+EV_STRTABLE_API evstring_error_t
+ev_strtable_pushStrview(
+    ev_strtable *t,
+    ev_strview v);
+
+/*!
+ * \returns Number of strings in the table
+ */
+static inline u64
+ev_strtable_count(
+    const ev_strtable *t)
+{
+    return t->count;
+}
+
+/*!
+ * \brief Returns the string at `index`. The view is null-terminated, and stays
+ * valid until the table grows or is modified. Defined in the header so that
+ * scans over the table are not function calls.
+ */
+static inline ev_strview
+ev_strtable_get(
+    const ev_strtable *t,
+    u64 index)
+{
+    const char *entry = t->data + t->offsets[index];
+    u32 len;
+    memcpy(&len, entry, sizeof(len));
+    return ev_strview_from(entry + sizeof(len), len);
+}
+
+/*!
+ * \brief Sorts the strings by content, in the order of `ev_strview_cmp`. Only
+ * the offsets are reordered; equal strings keep their relative order.
+ */
+EV_STRTABLE_API evstring_error_t
+ev_strtable_sort(
+    ev_strtable *t);
+
+/*!
+ * \brief Removes every string that is equal to an earlier one, and compacts
+ * the character buffer. The remaining strings keep their order.
+ */
+EV_STRTABLE_API evstring_error_t
+ev_strtable_dedupe(
+    ev_strtable *t);
+
+/*!
+ * \brief Writes the table as a small header followed by the offsets and the
+ * character buffer, in the machine's byte order
+ *
+ * \returns `EV_STR_ERR_IO` if a write fails
+ */
+EV_STRTABLE_API evstring_error_t
+ev_strtable_save(
+    const ev_strtable *t,
+    FILE *f);
+
+/*!
+ * \brief Replaces the table's content with one that was written by
+ * `ev_strtable_save`. The table is unchanged if loading fails.
+ *
+ * \returns `EV_STR_ERR_IO` if a read fails, or `EV_STR_ERR_CORRUPT` if the
+ * data is not a valid table
+ */
+EV_STRTABLE_API evstring_error_t
+ev_strtable_load(
+    ev_strtable *t,
+    FILE *f);
+
+#ifdef EV_STRTABLE_IMPLEMENTATION
+#undef EV_STRTABLE_IMPLEMENTATION
+
+#include <string.h>
+#include <assert.h>
+
+// Strings that are sorted with insertion sort before they are merged
+#define __EV_STRTABLE_SORT_RUN 16
+#define __EV_STRTABLE_FILE_MAGIC "EVST"
+#define __EV_STRTABLE_FILE_VERSION 1
+
+struct __ev_strtable_file_header {
+    char magic[4];
+    u32 version;
+    u64 count;
+    u64 data_len;
+};
+
+void
+ev_strtable_init(
+    ev_strtable *t)
+{
+    *t = (ev_strtable) {
+        .data = NULL,
+        .data_len = 0,
+        .data_cap = 0,
+        .offsets = NULL,
+        .count = 0,
+        .offsets_cap = 0,
+    };
+}
+
+void
+ev_strtable_fini(
+    ev_strtable *t)
+{
+    ev_str_free(t->data);
+    ev_str_free(t->offsets);
+    ev_strtable_init(t);
+}
+
+void
+ev_strtable_clear(
+    ev_strtable *t)
+{
+    t->data_len = 0;
+    t->count = 0;
+}
+
+static evstring_error_t
+__ev_strtable_growData(
+    ev_strtable *t,
+    u64 needed)
+{
+    if(needed <= t->data_cap) {
+        return EV_STR_ERR_NONE;
+    }
+    u64 cap = t->data_cap ? t->data_cap * 2 : EV_STRTABLE_INIT_BYTES;
+    while(cap < needed) {
+        cap *= 2;
+    }
+    char *data = ev_str_realloc(t->data, cap);
+    if(!data) {
+        return EV_STR_ERR_OOM;
+    }
+    t->data = data;
+    t->data_cap = cap;
+    return EV_STR_ERR_NONE;
+}
+
+static evstring_error_t
+__ev_strtable_growOffsets(
+    ev_strtable *t,
+    u64 needed)
+{
+    if(needed <= t->offsets_cap) {
+        return EV_STR_ERR_NONE;
+    }
+    u64 cap = t->offsets_cap ? t->offsets_cap * 2 : EV_STRTABLE_INIT_BYTES / sizeof(u64);
+    while(cap < needed) {
+        cap *= 2;
+    }
+    u64 *offsets = ev_str_realloc(t->offsets, cap * sizeof(u64));
+    if(!offsets) {
+        return EV_STR_ERR_OOM;
+    }
+    t->offsets = offsets;
+    t->offsets_cap = cap;
+    return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+ev_strtable_reserve(
+    ev_strtable *t,
+    u64 count,
+    u64 bytes)
+{
+    evstring_error_t err = __ev_strtable_growOffsets(t, t->count + count);
+    if(err != EV_STR_ERR_NONE) {
+        return err;
+    }
+    return __ev_strtable_growData(t, t->data_len + bytes + count * (sizeof(u32) + 1));
+}
+
+evstring_error_t
+ev_strtable_pushImpl(
+    ev_strtable *t,
+    const char *data,
+    u64 len)
+{
+    if(len > (u32)-1) {
+        return EV_STR_ERR_RANGE;
+    }
+    u64 entry_size = sizeof(u32) + len + 1;
+    if(__ev_strtable_growOffsets(t, t->count + 1) != EV_STR_ERR_NONE ||
+       __ev_strtable_growData(t, t->data_len + entry_size) != EV_STR_ERR_NONE) {
+        return EV_STR_ERR_OOM;
+    }
+
+    char *entry = t->data + t->data_len;
+    u32 len32 = (u32)len;
+    memcpy(entry, &len32, sizeof(len32));
+    memcpy(entry + sizeof(len32), data, len);
+    entry[sizeof(len32) + len] = '\0';
+
+    t->offsets[t->count++] = t->data_len;
+    t->data_len += entry_size;
+    return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+ev_strtable_pushStr(
+    ev_strtable *t,
+    const char *str)
+{
+    return ev_strtable_pushImpl(t, str, strlen(str));
+}
+
+evstring_error_t
+ev_strtable_pushView(
+    ev_strtable *t,
+    evstring_view v)
+{
+    return ev_strtable_pushImpl(t, v.data + v.offset, v.len);
+}
+
+evstring_error_t
+ev_strtable_pushStrview(
+    ev_strtable *t,
+    ev_strview v)
+{
+    return ev_strtable_pushImpl(t, v.ptr, v.len);
+}
+
+// Strings are sorted 8 bytes at a time: records are ordered by the bytes at
+// the current depth, loaded as an integer, and each run of records whose bytes
+// are all equal so far is sorted again at the next depth. Most comparisons
+// never touch the character buffer.
+struct __ev_strtable_sortrec_t {
+    u64 key;
+    u64 offset;
+    u64 len;
+};
+
+struct __ev_strtable_sortrange_t {
+    u64 lo;
+    u64 hi;
+    u64 depth;
+};
+
+static inline u64
+__ev_strtable_key(
+    const char *str,
+    u64 len,
+    u64 depth)
+{
+    // Big-endian, so that comparing keys as integers orders them like bytes
+    u64 key = 0;
+    for(u64 i = depth; i < depth + 8; i++) {
+        key = (key << 8) | (i < len ? (u8)str[i] : 0);
+    }
+    return key;
+}
+
+// Strings that end within the key are padded with zeros, so among equal keys
+// they come first, shortest first, and are not sorted any further
+static EV_FORCEINLINE bool
+__ev_strtable_less(
+    const struct __ev_strtable_sortrec_t *a,
+    const struct __ev_strtable_sortrec_t *b,
+    u64 depth)
+{
+    if(a->key != b->key) {
+        return a->key < b->key;
+    }
+    u64 end_a = a->len <= depth + 8 ? a->len : ~0ull;
+    u64 end_b = b->len <= depth + 8 ? b->len : ~0ull;
+    return end_a < end_b;
+}
+
+// Stable merge sort over insertion-sorted runs. `tmp` has room for `n`
+// records.
+static void
+__ev_strtable_sortRecs(
+    struct __ev_strtable_sortrec_t *recs,
+    struct __ev_strtable_sortrec_t *tmp,
+    u64 n,
+    u64 depth)
+{
+    for(u64 start = 0; start < n; start += __EV_STRTABLE_SORT_RUN) {
+        u64 end = start + __EV_STRTABLE_SORT_RUN < n ? start + __EV_STRTABLE_SORT_RUN : n;
+        for(u64 i = start + 1; i < end; i++) {
+            struct __ev_strtable_sortrec_t rec = recs[i];
+            u64 j = i;
+            while(j > start && __ev_strtable_less(&rec, &recs[j - 1], depth)) {
+                recs[j] = recs[j - 1];
+                j--;
+            }
+            recs[j] = rec;
+        }
+    }
+
+    struct __ev_strtable_sortrec_t *src = recs;
+    struct __ev_strtable_sortrec_t *dst = tmp;
+    for(u64 width = __EV_STRTABLE_SORT_RUN; width < n; width *= 2) {
+        for(u64 lo = 0; lo < n; lo += 2 * width) {
+            u64 mid = lo + width < n ? lo + width : n;
+            u64 hi = lo + 2 * width < n ? lo + 2 * width : n;
+            u64 i = lo, j = mid, k = lo;
+            // Already in order, which is common for partially sorted input
+            if(mid < hi && !__ev_strtable_less(&src[mid], &src[mid - 1], depth)) {
+                memcpy(dst + lo, src + lo, (hi - lo) * sizeof(*src));
+                continue;
+            }
+            while(i < mid && j < hi) {
+                dst[k++] = __ev_strtable_less(&src[j], &src[i], depth) ? src[j++] : src[i++];
+            }
+            memcpy(dst + k, src + i, (mid - i) * sizeof(*src));
+            k += mid - i;
+            memcpy(dst + k, src + j, (hi - j) * sizeof(*src));
+        }
+        struct __ev_strtable_sortrec_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if(src != recs) {
+        memcpy(recs, src, n * sizeof(*src));
+    }
+}
+
+evstring_error_t
+ev_strtable_sort(
+    ev_strtable *t)
+{
+    u64 n = t->count;
+    if(n < 2) {
+        return EV_STR_ERR_NONE;
+    }
+    struct __ev_strtable_sortrec_t *recs = ev_str_malloc(n * 2 * sizeof(struct __ev_strtable_sortrec_t));
+    u64 stack_cap = 64;
+    struct __ev_strtable_sortrange_t *stack = ev_str_malloc(stack_cap * sizeof(*stack));
+    if(!recs || !stack) {
+        ev_str_free(recs);
+        ev_str_free(stack);
+        return EV_STR_ERR_OOM;
+    }
+    struct __ev_strtable_sortrec_t *tmp = recs + n;
+    for(u64 i = 0; i < n; i++) {
+        ev_strview v = ev_strtable_get(t, i);
+        recs[i] = (struct __ev_strtable_sortrec_t) {
+            .key = __ev_strtable_key(v.ptr, v.len, 0),
+            .offset = t->offsets[i],
+            .len = v.len,
+        };
+    }
+
+    // Ranges are kept on a heap stack, since long shared prefixes would
+    // otherwise recurse once per 8 bytes
+    u64 stack_len = 0;
+    stack[stack_len++] = (struct __ev_strtable_sortrange_t) { .lo = 0, .hi = n, .depth = 0 };
+    evstring_error_t err = EV_STR_ERR_NONE;
+    while(stack_len > 0) {
+        struct __ev_strtable_sortrange_t range = stack[--stack_len];
+        struct __ev_strtable_sortrec_t *r = recs + range.lo;
+        u64 count = range.hi - range.lo;
+        if(range.depth > 0) {
+            for(u64 i = 0; i < count; i++) {
+                const char *str = t->data + r[i].offset + sizeof(u32);
+                r[i].key = __ev_strtable_key(str, r[i].len, range.depth);
+            }
+        }
+        __ev_strtable_sortRecs(r, tmp, count, range.depth);
+
+        // Runs that are equal so far and continue past the key
+        for(u64 i = 0; i < count;) {
+            u64 j = i + 1;
+            if(r[i].len > range.depth + 8) {
+                while(j < count && r[j].key == r[i].key && r[j].len > range.depth + 8) {
+                    j++;
+                }
+            }
+            if(j - i > 1) {
+                if(stack_len == stack_cap) {
+                    struct __ev_strtable_sortrange_t *grown = ev_str_realloc(stack, stack_cap * 2 * sizeof(*stack));
+                    if(!grown) {
+                        err = EV_STR_ERR_OOM;
+                        goto done;
+                    }
+                    stack = grown;
+                    stack_cap *= 2;
+                }
+                stack[stack_len++] = (struct __ev_strtable_sortrange_t) {
+                    .lo = range.lo + i,
+                    .hi = range.lo + j,
+                    .depth = range.depth + 8,
+                };
+            }
+            i = j;
+        }
+    }
+
+    for(u64 i = 0; i < n; i++) {
+        t->offsets[i] = recs[i].offset;
+    }
+done:
+    ev_str_free(recs);
+    ev_str_free(stack);
+    return err;
+}
+
+evstring_error_t
+ev_strtable_dedupe(
+    ev_strtable *t)
+{
+    if(t->count < 2) {
+        return EV_STR_ERR_NONE;
+    }
+
+    // Open-addressing set of the kept strings, as their index plus one
+    u64 cap = 16;
+    while(cap < t->count * 2) {
+        cap *= 2;
+    }
+    struct { u64 hash; u64 index; } *slots = ev_str_malloc(cap * sizeof(*slots));
+    char *data = ev_str_malloc(t->data_cap);
+    if(!slots || !data) {
+        ev_str_free(slots);
+        ev_str_free(data);
+        return EV_STR_ERR_OOM;
+    }
+    memset(slots, 0, cap * sizeof(*slots));
+
+    u64 kept = 0;
+    u64 data_len = 0;
+    for(u64 i = 0; i < t->count; i++) {
+        ev_strview s = ev_strtable_get(t, i);
+        u64 hash = ev_hash_murmur3(s.ptr, (u32)s.len, EV_STR_HASH_SEED);
+        u64 slot = hash & (cap - 1);
+        bool duplicate = false;
+        while(slots[slot].index) {
+            if(slots[slot].hash == hash) {
+                const char *entry = data + t->offsets[slots[slot].index - 1];
+                u32 len;
+                memcpy(&len, entry, sizeof(len));
+                if(ev_strview_eq(s, ev_strview_from(entry + sizeof(len), len))) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            slot = (slot + 1) & (cap - 1);
+        }
+        if(duplicate) {
+            continue;
+        }
+
+        u64 entry_size = sizeof(u32) + s.len + 1;
+        memcpy(data + data_len, s.ptr - sizeof(u32), entry_size);
+        t->offsets[kept] = data_len;
+        data_len += entry_size;
+        slots[slot].hash = hash;
+        slots[slot].index = ++kept;
+    }
+
+    ev_str_free(slots);
+    ev_str_free(t->data);
+    t->data = data;
+    t->data_len = data_len;
+    t->count = kept;
+    return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+ev_strtable_save(
+    const ev_strtable *t,
+    FILE *f)
+{
+    struct __ev_strtable_file_header header = {
+        .magic = __EV_STRTABLE_FILE_MAGIC,
+        .version = __EV_STRTABLE_FILE_VERSION,
+        .count = t->count,
+        .data_len = t->data_len,
+    };
+    if(fwrite(&header, sizeof(header), 1, f) != 1) {
+        return EV_STR_ERR_IO;
+    }
+    if(t->count > 0 && (fwrite(t->offsets, sizeof(u64), t->count, f) != t->count ||
+                        fwrite(t->data, 1, t->data_len, f) != t->data_len)) {
+        return EV_STR_ERR_IO;
+    }
+    return EV_STR_ERR_NONE;
+}
+
+evstring_error_t
+ev_strtable_load(
+    ev_strtable *t,
+    FILE *f)
+{
+    struct __ev_strtable_file_header header;
+    if(fread(&header, sizeof(header), 1, f) != 1) {
+        return EV_STR_ERR_IO;
+    }
+    if(memcmp(header.magic, __EV_STRTABLE_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+       header.version != __EV_STRTABLE_FILE_VERSION ||
+       header.count > header.data_len / (sizeof(u32) + 1)) {
+        return EV_STR_ERR_CORRUPT;
+    }
+
+    ev_strtable loaded;
+    ev_strtable_init(&loaded);
+    if(header.count > 0) {
+        if(__ev_strtable_growOffsets(&loaded, header.count) != EV_STR_ERR_NONE ||
+           __ev_strtable_growData(&loaded, header.data_len) != EV_STR_ERR_NONE) {
+            ev_strtable_fini(&loaded);
+            return EV_STR_ERR_OOM;
+        }
+        if(fread(loaded.offsets, sizeof(u64), header.count, f) != header.count ||
+           fread(loaded.data, 1, header.data_len, f) != header.data_len) {
+            ev_strtable_fini(&loaded);
+            return EV_STR_ERR_IO;
+        }
+    } else if(header.data_len > 0) {
+        return EV_STR_ERR_CORRUPT;
+    }
+    loaded.count = header.count;
+    loaded.data_len = header.data_len;
+
+    // Every entry has to fit in the buffer and be terminated where its length
+    // says, which is all that `ev_strtable_get` relies on
+    for(u64 i = 0; i < loaded.count; i++) {
+        u64 offset = loaded.offsets[i];
+        u32 len;
+        if(offset > loaded.data_len || loaded.data_len - offset < sizeof(u32) + 1) {
+            ev_strtable_fini(&loaded);
+            return EV_STR_ERR_CORRUPT;
+        }
+        memcpy(&len, loaded.data + offset, sizeof(len));
+        if(loaded.data_len - offset - sizeof(u32) - 1 < len || loaded.data[offset + sizeof(u32) + len] != '\0') {
+            ev_strtable_fini(&loaded);
+            return EV_STR_ERR_CORRUPT;
+        }
+    }
+
+    ev_strtable_fini(t);
+    *t = loaded;
+    return EV_STR_ERR_NONE;
+}
+
+#endif
+
+#endif
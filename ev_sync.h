@@ -0,0 +1,345 @@
+/*!
+ * \file ev_sync.h
+ * \brief Thin wrappers over the platform's synchronization primitives
+ */
+#ifndef EV_SYNC_HEADER
+#define EV_SYNC_HEADER
+
+#include "ev_macros.h"
+#include "ev_internal.h"
+
+#if EV_OS_WINDOWS
+# include <windows.h>
+typedef SRWLOCK ev_rwlock_t;
+typedef SRWLOCK ev_mutex_t;
+typedef CONDITION_VARIABLE ev_cond_t;
+#else
+# include <pthread.h>
+# include <sched.h>
+# include <time.h>
+typedef pthread_rwlock_t ev_rwlock_t;
+typedef pthread_mutex_t ev_mutex_t;
+typedef pthread_cond_t ev_cond_t;
+#endif
+
+typedef void (*ev_thread_fn)(void *arg);
+
+#if EV_OS_WINDOWS
+typedef DWORD ev_tls_key_t;
+# define EV_TLS_CALLBACK WINAPI
+#else
+typedef pthread_key_t ev_tls_key_t;
+# define EV_TLS_CALLBACK
+#endif
+
+//! Called with a thread's value of a key when the thread exits
+typedef void (EV_TLS_CALLBACK *ev_tls_dtor)(void *value);
+
+/*!
+ * \brief A thread started by `ev_thread_create`. It has to stay at the same
+ * address until `ev_thread_join` returns.
+ */
+typedef struct {
+#if EV_OS_WINDOWS
+  HANDLE handle;
+#else
+  pthread_t handle;
+#endif
+  ev_thread_fn fn;
+  void *arg;
+} ev_thread_t;
+
+static inline void
+ev_rwlock_init(
+  ev_rwlock_t *l)
+{
+#if EV_OS_WINDOWS
+  InitializeSRWLock(l);
+#else
+  pthread_rwlock_init(l, NULL);
+#endif
+}
+
+static inline void
+ev_rwlock_fini(
+  ev_rwlock_t *l)
+{
+#if EV_OS_WINDOWS
+  (void)l;
+#else
+  pthread_rwlock_destroy(l);
+#endif
+}
+
+static inline void
+ev_rwlock_read_lock(
+  ev_rwlock_t *l)
+{
+#if EV_OS_WINDOWS
+  AcquireSRWLockShared(l);
+#else
+  pthread_rwlock_rdlock(l);
+#endif
+}
+
+static inline void
+ev_rwlock_read_unlock(
+  ev_rwlock_t *l)
+{
+#if EV_OS_WINDOWS
+  ReleaseSRWLockShared(l);
+#else
+  pthread_rwlock_unlock(l);
+#endif
+}
+
+static inline void
+ev_rwlock_write_lock(
+  ev_rwlock_t *l)
+{
+#if EV_OS_WINDOWS
+  AcquireSRWLockExclusive(l);
+#else
+  pthread_rwlock_wrlock(l);
+#endif
+}
+
+static inline void
+ev_rwlock_write_unlock(
+  ev_rwlock_t *l)
+{
+#if EV_OS_WINDOWS
+  ReleaseSRWLockExclusive(l);
+#else
+  pthread_rwlock_unlock(l);
+#endif
+}
+
+static inline void
+ev_mutex_init(
+  ev_mutex_t *m)
+{
+#if EV_OS_WINDOWS
+  InitializeSRWLock(m);
+#else
+  pthread_mutex_init(m, NULL);
+#endif
+}
+
+static inline void
+ev_mutex_fini(
+  ev_mutex_t *m)
+{
+#if EV_OS_WINDOWS
+  (void)m;
+#else
+  pthread_mutex_destroy(m);
+#endif
+}
+
+static inline void
+ev_mutex_lock(
+  ev_mutex_t *m)
+{
+#if EV_OS_WINDOWS
+  AcquireSRWLockExclusive(m);
+#else
+  pthread_mutex_lock(m);
+#endif
+}
+
+static inline void
+ev_mutex_unlock(
+  ev_mutex_t *m)
+{
+#if EV_OS_WINDOWS
+  ReleaseSRWLockExclusive(m);
+#else
+  pthread_mutex_unlock(m);
+#endif
+}
+
+static inline void
+ev_cond_init(
+  ev_cond_t *c)
+{
+#if EV_OS_WINDOWS
+  InitializeConditionVariable(c);
+#else
+  pthread_cond_init(c, NULL);
+#endif
+}
+
+static inline void
+ev_cond_fini(
+  ev_cond_t *c)
+{
+#if EV_OS_WINDOWS
+  (void)c;
+#else
+  pthread_cond_destroy(c);
+#endif
+}
+
+/*!
+ * \brief Unlocks `m`, waits for `c` to be signaled, then locks `m` again.
+ * Wakeups can be spurious, so the condition has to be checked in a loop.
+ */
+static inline void
+ev_cond_wait(
+  ev_cond_t *c,
+  ev_mutex_t *m)
+{
+#if EV_OS_WINDOWS
+  SleepConditionVariableSRW(c, m, INFINITE, 0);
+#else
+  pthread_cond_wait(c, m);
+#endif
+}
+
+static inline void
+ev_cond_signal(
+  ev_cond_t *c)
+{
+#if EV_OS_WINDOWS
+  WakeConditionVariable(c);
+#else
+  pthread_cond_signal(c);
+#endif
+}
+
+static inline void
+ev_cond_broadcast(
+  ev_cond_t *c)
+{
+#if EV_OS_WINDOWS
+  WakeAllConditionVariable(c);
+#else
+  pthread_cond_broadcast(c);
+#endif
+}
+
+#if EV_OS_WINDOWS
+static DWORD WINAPI
+__ev_thread_start(
+  LPVOID t)
+{
+  ((ev_thread_t *)t)->fn(((ev_thread_t *)t)->arg);
+  return 0;
+}
+#else
+static void *
+__ev_thread_start(
+  void *t)
+{
+  ((ev_thread_t *)t)->fn(((ev_thread_t *)t)->arg);
+  return NULL;
+}
+#endif
+
+/*!
+ * \brief Starts a thread that runs `fn(arg)`
+ *
+ * \returns Whether the thread was started
+ */
+static inline bool
+ev_thread_create(
+  ev_thread_t *t,
+  ev_thread_fn fn,
+  void *arg)
+{
+  t->fn = fn;
+  t->arg = arg;
+#if EV_OS_WINDOWS
+  t->handle = CreateThread(NULL, 0, __ev_thread_start, t, 0, NULL);
+  return t->handle != NULL;
+#else
+  return pthread_create(&t->handle, NULL, __ev_thread_start, t) == 0;
+#endif
+}
+
+static inline void
+ev_thread_join(
+  ev_thread_t *t)
+{
+#if EV_OS_WINDOWS
+  WaitForSingleObject(t->handle, INFINITE);
+  CloseHandle(t->handle);
+#else
+  pthread_join(t->handle, NULL);
+#endif
+}
+
+/*!
+ * \brief Creates a key for a value of each thread. `dtor` is called on a
+ * thread that exits while its value is not NULL.
+ *
+ * \returns Whether the key was created
+ */
+static inline bool
+ev_tls_create(
+  ev_tls_key_t *key,
+  ev_tls_dtor dtor)
+{
+#if EV_OS_WINDOWS
+  *key = FlsAlloc(dtor);
+  return *key != FLS_OUT_OF_INDEXES;
+#else
+  return pthread_key_create(key, dtor) == 0;
+#endif
+}
+
+/*!
+ * \brief Sets the calling thread's value of `key`
+ */
+static inline void
+ev_tls_set(
+  ev_tls_key_t key,
+  void *value)
+{
+#if EV_OS_WINDOWS
+  FlsSetValue(key, value);
+#else
+  pthread_setspecific(key, value);
+#endif
+}
+
+/*!
+ * \brief Gives the rest of the calling thread's time slice to other threads
+ */
+static inline void
+ev_thread_yield(void)
+{
+#if EV_OS_WINDOWS
+  SwitchToThread();
+#else
+  sched_yield();
+#endif
+}
+
+static inline void
+ev_thread_sleep(
+  u32 ms)
+{
+#if EV_OS_WINDOWS
+  Sleep(ms);
+#else
+  struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+  nanosleep(&ts, NULL);
+#endif
+}
+
+/*!
+ * \brief A full memory barrier: no load or store is reordered across it
+ */
+static inline void
+ev_fence(void)
+{
+#if EV_OS_WINDOWS
+  MemoryBarrier();
+#else
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+#endif
@@ -5,6 +5,8 @@
 #include "ev_internal.h"
 #include "ev_hash.h"
 
+#include <string.h>
+
 typedef void(*ev_copy_fn)(void *dst, void *src);
 typedef void(*ev_free_fn)(void *self);
 typedef u64(*ev_hash_fn)(void *self, u64 seed);
@@ -45,26 +47,48 @@ typedef struct {
 #define DEFINE_DEFAULT_FREE_FUNCTION(T) \
   DEFINE_FREE_FUNCTION(T,DEFAULT) { (void)self; }
 
-#define DEFINE_HASH_FUNCTION(T,name) static inline void HASH_FUNCTION(T,name)(T *self, u64 seed)
+#define DEFINE_HASH_FUNCTION(T,name) static inline u64 HASH_FUNCTION(T,name)(T *self, u64 seed)
 #define DEFINE_DEFAULT_HASH_FUNCTION(T) \
-  DEFINE_HASH_FUNCTION(T,DEFAULT) { ev_hash_murmur3(self, sizeof(T), seed); }
+  DEFINE_HASH_FUNCTION(T,DEFAULT) { return ev_hash_murmur3(self, sizeof(T), seed); }
 
 #define DEFINE_EQUAL_FUNCTION(T,name) static inline bool EQUAL_FUNCTION(T,name)(T *self, T *other)
 // NOTE: This shouldn't be used for non-arithmetic types.
 #define DEFINE_DEFAULT_EQUAL_FUNCTION(T) \
   DEFINE_EQUAL_FUNCTION(T,DEFAULT) { return memcmp(self, other, sizeof(T)) == 0; }
 
+// Writes the lowercase hex digits of `len` bytes to `dst`, eight at a time:
+// the nibbles of four bytes are spread over the bytes of a u64, and turned
+// into digits with two additions instead of a table lookup per nibble.
+// ev_encoding.h builds its SIMD encoder on top of this.
+static inline void
+__ev_hex_encodeScalar(
+  const void *src,
+  u64 len,
+  char *dst)
+{
+  const u8 *s = (const u8 *)src;
+  u64 i = 0;
+  for(; i + 4 <= len; i += 4) {
+    u32 x;
+    memcpy(&x, s + i, sizeof(x));
+    u64 v = x;
+    v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+    v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+    // High nibble first, as in the text
+    u64 nibbles = ((v >> 4) & 0x000F000F000F000Full) | ((v & 0x000F000F000F000Full) << 8);
+    u64 letters = ((nibbles + 0x0606060606060606ull) >> 4) & 0x0101010101010101ull;
+    u64 digits = nibbles + 0x3030303030303030ull + letters * ('a' - '0' - 10);
+    memcpy(dst + 2 * i, &digits, sizeof(digits));
+  }
+  for(char *d = dst + 2 * i; i < len; i++, d += 2) {
+    d[0] = EV_TOHEX_CHAR(s[i] >> 4);
+    d[1] = EV_TOHEX_CHAR(s[i] & 0xf);
+  }
+}
+
 #define DEFINE_TOSTR_FUNCTION(T,name) static inline void TOSTR_FUNCTION(T,name)(T *self, char* out)
 #define DEFINE_DEFAULT_TOSTR_FUNCTION(T) \
-  DEFINE_TOSTR_FUNCTION(T,DEFAULT) \
-  {  \
-    for(int i = 0; i < sizeof(T); i++) \
-    { \
-      u8 byte = ((u8*)self)[i];\
-      out[i*2] = EV_TOHEX_CHAR((u32)(byte >> 4) & 0xf); \
-      out[i*2+1] = EV_TOHEX_CHAR((u32)byte & 0xf); \
-    } \
-  }
+  DEFINE_TOSTR_FUNCTION(T,DEFAULT) { __ev_hex_encodeScalar(self, sizeof(T), out); }
 
 #define DEFINE_TOSTRLEN_FUNCTION(T,name) static inline u32 TOSTRLEN_FUNCTION(T,name)()
 #define DEFINE_DEFAULT_TOSTRLEN_FUNCTION(T) \
@@ -0,0 +1,824 @@
+/*!
+ * \file ev_utf8.h
+ * \brief UTF-8 validation, code point counting, and transcoding between
+ * UTF-8, UTF-16 and UTF-32
+ */
+#ifndef EV_UTF8_HEADER
+#define EV_UTF8_HEADER
+
+#include "ev_str.h"
+
+#if defined(EV_UTF8_SHARED)
+# if defined (EV_UTF8_IMPL)
+#  define EV_UTF8_API EV_EXPORT
+# else
+#  define EV_UTF8_API EV_IMPORT
+# endif
+#else
+# define EV_UTF8_API
+#endif
+
+/*!
+ * \brief Value returned by the transcoding functions when the input is not
+ * valid
+ */
+#define EV_UTF8_INVALID (~0ull)
+
+/*!
+ * \brief Checks that `len` bytes of `data` are valid UTF-8: no overlong
+ * encodings, surrogates, code points above U+10FFFF, or truncated sequences.
+ * With SSSE3/AVX2, every byte is classified with a few nibble table lookups
+ * (Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per
+ * Byte"), and blocks of 32 ASCII bytes are skipped with a single test.
+ */
+EV_UTF8_API bool
+ev_utf8_validate(
+  const char *data,
+  u64 len);
+
+EV_UTF8_API bool
+evstring_utf8_validate(
+  const evstring s);
+
+/*!
+ * \returns The number of code points in valid UTF-8 text, which is the number
+ * of bytes that are not continuation bytes. Invalid text is counted the same
+ * way.
+ */
+EV_UTF8_API u64
+ev_utf8_count(
+  const char *data,
+  u64 len);
+
+EV_UTF8_API u64
+evstring_utf8_count(
+  const evstring s);
+
+/*!
+ * \returns The number of UTF-16 code units needed for valid UTF-8 text
+ */
+EV_UTF8_API u64
+ev_utf8_utf16Length(
+  const char *data,
+  u64 len);
+
+/*!
+ * \brief Converts UTF-8 to UTF-16 in `dst`, which must have room for
+ * `ev_utf8_utf16Length(src, len)` code units. The input is validated while it
+ * is converted.
+ *
+ * \returns The number of code units written, or `EV_UTF8_INVALID`
+ */
+EV_UTF8_API u64
+ev_utf8_toUtf16(
+  const char *src,
+  u64 len,
+  u16 *dst);
+
+/*!
+ * \brief Converts UTF-8 to UTF-32 in `dst`, which must have room for
+ * `ev_utf8_count(src, len)` code points. The input is validated while it is
+ * converted.
+ *
+ * \returns The number of code points written, or `EV_UTF8_INVALID`
+ */
+EV_UTF8_API u64
+ev_utf8_toUtf32(
+  const char *src,
+  u64 len,
+  u32 *dst);
+
+/*!
+ * \returns The number of bytes needed to encode valid UTF-16 as UTF-8
+ */
+EV_UTF8_API u64
+ev_utf16_utf8Length(
+  const u16 *src,
+  u64 len);
+
+/*!
+ * \brief Converts UTF-16 to UTF-8 in `dst`, which must have room for
+ * `ev_utf16_utf8Length(src, len)` bytes. Unpaired surrogates are invalid.
+ *
+ * \returns The number of bytes written, or `EV_UTF8_INVALID`
+ */
+EV_UTF8_API u64
+ev_utf16_toUtf8(
+  const u16 *src,
+  u64 len,
+  char *dst);
+
+/*!
+ * \returns The number of bytes needed to encode valid UTF-32 as UTF-8
+ */
+EV_UTF8_API u64
+ev_utf32_utf8Length(
+  const u32 *src,
+  u64 len);
+
+/*!
+ * \brief Converts UTF-32 to UTF-8 in `dst`, which must have room for
+ * `ev_utf32_utf8Length(src, len)` bytes. Surrogates and values above U+10FFFF
+ * are invalid.
+ *
+ * \returns The number of bytes written, or `EV_UTF8_INVALID`
+ */
+EV_UTF8_API u64
+ev_utf32_toUtf8(
+  const u32 *src,
+  u64 len,
+  char *dst);
+
+/*!
+ * \returns A new evstring with the UTF-8 encoding of `len` UTF-16 code units,
+ * or NULL if they are not valid UTF-16
+ */
+EV_UTF8_API evstring
+evstring_newFromUtf16(
+  const u16 *src,
+  u64 len);
+
+/*!
+ * \returns A new evstring with the UTF-8 encoding of `len` code points, or
+ * NULL if they are not valid UTF-32
+ */
+EV_UTF8_API evstring
+evstring_newFromUtf32(
+  const u32 *src,
+  u64 len);
+
+#ifdef EV_UTF8_IMPLEMENTATION
+#undef EV_UTF8_IMPLEMENTATION
+
+#include <string.h>
+
+#if EV_CC_MSVC
+#include <intrin.h>
+#endif
+#if EV_SIMD_AVX2
+#include <immintrin.h>
+#elif EV_SIMD_SSSE3
+#include <tmmintrin.h>
+#elif EV_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+// \returns Whether the 32 bytes at `p` are all ASCII
+static inline bool
+__ev_utf8_isAscii32(
+  const u8 *p)
+{
+#if EV_SIMD_AVX2
+  return _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)p)) == 0;
+#elif EV_SIMD_SSE2
+  __m128i x = _mm_or_si128(_mm_loadu_si128((const __m128i *)p), _mm_loadu_si128((const __m128i *)(p + 16)));
+  return _mm_movemask_epi8(x) == 0;
+#else
+  u64 w[4];
+  memcpy(w, p, sizeof(w));
+  return ((w[0] | w[1] | w[2] | w[3]) & 0x8080808080808080ull) == 0;
+#endif
+}
+
+// Decodes the sequence that starts at `s[*i]` into `*cp`, and moves `*i`
+// past it.
+// \returns false if the sequence is not valid or is truncated
+static inline bool
+__ev_utf8_decode(
+  const u8 *s,
+  u64 len,
+  u64 *i,
+  u32 *cp)
+{
+  u64 p = *i;
+  u32 b0 = s[p];
+  if(b0 < 0x80) {
+    *cp = b0;
+    *i = p + 1;
+    return true;
+  }
+
+  // Number of continuation bytes, and the range of the first one, which
+  // excludes overlong encodings, surrogates and values above U+10FFFF
+  u32 n;
+  u32 c;
+  u8 lo = 0x80;
+  u8 hi = 0xBF;
+  if(b0 >= 0xC2 && b0 <= 0xDF) {
+    n = 1;
+    c = b0 & 0x1F;
+  } else if(b0 >= 0xE0 && b0 <= 0xEF) {
+    n = 2;
+    c = b0 & 0x0F;
+    if(b0 == 0xE0) {
+      lo = 0xA0;
+    } else if(b0 == 0xED) {
+      hi = 0x9F;
+    }
+  } else if(b0 >= 0xF0 && b0 <= 0xF4) {
+    n = 3;
+    c = b0 & 0x07;
+    if(b0 == 0xF0) {
+      lo = 0x90;
+    } else if(b0 == 0xF4) {
+      hi = 0x8F;
+    }
+  } else {
+    return false;
+  }
+  if(len - p - 1 < n) {
+    return false;
+  }
+  u8 b1 = s[p + 1];
+  if(b1 < lo || b1 > hi) {
+    return false;
+  }
+  c = (c << 6) | (b1 & 0x3F);
+  for(u32 k = 2; k <= n; k++) {
+    u8 b = s[p + k];
+    if((b & 0xC0) != 0x80) {
+      return false;
+    }
+    c = (c << 6) | (b & 0x3F);
+  }
+  *cp = c;
+  *i = p + 1 + n;
+  return true;
+}
+
+#if EV_SIMD_SSSE3
+// Error classes of the lookup validation. Each table maps a nibble of the
+// previous byte (high, low) or of the current byte (high) to the classes that
+// it can be part of; a pair of bytes is an error if a class survives in all
+// three lookups.
+#define __EV_UTF8_TOO_SHORT   (1 << 0) // Lead byte or ASCII followed by a lead byte or ASCII
+#define __EV_UTF8_TOO_LONG    (1 << 1) // ASCII followed by a continuation byte
+#define __EV_UTF8_OVERLONG_3  (1 << 2) // 11100000 100_____
+#define __EV_UTF8_TOO_LARGE   (1 << 3) // 11110100 1001____, 11110100 101_____, 11110101+ 1001____+
+#define __EV_UTF8_SURROGATE   (1 << 4) // 11101101 101_____
+#define __EV_UTF8_OVERLONG_2  (1 << 5) // 1100000_ 10______
+#define __EV_UTF8_TOO_LARGE_1000 (1 << 6) // 11110101+ 1000____
+#define __EV_UTF8_OVERLONG_4  (1 << 6) // 11110000 1000____
+#define __EV_UTF8_TWO_CONTS   (1 << 7) // Continuation byte followed by a continuation byte
+#define __EV_UTF8_CARRY (__EV_UTF8_TOO_SHORT | __EV_UTF8_TOO_LONG | __EV_UTF8_TWO_CONTS)
+
+static const u8 __ev_utf8_byte1_high[16] = {
+  __EV_UTF8_TOO_LONG, __EV_UTF8_TOO_LONG, __EV_UTF8_TOO_LONG, __EV_UTF8_TOO_LONG,
+  __EV_UTF8_TOO_LONG, __EV_UTF8_TOO_LONG, __EV_UTF8_TOO_LONG, __EV_UTF8_TOO_LONG,
+  __EV_UTF8_TWO_CONTS, __EV_UTF8_TWO_CONTS, __EV_UTF8_TWO_CONTS, __EV_UTF8_TWO_CONTS,
+  __EV_UTF8_TOO_SHORT | __EV_UTF8_OVERLONG_2,
+  __EV_UTF8_TOO_SHORT,
+  __EV_UTF8_TOO_SHORT | __EV_UTF8_OVERLONG_3 | __EV_UTF8_SURROGATE,
+  __EV_UTF8_TOO_SHORT | __EV_UTF8_TOO_LARGE | __EV_UTF8_TOO_LARGE_1000 | __EV_UTF8_OVERLONG_4,
+};
+
+static const u8 __ev_utf8_byte1_low[16] = {
+  __EV_UTF8_CARRY | __EV_UTF8_OVERLONG_3 | __EV_UTF8_OVERLONG_2 | __EV_UTF8_OVERLONG_4,
+  __EV_UTF8_CARRY | __EV_UTF8_OVERLONG_2,
+  __EV_UTF8_CARRY,
+  __EV_UTF8_CARRY,
+  __EV_UTF8_CARRY | __EV_UTF8_TOO_LARGE,
+  __EV_UTF8_CARRY | __EV_UTF8_TOO_LARGE | __EV_UTF8_TOO_LARGE_1000,
+  __EV_UTF8_CARRY | __EV_UTF8_TOO_LARGE | __EV_UTF8_TOO_LARGE_1000,
+  __EV_UTF8_CARRY | __EV_UTF8_TOO_LARGE | __EV_UTF8_TOO_LARGE_1000,
+  __EV_UTF8_CARRY | __EV_UTF8_TOO_LARGE | __EV_UTF8_TOO_LARGE_1000,
+  __EV_UTF8_CARRY | __EV_UTF8_TOO_LARGE | __EV_UTF8_TOO_LARGE_1000,
+  __EV_UTF8_CARRY | __EV_UTF8_TOO_LARGE | __EV_UTF8_TOO_LARGE_1000,
+  __EV_UTF8_CARRY | __EV_UTF8_TOO_LARGE | __EV_UTF8_TOO_LARGE_1000,
+  __EV_UTF8_CARRY | __EV_UTF8_TOO_LARGE | __EV_UTF8_TOO_LARGE_1000,
+  __EV_UTF8_CARRY | __EV_UTF8_TOO_LARGE | __EV_UTF8_TOO_LARGE_1000 | __EV_UTF8_SURROGATE,
+  __EV_UTF8_CARRY | __EV_UTF8_TOO_LARGE | __EV_UTF8_TOO_LARGE_1000,
+  __EV_UTF8_CARRY | __EV_UTF8_TOO_LARGE | __EV_UTF8_TOO_LARGE_1000,
+};
+
+static const u8 __ev_utf8_byte2_high[16] = {
+  __EV_UTF8_TOO_SHORT, __EV_UTF8_TOO_SHORT, __EV_UTF8_TOO_SHORT, __EV_UTF8_TOO_SHORT,
+  __EV_UTF8_TOO_SHORT, __EV_UTF8_TOO_SHORT, __EV_UTF8_TOO_SHORT, __EV_UTF8_TOO_SHORT,
+  __EV_UTF8_TOO_LONG | __EV_UTF8_OVERLONG_2 | __EV_UTF8_TWO_CONTS | __EV_UTF8_OVERLONG_3 | __EV_UTF8_TOO_LARGE_1000 | __EV_UTF8_OVERLONG_4,
+  __EV_UTF8_TOO_LONG | __EV_UTF8_OVERLONG_2 | __EV_UTF8_TWO_CONTS | __EV_UTF8_OVERLONG_3 | __EV_UTF8_TOO_LARGE,
+  __EV_UTF8_TOO_LONG | __EV_UTF8_OVERLONG_2 | __EV_UTF8_TWO_CONTS | __EV_UTF8_SURROGATE | __EV_UTF8_TOO_LARGE,
+  __EV_UTF8_TOO_LONG | __EV_UTF8_OVERLONG_2 | __EV_UTF8_TWO_CONTS | __EV_UTF8_SURROGATE | __EV_UTF8_TOO_LARGE,
+  __EV_UTF8_TOO_SHORT, __EV_UTF8_TOO_SHORT, __EV_UTF8_TOO_SHORT, __EV_UTF8_TOO_SHORT,
+};
+
+// Largest value that each of the last three bytes of a block can have without
+// starting a sequence that continues in the next block
+static const u8 __ev_utf8_max_value[32] = {
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF,
+};
+#endif
+
+#if EV_SIMD_AVX2
+static bool
+__ev_utf8_validate_simd(
+  const u8 *data,
+  u64 len)
+{
+  const __m256i byte1_high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)__ev_utf8_byte1_high));
+  const __m256i byte1_low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)__ev_utf8_byte1_low));
+  const __m256i byte2_high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)__ev_utf8_byte2_high));
+  const __m256i max_value = _mm256_loadu_si256((const __m256i *)__ev_utf8_max_value);
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i third_min = _mm256_set1_epi8((char)(0xE0 - 0x80));
+  const __m256i fourth_min = _mm256_set1_epi8((char)(0xF0 - 0x80));
+  const __m256i high_bit = _mm256_set1_epi8((char)0x80);
+
+  __m256i error = _mm256_setzero_si256();
+  __m256i prev_input = _mm256_setzero_si256();
+  __m256i prev_incomplete = _mm256_setzero_si256();
+
+  u8 tail[32];
+  for(u64 i = 0; i < len; i += 32) {
+    const u8 *block = data + i;
+    if(len - i < 32) {
+      // ASCII padding completes nothing, so truncated sequences are caught
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, block, len - i);
+      block = tail;
+    }
+    __m256i input = _mm256_loadu_si256((const __m256i *)block);
+    if(_mm256_movemask_epi8(input) == 0) {
+      error = _mm256_or_si256(error, prev_incomplete);
+      prev_incomplete = _mm256_setzero_si256();
+      prev_input = input;
+      continue;
+    }
+
+    // The previous 1, 2 and 3 bytes of every position
+    __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(
+          _mm256_shuffle_epi8(byte1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+          _mm256_shuffle_epi8(byte1_low, _mm256_and_si256(prev1, nibble))),
+        _mm256_shuffle_epi8(byte2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+    // Third and fourth bytes of a sequence must be continuation bytes, which
+    // the tables flag as TWO_CONTS
+    __m256i must_be_cont = _mm256_and_si256(
+        _mm256_or_si256(_mm256_subs_epu8(prev2, third_min), _mm256_subs_epu8(prev3, fourth_min)),
+        high_bit);
+    error = _mm256_or_si256(error, _mm256_xor_si256(must_be_cont, special));
+
+    prev_incomplete = _mm256_subs_epu8(input, max_value);
+    prev_input = input;
+  }
+  error = _mm256_or_si256(error, prev_incomplete);
+  return _mm256_testz_si256(error, error);
+}
+#elif EV_SIMD_SSSE3
+// \returns The errors of one 16-byte block; `prev_input` is the block before it
+static inline __m128i
+__ev_utf8_check16(
+  __m128i input,
+  __m128i prev_input)
+{
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  const __m128i high_bit = _mm_set1_epi8((char)0x80);
+  __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+  __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+  __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+
+  __m128i special = _mm_and_si128(
+      _mm_and_si128(
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)__ev_utf8_byte1_high), _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)__ev_utf8_byte1_low), _mm_and_si128(prev1, nibble))),
+      _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)__ev_utf8_byte2_high), _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+
+  __m128i must_be_cont = _mm_and_si128(
+      _mm_or_si128(
+        _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80))),
+        _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80)))),
+      high_bit);
+  return _mm_xor_si128(must_be_cont, special);
+}
+
+static bool
+__ev_utf8_validate_simd(
+  const u8 *data,
+  u64 len)
+{
+  const __m128i max_value = _mm_loadu_si128((const __m128i *)(__ev_utf8_max_value + 16));
+
+  __m128i error = _mm_setzero_si128();
+  __m128i prev_input = _mm_setzero_si128();
+  __m128i prev_incomplete = _mm_setzero_si128();
+
+  u8 tail[32];
+  for(u64 i = 0; i < len; i += 32) {
+    const u8 *block = data + i;
+    if(len - i < 32) {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, block, len - i);
+      block = tail;
+    }
+    __m128i in0 = _mm_loadu_si128((const __m128i *)block);
+    __m128i in1 = _mm_loadu_si128((const __m128i *)(block + 16));
+    if(_mm_movemask_epi8(_mm_or_si128(in0, in1)) == 0) {
+      error = _mm_or_si128(error, prev_incomplete);
+      prev_incomplete = _mm_setzero_si128();
+      prev_input = in1;
+      continue;
+    }
+    error = _mm_or_si128(error, __ev_utf8_check16(in0, prev_input));
+    error = _mm_or_si128(error, __ev_utf8_check16(in1, in0));
+    prev_incomplete = _mm_subs_epu8(in1, max_value);
+    prev_input = in1;
+  }
+  error = _mm_or_si128(error, prev_incomplete);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+#else
+// Skips ASCII 32 bytes at a time, and decodes everything else
+static bool
+__ev_utf8_validate_simd(
+  const u8 *data,
+  u64 len)
+{
+  u64 i = 0;
+  while(i < len) {
+    if(len - i >= 32 && __ev_utf8_isAscii32(data + i)) {
+      i += 32;
+      continue;
+    }
+    u64 block_end = len - i >= 32 ? i + 32 : len;
+    while(i < block_end) {
+      u32 cp;
+      if(!__ev_utf8_decode(data, len, &i, &cp)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+#endif
+
+bool
+ev_utf8_validate(
+  const char *data,
+  u64 len)
+{
+  return __ev_utf8_validate_simd((const u8 *)data, len);
+}
+
+bool
+evstring_utf8_validate(
+  const evstring s)
+{
+  return ev_utf8_validate(s, evstring_getLength(s));
+}
+
+// Counts the continuation bytes of `data`, and the lead bytes of 4-byte
+// sequences, which need a surrogate pair in UTF-16
+static void
+__ev_utf8_countBytes(
+  const u8 *data,
+  u64 len,
+  u64 *continuations,
+  u64 *four_byte_leads)
+{
+  u64 conts = 0;
+  u64 fours = 0;
+  u64 i = 0;
+#if EV_SIMD_AVX2
+  // As signed bytes, continuations are [-128, -65] and 4-byte leads are
+  // [-16, -1]. Matches are counted in byte lanes, which are summed before
+  // they can overflow.
+  const __m256i cont_limit = _mm256_set1_epi8(-64);
+  const __m256i four_limit = _mm256_set1_epi8(-17);
+  while(len - i >= 32) {
+    __m256i cont_acc = _mm256_setzero_si256();
+    __m256i four_acc = _mm256_setzero_si256();
+    for(u32 n = 0; n < 255 && len - i >= 32; n++, i += 32) {
+      __m256i x = _mm256_loadu_si256((const __m256i *)(data + i));
+      cont_acc = _mm256_sub_epi8(cont_acc, _mm256_cmpgt_epi8(cont_limit, x));
+      four_acc = _mm256_sub_epi8(four_acc, _mm256_and_si256(_mm256_cmpgt_epi8(x, four_limit), _mm256_cmpgt_epi8(_mm256_setzero_si256(), x)));
+    }
+    __m256i sums = _mm256_add_epi64(
+        _mm256_sad_epu8(cont_acc, _mm256_setzero_si256()),
+        _mm256_slli_epi64(_mm256_sad_epu8(four_acc, _mm256_setzero_si256()), 32));
+    u64 lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, sums);
+    for(u32 k = 0; k < 4; k++) {
+      conts += lanes[k] & 0xFFFFFFFF;
+      fours += lanes[k] >> 32;
+    }
+  }
+#elif EV_SIMD_SSE2
+  const __m128i cont_limit = _mm_set1_epi8(-64);
+  const __m128i four_limit = _mm_set1_epi8(-17);
+  while(len - i >= 16) {
+    __m128i cont_acc = _mm_setzero_si128();
+    __m128i four_acc = _mm_setzero_si128();
+    for(u32 n = 0; n < 255 && len - i >= 16; n++, i += 16) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(data + i));
+      cont_acc = _mm_sub_epi8(cont_acc, _mm_cmpgt_epi8(cont_limit, x));
+      four_acc = _mm_sub_epi8(four_acc, _mm_and_si128(_mm_cmpgt_epi8(x, four_limit), _mm_cmpgt_epi8(_mm_setzero_si128(), x)));
+    }
+    __m128i sums = _mm_add_epi64(
+        _mm_sad_epu8(cont_acc, _mm_setzero_si128()),
+        _mm_slli_epi64(_mm_sad_epu8(four_acc, _mm_setzero_si128()), 32));
+    u64 lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, sums);
+    for(u32 k = 0; k < 2; k++) {
+      conts += lanes[k] & 0xFFFFFFFF;
+      fours += lanes[k] >> 32;
+    }
+  }
+#endif
+  for(; i < len; i++) {
+    conts += (data[i] & 0xC0) == 0x80;
+    fours += data[i] >= 0xF0;
+  }
+  *continuations = conts;
+  *four_byte_leads = fours;
+}
+
+u64
+ev_utf8_count(
+  const char *data,
+  u64 len)
+{
+  u64 conts, fours;
+  __ev_utf8_countBytes((const u8 *)data, len, &conts, &fours);
+  return len - conts;
+}
+
+u64
+evstring_utf8_count(
+  const evstring s)
+{
+  return ev_utf8_count(s, evstring_getLength(s));
+}
+
+u64
+ev_utf8_utf16Length(
+  const char *data,
+  u64 len)
+{
+  u64 conts, fours;
+  __ev_utf8_countBytes((const u8 *)data, len, &conts, &fours);
+  return len - conts + fours;
+}
+
+u64
+ev_utf8_toUtf16(
+  const char *src,
+  u64 len,
+  u16 *dst)
+{
+  const u8 *s = (const u8 *)src;
+  u64 out = 0;
+  u64 i = 0;
+  while(i < len) {
+    if(len - i >= 32 && __ev_utf8_isAscii32(s + i)) {
+#if EV_SIMD_SSE2
+      const __m128i zero = _mm_setzero_si128();
+      for(u32 k = 0; k < 32; k += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(s + i + k));
+        _mm_storeu_si128((__m128i *)(dst + out + k), _mm_unpacklo_epi8(x, zero));
+        _mm_storeu_si128((__m128i *)(dst + out + k + 8), _mm_unpackhi_epi8(x, zero));
+      }
+#else
+      for(u32 k = 0; k < 32; k++) {
+        dst[out + k] = s[i + k];
+      }
+#endif
+      i += 32;
+      out += 32;
+      continue;
+    }
+
+    u64 block_end = len - i >= 32 ? i + 32 : len;
+    while(i < block_end) {
+      u32 cp;
+      if(!__ev_utf8_decode(s, len, &i, &cp)) {
+        return EV_UTF8_INVALID;
+      }
+      if(cp < 0x10000) {
+        dst[out++] = (u16)cp;
+      } else {
+        cp -= 0x10000;
+        dst[out++] = (u16)(0xD800 | (cp >> 10));
+        dst[out++] = (u16)(0xDC00 | (cp & 0x3FF));
+      }
+    }
+  }
+  return out;
+}
+
+u64
+ev_utf8_toUtf32(
+  const char *src,
+  u64 len,
+  u32 *dst)
+{
+  const u8 *s = (const u8 *)src;
+  u64 out = 0;
+  u64 i = 0;
+  while(i < len) {
+    if(len - i >= 32 && __ev_utf8_isAscii32(s + i)) {
+#if EV_SIMD_SSE2
+      const __m128i zero = _mm_setzero_si128();
+      for(u32 k = 0; k < 32; k += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(s + i + k));
+        __m128i lo = _mm_unpacklo_epi8(x, zero);
+        __m128i hi = _mm_unpackhi_epi8(x, zero);
+        _mm_storeu_si128((__m128i *)(dst + out + k), _mm_unpacklo_epi16(lo, zero));
+        _mm_storeu_si128((__m128i *)(dst + out + k + 4), _mm_unpackhi_epi16(lo, zero));
+        _mm_storeu_si128((__m128i *)(dst + out + k + 8), _mm_unpacklo_epi16(hi, zero));
+        _mm_storeu_si128((__m128i *)(dst + out + k + 12), _mm_unpackhi_epi16(hi, zero));
+      }
+#else
+      for(u32 k = 0; k < 32; k++) {
+        dst[out + k] = s[i + k];
+      }
+#endif
+      i += 32;
+      out += 32;
+      continue;
+    }
+
+    u64 block_end = len - i >= 32 ? i + 32 : len;
+    while(i < block_end) {
+      u32 cp;
+      if(!__ev_utf8_decode(s, len, &i, &cp)) {
+        return EV_UTF8_INVALID;
+      }
+      dst[out++] = cp;
+    }
+  }
+  return out;
+}
+
+// Writes the UTF-8 encoding of a valid code point
+// \returns The number of bytes written
+static inline u32
+__ev_utf8_encode(
+  u32 cp,
+  u8 *out)
+{
+  if(cp < 0x80) {
+    out[0] = (u8)cp;
+    return 1;
+  }
+  if(cp < 0x800) {
+    out[0] = (u8)(0xC0 | (cp >> 6));
+    out[1] = (u8)(0x80 | (cp & 0x3F));
+    return 2;
+  }
+  if(cp < 0x10000) {
+    out[0] = (u8)(0xE0 | (cp >> 12));
+    out[1] = (u8)(0x80 | ((cp >> 6) & 0x3F));
+    out[2] = (u8)(0x80 | (cp & 0x3F));
+    return 3;
+  }
+  out[0] = (u8)(0xF0 | (cp >> 18));
+  out[1] = (u8)(0x80 | ((cp >> 12) & 0x3F));
+  out[2] = (u8)(0x80 | ((cp >> 6) & 0x3F));
+  out[3] = (u8)(0x80 | (cp & 0x3F));
+  return 4;
+}
+
+u64
+ev_utf16_utf8Length(
+  const u16 *src,
+  u64 len)
+{
+  u64 out = 0;
+  for(u64 i = 0; i < len; i++) {
+    u16 u = src[i];
+    // Each half of a surrogate pair counts for half of the 4 bytes
+    out += u < 0x80 ? 1 : u < 0x800 ? 2 : (u >= 0xD800 && u <= 0xDFFF) ? 2 : 3;
+  }
+  return out;
+}
+
+u64
+ev_utf16_toUtf8(
+  const u16 *src,
+  u64 len,
+  char *dst)
+{
+  u8 *d = (u8 *)dst;
+  u64 out = 0;
+  u64 i = 0;
+  while(i < len) {
+#if EV_SIMD_SSE2
+    if(len - i >= 16) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+      __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 8));
+      __m128i non_ascii = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16((short)0xFF80));
+      if(_mm_movemask_epi8(_mm_cmpeq_epi16(non_ascii, _mm_setzero_si128())) == 0xFFFF) {
+        _mm_storeu_si128((__m128i *)(d + out), _mm_packus_epi16(a, b));
+        i += 16;
+        out += 16;
+        continue;
+      }
+    }
+#endif
+
+    u64 block_end = len - i >= 16 ? i + 16 : len;
+    while(i < block_end) {
+      u32 cp = src[i++];
+      if(cp >= 0xD800 && cp <= 0xDFFF) {
+        if(cp >= 0xDC00 || i == len || src[i] < 0xDC00 || src[i] > 0xDFFF) {
+          return EV_UTF8_INVALID;
+        }
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (src[i++] - 0xDC00);
+      }
+      out += __ev_utf8_encode(cp, d + out);
+    }
+  }
+  return out;
+}
+
+u64
+ev_utf32_utf8Length(
+  const u32 *src,
+  u64 len)
+{
+  u64 out = 0;
+  for(u64 i = 0; i < len; i++) {
+    u32 cp = src[i];
+    out += cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+  }
+  return out;
+}
+
+u64
+ev_utf32_toUtf8(
+  const u32 *src,
+  u64 len,
+  char *dst)
+{
+  u8 *d = (u8 *)dst;
+  u64 out = 0;
+  u64 i = 0;
+  while(i < len) {
+#if EV_SIMD_SSE2
+    if(len - i >= 16) {
+      __m128i x0 = _mm_loadu_si128((const __m128i *)(src + i));
+      __m128i x1 = _mm_loadu_si128((const __m128i *)(src + i + 4));
+      __m128i x2 = _mm_loadu_si128((const __m128i *)(src + i + 8));
+      __m128i x3 = _mm_loadu_si128((const __m128i *)(src + i + 12));
+      __m128i any = _mm_or_si128(_mm_or_si128(x0, x1), _mm_or_si128(x2, x3));
+      __m128i non_ascii = _mm_and_si128(any, _mm_set1_epi32((int)0xFFFFFF80));
+      if(_mm_movemask_epi8(_mm_cmpeq_epi32(non_ascii, _mm_setzero_si128())) == 0xFFFF) {
+        __m128i lo = _mm_packs_epi32(x0, x1);
+        __m128i hi = _mm_packs_epi32(x2, x3);
+        _mm_storeu_si128((__m128i *)(d + out), _mm_packus_epi16(lo, hi));
+        i += 16;
+        out += 16;
+        continue;
+      }
+    }
+#endif
+
+    u64 block_end = len - i >= 16 ? i + 16 : len;
+    for(; i < block_end; i++) {
+      u32 cp = src[i];
+      if(cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        return EV_UTF8_INVALID;
+      }
+      out += __ev_utf8_encode(cp, d + out);
+    }
+  }
+  return out;
+}
+
+evstring
+evstring_newFromUtf16(
+  const u16 *src,
+  u64 len)
+{
+  // The length is exact for valid input, and conversion stops before writing
+  // the first invalid unit
+  evstring s = evstring_new_impl(NULL, ev_utf16_utf8Length(src, len));
+  if(ev_utf16_toUtf8(src, len, s) == EV_UTF8_INVALID) {
+    evstring_free(s);
+    return NULL;
+  }
+  return s;
+}
+
+evstring
+evstring_newFromUtf32(
+  const u32 *src,
+  u64 len)
+{
+  evstring s = evstring_new_impl(NULL, ev_utf32_utf8Length(src, len));
+  if(ev_utf32_toUtf8(src, len, s) == EV_UTF8_INVALID) {
+    evstring_free(s);
+    return NULL;
+  }
+  return s;
+}
+
+#endif
+
+#endif
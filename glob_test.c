@@ -0,0 +1,289 @@
+#define EV_STR_IMPLEMENTATION
+#define EV_GLOB_IMPLEMENTATION
+#include "ev_glob.h"
+
+#include <stdio.h>
+
+static u64 rng_state = 0x9E3779B97F4A7C15ull;
+static u64 rng()
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static bool matches(const char *pattern, const char *text)
+{
+  ev_glob_t *g = ev_glob_compile(pattern);
+  assert(g);
+  bool res = ev_glob_match(g, ev_strview_fromStr(text));
+  ev_glob_fini(g);
+  return res;
+}
+
+// Backtracking matcher for patterns without braces, to compare against. A
+// `**` of the original pattern is marked with '\x01', so that stars that end
+// up next to each other after brace expansion are still single stars.
+static const char *ref_pattern;
+static bool ref_match(const char *p, const char *t)
+{
+  if(*p == '\0') {
+    return *t == '\0';
+  }
+  if(*p == '*' || *p == '\x01') {
+    u32 n = 1;
+    bool component = *p == '\x01' && (p == ref_pattern || p[-1] == '/') && (p[n] == '\0' || p[n] == '/');
+    if(component && p[n] == '\0') {
+      return true;
+    }
+    if(component) {
+      if(ref_match(p + n + 1, t)) {
+        return true;
+      }
+      for(; *t; t++) {
+        if(*t == '/' && ref_match(p + n + 1, t + 1)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    for(;; t++) {
+      if(ref_match(p + n, t)) {
+        return true;
+      }
+      if(*t == '\0' || *t == '/') {
+        return false;
+      }
+    }
+  }
+  if(*t == '\0') {
+    return false;
+  }
+  if(*p == '?') {
+    return *t != '/' && ref_match(p + 1, t + 1);
+  }
+  if(*p == '[') {
+    bool negate = p[1] == '!';
+    const char *end = strchr(p + 1 + negate, ']');
+    bool in = memchr(p + 1 + negate, *t, end - p - 1 - negate) != NULL;
+    return *t != '/' && in != negate && ref_match(end + 1, t + 1);
+  }
+  return *p == *t && ref_match(p + 1, t + 1);
+}
+
+// Expands the first brace group, recursively
+static bool ref_expand_match(const char *pattern, const char *text)
+{
+  const char *open = strchr(pattern, '{');
+  if(!open) {
+    ref_pattern = pattern;
+    return ref_match(pattern, text);
+  }
+  const char *close = strchr(open, '}');
+  char buf[256];
+  const char *alt = open + 1;
+  while(alt <= close) {
+    const char *end = alt;
+    while(*end != ',' && *end != '}') {
+      end++;
+    }
+    sprintf(buf, "%.*s%.*s%s", (int)(open - pattern), pattern, (int)(end - alt), alt, close + 1);
+    if(ref_expand_match(buf, text)) {
+      return true;
+    }
+    alt = end + 1;
+  }
+  return false;
+}
+
+static bool ref(const char *pattern, const char *text)
+{
+  char marked[256];
+  u32 n = 0;
+  for(const char *p = pattern; *p; p++) {
+    if(p[0] == '*' && p[1] == '*') {
+      marked[n++] = '\x01';
+      while(p[1] == '*') {
+        p++;
+      }
+    } else {
+      marked[n++] = *p;
+    }
+  }
+  marked[n] = '\0';
+  return ref_expand_match(marked, text);
+}
+
+static void random_pattern(char *buf)
+{
+  static const char *tokens[] = { "a", "b", ".", "/", "*", "?", "[ab]", "[!a]", "*a", "b*" };
+  static const char *simple[] = { "", "a", "b", "*", "?", ".a", "[!b]" };
+  u32 n = rng() % 6;
+  buf[0] = '\0';
+  if(rng() % 4 == 0) {
+    strcat(buf, "**/");
+  }
+  for(u32 i = 0; i < n; i++) {
+    u32 kind = rng() % 10;
+    if(kind == 0) {
+      strcat(buf, "{");
+      strcat(buf, simple[rng() % 7]);
+      strcat(buf, ",");
+      strcat(buf, simple[rng() % 7]);
+      strcat(buf, "}");
+    } else if(kind == 1 && (buf[0] == '\0' || buf[strlen(buf) - 1] == '/')) {
+      strcat(buf, "**/");
+    } else {
+      strcat(buf, tokens[rng() % 10]);
+    }
+  }
+  if(rng() % 6 == 0) {
+    strcat(buf, buf[0] && buf[strlen(buf) - 1] == '/' ? "**" : "/**");
+  }
+}
+
+int main()
+{
+  // Wildcards and path components
+  {
+    assert(matches("textures/**/*.png", "textures/a.png"));
+    assert(matches("textures/**/*.png", "textures/env/forest/a.png"));
+    assert(!matches("textures/**/*.png", "textures/a.jpg"));
+    assert(!matches("textures/**/*.png", "meshes/textures/a.png"));
+    assert(!matches("textures/*.png", "textures/env/a.png"));
+    assert(matches("**/*.png", "a.png"));
+    assert(matches("**/*.png", "x/y/a.png"));
+    assert(matches("assets/**", "assets/x/y"));
+    assert(matches("assets/**", "assets/"));
+    assert(!matches("assets/**", "assets"));
+    assert(matches("**", "a/b/c"));
+    assert(matches("**", ""));
+    assert(matches("a**b", "axyb"));
+    assert(!matches("a**b", "ax/yb"));
+    assert(matches("*", "anything"));
+    assert(!matches("*", "a/b"));
+    assert(matches("", ""));
+    assert(!matches("", "a"));
+    assert(matches("file?.txt", "file1.txt"));
+    assert(!matches("file?.txt", "file.txt"));
+    assert(!matches("a?b", "a/b"));
+  }
+
+  // Sets, braces and escapes
+  {
+    assert(matches("[a-c]x", "bx"));
+    assert(!matches("[a-c]x", "dx"));
+    assert(matches("[!a-c]x", "dx"));
+    assert(matches("[^a-c]x", "dx"));
+    assert(!matches("[!a-c]x", "/x"));
+    assert(matches("[]a]", "]"));
+    assert(matches("[!]]", "a"));
+    assert(matches("[a-]", "-"));
+    assert(matches("*.{png,jpg,tga}", "x.jpg"));
+    assert(!matches("*.{png,jpg,tga}", "x.bmp"));
+    assert(matches("{textures,meshes/{lod0,lod1}}/*", "meshes/lod1/rock"));
+    assert(!matches("{textures,meshes/{lod0,lod1}}/*", "meshes/lod2/rock"));
+    assert(matches("a{,b}c", "ac"));
+    assert(matches("a{,b}c", "abc"));
+    assert(matches("{**/,}x", "d/x"));
+    assert(matches("\\*\\?", "*?"));
+    assert(!matches("\\*", "a"));
+    assert(matches("a,b", "a,b"));
+
+    const char *invalid[] = { "[ab", "{a,b", "a}", "ab\\", "[\\" };
+    for(u32 i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+      assert(ev_glob_compile(invalid[i]) == NULL);
+    }
+    char too_long[EV_GLOB_MAX_POSITIONS + 2];
+    memset(too_long, 'a', sizeof(too_long) - 1);
+    too_long[sizeof(too_long) - 1] = '\0';
+    assert(ev_glob_compile(too_long) == NULL);
+    too_long[sizeof(too_long) - 2] = '\0';
+    ev_glob_t *g = ev_glob_compile(too_long);
+    assert(g && ev_glob_match(g, ev_strview_fromStr(too_long)));
+    ev_glob_fini(g);
+  }
+
+  // evstrings and views
+  {
+    ev_glob_t *g = ev_glob_compile(evstring_slice(evstr("--*.png--"), 2, 7));
+    assert(g);
+    evstring s = evstring_new("textures/a.png");
+    assert(!ev_glob_match(g, s));
+    assert(ev_glob_match(g, evstring_slice(s, 9, 14)));
+    assert(ev_glob_match(g, evstr("a.png")));
+    assert(ev_glob_match_evstring(g, evstr("a.png")));
+    assert(!ev_glob_match_evstring(g, s));
+
+    // C strings, including literals
+    const char *c_string = "b.png";
+    assert(ev_glob_match(g, c_string));
+    assert(ev_glob_match(g, "a.png"));
+    assert(!ev_glob_match(g, "a.jpg"));
+    evstring_free(s);
+    ev_glob_fini(g);
+  }
+
+  // Against the backtracking matcher
+  {
+    char pattern[256];
+    char text[16];
+    u64 matched = 0;
+    for(u32 round = 0; round < 3000; round++) {
+      random_pattern(pattern);
+      ev_glob_t *g = ev_glob_compile(pattern);
+      assert(g);
+      for(u32 t = 0; t < 100; t++) {
+        u32 len = rng() % 10;
+        for(u32 i = 0; i < len; i++) {
+          text[i] = "ab/."[rng() % 4];
+        }
+        text[len] = '\0';
+        bool expected = ref(pattern, text);
+        matched += expected;
+        if(ev_glob_match(g, ev_strview_fromStr(text)) != expected) {
+          fprintf(stderr, "pattern '%s', text '%s': expected %d\n", pattern, text, expected);
+          assert(false);
+        }
+      }
+      ev_glob_fini(g);
+    }
+    // The random cases are not all trivial mismatches
+    assert(matched > 3000 * 100 / 20);
+  }
+
+  // Patterns whose DFA would be too large fall back to the NFA
+  {
+    ev_glob_t *g = ev_glob_compile("*a?????????????");
+    assert(g && g->transitions == NULL);
+    char text[32];
+    for(u32 t = 0; t < 2000; t++) {
+      u32 len = 10 + rng() % 20;
+      for(u32 i = 0; i < len; i++) {
+        text[i] = "ab"[rng() % 2];
+      }
+      text[len] = '\0';
+      assert(ev_glob_match(g, ev_strview_fromStr(text)) == (len >= 14 && text[len - 14] == 'a'));
+    }
+    ev_glob_fini(g);
+  }
+
+  // No backtracking: this takes exponential time in a backtracking matcher
+  {
+    ev_glob_t *g = ev_glob_compile("a*a*a*a*a*a*a*a*a*a*a*a*b");
+    assert(g && g->transitions != NULL);
+    char text[201];
+    memset(text, 'a', 200);
+    text[200] = '\0';
+    for(u32 i = 0; i < 1000; i++) {
+      assert(!ev_glob_match(g, ev_strview_fromStr(text)));
+    }
+    text[199] = 'b';
+    assert(ev_glob_match(g, ev_strview_fromStr(text)));
+    ev_glob_fini(g);
+  }
+
+  puts("ev_glob tests passed");
+  return 0;
+}
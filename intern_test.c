@@ -0,0 +1,101 @@
+#define EV_STR_IMPLEMENTATION
+#include "ev_str.h"
+#define EV_INTERN_IMPLEMENTATION
+#include "ev_intern.h"
+
+#include <stdio.h>
+
+#if !EV_OS_WINDOWS
+#include <pthread.h>
+
+#define THREAD_COUNT 4
+#define NAMES_PER_THREAD 20000
+
+static ev_intern_t *shared_table;
+
+static void *intern_names(void *arg)
+{
+  u32 *ids = arg;
+  char buf[32];
+  for(u32 i = 0; i < NAMES_PER_THREAD; i++) {
+    sprintf(buf, "name_%u", i);
+    ids[i] = ev_intern(shared_table, buf);
+  }
+  return NULL;
+}
+#endif
+
+int main()
+{
+  ev_intern_t *t = ev_intern_init();
+  assert(t);
+
+  u32 transform = ev_intern(t, "Transform");
+  u32 mesh = ev_intern(t, "Mesh");
+  assert(transform != mesh);
+  assert(ev_intern(t, "Transform") == transform);
+  assert(ev_intern_count(t) == 2);
+
+  evstring name = evstring_new("MeshRenderer");
+  assert(ev_intern(t, evstring_slice(name, 0, 4)) == mesh);
+  evstring_free(name);
+
+  evstring canonical = ev_intern_get(t, transform);
+  assert(evstring_getLength(canonical) == 9);
+  assert(strcmp(canonical, "Transform") == 0);
+  assert(evstring_cmp(canonical, evstr("Transform")) == 0);
+  // Canonical strings are immutable
+  assert(evstring_pushChar(&canonical, 'x') == EV_STR_ERR_OOM);
+
+  assert(ev_intern_find(t, "Mesh", 4) == mesh);
+  assert(ev_intern_find(t, "Camera", 6) == EV_INTERN_INVALID_ID);
+  assert(ev_intern_hash(t, mesh) == ev_hash_murmur3("Mesh", 4, EV_INTERN_HASH_SEED));
+
+  u32 empty = ev_intern(t, "");
+  assert(evstring_getLength(ev_intern_get(t, empty)) == 0);
+
+  // Enough strings to grow the tables and span several blocks and pages
+  char buf[32];
+  for(u32 i = 0; i < 50000; i++) {
+    sprintf(buf, "component_%u", i);
+    u32 id = ev_intern(t, buf);
+    assert(strcmp(ev_intern_get(t, id), buf) == 0);
+  }
+  for(u32 i = 0; i < 50000; i += 97) {
+    sprintf(buf, "component_%u", i);
+    u32 id = ev_intern_find(t, buf, strlen(buf));
+    assert(id != EV_INTERN_INVALID_ID);
+    assert(strcmp(ev_intern_get(t, id), buf) == 0);
+  }
+  assert(ev_intern_get(t, transform) == canonical);
+
+  // Large strings get a block of their own
+  static char large[EV_INTERN_BLOCK_SIZE];
+  memset(large, 'a', sizeof(large) - 1);
+  u32 large_id = ev_intern(t, large);
+  assert(evstring_getLength(ev_intern_get(t, large_id)) == sizeof(large) - 1);
+
+  ev_intern_fini(t);
+
+#if !EV_OS_WINDOWS
+  shared_table = ev_intern_init();
+  static u32 ids[THREAD_COUNT][NAMES_PER_THREAD];
+  pthread_t threads[THREAD_COUNT];
+  for(u32 i = 0; i < THREAD_COUNT; i++) {
+    pthread_create(&threads[i], NULL, intern_names, ids[i]);
+  }
+  for(u32 i = 0; i < THREAD_COUNT; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  assert(ev_intern_count(shared_table) == NAMES_PER_THREAD);
+  for(u32 i = 0; i < NAMES_PER_THREAD; i++) {
+    for(u32 th = 1; th < THREAD_COUNT; th++) {
+      assert(ids[th][i] == ids[0][i]);
+    }
+  }
+  ev_intern_fini(shared_table);
+#endif
+
+  puts("ev_intern tests passed");
+  return 0;
+}
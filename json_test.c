@@ -0,0 +1,532 @@
+#define EV_STR_IMPLEMENTATION
+#define EV_JSON_IMPLEMENTATION
+#include "ev_json.h"
+
+#include <stdio.h>
+
+static u64 rng_state = 0x9E3779B97F4A7C15ull;
+static u64 rng()
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static bool view_eq(evstring_view v, const char *s)
+{
+  return v.len == strlen(s) && (v.len == 0 || memcmp(v.data + v.offset, s, v.len) == 0);
+}
+
+static evstring_error_t parse(const char *text, ev_json_doc *doc)
+{
+  evstring json = evstring_new(text);
+  evstring_error_t err = ev_json_parse(json, doc);
+  evstring_free(json);
+  return err;
+}
+
+// Straightforward recursive descent tokenizer, to compare against
+typedef struct {
+  ev_json_type type;
+  u64 offset;
+  u64 len;
+  u32 depth;
+} ref_token;
+
+typedef struct {
+  const u8 *s;
+  u64 len;
+  u64 i;
+  ref_token *tokens;
+  u32 count;
+} ref_parser;
+
+static void ref_ws(ref_parser *P)
+{
+  while(P->i < P->len && (P->s[P->i] == ' ' || P->s[P->i] == '\t' || P->s[P->i] == '\n' || P->s[P->i] == '\r')) {
+    P->i++;
+  }
+}
+
+static void ref_emit(ref_parser *P, ev_json_type type, u64 offset, u64 len, u32 depth)
+{
+  P->tokens[P->count++] = (ref_token) { type, offset, len, depth };
+}
+
+static bool ref_string(ref_parser *P, ev_json_type type, u32 depth)
+{
+  u64 start = ++P->i;
+  while(P->i < P->len && P->s[P->i] != '"') {
+    if(P->s[P->i] < 0x20) {
+      return false;
+    }
+    if(P->s[P->i] == '\\') {
+      P->i++;
+      if(P->i == P->len || P->s[P->i] < 0x20) {
+        return false;
+      }
+    }
+    P->i++;
+  }
+  if(P->i == P->len) {
+    return false;
+  }
+  ref_emit(P, type, start, P->i - start, depth);
+  P->i++;
+  return true;
+}
+
+static bool ref_digits(ref_parser *P)
+{
+  u64 start = P->i;
+  while(P->i < P->len && P->s[P->i] >= '0' && P->s[P->i] <= '9') {
+    P->i++;
+  }
+  return P->i > start;
+}
+
+static bool ref_value(ref_parser *P, u32 depth)
+{
+  if(P->i == P->len) {
+    return false;
+  }
+  u8 c = P->s[P->i];
+  u64 start = P->i;
+  if(c == '{' || c == '[') {
+    bool object = c == '{';
+    ref_emit(P, object ? EV_JSON_OBJECT : EV_JSON_ARRAY, P->i, 1, depth);
+    P->i++;
+    ref_ws(P);
+    if(P->i < P->len && P->s[P->i] == (object ? '}' : ']')) {
+      ref_emit(P, EV_JSON_END, P->i++, 1, depth);
+      return true;
+    }
+    for(;;) {
+      if(object) {
+        if(P->i == P->len || P->s[P->i] != '"' || !ref_string(P, EV_JSON_KEY, depth + 1)) {
+          return false;
+        }
+        ref_ws(P);
+        if(P->i == P->len || P->s[P->i] != ':') {
+          return false;
+        }
+        P->i++;
+        ref_ws(P);
+      }
+      if(!ref_value(P, depth + 1)) {
+        return false;
+      }
+      ref_ws(P);
+      if(P->i == P->len) {
+        return false;
+      }
+      if(P->s[P->i] == ',') {
+        P->i++;
+        ref_ws(P);
+        continue;
+      }
+      if(P->s[P->i] != (object ? '}' : ']')) {
+        return false;
+      }
+      ref_emit(P, EV_JSON_END, P->i++, 1, depth);
+      return true;
+    }
+  }
+  if(c == '"') {
+    return ref_string(P, EV_JSON_STRING, depth);
+  }
+  const char *literals[] = { "null", "false", "true" };
+  for(u32 l = 0; l < 3; l++) {
+    u64 n = strlen(literals[l]);
+    if(P->len - P->i >= n && memcmp(P->s + P->i, literals[l], n) == 0) {
+      P->i += n;
+      ref_emit(P, EV_JSON_NULL + l, start, n, depth);
+      return true;
+    }
+  }
+  if(P->i < P->len && P->s[P->i] == '-') {
+    P->i++;
+  }
+  if(P->i < P->len && P->s[P->i] == '0') {
+    P->i++;
+  } else if(!ref_digits(P)) {
+    return false;
+  }
+  if(P->i < P->len && P->s[P->i] == '.') {
+    P->i++;
+    if(!ref_digits(P)) {
+      return false;
+    }
+  }
+  if(P->i < P->len && (P->s[P->i] == 'e' || P->s[P->i] == 'E')) {
+    P->i++;
+    if(P->i < P->len && (P->s[P->i] == '+' || P->s[P->i] == '-')) {
+      P->i++;
+    }
+    if(!ref_digits(P)) {
+      return false;
+    }
+  }
+  ref_emit(P, EV_JSON_NUMBER, start, P->i - start, depth);
+  return true;
+}
+
+static bool ref_parse(const char *s, u64 len, ref_token *tokens, u32 *count)
+{
+  ref_parser P = { (const u8 *)s, len, 0, tokens, 0 };
+  ref_ws(&P);
+  bool ok = ref_value(&P, 0);
+  ref_ws(&P);
+  *count = P.count;
+  return ok && P.i == P.len;
+}
+
+static char *out;
+static void gen_ws()
+{
+  static const char *ws[] = { "", "", "", " ", "\n", "\t", "\r\n  ", "                                " };
+  strcat(out, ws[rng() % 8]);
+}
+
+static void gen_string()
+{
+  strcat(out, "\"");
+  u32 len = rng() % 4 == 0 ? rng() % 150 : rng() % 8;
+  char *p = out + strlen(out);
+  for(u32 i = 0; i < len; i++) {
+    u32 kind = rng() % 12;
+    if(kind == 0) {
+      // Runs of backslashes of any length, which may cross a block boundary
+      u32 run = 1 + rng() % 6;
+      for(u32 r = 0; r < run; r++) {
+        *p++ = '\\';
+      }
+      if(run % 2) {
+        *p++ = "\"\\/bnrtu"[rng() % 8];
+      }
+    } else if(kind == 1) {
+      *p++ = "{}[]:, "[rng() % 7];
+    } else if(kind == 2) {
+      *p++ = (char)(0x80 + rng() % 0x80);
+    } else {
+      *p++ = "abcxyz019-."[rng() % 11];
+    }
+  }
+  *p = '\0';
+  strcat(out, "\"");
+}
+
+static void gen_value(u32 depth)
+{
+  u32 kind = depth > 5 ? 4 + rng() % 4 : rng() % 8;
+  char buf[64];
+  gen_ws();
+  switch(kind) {
+  case 0:
+  case 1: {
+    bool object = kind == 0;
+    strcat(out, object ? "{" : "[");
+    u32 n = rng() % 5;
+    for(u32 i = 0; i < n; i++) {
+      if(i) {
+        gen_ws();
+        strcat(out, ",");
+      }
+      if(object) {
+        gen_ws();
+        gen_string();
+        gen_ws();
+        strcat(out, ":");
+      }
+      gen_value(depth + 1);
+    }
+    gen_ws();
+    strcat(out, object ? "}" : "]");
+    break;
+  }
+  case 2:
+  case 3:
+    gen_string();
+    break;
+  case 4:
+    strcat(out, (const char *[]){ "true", "false", "null" }[rng() % 3]);
+    break;
+  default:
+    switch(rng() % 4) {
+    case 0: sprintf(buf, "%lld", (long long)(rng() % 2000000) - 1000000); break;
+    case 1: sprintf(buf, "%.17g", (f64)(i64)rng() / 1e10); break;
+    case 2: sprintf(buf, "%de%s%d", (int)(rng() % 10), (rng() % 2) ? "-" : "", (int)(rng() % 300)); break;
+    default: sprintf(buf, "-0.%u", (unsigned)(rng() % 1000)); break;
+    }
+    strcat(out, buf);
+    break;
+  }
+  gen_ws();
+}
+
+int main()
+{
+  // The tape
+  {
+    evstring json = evstring_new(
+        "{ \"name\": \"level\\n1\", \"gravity\": -9.81, \"seed\": 42, \"big\": 18446744073709551615,\n"
+        "  \"entities\": [ { \"id\": 1, \"tags\": [\"a\", \"b\"], \"visible\": true },\n"
+        "                { \"id\": 2, \"tags\": [], \"visible\": false, \"parent\": null } ],\n"
+        "  \"empty\": {}, \"caf\\u00e9\": \"\\ud83d\\ude00\" }");
+    ev_json_doc doc = {0};
+    assert(ev_json_parse(json, &doc) == EV_STR_ERR_NONE);
+    ev_json_value root = ev_json_root(&doc);
+    assert(ev_json_getType(root) == EV_JSON_OBJECT);
+    assert(ev_json_getCount(root) == 7);
+    assert(ev_json_getView(root).len == evstring_getLength(json));
+
+    evstring s = evstring_new("");
+    ev_json_value name = ev_json_get(root, "name");
+    assert(view_eq(ev_json_getView(name), "level\\n1"));
+    assert(ev_json_getString(name, &s) == EV_STR_ERR_NONE);
+    assert(strcmp(s, "level\n1") == 0);
+    assert(view_eq(ev_json_getKey(name), "name"));
+
+    f64 gravity;
+    i64 seed;
+    u64 big;
+    assert(ev_json_getF64(ev_json_get(root, "gravity"), &gravity) == EV_STR_ERR_NONE && gravity == -9.81);
+    assert(ev_json_getI64(ev_json_get(root, "gravity"), &seed) == EV_STR_ERR_PARSE);
+    assert(ev_json_getI64(ev_json_get(root, "seed"), &seed) == EV_STR_ERR_NONE && seed == 42);
+    assert(ev_json_getU64(ev_json_get(root, "big"), &big) == EV_STR_ERR_NONE && big == ~0ull);
+    assert(ev_json_getI64(ev_json_get(root, "big"), &seed) == EV_STR_ERR_RANGE);
+    assert(ev_json_getI64(name, &seed) == EV_STR_ERR_PARSE);
+
+    ev_json_value entities = ev_json_get(root, ev_strview_fromStr("entities"));
+    assert(ev_json_getType(entities) == EV_JSON_ARRAY && ev_json_getCount(entities) == 2);
+    u32 n = 0;
+    for(ev_json_value e = ev_json_first(entities); ev_json_getType(e); e = ev_json_next(e), n++) {
+      i64 id;
+      bool visible;
+      assert(ev_json_getI64(ev_json_get(e, "id"), &id) == EV_STR_ERR_NONE && id == n + 1);
+      assert(ev_json_getBool(ev_json_get(e, "visible"), &visible) == EV_STR_ERR_NONE && visible == (n == 0));
+      assert(ev_json_getCount(ev_json_get(e, "tags")) == (n == 0 ? 2 : 0));
+    }
+    assert(n == 2);
+    ev_json_value second = ev_json_at(entities, 1);
+    assert(ev_json_getType(ev_json_get(second, "parent")) == EV_JSON_NULL);
+    assert(ev_json_getType(ev_json_get(second, "missing")) == EV_JSON_INVALID);
+    assert(view_eq(ev_json_getView(ev_json_at(ev_json_get(ev_json_first(entities), "tags"), 1)), "b"));
+    assert(ev_json_getType(ev_json_at(entities, 2)) == EV_JSON_INVALID);
+    assert(view_eq(ev_json_getView(ev_json_at(second, 1)), "[]"));
+    assert(view_eq(ev_json_getKey(ev_json_at(second, 3)), "parent"));
+
+    // Missing values can be chained through
+    assert(ev_json_getType(ev_json_get(ev_json_at(ev_json_get(root, "nope"), 3), "x")) == EV_JSON_INVALID);
+    assert(ev_json_getCount(ev_json_get(root, "nope")) == 0);
+    assert(ev_json_getType(ev_json_first(ev_json_get(root, "empty"))) == EV_JSON_INVALID);
+
+    // Keys are compared decoded
+    ev_json_value smiley = ev_json_get(root, "caf\xc3\xa9");
+    assert(ev_json_getType(smiley) == EV_JSON_STRING);
+    evstring_clear(&s);
+    assert(ev_json_getString(smiley, &s) == EV_STR_ERR_NONE);
+    assert(strcmp(s, "\xf0\x9f\x98\x80") == 0);
+    assert(ev_json_getType(ev_json_get(root, "caf")) == EV_JSON_INVALID);
+    assert(ev_json_getType(ev_json_get(root, "caf\xc3\xa9!")) == EV_JSON_INVALID);
+
+    // Reparsing reuses the tape
+    __ev_json_node *nodes = doc.nodes;
+    assert(ev_json_parse(json, &doc) == EV_STR_ERR_NONE && doc.nodes == nodes);
+    ev_json_fini(&doc);
+    evstring_free(s);
+    evstring_free(json);
+  }
+
+  // Escapes are decoded on access
+  {
+    const char *raw[] = { "a\\\"b\\\\c\\/d", "\\b\\f\\n\\r\\t", "\\u0041\\u00DF\\u20ac", "\\uD834\\uDD1E", "" };
+    const char *decoded[] = { "a\"b\\c/d", "\b\f\n\r\t", "A\xc3\x9f\xe2\x82\xac", "\xf0\x9d\x84\x9e", "" };
+    for(u32 i = 0; i < 5; i++) {
+      evstring json = evstring_new("\"%s\"", raw[i]);
+      ev_json_doc doc = {0};
+      assert(ev_json_parse(json, &doc) == EV_STR_ERR_NONE);
+      evstring s = evstring_new("x");
+      assert(ev_json_getString(ev_json_root(&doc), &s) == EV_STR_ERR_NONE);
+      assert(s[0] == 'x' && strcmp(s + 1, decoded[i]) == 0);
+      assert(ev_json_keyEquals(ev_json_getView(ev_json_root(&doc)), decoded[i]));
+      evstring_free(s);
+      ev_json_fini(&doc);
+      evstring_free(json);
+    }
+    const char *invalid[] = { "\\x", "\\u12", "\\u12G4", "\\uD834", "\\uD834\\u0041", "\\uDD1E", "ab\\" };
+    for(u32 i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+      evstring json = evstring_new(invalid[i]);
+      evstring s = evstring_new("keep");
+      evstring_view v = { .data = json, .offset = 0, .len = evstring_getLength(json) };
+      assert(ev_json_unescape(&s, v) == EV_STR_ERR_PARSE);
+      assert(strcmp(s, "keep") == 0);
+      assert(!ev_json_keyEquals(v, "x"));
+      evstring_free(s);
+      evstring_free(json);
+    }
+  }
+
+  // Invalid documents
+  {
+    const char *invalid[] = {
+      "", " ", "{", "}", "[1,]", "[1 2]", "{\"a\"}", "{\"a\":}", "{\"a\" 1}", "{1:2}", "{\"a\":1,}",
+      "[01]", "[1.]", "[.5]", "[1e]", "[-]", "[+1]", "[1x]", "[tru]", "[truex]", "[nul]", "[\"a\" \"b\"]",
+      "\"abc", "\"a\x01\"", "\"\t\"", "[1] [2]", "1 2", "[}", "{]", "[\"a\"1]", "[1\"a\"]", "\"\\\"",
+      "[\x0c]", "[1\x1a]", "{\"a\":1 \"b\":2}",
+    };
+    for(u32 i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+      ev_json_doc doc = {0};
+      if(parse(invalid[i], &doc) != EV_STR_ERR_PARSE) {
+        fprintf(stderr, "accepted '%s'\n", invalid[i]);
+        assert(false);
+      }
+      assert(ev_json_getType(ev_json_root(&doc)) == EV_JSON_INVALID);
+      ev_json_fini(&doc);
+    }
+    ev_json_doc doc = {0};
+    assert(parse("{\"a\": [1, 2, x]}", &doc) == EV_STR_ERR_PARSE && doc.error_offset == 13);
+    assert(parse("[\"abc", &doc) == EV_STR_ERR_PARSE && doc.error_offset == 5);
+    assert(parse("[\"ab\ncd\"]", &doc) == EV_STR_ERR_PARSE && doc.error_offset == 4);
+    const char *valid[] = { "0", "-0.0e+0", " \"\" ", "[]", "{}", "[[[]]]", "true", "null", "1E5" };
+    for(u32 i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+      assert(parse(valid[i], &doc) == EV_STR_ERR_NONE);
+    }
+    ev_json_fini(&doc);
+  }
+
+  // Nesting limit
+  {
+    evstring json = evstring_new("");
+    for(u32 i = 0; i < EV_JSON_MAX_DEPTH; i++) {
+      evstring_pushChar(&json, '[');
+    }
+    for(u32 i = 0; i < EV_JSON_MAX_DEPTH; i++) {
+      evstring_pushChar(&json, ']');
+    }
+    ev_json_doc doc = {0};
+    assert(ev_json_parse(json, &doc) == EV_STR_ERR_NONE);
+    evstring deeper = evstring_new("[%s]", json);
+    assert(ev_json_parse(deeper, &doc) == EV_STR_ERR_RANGE);
+    ev_json_fini(&doc);
+    evstring_free(deeper);
+    evstring_free(json);
+  }
+
+  // The iterator
+  {
+    evstring json = evstring_new("{\"meshes\": [{\"lods\": [1, [2]]}, \"x\"], \"count\": 3}");
+    ev_json_iter it;
+    ev_json_iter_init(&it, json);
+    ev_json_token tok;
+    ev_json_type types[] = { EV_JSON_OBJECT, EV_JSON_KEY, EV_JSON_ARRAY, EV_JSON_OBJECT, EV_JSON_KEY, EV_JSON_ARRAY,
+      EV_JSON_NUMBER, EV_JSON_ARRAY, EV_JSON_NUMBER, EV_JSON_END, EV_JSON_END, EV_JSON_END, EV_JSON_STRING,
+      EV_JSON_END, EV_JSON_KEY, EV_JSON_NUMBER, EV_JSON_END };
+    u32 depths[] = { 0, 1, 1, 2, 3, 3, 4, 4, 5, 4, 3, 2, 2, 1, 1, 1, 0 };
+    for(u32 i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+      assert(ev_json_iter_next(&it, &tok));
+      assert(tok.type == types[i] && tok.depth == depths[i]);
+    }
+    assert(!ev_json_iter_next(&it, &tok) && it.error == EV_STR_ERR_NONE);
+    assert(!ev_json_iter_next(&it, &tok) && it.error == EV_STR_ERR_NONE);
+
+    // Skipping the meshes
+    ev_json_iter_init(&it, json);
+    assert(!ev_json_iter_skip(&it));
+    assert(ev_json_iter_next(&it, &tok) && tok.type == EV_JSON_OBJECT);
+    assert(ev_json_iter_next(&it, &tok) && ev_json_keyEquals(tok.view, "meshes"));
+    assert(ev_json_iter_next(&it, &tok) && tok.type == EV_JSON_ARRAY);
+    assert(ev_json_iter_skip(&it));
+    assert(ev_json_iter_next(&it, &tok) && tok.type == EV_JSON_KEY && view_eq(tok.view, "count"));
+    assert(ev_json_iter_next(&it, &tok) && tok.type == EV_JSON_NUMBER && view_eq(tok.view, "3"));
+    assert(ev_json_iter_skip(&it));
+    assert(!ev_json_iter_next(&it, &tok) && it.error == EV_STR_ERR_NONE);
+    evstring_free(json);
+
+    json = evstring_new("[1, {\"a\": 2 x");
+    ev_json_iter_init(&it, json);
+    while(ev_json_iter_next(&it, &tok)) {
+    }
+    assert(it.error == EV_STR_ERR_PARSE && it.error_offset == 12);
+    ev_json_iter_init(&it, json);
+    assert(ev_json_iter_next(&it, &tok) && ev_json_iter_skip(&it) == false && it.error == EV_STR_ERR_PARSE);
+    evstring_free(json);
+  }
+
+  // Against the reference tokenizer, on random documents and their mutations
+  {
+    char *buf = malloc(1 << 20);
+    ref_token *expected = malloc(sizeof(ref_token) * (1 << 18));
+    u64 valid_mutations = 0;
+    for(u32 round = 0; round < 3000; round++) {
+      out = buf;
+      buf[0] = '\0';
+      gen_value(0);
+      u64 len = strlen(buf);
+      u32 count;
+      assert(ref_parse(buf, len, expected, &count));
+
+      evstring json = evstring_newFromStrview(ev_strview_from(buf, len));
+      ev_json_iter it;
+      ev_json_iter_init(&it, json);
+      ev_json_token tok;
+      for(u32 i = 0; i < count; i++) {
+        assert(ev_json_iter_next(&it, &tok));
+        assert(tok.type == expected[i].type && tok.depth == expected[i].depth);
+        assert(tok.view.offset == expected[i].offset && tok.view.len == expected[i].len);
+      }
+      assert(!ev_json_iter_next(&it, &tok) && it.error == EV_STR_ERR_NONE);
+
+      // Skipping from a random container lands on the token after its end
+      u32 from = rng() % count;
+      if(expected[from].type == EV_JSON_ARRAY || expected[from].type == EV_JSON_OBJECT) {
+        u32 after = from + 1;
+        while(!(expected[after].type == EV_JSON_END && expected[after].depth == expected[from].depth)) {
+          after++;
+        }
+        after++;
+        ev_json_iter_init(&it, json);
+        for(u32 i = 0; i <= from; i++) {
+          assert(ev_json_iter_next(&it, &tok));
+        }
+        assert(ev_json_iter_skip(&it));
+        if(after < count) {
+          assert(ev_json_iter_next(&it, &tok) && tok.view.offset == expected[after].offset);
+        } else {
+          assert(!ev_json_iter_next(&it, &tok) && it.error == EV_STR_ERR_NONE);
+        }
+      }
+
+      ev_json_doc doc = {0};
+      assert(ev_json_parse(json, &doc) == EV_STR_ERR_NONE);
+      assert(doc.node_count == count);
+      ev_json_fini(&doc);
+
+      // Mutations are rejected exactly when the reference rejects them
+      for(u32 m = 0; m < 10; m++) {
+        u64 at = rng() % len;
+        char saved = json[at];
+        json[at] = "\"\\{}[],: \x01x0e-."[rng() % 15];
+        bool ok = ref_parse(json, len, expected, &count);
+        valid_mutations += ok;
+        evstring_error_t err = ev_json_parse(json, &doc);
+        if((err == EV_STR_ERR_NONE) != ok) {
+          fprintf(stderr, "mutation at %llu of '%s': expected %d\n", at, json, ok);
+          assert(false);
+        }
+        assert(!ok || doc.node_count == count);
+        json[at] = saved;
+      }
+      ev_json_fini(&doc);
+      evstring_free(json);
+    }
+    // The mutations are not all trivially invalid
+    assert(valid_mutations > 3000);
+    free(expected);
+    free(buf);
+  }
+
+  puts("ev_json tests passed");
+  return 0;
+}
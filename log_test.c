@@ -1,9 +1,372 @@
 #define EV_LOG_IMPLEMENTATION
 #include "ev_log.h"
 
+#include <assert.h>
+
+#define THREAD_COUNT 4
+
+// Only called on the writer thread in asynchronous mode
+static u64 received;
+static i64 last_index[THREAD_COUNT + 1];
+static bool consecutive;
+static bool slow;
+static u32 last_length;
+
+static void counting_callback(ev_log_event_t* ev)
+{
+  char buf[1024];
+  last_length = vsnprintf(buf, sizeof(buf), ev->fmt, ev->ap);
+  u32 thread, index;
+  if (sscanf(buf, "%u %u", &thread, &index) == 2) {
+    assert(ev->level == EV_LOG_INFO);
+    assert(consecutive ? index == last_index[thread] + 1 : index > last_index[thread]);
+    last_index[thread] = index;
+  }
+  received++;
+  if (slow) {
+    for (volatile u32 i = 0; i < 2000; i++) {
+    }
+  }
+}
+
+static void reset(bool in_order)
+{
+  received = 0;
+  consecutive = in_order;
+  for (u32 i = 0; i <= THREAD_COUNT; i++) {
+    last_index[i] = -1;
+  }
+}
+
+typedef struct {
+  u32 id;
+  u32 count;
+} producer_t;
+
+static void producer(void* arg)
+{
+  producer_t* p = arg;
+  for (u32 i = 0; i < p->count; i++) {
+    ev_log_info("%u %u", p->id, i);
+    ev_log_debug("filtered out");
+  }
+}
+
+static void run_producers(u32 count)
+{
+  ev_thread_t threads[THREAD_COUNT];
+  producer_t producers[THREAD_COUNT];
+  for (u32 i = 0; i < THREAD_COUNT; i++) {
+    producers[i] = (producer_t) { i, count };
+    assert(ev_thread_create(&threads[i], producer, &producers[i]));
+  }
+  for (u32 i = 0; i < THREAD_COUNT; i++) {
+    ev_thread_join(&threads[i]);
+  }
+}
+
+static void binlog_producer(void* arg)
+{
+  producer_t* p = arg;
+  for (u32 i = 0; i < p->count; i++) {
+    ev_binlog_info("%u %u", p->id, i);
+    ev_binlog_debug("filtered out %u", i);
+  }
+}
+
+// Logs from what runs after the thread's buffer is released on exit, like
+// the thread-exit destructors of other libraries
+static void binlog_exiting(void* arg)
+{
+  (void)arg;
+  ev_binlog_info("before exit");
+  ev_binlog_buffer_t* buffer = binlog_buffer;
+  assert(buffer);
+  binlog_thread_exit(buffer);
+  ev_tls_set(G.binlog_key, NULL);
+  ev_binlog_info("after exit");
+  assert(!binlog_buffer);
+}
+
+// The same call site, logged to two files
+static void binlog_restarted(u32 session)
+{
+  ev_binlog_warn("session %u", session);
+}
+
+// \returns The message of the next decoded line
+static const char* next_message(FILE* fp, char* line, u32 size)
+{
+  if (!fgets(line, size, fp))
+    return NULL;
+  line[strcspn(line, "\n")] = '\0';
+  const char* message = strstr(line, ": ");
+  assert(message);
+  return message + 2;
+}
+
+static u64 count_lines(FILE* fp)
+{
+  u64 lines = 0;
+  i32 c;
+  rewind(fp);
+  while ((c = fgetc(fp)) != EOF) {
+    lines += c == '\n';
+  }
+  fseek(fp, 0, SEEK_END);
+  return lines;
+}
 
 int main()
 {
   ev_log_trace("Trace Log");
+
+  ev_log_set_quiet(true);
+  ev_log_set_level(EV_LOG_INFO);
+  assert(ev_log_add_callback(counting_callback, NULL, EV_LOG_INFO) == 0);
+  FILE* fp = tmpfile();
+  assert(fp);
+  assert(ev_log_add_fp(fp, EV_LOG_INFO) == 0);
+
+  // Blocking: nothing is lost, and each thread's messages stay in order
+  {
+    reset(true);
+    assert(ev_log_start_async(64, EV_LOG_OVERFLOW_BLOCK));
+    assert(!ev_log_start_async(64, EV_LOG_OVERFLOW_BLOCK));
+    run_producers(20000);
+    ev_log_flush();
+    assert(received == THREAD_COUNT * 20000);
+    assert(ev_log_dropped_count() == 0);
+    for (u32 i = 0; i < THREAD_COUNT; i++) {
+      assert(last_index[i] == 20000 - 1);
+    }
+    assert(count_lines(fp) == THREAD_COUNT * 20000);
+
+    // Long messages are truncated
+    char long_message[1000];
+    memset(long_message, 'x', sizeof(long_message) - 1);
+    long_message[sizeof(long_message) - 1] = '\0';
+    ev_log_info("%s", long_message);
+    ev_log_flush();
+    assert(last_length == EV_LOG_ASYNC_MESSAGE_SIZE - 1);
+
+    // Stopping writes what is left in the queue
+    reset(true);
+    for (u32 i = 0; i < 1000; i++) {
+      ev_log_info("%u %u", THREAD_COUNT, i);
+    }
+    ev_log_stop_async();
+    assert(received == 1000);
+    ev_log_flush();
+  }
+
+  // Dropping the newest messages keeps the first ones
+  {
+    reset(false);
+    slow = true;
+    assert(ev_log_start_async(16, EV_LOG_OVERFLOW_DROP_NEWEST));
+    for (u32 i = 0; i < 2000; i++) {
+      ev_log_info("%u %u", THREAD_COUNT, i);
+    }
+    ev_log_flush();
+    u64 dropped = ev_log_dropped_count();
+    assert(dropped > 0 && received + dropped == 2000);
+    assert(last_index[THREAD_COUNT] < 2000 - 1);
+
+    run_producers(5000);
+    ev_log_flush();
+    assert(received + ev_log_dropped_count() == 2000 + THREAD_COUNT * 5000);
+    ev_log_stop_async();
+  }
+
+  // Dropping the oldest messages keeps the last ones
+  {
+    reset(false);
+    assert(ev_log_start_async(16, EV_LOG_OVERFLOW_DROP_OLDEST));
+    assert(ev_log_dropped_count() == 0);
+    for (u32 i = 0; i < 2000; i++) {
+      ev_log_info("%u %u", THREAD_COUNT, i);
+    }
+    ev_log_flush();
+    u64 dropped = ev_log_dropped_count();
+    assert(dropped > 0 && received + dropped == 2000);
+    assert(last_index[THREAD_COUNT] == 2000 - 1);
+
+    run_producers(5000);
+    ev_log_flush();
+    assert(received + ev_log_dropped_count() == 2000 + THREAD_COUNT * 5000);
+    ev_log_stop_async();
+    slow = false;
+  }
+
+  // Binary logging
+  {
+    FILE* bin = tmpfile();
+    FILE* text = tmpfile();
+    assert(bin && text);
+    assert(ev_binlog_start(bin));
+    assert(!ev_binlog_start(bin));
+    ev_binlog_info("no arguments");
+    ev_binlog_info("%d %u %lld %llu %ld %hhd %c %%", -5, 7u, -1234567890123ll, ~0ull, -9l, (signed char)-3, 'x');
+    ev_binlog_info("%.3f|%8.2e|%g|%-6s|%6s|%.*s|%*d|%-*d|", 3.14159, 1e10, 0.5f, "ab", "cd", 3, "abcdef", 5, 42, 4, 1);
+    const char* null_string = NULL;
+    char long_string[EV_BINLOG_MAX_STRING + 100];
+    memset(long_string, 'y', sizeof(long_string) - 1);
+    long_string[sizeof(long_string) - 1] = '\0';
+    ev_binlog_error("%s %s", null_string, long_string);
+    ev_binlog_info("%p %s", (void*)bin, "mismatched %d");
+    binlog_restarted(1);
+
+    // Enough messages to wrap around the threads' buffers
+    ev_thread_t threads[THREAD_COUNT];
+    producer_t producers[THREAD_COUNT];
+    for (u32 i = 0; i < THREAD_COUNT; i++) {
+      producers[i] = (producer_t) { i, 60000 };
+      assert(ev_thread_create(&threads[i], binlog_producer, &producers[i]));
+    }
+    for (u32 i = 0; i < THREAD_COUNT; i++) {
+      ev_thread_join(&threads[i]);
+    }
+    ev_binlog_flush();
+    long flushed = ftell(bin);
+    ev_binlog_stop();
+    assert(ftell(bin) == flushed);
+
+    rewind(bin);
+    assert(ev_binlog_decode(bin, text));
+    rewind(text);
+    char line[2048];
+    char expected[2048];
+    assert(strcmp(next_message(text, line, sizeof(line)), "no arguments") == 0);
+    assert(strstr(line, " INFO  log_test.c:"));
+    assert(strcmp(next_message(text, line, sizeof(line)), "-5 7 -1234567890123 18446744073709551615 -9 -3 x %") == 0);
+    snprintf(expected, sizeof(expected), "%.3f|%8.2e|%g|%-6s|%6s|%.*s|%*d|%-*d|", 3.14159, 1e10, 0.5, "ab", "cd", 3,
+        "abcdef", 5, 42, 4, 1);
+    assert(strcmp(next_message(text, line, sizeof(line)), expected) == 0);
+    const char* message = next_message(text, line, sizeof(line));
+    assert(strstr(line, " ERROR "));
+    assert(strncmp(message, "(null) yyy", 10) == 0 && strlen(message) == 7 + EV_BINLOG_MAX_STRING);
+    snprintf(expected, sizeof(expected), "%p %s", (void*)bin, "mismatched %d");
+    assert(strcmp(next_message(text, line, sizeof(line)), expected) == 0);
+    assert(strcmp(next_message(text, line, sizeof(line)), "session 1") == 0);
+
+    // The threads' messages are interleaved by time
+    reset(true);
+    u64 messages = 0;
+    char last_time[32] = "";
+    while ((message = next_message(text, line, sizeof(line)))) {
+      u32 thread, index;
+      assert(sscanf(message, "%u %u", &thread, &index) == 2 && thread < THREAD_COUNT);
+      assert(index == last_index[thread] + 1);
+      last_index[thread] = index;
+      messages++;
+      line[26] = '\0';
+      assert(strcmp(line, last_time) >= 0);
+      strcpy(last_time, line);
+    }
+    assert(messages == THREAD_COUNT * 60000);
+
+    // A second file defines the call sites it uses again
+    FILE* second = tmpfile();
+    assert(ev_binlog_start(second));
+    binlog_restarted(2);
+
+    // The buffers of threads that exited are reused
+    for (u32 round = 0; round < 4; round++) {
+      for (u32 i = 0; i < THREAD_COUNT; i++) {
+        producers[i] = (producer_t) { i, 100 };
+        assert(ev_thread_create(&threads[i], binlog_producer, &producers[i]));
+      }
+      for (u32 i = 0; i < THREAD_COUNT; i++) {
+        ev_thread_join(&threads[i]);
+      }
+      // Once to copy what they logged, once more to see it copied
+      ev_binlog_flush();
+      ev_binlog_flush();
+    }
+    u32 buffers = 0;
+    for (ev_binlog_buffer_t* b = G.binlog_buffers; b; b = b->next) {
+      buffers++;
+    }
+    for (ev_binlog_buffer_t* b = G.binlog_free_buffers; b; b = b->next) {
+      buffers++;
+    }
+    assert(buffers <= THREAD_COUNT + 1);
+
+    // Nothing is written to a buffer after it is released
+    ev_thread_t exiting;
+    assert(ev_thread_create(&exiting, binlog_exiting, NULL));
+    ev_thread_join(&exiting);
+    ev_binlog_stop();
+    rewind(second);
+    rewind(text);
+    assert(ev_binlog_decode(second, text));
+    rewind(text);
+    assert(strcmp(next_message(text, line, sizeof(line)), "session 2") == 0);
+    u32 before_exit = 0;
+    while ((message = next_message(text, line, sizeof(line)))) {
+      before_exit += strcmp(message, "before exit") == 0;
+      assert(strcmp(message, "after exit") != 0);
+    }
+    assert(before_exit == 1);
+
+    // Truncated and invalid logs
+    rewind(bin);
+    FILE* truncated = tmpfile();
+    for (long i = 0; i < flushed - 3; i++) {
+      fputc(fgetc(bin), truncated);
+    }
+    rewind(truncated);
+    assert(!ev_binlog_decode(truncated, text));
+    rewind(text);
+    assert(!ev_binlog_decode(text, text));
+
+    // Runs of records from different buffers are merged by their ticks
+    rewind(bin);
+    u8 header[32];
+    assert(fread(header, 1, sizeof(header), bin) == sizeof(header));
+    u64 start_ticks;
+    memcpy(&start_ticks, header + 8, 8);
+    FILE* runs = tmpfile();
+    fwrite(header, 1, sizeof(header), runs);
+    u32 site[10] = { sizeof(site), 0xFFFFFFFFu, 1, 1, EV_LOG_INFO, 1, 1, 2 };
+    memcpy(&site[8], "\x01" "f%u", 4);
+    fwrite(site, 1, sizeof(site), runs);
+    const u32 order[] = { 1, 3, 6, 2, 4, 5, 4, 7 };
+    for (u32 i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+      u32 record[6] = { sizeof(record), 1 };
+      u64 ticks = start_ticks + order[i];
+      memcpy(&record[2], &ticks, 8);
+      record[4] = order[i] * 10 + i;
+      fwrite(record, 1, sizeof(record), runs);
+    }
+    rewind(runs);
+    rewind(text);
+    assert(ev_binlog_decode(runs, text));
+    rewind(text);
+    const char* merged[] = { "10", "23", "31", "44", "46", "55", "62", "77" };
+    for (u32 i = 0; i < sizeof(merged) / sizeof(merged[0]); i++) {
+      assert(strcmp(next_message(text, line, sizeof(line)), merged[i]) == 0);
+    }
+    fclose(runs);
+
+    // A call site id that skips ids that were not defined
+    FILE* corrupt = tmpfile();
+    fwrite(header, 1, sizeof(header), corrupt);
+    u32 definition[10] = { sizeof(definition), 0xFFFFFFFFu, 0x7FFFFFFF, 1, EV_LOG_INFO, 0, 1, 1 };
+    memcpy(&definition[8], "ab", 2);
+    fwrite(definition, 1, sizeof(definition), corrupt);
+    rewind(corrupt);
+    assert(!ev_binlog_decode(corrupt, text));
+    fclose(corrupt);
+
+    fclose(truncated);
+    fclose(second);
+    fclose(text);
+    fclose(bin);
+  }
+
+  fclose(fp);
+  puts("ev_log tests passed");
   return 0;
 }
@@ -0,0 +1,102 @@
+#define EV_SET_IMPLEMENTATION
+#include "ev_set.h"
+#define EV_STR_IMPLEMENTATION
+#include "ev_str.h"
+
+#include <stdio.h>
+
+int main()
+{
+  { // Integers, hashed and compared bytewise
+    ev_set(i32) s = ev_set_init(i32);
+    for(i32 i = 0; i < 1000; i++) {
+      assert(ev_set_insert(&s, &i) == EV_SET_ERR_NONE);
+    }
+    for(i32 i = 0; i < 1000; i += 2) {
+      assert(ev_set_insert(&s, &i) == EV_SET_ERR_EXISTS);
+    }
+    assert(ev_set_len(&s) == 1000);
+
+    for(i32 i = 0; i < 1000; i += 2) {
+      assert(ev_set_remove(&s, &i));
+    }
+    assert(ev_set_len(&s) == 500);
+    for(i32 i = 0; i < 1000; i++) {
+      assert(ev_set_contains(&s, &i) == (i % 2 == 1));
+    }
+
+    u64 count = 0;
+    i64 sum = 0;
+    for(i32 *it = ev_set_iter_begin(&s); it != ev_set_iter_end(&s); ev_set_iter_next(&s, (void **)&it)) {
+      count++;
+      sum += *it;
+    }
+    assert(count == 500);
+    assert(sum == 250000);
+
+    assert(ev_set_reserve(&s, 100000) == EV_SET_ERR_NONE);
+    assert(ev_set_len(&s) == 500);
+    i32 seven = 7;
+    assert(ev_set_contains(&s, &seven));
+
+    ev_set_fini(&s);
+  }
+
+  { // Set algebra
+    ev_set(i32) a = ev_set_init(i32);
+    ev_set(i32) b = ev_set_init(i32);
+    for(i32 i = 0; i < 100; i++) {
+      ev_set_insert(&a, &i);
+    }
+    for(i32 i = 90; i < 120; i++) {
+      ev_set_insert(&b, &i);
+    }
+
+    ev_set(i32) u = ev_set_union(&a, &b);
+    ev_set(i32) n = ev_set_intersection(&a, &b);
+    ev_set(i32) d_ab = ev_set_difference(&a, &b);
+    ev_set(i32) d_ba = ev_set_difference(&b, &a);
+    assert(ev_set_len(&u) == 120);
+    assert(ev_set_len(&n) == 10);
+    assert(ev_set_len(&d_ab) == 90);
+    assert(ev_set_len(&d_ba) == 20);
+    for(i32 i = 0; i < 120; i++) {
+      assert(ev_set_contains(&u, &i));
+      assert(ev_set_contains(&n, &i) == (i >= 90 && i < 100));
+      assert(ev_set_contains(&d_ab, &i) == (i < 90));
+      assert(ev_set_contains(&d_ba, &i) == (i >= 100));
+    }
+
+    ev_set_fini(&u);
+    ev_set_fini(&n);
+    ev_set_fini(&d_ab);
+    ev_set_fini(&d_ba);
+    ev_set_fini(&a);
+    ev_set_fini(&b);
+  }
+
+  { // Strings, through the evstring type hooks
+    ev_set(evstring) paths = ev_set_init(evstring);
+    evstring p1 = evstr("textures/wall.png");
+    evstring p2 = evstr("textures/floor.png");
+    evstring p1_dup = evstring_new("textures/wall.png");
+
+    assert(ev_set_insert(&paths, &p1) == EV_SET_ERR_NONE);
+    assert(ev_set_insert(&paths, &p2) == EV_SET_ERR_NONE);
+    assert(ev_set_insert(&paths, &p1_dup) == EV_SET_ERR_EXISTS);
+    assert(ev_set_len(&paths) == 2);
+    assert(ev_set_contains(&paths, &p1_dup));
+
+    ev_set(evstring) copy = ev_set_dup(&paths);
+    assert(ev_set_remove(&paths, &p1_dup));
+    assert(!ev_set_contains(&paths, &p1));
+    assert(ev_set_contains(&copy, &p1));
+
+    evstring_free(p1_dup);
+    ev_set_fini(&copy);
+    ev_set_fini(&paths);
+  }
+
+  puts("ev_set tests passed");
+  return 0;
+}
@@ -0,0 +1,137 @@
+#define EV_STR_IMPLEMENTATION
+#include "ev_str.h"
+#define EV_SKETCH_IMPLEMENTATION
+#include "ev_sketch.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#define THREAD_SKETCHES 4
+
+int main()
+{
+  { // HyperLogLog accuracy from the sparse range to far beyond the registers
+    const u64 cardinalities[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+    for(u32 c = 0; c < EV_ARRSIZE(cardinalities); c++) {
+      ev_hll_t h;
+      assert(ev_hll_init(&h, 12) == EV_SKETCH_ERR_NONE);
+      for(u64 i = 0; i < cardinalities[c]; i++) {
+        // Every element is added twice; duplicates must not count
+        ev_hll_add(&h, &i, sizeof(i));
+        ev_hll_add(&h, &i, sizeof(i));
+      }
+      f64 estimate = ev_hll_estimate(&h);
+      f64 error = fabs(estimate - cardinalities[c]) / cardinalities[c];
+      printf("hll %7llu: estimate %10.1f, error %.4f, %s\n",
+             cardinalities[c], estimate, error, h.sparse ? "sparse" : "dense");
+      // Four standard errors of 1.04/sqrt(4096)
+      assert(error < 4 * 0.01625);
+      ev_hll_fini(&h);
+    }
+  }
+
+  { // Per-thread sketches merge losslessly
+    ev_hll_t parts[THREAD_SKETCHES];
+    ev_hll_t whole, merged;
+    ev_hll_init(&whole, 12);
+    ev_hll_init(&merged, 12);
+    for(u32 t = 0; t < THREAD_SKETCHES; t++) {
+      ev_hll_init(&parts[t], 12);
+    }
+    for(u64 i = 0; i < 200000; i++) {
+      // Overlapping streams
+      ev_hll_add(&parts[i % THREAD_SKETCHES], &(u64){ i % 150000 }, sizeof(u64));
+      ev_hll_add(&whole, &(u64){ i % 150000 }, sizeof(u64));
+    }
+    // A sparse sketch merged into a dense one and the other way around
+    ev_hll_t small;
+    ev_hll_init(&small, 12);
+    ev_hll_add(&small, "extra", 5);
+    ev_hll_add(&whole, "extra", 5);
+    assert(small.sparse);
+
+    ev_hll_merge(&merged, &small);
+    assert(merged.sparse);
+    for(u32 t = 0; t < THREAD_SKETCHES; t++) {
+      assert(ev_hll_merge(&merged, &parts[t]) == EV_SKETCH_ERR_NONE);
+    }
+    assert(!merged.sparse);
+    assert(memcmp(merged.registers, whole.registers, 1u << 12) == 0);
+    assert(ev_hll_estimate(&merged) == ev_hll_estimate(&whole));
+
+    ev_hll_t other_precision;
+    ev_hll_init(&other_precision, 10);
+    assert(ev_hll_merge(&merged, &other_precision) == EV_SKETCH_ERR_MISMATCH);
+
+    ev_hll_fini(&other_precision);
+    ev_hll_fini(&small);
+    for(u32 t = 0; t < THREAD_SKETCHES; t++) {
+      ev_hll_fini(&parts[t]);
+    }
+    ev_hll_fini(&whole);
+    ev_hll_fini(&merged);
+  }
+
+  { // Typed values go through the type's hash hook
+    ev_hll_t h;
+    ev_hll_init(&h, 8);
+    evstring a = evstring_new("shader_key");
+    evstring b = evstring_new("shader_key");
+    ev_hll_add_value(&h, evstring, &a);
+    ev_hll_add_value(&h, evstring, &b);
+    ev_hll_add_value(&h, i32, &(i32){ 7 });
+    assert(h.sparse && h.sparse_len <= 2);
+    assert(round(ev_hll_estimate(&h)) == 2);
+    evstring_free(a);
+    evstring_free(b);
+    ev_hll_fini(&h);
+  }
+
+  { // Count-min: never undercounts, error bounded by epsilon * total
+    ev_cms_t c;
+    assert(ev_cms_init_error(&c, 0.001, 0.01) == EV_SKETCH_ERR_NONE);
+    printf("cms: %u x %u counters\n", c.width, c.depth);
+
+    // Zipf-like stream: element i appears 10000 / (i + 1) times
+    for(u32 i = 0; i < 5000; i++) {
+      ev_cms_add(&c, &i, sizeof(i), 10000 / (i + 1));
+    }
+    u32 over_bound = 0;
+    for(u32 i = 0; i < 5000; i++) {
+      u32 truth = 10000 / (i + 1);
+      u32 estimate = ev_cms_estimate(&c, &i, sizeof(i));
+      assert(estimate >= truth);
+      over_bound += (estimate - truth) > 0.001 * c.total;
+    }
+    assert(over_bound <= 50); // delta = 1%
+    assert(ev_cms_estimate(&c, &(u32){ 0 }, sizeof(u32)) == 10000);
+
+    // Merged per-thread sketches still bound the combined counts
+    ev_cms_t parts[2];
+    ev_cms_init(&parts[0], c.width, c.depth);
+    ev_cms_init(&parts[1], c.width, c.depth);
+    ev_cms_add_value(&parts[0], i32, &(i32){ 42 }, 5);
+    ev_cms_add_value(&parts[1], i32, &(i32){ 42 }, 7);
+    assert(ev_cms_merge(&parts[0], &parts[1]) == EV_SKETCH_ERR_NONE);
+    assert(ev_cms_estimate_value(&parts[0], i32, &(i32){ 42 }) == 12);
+    assert(parts[0].total == 12);
+
+    ev_cms_fini(&parts[0]);
+    ev_cms_fini(&parts[1]);
+    ev_cms_fini(&c);
+
+    // Parameters whose dimensions do not fit in a u32
+    assert(ev_cms_init_error(&c, 1e-10, 0.01) == EV_SKETCH_ERR_INVALID_PARAMS);
+    assert(ev_cms_init_error(&c, NAN, 0.01) == EV_SKETCH_ERR_INVALID_PARAMS);
+    assert(ev_cms_init_error(&c, 0.001, NAN) == EV_SKETCH_ERR_INVALID_PARAMS);
+    assert(ev_cms_init_error(&c, 0.001, 0.0) == EV_SKETCH_ERR_INVALID_PARAMS);
+    assert(ev_cms_init_error(&c, 0.001, 1.0) == EV_SKETCH_ERR_INVALID_PARAMS);
+    assert(ev_cms_init_error(&c, 0.5, 5e-324) == EV_SKETCH_ERR_NONE);
+    assert(c.depth == 745);
+    ev_cms_fini(&c);
+  }
+
+  puts("ev_sketch tests passed");
+  return 0;
+}
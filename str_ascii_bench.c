@@ -0,0 +1,141 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <time.h>
+
+#define EV_STR_IMPLEMENTATION
+#include "ev_str.h"
+
+#define PATH_COUNT 1000000
+#define INPUT_SIZE (64ull * 1024 * 1024)
+#define ROUNDS 4
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Windows-style asset paths, as they come out of a manifest
+static void generate(evstring *paths)
+{
+  static const char *dirs[] = { "Assets\\Textures\\Environment\\Forest\\", "Assets\\Meshes\\Characters\\",
+    "Assets\\Audio\\Ambient\\", "Assets\\Materials\\" };
+  u64 state = 0x9E3779B97F4A7C15ull;
+  for(u32 i = 0; i < PATH_COUNT; i++) {
+    state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+    paths[i] = evstring_new(" %sSubFolder_%02u\\Asset_%07llu_Variant.PNG\r\n", dirs[state % 4],
+        (u32)(state >> 8) % 40, (state >> 16) % 10000000);
+  }
+}
+
+// Baseline: what the pipeline does today, one character at a time
+static void normalize_loop(evstring *s)
+{
+  char *p = *s;
+  u64 len = evstring_getLength(*s);
+  u64 begin = 0, end = len;
+  while(begin < end && isspace((u8)p[begin])) {
+    begin++;
+  }
+  while(end > begin && isspace((u8)p[end - 1])) {
+    end--;
+  }
+  for(u64 i = begin; i < end; i++) {
+    char c = p[i] == '\\' ? '/' : p[i];
+    p[i - begin] = (char)tolower((u8)c);
+  }
+  evstring_setLength(s, end - begin);
+}
+
+static void normalize(evstring *s)
+{
+  evstring_trim(s);
+  evstring_replaceChar(s, '\\', '/');
+  evstring_toLower(s);
+}
+
+int main()
+{
+  evstring *paths = malloc(PATH_COUNT * sizeof(evstring));
+  evstring *work = malloc(PATH_COUNT * sizeof(evstring));
+  generate(paths);
+
+  printf("Normalizing %u paths (trim, '\\' -> '/', lowercase)\n", PATH_COUNT);
+  double ms[2];
+  u64 checksum[2] = { 0, 0 };
+  for(u32 method = 0; method < 2; method++) {
+    for(u32 i = 0; i < PATH_COUNT; i++) {
+      work[i] = evstring_new(paths[i]);
+    }
+    double start = now_ms();
+    for(u32 i = 0; i < PATH_COUNT; i++) {
+      if(method == 0) {
+        normalize_loop(&work[i]);
+      } else {
+        normalize(&work[i]);
+      }
+    }
+    ms[method] = now_ms() - start;
+    for(u32 i = 0; i < PATH_COUNT; i++) {
+      checksum[method] += evstring_hash(work[i]);
+      evstring_free(work[i]);
+    }
+  }
+  assert(checksum[0] == checksum[1]);
+  printf("  %-26s %8.2f ms\n", "per-character loop", ms[0]);
+  printf("  %-26s %8.2f ms (%.2fx)\n", "evstring transforms", ms[1], ms[0] / ms[1]);
+
+  // Raw kernels over one large buffer
+  char *text = malloc(INPUT_SIZE);
+  char *out = malloc(INPUT_SIZE);
+  u64 state = 0x2545F4914F6CDD1Dull;
+  for(u64 i = 0; i < INPUT_SIZE; i++) {
+    state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+    text[i] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 _-."[state % 66];
+  }
+  memset(out, 0, INPUT_SIZE);
+  printf("%llu MB input, %u rounds\n", INPUT_SIZE / (1024 * 1024), ROUNDS);
+
+  double start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    for(u64 i = 0; i < INPUT_SIZE; i++) {
+      out[i] = (char)tolower((u8)text[i]);
+    }
+  }
+  double loop_ms = now_ms() - start;
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    ev_str_toLower(out, text, INPUT_SIZE);
+  }
+  double lower_ms = now_ms() - start;
+  printf("  %-26s %8.2f GB/s\n", "tolower loop", INPUT_SIZE * (double)ROUNDS / loop_ms / 1e6);
+  printf("  %-26s %8.2f GB/s\n", "ev_str_toLower", INPUT_SIZE * (double)ROUNDS / lower_ms / 1e6);
+
+  // Characters that do not occur, so the whole input is scanned
+  const char *absent = "/\\:*?\"<>|";
+  const ev_str_charset set = ev_str_charset_fromStr(absent);
+  text[INPUT_SIZE - 1] = '\0';
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    assert(strcspn(text, absent) == INPUT_SIZE - 1);
+  }
+  double strcspn_ms = now_ms() - start;
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    assert(ev_str_findFirstOf(text, INPUT_SIZE - 1, &set) == EV_STR_NPOS);
+  }
+  double find_ms = now_ms() - start;
+  printf("  %-26s %8.2f GB/s\n", "strcspn", INPUT_SIZE * (double)ROUNDS / strcspn_ms / 1e6);
+  printf("  %-26s %8.2f GB/s\n", "ev_str_findFirstOf", INPUT_SIZE * (double)ROUNDS / find_ms / 1e6);
+
+  for(u32 i = 0; i < PATH_COUNT; i++) {
+    evstring_free(paths[i]);
+  }
+  free(paths);
+  free(work);
+  free(text);
+  free(out);
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <strings.h>
+#include <time.h>
+
+#define EV_STR_IMPLEMENTATION
+#include "ev_str.h"
+
+#define PATH_COUNT 1000000
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Baseline comparators that a caller would write without evstring_order
+static int strcmp_qsort(const void *a, const void *b)
+{
+  return strcmp(*(const evstring *)a, *(const evstring *)b);
+}
+
+static int strcasecmp_qsort(const void *a, const void *b)
+{
+  return strcasecmp(*(const evstring *)a, *(const evstring *)b);
+}
+
+static int order_icase_qsort(const void *a, const void *b)
+{
+  return evstring_order_icase(*(const evstring *)a, *(const evstring *)b);
+}
+
+// Asset paths with long shared prefixes, like a build's file list
+static void generate(evstring *paths)
+{
+  static const char *dirs[] = { "assets/textures/environment/forest/", "assets/textures/environment/Desert/",
+    "assets/meshes/characters/", "assets/audio/ambient/loops/", "assets/materials/" };
+  static const char *exts[] = { ".png", ".PNG", ".mesh", ".ogg", ".mat" };
+  u64 state = 0x9E3779B97F4A7C15ull;
+  for(u32 i = 0; i < PATH_COUNT; i++) {
+    state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+    u32 d = state % 5;
+    paths[i] = evstring_new("%ssubfolder_%02u/asset_%07llu_variant%s", dirs[d], (u32)(state >> 8) % 40,
+        (state >> 16) % 10000000, exts[(state >> 40) % 5]);
+  }
+}
+
+static void bench_sort(const char *name, evstring *src, evstring *work, int (*cmp)(const void *, const void *))
+{
+  memcpy(work, src, PATH_COUNT * sizeof(evstring));
+  double start = now_ms();
+  qsort(work, PATH_COUNT, sizeof(evstring), cmp);
+  printf("  %-26s %8.2f ms\n", name, now_ms() - start);
+}
+
+int main()
+{
+  evstring *paths = malloc(PATH_COUNT * sizeof(evstring));
+  evstring *work = malloc(PATH_COUNT * sizeof(evstring));
+  generate(paths);
+  printf("Sorting %u asset paths\n", PATH_COUNT);
+
+  bench_sort("strcmp", paths, work, strcmp_qsort);
+  bench_sort("evstring_order", paths, work, evstring_order_qsort);
+  for(u32 i = 1; i < PATH_COUNT; i++) {
+    assert(strcmp(work[i - 1], work[i]) <= 0);
+  }
+  bench_sort("strcasecmp", paths, work, strcasecmp_qsort);
+  bench_sort("evstring_order_icase", paths, work, order_icase_qsort);
+  for(u32 i = 1; i < PATH_COUNT; i++) {
+    assert(strcasecmp(work[i - 1], work[i]) <= 0);
+  }
+
+  printf("Comparing neighbours %u times\n", PATH_COUNT * 10);
+  u64 hits = 0;
+  double start = now_ms();
+  for(u32 r = 0; r < 10; r++) {
+    for(u32 i = 1; i < PATH_COUNT; i++) {
+      hits += strncasecmp(work[i - 1], work[i], 40) == 0;
+    }
+  }
+  printf("  %-26s %8.2f ms\n", "strncasecmp prefix", now_ms() - start);
+  u64 ev_hits = 0;
+  start = now_ms();
+  for(u32 r = 0; r < 10; r++) {
+    for(u32 i = 1; i < PATH_COUNT; i++) {
+      ev_hits += evstring_eq_icase(ev_strview_from(work[i - 1], 40), ev_strview_from(work[i], 40));
+    }
+  }
+  printf("  %-26s %8.2f ms\n", "evstring_eq_icase prefix", now_ms() - start);
+  assert(hits == ev_hits);
+
+  u64 pngs = 0;
+  start = now_ms();
+  for(u32 r = 0; r < 10; r++) {
+    for(u32 i = 0; i < PATH_COUNT; i++) {
+      pngs += evstring_startsWith(paths[i], "assets/textures/") && evstring_endsWith(paths[i], ".png");
+    }
+  }
+  printf("  %-26s %8.2f ms (%llu matches)\n", "startsWith && endsWith", now_ms() - start, pngs);
+
+  for(u32 i = 0; i < PATH_COUNT; i++) {
+    evstring_free(paths[i]);
+  }
+  free(paths);
+  free(work);
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define EV_STR_IMPLEMENTATION
+#define EV_ENCODING_IMPLEMENTATION
+#include "ev_encoding.h"
+
+// Small enough to stay in cache, so that the kernels are measured rather than
+// memory bandwidth
+#define INPUT_SIZE (96ull * 1024)
+#define ROUNDS 20000
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static double gbps(double ms)
+{
+  return INPUT_SIZE * (double)ROUNDS / ms / 1e6;
+}
+
+// Baseline: what the default tostr hook did, one nibble at a time
+static void hex_loop(const u8 *src, u64 len, char *dst)
+{
+  for(u64 i = 0; i < len; i++) {
+    dst[i * 2] = EV_TOHEX_CHAR((u32)(src[i] >> 4) & 0xf);
+    dst[i * 2 + 1] = EV_TOHEX_CHAR((u32)src[i] & 0xf);
+  }
+}
+
+typedef struct {
+  u64 id;
+  f32 position[3];
+  u32 flags;
+} Entity;
+DEFINE_DEFAULT_TOSTR_FUNCTION(Entity)
+
+int main()
+{
+  u8 *data = malloc(INPUT_SIZE);
+  u8 *decoded = malloc(INPUT_SIZE);
+  char *text = malloc(ev_hex_encodedLength(INPUT_SIZE));
+  u64 state = 0x9E3779B97F4A7C15ull;
+  for(u64 i = 0; i < INPUT_SIZE; i++) {
+    state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+    data[i] = (u8)state;
+  }
+  printf("%llu KB input, %u rounds, GB/s of binary data\n", INPUT_SIZE / 1024, ROUNDS);
+
+  double start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    hex_loop(data, INPUT_SIZE, text);
+  }
+  double loop_ms = now_ms() - start;
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    __ev_hex_encodeScalar(data, INPUT_SIZE, text);
+  }
+  double scalar_ms = now_ms() - start;
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    ev_hex_encode(data, INPUT_SIZE, text);
+  }
+  double hex_encode_ms = now_ms() - start;
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    assert(ev_hex_decode(text, ev_hex_encodedLength(INPUT_SIZE), decoded) == INPUT_SIZE);
+  }
+  double hex_decode_ms = now_ms() - start;
+  assert(memcmp(data, decoded, INPUT_SIZE) == 0);
+
+  u64 base64_len = ev_base64_encodedLength(INPUT_SIZE);
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    assert(ev_base64_encode(data, INPUT_SIZE, text) == base64_len);
+  }
+  double base64_encode_ms = now_ms() - start;
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    assert(ev_base64_decode(text, base64_len, decoded) == INPUT_SIZE);
+  }
+  double base64_decode_ms = now_ms() - start;
+  assert(memcmp(data, decoded, INPUT_SIZE) == 0);
+
+  printf("  %-26s %8.2f GB/s\n", "hex, per-nibble loop", gbps(loop_ms));
+  printf("  %-26s %8.2f GB/s\n", "hex, scalar (tostr hook)", gbps(scalar_ms));
+  printf("  %-26s %8.2f GB/s\n", "ev_hex_encode", gbps(hex_encode_ms));
+  printf("  %-26s %8.2f GB/s\n", "ev_hex_decode", gbps(hex_decode_ms));
+  printf("  %-26s %8.2f GB/s\n", "ev_base64_encode", gbps(base64_encode_ms));
+  printf("  %-26s %8.2f GB/s\n", "ev_base64_decode", gbps(base64_decode_ms));
+
+  // The default tostr hook, on a small struct
+  Entity *entities = (Entity *)data;
+  u64 entity_count = INPUT_SIZE / sizeof(Entity);
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    for(u64 i = 0; i < entity_count; i++) {
+      hex_loop((const u8 *)&entities[i], sizeof(Entity), text + i * 2 * sizeof(Entity));
+    }
+  }
+  double entity_loop_ms = now_ms() - start;
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    for(u64 i = 0; i < entity_count; i++) {
+      TOSTR_FUNCTION(Entity, DEFAULT)(&entities[i], text + i * 2 * sizeof(Entity));
+    }
+  }
+  double entity_hook_ms = now_ms() - start;
+  printf("%llu %llu-byte structs through the default tostr hook\n", entity_count, (u64)sizeof(Entity));
+  printf("  %-26s %8.2f ns/struct\n", "per-nibble loop", entity_loop_ms * 1e6 / (entity_count * ROUNDS));
+  printf("  %-26s %8.2f ns/struct (%.2fx)\n", "__ev_hex_encodeScalar", entity_hook_ms * 1e6 / (entity_count * ROUNDS),
+      entity_loop_ms / entity_hook_ms);
+
+  free(data);
+  free(decoded);
+  free(text);
+  return 0;
+}
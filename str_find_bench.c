@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define EV_STR_IMPLEMENTATION
+#include "ev_str.h"
+
+#define INPUT_SIZE (100ull * 1024 * 1024)
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Byte-by-byte search with the same results, as a baseline
+static u64 naive_memmem(const char *data, u64 len, const char *needle, u64 needle_len)
+{
+  for(u64 i = 0; i + needle_len <= len; i++) {
+    u64 j = 0;
+    while(j < needle_len && data[i + j] == needle[j]) {
+      j++;
+    }
+    if(j == needle_len) {
+      return i;
+    }
+  }
+  return EV_STR_NPOS;
+}
+
+static u64 naive_memchr(const char *data, u64 len, char c)
+{
+  for(u64 i = 0; i < len; i++) {
+    if(data[i] == c) {
+      return i;
+    }
+  }
+  return EV_STR_NPOS;
+}
+
+static void report(const char *name, double naive_ms, double simd_ms)
+{
+  printf("  %-28s naive %8.2f ms (%5.2f GB/s)   ev_str %8.2f ms (%5.2f GB/s)\n", name,
+      naive_ms, INPUT_SIZE / naive_ms / 1e6, simd_ms, INPUT_SIZE / simd_ms / 1e6);
+}
+
+static void bench_needle(const char *name, const char *data, const char *needle)
+{
+  u64 needle_len = strlen(needle);
+  double start = now_ms();
+  u64 a = naive_memmem(data, INPUT_SIZE, needle, needle_len);
+  double naive_ms = now_ms() - start;
+  start = now_ms();
+  u64 b = ev_str_memmem(data, INPUT_SIZE, needle, needle_len);
+  double simd_ms = now_ms() - start;
+  assert(a == b);
+  report(name, naive_ms, simd_ms);
+}
+
+int main()
+{
+  // English-like text where the needles only occur at the very end
+  static const char words[] = "the quick brown fox jumps over the lazy dog while some text is searched ";
+  char *text = malloc(INPUT_SIZE + 1);
+  for(u64 i = 0; i < INPUT_SIZE; i++) {
+    text[i] = words[i % (sizeof(words) - 1)];
+  }
+  memcpy(text + INPUT_SIZE - 16, "#needle_at_end#", 15);
+  text[INPUT_SIZE] = '\0';
+
+  printf("%llu MB input\n", INPUT_SIZE / (1024 * 1024));
+  {
+    double start = now_ms();
+    u64 a = naive_memchr(text, INPUT_SIZE, '#');
+    double naive_ms = now_ms() - start;
+    start = now_ms();
+    u64 b = ev_str_memchr(text, INPUT_SIZE, '#');
+    double simd_ms = now_ms() - start;
+    assert(a == b);
+    report("char", naive_ms, simd_ms);
+  }
+  bench_needle("needle (6 bytes)", text, "needle");
+  bench_needle("needle (15 bytes)", text, "#needle_at_end#");
+  bench_needle("common prefix (11 bytes)", text, "the quick x");
+  bench_needle("long (68 bytes)", text,
+      "over the lazy dog while some text is searched the quick brown fox X");
+
+  // All 'a's, needle "aaa...ab": every position passes the byte filter
+  memset(text, 'a', INPUT_SIZE);
+  char needle[257];
+  memset(needle, 'a', 255);
+  needle[255] = 'b';
+  needle[256] = '\0';
+  {
+    double start = now_ms();
+    u64 b = ev_str_memmem(text, INPUT_SIZE, needle, 256);
+    double simd_ms = now_ms() - start;
+    assert(b == EV_STR_NPOS);
+    // The naive search does ~256 comparisons per byte here; it is left out
+    printf("  %-28s ev_str %8.2f ms (%5.2f GB/s)\n", "pathological (256 bytes)",
+        simd_ms, INPUT_SIZE / simd_ms / 1e6);
+  }
+
+  free(text);
+  return 0;
+}
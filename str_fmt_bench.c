@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define EV_STR_IMPLEMENTATION
+#include "ev_str.h"
+
+#define APPEND_COUNT 2000000
+#define NEW_COUNT 1000000
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// The previous implementation: measure with a NULL buffer, resize, then
+// format again
+static evstring_error_t two_pass_push(evstring *s, const char *fmt, ...)
+{
+  va_list ap, test;
+  va_start(ap, fmt);
+  va_copy(test, ap);
+  int fmt_len = vsnprintf(NULL, 0, fmt, test);
+  u64 old_len = evstring_getLength(*s);
+  evstring_error_t res = evstring_setLength(s, old_len + fmt_len);
+  if(res == EV_STR_ERR_NONE) {
+    vsnprintf((*s) + old_len, fmt_len + 1, fmt, ap);
+  }
+  va_end(test);
+  va_end(ap);
+  return res;
+}
+
+static evstring two_pass_new(const char *fmt, ...)
+{
+  va_list ap, test;
+  va_start(ap, fmt);
+  va_copy(test, ap);
+  int len = vsnprintf(NULL, 0, fmt, test);
+  evstring res = evstring_new_impl(NULL, 0);
+  evstring_setLength(&res, len);
+  vsnprintf(res, len + 1, fmt, ap);
+  va_end(test);
+  va_end(ap);
+  return res;
+}
+
+int main()
+{
+  printf("%u formatted appends, %u formatted strings\n", APPEND_COUNT, NEW_COUNT);
+
+  evstring a = evstring_new("");
+  double start = now_ms();
+  for(u32 i = 0; i < APPEND_COUNT; i++) {
+    two_pass_push(&a, "entity %u at (%.2f, %.2f)\n", i, i * 0.5, i * 0.25);
+  }
+  double two_pass_ms = now_ms() - start;
+
+  evstring b = evstring_new("");
+  start = now_ms();
+  for(u32 i = 0; i < APPEND_COUNT; i++) {
+    evstring_push(&b, "entity %u at (%.2f, %.2f)\n", i, i * 0.5, i * 0.25);
+  }
+  double single_pass_ms = now_ms() - start;
+  assert(evstring_cmp(a, b) == 0);
+
+  printf("  pushFmt, two passes:  %7.2f ms (%5.2f M appends/s)\n", two_pass_ms, APPEND_COUNT / two_pass_ms / 1e3);
+  printf("  pushFmt, single pass: %7.2f ms (%5.2f M appends/s)\n", single_pass_ms, APPEND_COUNT / single_pass_ms / 1e3);
+  evstring_free(a);
+  evstring_free(b);
+
+  evstring *strs = malloc(NEW_COUNT * sizeof(evstring));
+  memset(strs, 0xFF, NEW_COUNT * sizeof(evstring));
+  start = now_ms();
+  for(u32 i = 0; i < NEW_COUNT; i++) {
+    strs[i] = two_pass_new("textures/%s_%u.png", "wall", i);
+  }
+  two_pass_ms = now_ms() - start;
+  for(u32 i = 0; i < NEW_COUNT; i++) {
+    evstring_free(strs[i]);
+  }
+
+  start = now_ms();
+  for(u32 i = 0; i < NEW_COUNT; i++) {
+    strs[i] = evstring_new("textures/%s_%u.png", "wall", i);
+  }
+  single_pass_ms = now_ms() - start;
+  for(u32 i = 0; i < NEW_COUNT; i++) {
+    evstring_free(strs[i]);
+  }
+  free(strs);
+
+  printf("  newFmt, two passes:   %7.2f ms (%5.2f M strings/s)\n", two_pass_ms, NEW_COUNT / two_pass_ms / 1e3);
+  printf("  newFmt, single pass:  %7.2f ms (%5.2f M strings/s)\n", single_pass_ms, NEW_COUNT / single_pass_ms / 1e3);
+  return 0;
+}
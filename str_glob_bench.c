@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define EV_STR_IMPLEMENTATION
+#define EV_GLOB_IMPLEMENTATION
+#include "ev_glob.h"
+
+#define PATH_COUNT 200000
+#define ROUNDS 10
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static u64 rng_state = 0x9E3779B97F4A7C15ull;
+static u64 rng()
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+// Baseline: a recursive backtracking matcher, for `*`, `**` and `?`
+static bool naive_match(const char *p, const char *pend, const char *t, const char *tend)
+{
+  if(p == pend) {
+    return t == tend;
+  }
+  if(*p == '*') {
+    bool deep = p + 1 < pend && p[1] == '*';
+    const char *rest = p + 1 + deep;
+    if(deep && rest < pend && *rest == '/' && naive_match(rest + 1, pend, t, tend)) {
+      return true;
+    }
+    for(;; t++) {
+      if(naive_match(rest, pend, t, tend)) {
+        return true;
+      }
+      if(t == tend || (!deep && *t == '/')) {
+        return false;
+      }
+    }
+  }
+  if(t == tend || (*p == '?' ? *t == '/' : *p != *t)) {
+    return false;
+  }
+  return naive_match(p + 1, pend, t + 1, tend);
+}
+
+static void bench(const char *pattern, ev_strview *paths, u64 count, u32 rounds)
+{
+  ev_strview pv = ev_strview_fromStr(pattern);
+  u64 naive_matches = 0;
+  double start = now_ms();
+  for(u32 r = 0; r < rounds; r++) {
+    for(u64 i = 0; i < count; i++) {
+      naive_matches += naive_match(pv.ptr, pv.ptr + pv.len, paths[i].ptr, paths[i].ptr + paths[i].len);
+    }
+  }
+  double naive_ms = now_ms() - start;
+
+  ev_glob_t *g = ev_glob_compile(pattern);
+  assert(g);
+  u64 glob_matches = 0;
+  start = now_ms();
+  for(u32 r = 0; r < rounds; r++) {
+    for(u64 i = 0; i < count; i++) {
+      glob_matches += ev_glob_match(g, paths[i]);
+    }
+  }
+  double glob_ms = now_ms() - start;
+  ev_glob_fini(g);
+  assert(naive_matches == glob_matches);
+
+  printf("%s (%llu of %llu match)\n", pattern, glob_matches / rounds, count);
+  printf("  %-22s %8.1f ns/path\n", "backtracking", naive_ms * 1e6 / (count * rounds));
+  printf("  %-22s %8.1f ns/path (%.1fx)\n", "ev_glob", glob_ms * 1e6 / (count * rounds), naive_ms / glob_ms);
+}
+
+int main()
+{
+  static const char *roots[] = { "textures", "meshes", "audio", "shaders", "scenes" };
+  static const char *dirs[] = { "env", "characters", "props", "forest", "city", "lod0", "lod1", "ui" };
+  static const char *exts[] = { ".png", ".jpg", ".tga", ".mesh", ".wav", ".glsl", ".json" };
+  ev_strview *paths = malloc(PATH_COUNT * sizeof(ev_strview));
+  char *storage = malloc(PATH_COUNT * 96);
+  for(u64 i = 0; i < PATH_COUNT; i++) {
+    char *path = storage + i * 96;
+    int len = sprintf(path, "%s", roots[rng() % 5]);
+    for(u64 depth = rng() % 4; depth > 0; depth--) {
+      len += sprintf(path + len, "/%s", dirs[rng() % 8]);
+    }
+    len += sprintf(path + len, "/asset_%llu%s", rng() % 10000, exts[rng() % 7]);
+    paths[i] = ev_strview_from(path, len);
+  }
+
+  bench("textures/**/*.png", paths, PATH_COUNT, ROUNDS);
+  bench("**/*.json", paths, PATH_COUNT, ROUNDS);
+  bench("**/lod?/*", paths, PATH_COUNT, ROUNDS);
+  bench("*/*/*_1*.*", paths, PATH_COUNT, ROUNDS);
+
+  // Backtracking is exponential in the number of stars on texts that almost
+  // match
+  ev_strview *almost = malloc(1000 * sizeof(ev_strview));
+  char text[41];
+  memset(text, 'a', 40);
+  text[40] = '\0';
+  for(u64 i = 0; i < 1000; i++) {
+    almost[i] = ev_strview_from(text, 40);
+  }
+  bench("a*a*a*a*a*a*b", almost, 1000, 1);
+
+  free(almost);
+  free(paths);
+  free(storage);
+  return 0;
+}
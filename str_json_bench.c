@@ -0,0 +1,240 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define EV_STR_IMPLEMENTATION
+#define EV_JSON_IMPLEMENTATION
+#include "ev_json.h"
+
+#define ENTITY_COUNT 100000
+#define ROUNDS 10
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static u64 rng_state = 0x9E3779B97F4A7C15ull;
+static u64 rng()
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+// Baseline: a DOM parser like the usual third-party ones, which allocates
+// every node and copies every string out of the document
+typedef struct node {
+  ev_json_type type;
+  char *key;
+  char *string;
+  f64 number;
+  struct node *child;
+  struct node *next;
+} node;
+
+static const char *skip_ws(const char *p)
+{
+  while(*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r') {
+    p++;
+  }
+  return p;
+}
+
+static const char *copy_string(const char *p, char **out)
+{
+  const char *end = p;
+  while(*end != '"') {
+    end += *end == '\\' ? 2 : 1;
+  }
+  char *s = malloc(end - p + 1);
+  char *d = s;
+  while(p < end) {
+    if(*p == '\\') {
+      p++;
+      *d++ = *p == 'n' ? '\n' : *p == 't' ? '\t' : *p;
+      p++;
+    } else {
+      *d++ = *p++;
+    }
+  }
+  *d = '\0';
+  *out = s;
+  return end + 1;
+}
+
+static const char *copying_parse(const char *p, node **out)
+{
+  node *n = calloc(1, sizeof(node));
+  *out = n;
+  p = skip_ws(p);
+  if(*p == '{' || *p == '[') {
+    bool object = *p == '{';
+    n->type = object ? EV_JSON_OBJECT : EV_JSON_ARRAY;
+    p = skip_ws(p + 1);
+    node **tail = &n->child;
+    while(*p != '}' && *p != ']') {
+      char *key = NULL;
+      if(object) {
+        p = skip_ws(copy_string(skip_ws(p) + 1, &key) );
+        p++;
+      }
+      p = copying_parse(p, tail);
+      (*tail)->key = key;
+      tail = &(*tail)->next;
+      p = skip_ws(p);
+      p += *p == ',';
+      p = skip_ws(p);
+    }
+    return p + 1;
+  }
+  if(*p == '"') {
+    n->type = EV_JSON_STRING;
+    return copy_string(p + 1, &n->string);
+  }
+  if(*p == 't' || *p == 'n') {
+    n->type = *p == 't' ? EV_JSON_TRUE : EV_JSON_NULL;
+    return p + 4;
+  }
+  if(*p == 'f') {
+    n->type = EV_JSON_FALSE;
+    return p + 5;
+  }
+  n->type = EV_JSON_NUMBER;
+  char *end;
+  n->number = strtod(p, &end);
+  return end;
+}
+
+static void copying_free(node *n)
+{
+  while(n) {
+    node *next = n->next;
+    copying_free(n->child);
+    free(n->key);
+    free(n->string);
+    free(n);
+    n = next;
+  }
+}
+
+static void push_float(evstring *s)
+{
+  evstring_pushFmt(s, "%.3f", (f64)(i64)(rng() % 200000 - 100000) / 1000.0);
+}
+
+int main()
+{
+  // A scene file
+  static const char *meshes[] = { "tree", "rock", "house", "lamp", "fence", "crate" };
+  static const char *tags[] = { "static", "foliage", "interactive", "lod", "shadow", "navmesh" };
+  evstring json = evstring_new("{\n  \"scene\": \"forest\",\n  \"version\": 3,\n  \"entities\": [\n");
+  for(u32 i = 0; i < ENTITY_COUNT; i++) {
+    const char *mesh = meshes[rng() % 6];
+    evstring_pushFmt(&json, "    {\n      \"id\": %u,\n      \"name\": \"%s_%u\",\n", i, mesh, i);
+    evstring_pushStr(&json, "      \"transform\": {\n        \"position\": [");
+    push_float(&json); evstring_pushStr(&json, ", "); push_float(&json); evstring_pushStr(&json, ", "); push_float(&json);
+    evstring_pushStr(&json, "],\n        \"rotation\": [0.0, ");
+    push_float(&json);
+    evstring_pushStr(&json, ", 0.0, 1.0],\n        \"scale\": [1.0, 1.0, 1.0]\n      },\n");
+    evstring_pushFmt(&json, "      \"mesh\": \"assets/meshes/%s_%02u.mesh\",\n", mesh, (u32)(rng() % 20));
+    evstring_pushFmt(&json, "      \"tags\": [\"%s\", \"%s\"],\n", tags[rng() % 6], tags[rng() % 6]);
+    evstring_pushFmt(&json, "      \"description\": \"A \\\"%s\\\" placed by hand\\n\",\n", mesh);
+    evstring_pushFmt(&json, "      \"visible\": %s,\n      \"parent\": null\n    }%s\n", rng() % 4 ? "true" : "false",
+        i + 1 < ENTITY_COUNT ? "," : "");
+  }
+  evstring_pushStr(&json, "  ]\n}\n");
+  u64 len = evstring_getLength(json);
+  printf("%.1f MB scene file, %u entities, %u rounds\n", len / 1e6, ENTITY_COUNT, ROUNDS);
+
+  double start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    node *root;
+    copying_parse(json, &root);
+    copying_free(root);
+  }
+  double copying_ms = now_ms() - start;
+
+  // Parsing into a tape, reused between rounds as a loader would
+  ev_json_doc doc = {0};
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    assert(ev_json_parse(json, &doc) == EV_STR_ERR_NONE);
+  }
+  double tape_ms = now_ms() - start;
+  ev_json_value entities = ev_json_get(ev_json_root(&doc), "entities");
+  assert(ev_json_getCount(entities) == ENTITY_COUNT);
+
+  // Reading the positions off the tape
+  start = now_ms();
+  f64 sum = 0;
+  for(u32 r = 0; r < ROUNDS; r++) {
+    for(ev_json_value e = ev_json_first(entities); ev_json_getType(e); e = ev_json_next(e)) {
+      ev_json_value position = ev_json_get(ev_json_get(e, "transform"), "position");
+      for(ev_json_value x = ev_json_first(position); ev_json_getType(x); x = ev_json_next(x)) {
+        f64 v;
+        ev_json_getF64(x, &v);
+        sum += v;
+      }
+    }
+  }
+  double read_ms = now_ms() - start;
+
+  ev_json_iter it;
+  ev_json_token tok;
+  u64 tokens = 0;
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    ev_json_iter_init(&it, json);
+    while(ev_json_iter_next(&it, &tok)) {
+      tokens++;
+    }
+    assert(it.error == EV_STR_ERR_NONE);
+  }
+  double iter_ms = now_ms() - start;
+  assert(tokens == (u64)doc.node_count * ROUNDS);
+
+  // Counting the entities, skipping their contents
+  u64 skipped = 0;
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    ev_json_iter_init(&it, json);
+    while(ev_json_iter_next(&it, &tok)) {
+      if(tok.type == EV_JSON_OBJECT && tok.depth == 2) {
+        skipped++;
+        ev_json_iter_skip(&it);
+      }
+    }
+    assert(it.error == EV_STR_ERR_NONE);
+  }
+  double skip_ms = now_ms() - start;
+  assert(skipped == (u64)ENTITY_COUNT * ROUNDS);
+
+  // The structural index alone
+  u64 structurals = 0;
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    ev_json_iter_init(&it, json);
+    do {
+      __ev_json_refill(&it.index);
+      structurals += it.index.count;
+    } while(it.index.count);
+  }
+  double index_ms = now_ms() - start;
+
+  double bytes = (double)len * ROUNDS;
+  printf("  %-28s %8.2f GB/s\n", "copying DOM parser", bytes / copying_ms / 1e6);
+  printf("  %-28s %8.2f GB/s (%.1fx)\n", "ev_json_parse", bytes / tape_ms / 1e6, copying_ms / tape_ms);
+  printf("  %-28s %8.2f GB/s (%.1fx)\n", "ev_json_iter_next", bytes / iter_ms / 1e6, copying_ms / iter_ms);
+  printf("  %-28s %8.2f GB/s (%.1fx)\n", "ev_json_iter_skip", bytes / skip_ms / 1e6, copying_ms / skip_ms);
+  printf("  %-28s %8.2f GB/s\n", "structural index", bytes / index_ms / 1e6);
+  printf("%llu nodes, %llu structurals; positions read from the tape in %.2f ms (%g)\n",
+      (u64)doc.node_count, structurals / ROUNDS, read_ms / ROUNDS, sum);
+
+  ev_json_fini(&doc);
+  evstring_free(json);
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <time.h>
+
+#define EV_LOG_IMPLEMENTATION
+#include "ev_log.h"
+
+#define THREAD_COUNT 4
+#define MESSAGE_COUNT 100000
+#define BURST 4096
+#define BURST_ROUNDS 50
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+typedef struct {
+  u32 id;
+  double ms;
+} worker_t;
+
+static void worker(void* arg)
+{
+  worker_t* w = arg;
+  double start = now_ms();
+  for (u32 i = 0; i < MESSAGE_COUNT; i++) {
+    ev_log_info("worker %u finished job %u in %.3f ms", w->id, i, i * 0.001);
+  }
+  w->ms = now_ms() - start;
+}
+
+// \returns The time the workers spent in ev_log, per message
+static double run(double* total_ms)
+{
+  ev_thread_t threads[THREAD_COUNT];
+  worker_t workers[THREAD_COUNT];
+  double start = now_ms();
+  for (u32 i = 0; i < THREAD_COUNT; i++) {
+    workers[i].id = i;
+    ev_thread_create(&threads[i], worker, &workers[i]);
+  }
+  double worker_ms = 0;
+  for (u32 i = 0; i < THREAD_COUNT; i++) {
+    ev_thread_join(&threads[i]);
+    worker_ms += workers[i].ms;
+  }
+  ev_log_flush();
+  *total_ms = now_ms() - start;
+  return worker_ms * 1e6 / (THREAD_COUNT * MESSAGE_COUNT);
+}
+
+// \returns The best time per call of a burst of messages that fits in the
+// queue or buffer, flushed between bursts
+static double burst(bool binary)
+{
+  double best = 1e9;
+  for (u32 r = 0; r < BURST_ROUNDS; r++) {
+    double start = now_ms();
+    if (binary) {
+      for (u32 i = 0; i < BURST; i++) {
+        ev_binlog_info("worker %u finished job %u in %.3f ms", 0, i, i * 0.001);
+      }
+    } else {
+      for (u32 i = 0; i < BURST; i++) {
+        ev_log_info("worker %u finished job %u in %.3f ms", 0, i, i * 0.001);
+      }
+    }
+    double ms = now_ms() - start;
+    best = ms < best ? ms : best;
+    if (binary) {
+      ev_binlog_flush();
+    } else {
+      ev_log_flush();
+    }
+  }
+  return best * 1e6 / BURST;
+}
+
+int main()
+{
+  FILE* fp = tmpfile();
+  ev_log_set_quiet(true);
+  ev_log_add_fp(fp, EV_LOG_INFO);
+  printf("%u threads logging %u messages each to a file\n", THREAD_COUNT, MESSAGE_COUNT);
+
+  double total_ms;
+  double ns = run(&total_ms);
+  printf("  %-26s %8.1f ns/message in ev_log, %8.1f ms total\n", "synchronous", ns, total_ms);
+
+  static const char* names[] = { "async, block", "async, drop newest", "async, drop oldest" };
+  for (u32 policy = EV_LOG_OVERFLOW_BLOCK; policy <= EV_LOG_OVERFLOW_DROP_OLDEST; policy++) {
+    ev_log_start_async(4096, policy);
+    ns = run(&total_ms);
+    printf("  %-26s %8.1f ns/message in ev_log, %8.1f ms total, %llu dropped\n", names[policy], ns, total_ms,
+        ev_log_dropped_count());
+    ev_log_stop_async();
+  }
+
+  printf("One thread, bursts of %u messages\n", BURST);
+  printf("  %-26s %8.1f ns/message in ev_log\n", "synchronous", burst(false));
+  ev_log_start_async(BURST, EV_LOG_OVERFLOW_BLOCK);
+  printf("  %-26s %8.1f ns/message in ev_log\n", "async", burst(false));
+  ev_log_stop_async();
+  FILE* bin = tmpfile();
+  ev_binlog_start(bin);
+  printf("  %-26s %8.1f ns/message in ev_binlog\n", "binary", burst(true));
+  ev_binlog_stop();
+
+  fclose(bin);
+  fclose(fp);
+  return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define EV_STR_IMPLEMENTATION
+#include "ev_str.h"
+
+#define COUNT 2000000
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void report(const char *name, double ms)
+{
+  printf("  %-34s %8.2f ms (%6.2f M/s)\n", name, ms, COUNT / ms / 1e3);
+}
+
+int main()
+{
+  f64 *floats = malloc(COUNT * sizeof(f64));
+  i64 *ints = malloc(COUNT * sizeof(i64));
+  u64 state = 0x2545F4914F6CDD1Dull;
+  for(u32 i = 0; i < COUNT; i++) {
+    state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+    // Typical export data: coordinates and the like
+    floats[i] = (f64)(state >> 11) / (f64)(1ull << 53) * 2000.0 - 1000.0;
+    ints[i] = (i64)(state >> 20) - (i64)(1ull << 43);
+  }
+  printf("%u numbers\n", COUNT);
+
+  // %.17g is what round-trips with printf; the shortest output needs a loop
+  // over precisions, so it is not measured
+  evstring a = evstring_new("");
+  double start = now_ms();
+  for(u32 i = 0; i < COUNT; i++) {
+    evstring_push(&a, "%.17g\n", floats[i]);
+  }
+  report("f64, evstring_pushFmt(\"%.17g\")", now_ms() - start);
+
+  evstring b = evstring_new("");
+  start = now_ms();
+  for(u32 i = 0; i < COUNT; i++) {
+    evstring_pushF64(&b, floats[i]);
+    evstring_pushChar(&b, '\n');
+  }
+  report("f64, evstring_pushF64", now_ms() - start);
+
+  evstring_clear(&a);
+  start = now_ms();
+  for(u32 i = 0; i < COUNT; i++) {
+    evstring_push(&a, "%lld\n", ints[i]);
+  }
+  report("i64, evstring_pushFmt(\"%lld\")", now_ms() - start);
+
+  evstring c = evstring_new("");
+  start = now_ms();
+  for(u32 i = 0; i < COUNT; i++) {
+    evstring_pushI64(&c, ints[i]);
+    evstring_pushChar(&c, '\n');
+  }
+  report("i64, evstring_pushI64", now_ms() - start);
+  assert(evstring_cmp(a, c) == 0);
+
+  // Parse back the shortest representations
+  u64 len = evstring_getLength(b);
+  f64 sum_strtod = 0;
+  start = now_ms();
+  for(char *p = b; p < b + len;) {
+    char *end;
+    sum_strtod += strtod(p, &end);
+    p = end + 1;
+  }
+  report("f64, strtod", now_ms() - start);
+
+  f64 sum_parse = 0;
+  u32 parsed = 0;
+  start = now_ms();
+  for(u64 pos = 0; pos < len;) {
+    u64 nl = pos + ev_str_memchr(b + pos, len - pos, '\n');
+    f64 d;
+    evstring_view_parseF64((evstring_view) { .data = b, .offset = pos, .len = nl - pos }, &d);
+    assert(d == floats[parsed]);
+    sum_parse += d;
+    parsed++;
+    pos = nl + 1;
+  }
+  report("f64, evstring_view_parseF64", now_ms() - start);
+  assert(parsed == COUNT && sum_parse == sum_strtod);
+
+  evstring_free(a);
+  evstring_free(b);
+  evstring_free(c);
+  free(floats);
+  free(ints);
+  return 0;
+}
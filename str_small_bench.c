@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+static unsigned long long alloc_count;
+
+static void *counting_malloc(size_t size)
+{
+  alloc_count++;
+  return malloc(size);
+}
+
+static void *counting_realloc(void *p, size_t size)
+{
+  alloc_count++;
+  return realloc(p, size);
+}
+
+#define ev_str_malloc counting_malloc
+#define ev_str_realloc counting_realloc
+#define ev_str_free free
+#define EV_STR_IMPLEMENTATION
+#include "ev_str.h"
+
+#define NAME_COUNT 500000
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main()
+{
+  static char names[NAME_COUNT][16];
+  for(u32 i = 0; i < NAME_COUNT; i++) {
+    sprintf(names[i], "entity_%u", i);
+  }
+
+  evstring *heap = malloc(NAME_COUNT * sizeof(evstring));
+  memset(heap, 0xFF, NAME_COUNT * sizeof(evstring));
+  alloc_count = 0;
+  double start = now_ms();
+  for(u32 i = 0; i < NAME_COUNT; i++) {
+    heap[i] = evstring_new(names[i]);
+  }
+  double heap_ms = now_ms() - start;
+  unsigned long long heap_allocs = alloc_count;
+
+  evstring_small *storage = malloc(NAME_COUNT * sizeof(evstring_small));
+  evstring *small = malloc(NAME_COUNT * sizeof(evstring));
+  // The storage usually lives inside already existing objects, so it is
+  // faulted in before timing.
+  memset(storage, 0xFF, NAME_COUNT * sizeof(evstring_small));
+  memset(small, 0xFF, NAME_COUNT * sizeof(evstring));
+  alloc_count = 0;
+  start = now_ms();
+  for(u32 i = 0; i < NAME_COUNT; i++) {
+    small[i] = evstring_initSmall(&storage[i], names[i]);
+  }
+  double small_ms = now_ms() - start;
+  unsigned long long small_allocs = alloc_count;
+
+  printf("%u names (evstring_small capacity: %u)\n", NAME_COUNT, EV_STR_SMALL_CAPACITY);
+  printf("  evstring_new:       %8llu allocations, %7.2f ms\n", heap_allocs, heap_ms);
+  printf("  evstring_initSmall: %8llu allocations, %7.2f ms\n", small_allocs, small_ms);
+
+  for(u32 i = 0; i < NAME_COUNT; i++) {
+    evstring_free(heap[i]);
+    evstring_free(small[i]);
+  }
+  free(heap);
+  free(small);
+  free(storage);
+  return 0;
+}
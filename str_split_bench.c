@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define EV_STR_IMPLEMENTATION
+#define EV_STRSPLIT_IMPLEMENTATION
+#include "ev_strsplit.h"
+
+#define INPUT_SIZE (100ull * 1024 * 1024)
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void report(const char *name, u64 tokens, double loop_ms, double iter_ms)
+{
+  printf("  %-28s %9llu tokens   loop %8.2f ms (%5.2f GB/s)   iterator %8.2f ms (%5.2f GB/s)\n", name, tokens,
+      loop_ms, INPUT_SIZE / loop_ms / 1e6, iter_ms, INPUT_SIZE / iter_ms / 1e6);
+}
+
+// Fills `text` with words of about `word_len` letters, separated by `seps`
+static void generate(char *text, u64 word_len, const char *seps)
+{
+  u64 state = 0x9E3779B97F4A7C15ull;
+  u64 nseps = strlen(seps);
+  for(u64 i = 0; i < INPUT_SIZE; i++) {
+    state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+    text[i] = state % word_len == 0 ? seps[(state >> 32) % nseps] : (char)('a' + (state >> 8) % 26);
+  }
+}
+
+// Baselines that count the same tokens without building them: repeated
+// searches from the end of the previous token, and a bytewise set lookup
+static u64 loop_split(evstring text, char delim)
+{
+  u64 tokens = 0;
+  u64 pos = 0;
+  u64 len = evstring_getLength(text);
+  for(;;) {
+    tokens++;
+    u64 idx = ev_str_memchr(text + pos, len - pos, delim);
+    if(idx == EV_STR_NPOS) {
+      return tokens;
+    }
+    pos += idx + 1;
+  }
+}
+
+static u64 loop_split_any(evstring text, const char *set)
+{
+  u64 tokens = 1;
+  u64 len = evstring_getLength(text);
+  for(u64 i = 0; i < len; i++) {
+    tokens += strchr(set, text[i]) != NULL;
+  }
+  return tokens;
+}
+
+static u64 iter_count(evstring_split_iter it)
+{
+  u64 tokens = 0;
+  evstring_view token;
+  while(evstring_split_next(&it, &token)) {
+    tokens++;
+  }
+  return tokens;
+}
+
+int main()
+{
+  char *raw = malloc(INPUT_SIZE);
+  printf("%llu MB input\n", INPUT_SIZE / (1024 * 1024));
+
+  u64 word_lens[] = { 8, 60, 2000 };
+  for(u32 w = 0; w < sizeof(word_lens) / sizeof(word_lens[0]); w++) {
+    char name[64];
+
+    generate(raw, word_lens[w], ",");
+    evstring text = evstring_new_impl(raw, INPUT_SIZE);
+    double start = now_ms();
+    u64 a = loop_split(text, ',');
+    double loop_ms = now_ms() - start;
+    start = now_ms();
+    u64 b = iter_count(evstring_split_char(text, ','));
+    double iter_ms = now_ms() - start;
+    assert(a == b);
+    snprintf(name, sizeof(name), "char, ~%llu B tokens", word_lens[w]);
+    report(name, a, loop_ms, iter_ms);
+    evstring_free(text);
+
+    generate(raw, word_lens[w], " \t\r\n");
+    text = evstring_new_impl(raw, INPUT_SIZE);
+    start = now_ms();
+    a = loop_split_any(text, " \t\r\n");
+    loop_ms = now_ms() - start;
+    start = now_ms();
+    b = iter_count(evstring_split_any(text, " \t\r\n"));
+    iter_ms = now_ms() - start;
+    assert(a == b);
+    snprintf(name, sizeof(name), "whitespace, ~%llu B tokens", word_lens[w]);
+    report(name, a, loop_ms, iter_ms);
+    evstring_free(text);
+  }
+
+  free(raw);
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define EV_STR_IMPLEMENTATION
+#define EV_STRTABLE_IMPLEMENTATION
+#include "ev_strtable.h"
+
+#define NAME_COUNT 1000000
+#define ROUNDS 10
+
+// Cost of a heap block in a typical allocator: an 8-byte header, rounded up
+// to 16 bytes
+#define MALLOC_BLOCK(size) ((((size) + 8) + 15) & ~15ull)
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Symbol names like a compiler's or an engine's reflection data
+static void generate(char *buf, u32 i, u64 *state)
+{
+  static const char *modules[] = { "render", "physics", "audio", "ui", "net", "ecs" };
+  static const char *kinds[] = { "Transform", "Mesh", "update", "init", "Handle", "count" };
+  *state ^= *state << 13; *state ^= *state >> 7; *state ^= *state << 17;
+  sprintf(buf, "%s_%s_%u", modules[*state % 6], kinds[(*state >> 8) % 6], (u32)(*state >> 16) % (NAME_COUNT / 2) + i % 2);
+}
+
+int main()
+{
+  char buf[64];
+  evstring *names = malloc(NAME_COUNT * sizeof(evstring));
+  ev_strtable table;
+  ev_strtable_init(&table);
+
+  // Names are created while the program allocates other things, so they end
+  // up scattered across the heap
+  void **others = malloc(NAME_COUNT * sizeof(void *));
+  u64 state = 0x9E3779B97F4A7C15ull;
+  double start = now_ms();
+  for(u32 i = 0; i < NAME_COUNT; i++) {
+    generate(buf, i, &state);
+    names[i] = evstring_new(buf);
+    others[i] = malloc(16 + (state >> 32) % 256);
+  }
+  double evstring_build_ms = now_ms() - start;
+
+  state = 0x9E3779B97F4A7C15ull;
+  start = now_ms();
+  for(u32 i = 0; i < NAME_COUNT; i++) {
+    generate(buf, i, &state);
+    ev_strtable_push(&table, buf);
+  }
+  double table_build_ms = now_ms() - start;
+
+  u64 chars = 0;
+  u64 evstring_bytes = MALLOC_BLOCK(NAME_COUNT * sizeof(evstring));
+  for(u32 i = 0; i < NAME_COUNT; i++) {
+    chars += evstring_getLength(names[i]);
+    evstring_bytes += MALLOC_BLOCK(sizeof(struct evstr_meta_t) + evstring_getLength(names[i]) + 1);
+  }
+  u64 table_bytes = table.data_len + table.count * sizeof(u64);
+  printf("%u names, %.1f characters on average\n", NAME_COUNT, (double)chars / NAME_COUNT);
+  printf("  %-26s %10s %10s %10s\n", "", "evstring", "strtable", "ratio");
+  printf("  %-26s %9.1fM %9.1fM %9.2fx\n", "memory (bytes)", evstring_bytes / 1e6, table_bytes / 1e6,
+      (double)evstring_bytes / table_bytes);
+  printf("  %-26s %8.2fms %8.2fms %9.2fx\n", "build", evstring_build_ms, table_build_ms,
+      evstring_build_ms / table_build_ms);
+
+  // Sequential scans that read every character
+  ev_strview suffix = ev_strview_fromStr("Transform_1");
+  u64 evstring_hits = 0;
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    for(u32 i = 0; i < NAME_COUNT; i++) {
+      ev_strview name = evstring_toStrview(names[i]);
+      evstring_hits += ev_strview_endsWith(name, suffix) + (ev_strview_findChar(name, 'Z') != EV_STR_NPOS);
+    }
+  }
+  double evstring_scan_ms = now_ms() - start;
+
+  u64 table_hits = 0;
+  start = now_ms();
+  for(u32 r = 0; r < ROUNDS; r++) {
+    for(u32 i = 0; i < NAME_COUNT; i++) {
+      ev_strview name = ev_strtable_get(&table, i);
+      table_hits += ev_strview_endsWith(name, suffix) + (ev_strview_findChar(name, 'Z') != EV_STR_NPOS);
+    }
+  }
+  double table_scan_ms = now_ms() - start;
+  assert(evstring_hits == table_hits);
+  printf("  %-26s %8.2fms %8.2fms %9.2fx (%.2f GB/s)\n", "scan", evstring_scan_ms / ROUNDS, table_scan_ms / ROUNDS,
+      evstring_scan_ms / table_scan_ms, table_bytes * (double)ROUNDS / table_scan_ms / 1e6);
+
+  start = now_ms();
+  qsort(names, NAME_COUNT, sizeof(evstring), evstring_order_qsort);
+  double evstring_sort_ms = now_ms() - start;
+  start = now_ms();
+  ev_strtable_sort(&table);
+  double table_sort_ms = now_ms() - start;
+  for(u32 i = 0; i < NAME_COUNT; i++) {
+    assert(ev_strview_eq(evstring_toStrview(names[i]), ev_strtable_get(&table, i)));
+  }
+  printf("  %-26s %8.2fms %8.2fms %9.2fx\n", "sort", evstring_sort_ms, table_sort_ms,
+      evstring_sort_ms / table_sort_ms);
+
+  start = now_ms();
+  ev_strtable_dedupe(&table);
+  printf("  %-26s %10s %8.2fms (%llu unique)\n", "dedupe", "", now_ms() - start, ev_strtable_count(&table));
+
+  for(u32 i = 0; i < NAME_COUNT; i++) {
+    evstring_free(names[i]);
+    free(others[i]);
+  }
+  free(names);
+  free(others);
+  ev_strtable_fini(&table);
+  return 0;
+}
@@ -3,6 +3,54 @@
 
 evstring global_str = evstr("Global 'Hello, World!'");
 
+static struct { u32 allocs, reallocs, frees; i32 live; } alloc_counts;
+
+static void *counting_alloc(void *ctx, u64 size)
+{
+  (void)ctx;
+  alloc_counts.allocs++;
+  alloc_counts.live++;
+  return malloc(size);
+}
+
+static void *counting_realloc(void *ctx, void *ptr, u64 used, u64 new_size)
+{
+  (void)ctx;
+  (void)used;
+  alloc_counts.reallocs++;
+  return realloc(ptr, new_size);
+}
+
+static void counting_free(void *ctx, void *ptr)
+{
+  (void)ctx;
+  alloc_counts.frees++;
+  alloc_counts.live--;
+  free(ptr);
+}
+
+// Strings allocated with these can never grow
+static void *plain_alloc(void *ctx, u64 size)
+{
+  (void)ctx;
+  return malloc(size);
+}
+
+static void plain_free(void *ctx, void *ptr)
+{
+  (void)ctx;
+  free(ptr);
+}
+
+static void *failing_realloc(void *ctx, void *ptr, u64 used, u64 new_size)
+{
+  (void)ctx;
+  (void)ptr;
+  (void)used;
+  (void)new_size;
+  return NULL;
+}
+
 int main()
 {
   const evstring stack_str = evstr("Stack 'Hello, World!'");
@@ -77,5 +125,793 @@ int main()
     evstring_free(heap_str);
   }
 
+  { // Formatting into spare capacity
+    evstring s = evstring_new("");
+    assert(evstring_reserve(&s, 64) == EV_STR_ERR_NONE);
+    assert(evstring_getSpace(s) >= 64);
+    evstring before = s;
+    for(u32 i = 0; i < 8; i++) {
+      assert(evstring_push(&s, "%u,", i) == EV_STR_ERR_NONE);
+    }
+    assert(s == before); // No reallocation
+    assert(strcmp(s, "0,1,2,3,4,5,6,7,") == 0);
+    assert(evstring_getLength(s) == 16);
+
+    // Output that does not fit is formatted again after growing
+    char big[1000];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    assert(evstring_push(&s, "[%s]", big) == EV_STR_ERR_NONE);
+    assert(evstring_getLength(s) == 16 + 1001);
+    assert(s[16] == '[' && s[1016] == ']' && s[1017] == '\0');
+
+    u64 hash = evstring_hash(s);
+    evstring_push(&s, "%d", 1);
+    assert(evstring_hash(s) != hash);
+
+    evstring long_fmt = evstring_new("%s%s", big, "!");
+    assert(evstring_getLength(long_fmt) == 1000);
+    assert(long_fmt[999] == '!' && long_fmt[1000] == '\0');
+
+    evstring_free(long_fmt);
+    evstring_free(s);
+  }
+
+  { // Numbers
+    evstring s = evstring_new("");
+    evstring_pushNum(&s, (i32)-42);
+    evstring_pushChar(&s, ' ');
+    evstring_pushNum(&s, (u64)18446744073709551615ull);
+    evstring_pushChar(&s, ' ');
+    evstring_pushNum(&s, (i64)(-9223372036854775807LL - 1));
+    evstring_pushChar(&s, ' ');
+    evstring_pushNum(&s, 0.1);
+    evstring_pushChar(&s, ' ');
+    evstring_pushNum(&s, 0.1f);
+    evstring_pushChar(&s, ' ');
+    evstring_pushNum(&s, -1234.5);
+    evstring_pushChar(&s, ' ');
+    evstring_pushNum(&s, 1e21);
+    evstring_pushChar(&s, ' ');
+    evstring_pushNum(&s, 2.5e-7);
+    evstring_pushChar(&s, ' ');
+    evstring_pushNum(&s, 5e-324);
+    evstring_pushChar(&s, ' ');
+    evstring_pushNum(&s, -0.0);
+    assert(strcmp(s, "-42 18446744073709551615 -9223372036854775808 0.1 0.1 -1234.5 1e+21 2.5e-7 5e-324 -0") == 0);
+
+    i64 i;
+    u64 u;
+    f64 d;
+    assert(evstring_view_parseI64(evstring_slice(evstr("-9223372036854775808"), 0, -1), &i) == EV_STR_ERR_NONE);
+    assert(i == -9223372036854775807LL - 1);
+    assert(evstring_view_parseI64(evstring_slice(evstr("9223372036854775808"), 0, -1), &i) == EV_STR_ERR_RANGE);
+    assert(evstring_view_parseU64(evstring_slice(evstr("18446744073709551616"), 0, -1), &u) == EV_STR_ERR_RANGE);
+    assert(evstring_view_parseI64(evstring_slice(evstr("12a"), 0, -1), &i) == EV_STR_ERR_PARSE);
+    assert(evstring_view_parseI64(evstring_slice(evstr("-"), 0, -1), &i) == EV_STR_ERR_PARSE);
+    // Views stop where they end, not at a terminator
+    assert(evstring_view_parseI64(evstring_slice(evstr("1234x"), 1, 3), &i) == EV_STR_ERR_NONE);
+    assert(i == 23);
+
+    assert(evstring_view_parseF64(evstring_slice(evstr("-1234.5e-3"), 0, -1), &d) == EV_STR_ERR_NONE);
+    assert(d == -1.2345);
+    assert(evstring_view_parseF64(evstring_slice(evstr("2.2250738585072011e-308"), 0, -1), &d) == EV_STR_ERR_NONE);
+    assert(d == 2.2250738585072011e-308);
+    assert(evstring_view_parseF64(evstring_slice(evstr("1e400"), 0, -1), &d) == EV_STR_ERR_NONE);
+    assert(d > 1.7976931348623157e308);
+    // Inputs that need an exact conversion: halfway cases, long mantissas,
+    // subnormals and the edges of the range
+    const char *exact[] = {
+      "9007199254740993", "9007199254740993.000000000000000000001", "9007199254740995",
+      "1.2345678901234567890123", "0.1000000000000000055511151231257827021181583404541015625",
+      "2.4703282292062327e-324", "2.4703282292062328e-324", "4.9406564584124654e-324",
+      "2.2250738585072012e-308", "2.2250738585072011e-308", "1.7976931348623157e308",
+      "1.7976931348623158e308", "1.7976931348623159e308", "0.000000000000000000000000000000000000001e-290",
+      "123456789012345678901234567890e-40", "-7.4109846876186982e-323",
+    };
+    for(u32 n = 0; n < sizeof(exact) / sizeof(exact[0]); n++) {
+      assert(ev_strview_parseF64(ev_strview_fromStr(exact[n]), &d) == EV_STR_ERR_NONE);
+      assert(memcmp(&d, &(f64) { strtod(exact[n], NULL) }, sizeof(d)) == 0);
+    }
+    // A digit that decides the rounding, past the ones that are kept exactly
+    char halfway[1024] = "9007199254740993.";
+    memset(halfway + 17, '0', 1000);
+    halfway[1017] = '1';
+    halfway[1018] = '\0';
+    assert(ev_strview_parseF64(ev_strview_fromStr(halfway), &d) == EV_STR_ERR_NONE);
+    assert(d == 9007199254740994.0 && strtod(halfway, NULL) == d);
+
+    char digits[96];
+    u64 seed = 0x2545F4914F6CDD1Dull;
+    for(u32 n = 0; n < 20000; n++) {
+      u32 len = 0;
+      seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+      u32 count = 17 + (u32)(seed % 40);
+      u32 dot = (u32)(seed >> 8) % count;
+      for(u32 i = 0; i < count; i++) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        if(i == dot) {
+          digits[len++] = '.';
+        }
+        // Long runs of 0 and 9 land near halfway cases
+        digits[len++] = (seed & 3) == 0 ? '0' : (seed & 3) == 1 ? '9' : (char)('0' + (seed >> 2) % 10);
+      }
+      len += (u32)snprintf(digits + len, sizeof(digits) - len, "e%d", (i32)((seed >> 20) % 660) - 340);
+      assert(ev_strview_parseF64(ev_strview_from(digits, len), &d) == EV_STR_ERR_NONE);
+      assert(memcmp(&d, &(f64) { strtod(digits, NULL) }, sizeof(d)) == 0);
+    }
+    assert(evstring_view_parseF64(evstring_slice(evstr("1.5e"), 0, -1), &d) == EV_STR_ERR_PARSE);
+    assert(evstring_view_parseF64(evstring_slice(evstr("."), 0, -1), &d) == EV_STR_ERR_PARSE);
+
+    // Formatting and parsing round-trip
+    u64 state = 0x9E3779B97F4A7C15ull;
+    for(u32 n = 0; n < 100000; n++) {
+      state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+      f64 x;
+      memcpy(&x, &state, sizeof(x));
+      if(x != x || x - x != 0) { // NaN or infinity
+        continue;
+      }
+      evstring_clear(&s);
+      evstring_pushF64(&s, x);
+      assert(evstring_view_parseF64(evstring_slice(s, 0, -1), &d) == EV_STR_ERR_NONE);
+      assert(d == x);
+      assert(strtod(s, NULL) == x);
+    }
+
+    evstring_free(s);
+  }
+
+  { // Hash caching
+    evstring a = evstring_new("component");
+    evstring b = evstring_new("component");
+    u64 hash = evstring_hash(a);
+    assert(hash == ev_hash_murmur3("component", 9, EV_STR_HASH_SEED));
+    assert(evstring_hash(a) == hash);
+    assert(EV_HASH(evstring)(&a, EV_STR_HASH_SEED) == hash);
+    assert(evstring_hash(b) == hash);
+    assert(evstring_cmp(a, b) == 0);
+
+    evstring_push(&a, (char)'s');
+    assert(evstring_hash(a) == ev_hash_murmur3("components", 10, EV_STR_HASH_SEED));
+    evstring_setLength(&a, 9);
+    assert(evstring_hash(a) == hash);
+    evstring_clear(&a);
+    assert(evstring_hash(a) == ev_hash_murmur3("", 0, EV_STR_HASH_SEED));
+
+    // Same length, both hashes cached, different content
+    evstring c = evstring_new("componenT");
+    evstring_hash(c);
+    assert(evstring_cmp(b, c) != 0);
+
+    evstring_free(a);
+    evstring_free(b);
+    evstring_free(c);
+  }
+
+  { // Small strings
+    evstring_small storage;
+    evstring small = evstring_initSmall(&storage, "Transform");
+    assert(small == storage.data);
+    assert(evstring_getLength(small) == 9);
+    assert(evstring_cmp(small, evstr("Transform")) == 0);
+
+    assert(evstring_push(&small, "Comp") == EV_STR_ERR_NONE);
+    assert(small == storage.data); // Still fits
+    assert(strcmp(small, "TransformComp") == 0);
+
+    assert(evstring_push(&small, "onent_%d", 12345) == EV_STR_ERR_NONE);
+    assert(small != storage.data); // Promoted to the heap
+    assert(strcmp(small, "TransformComponent_12345") == 0);
+    assert(evstring_getLength(small) == 24);
+    evstring_free(small);
+
+    evstring too_long = evstring_initSmall(&storage, "a string that does not fit inline");
+    assert(too_long != storage.data);
+    evstring_free(too_long);
+
+    evstring tmp = evstring_newSmall("tmp");
+    evstring_push(&tmp, (char)'!');
+    assert(strcmp(tmp, "tmp!") == 0);
+    evstring_free(tmp);
+  }
+
+  { // Search
+    // A partial match must not consume the characters of the real one
+    evstring_view v = evstring_findFirst(evstr("aaab"), evstr("aab"));
+    assert(v.len == 3 && v.offset == 1);
+    v = evstring_findFirst(evstr("abcabd"), evstr("abd"));
+    assert(v.len == 3 && v.offset == 3);
+    v = evstring_findFirst(evstr("abc"), evstr("abcd"));
+    assert(v.len == 0);
+    v = evstring_findFirst(evstr(""), evstr("a"));
+    assert(v.len == 0);
+
+    // Matches at the very end, and across SIMD block boundaries
+    evstring long_str = evstring_new("");
+    for(u32 i = 0; i < 100; i++) {
+      evstring_push(&long_str, "0123456789abcdef_");
+    }
+    evstring_push(&long_str, "needle");
+    v = evstring_findFirst(long_str, evstr("needle"));
+    assert(v.len == 6 && v.offset == 1700);
+    v = evstring_findFirst(long_str, evstr("f_0123456789abcdef_0"));
+    assert(v.len == 20 && v.offset == 15);
+    assert(evstring_findAll(long_str, evstr("_0"), NULL) == 99);
+    assert(evstring_findAll(long_str, evstr("needle"), NULL) == 1);
+
+    assert(evstring_findFirstChar(long_str, 'n') == 1700);
+    assert(evstring_findLastChar(long_str, 'e') == 1705);
+    assert(evstring_findLastChar(long_str, '_') == 1699);
+    assert(evstring_findFirstChar(long_str, 'z') == -1);
+    assert(evstring_findLastChar(long_str, 'z') == -1);
+
+    // Periodic needle that defeats the first/last byte filter
+    evstring periodic = evstring_new("");
+    for(u32 i = 0; i < 4096; i++) {
+      evstring_push(&periodic, (char)'a');
+    }
+    evstring needle = evstring_new("");
+    for(u32 i = 0; i < 300; i++) {
+      evstring_push(&needle, (char)'a');
+    }
+    evstring_push(&needle, "ba");
+    assert(evstring_findFirst(periodic, needle).len == 0);
+    evstring_push(&periodic, "ba");
+    v = evstring_findFirst(periodic, needle);
+    assert(v.len == 302 && v.offset == 4096 - 300);
+
+    evstring_free(needle);
+    evstring_free(periodic);
+    evstring_free(long_str);
+  }
+
+  { // Replacement
+    evstring text = evstring_new("a-b-c-d");
+    evstring r = evstring_replaceFirst(text, evstr("-"), evstr("--"));
+    assert(strcmp(r, "a--b-c-d") == 0 && evstring_getLength(r) == 8);
+    evstring_free(r);
+
+    r = evstring_replaceAll(text, evstr("-"), evstr(", "));
+    assert(strcmp(r, "a, b, c, d") == 0 && evstring_getLength(r) == 10);
+    evstring_free(r);
+
+    r = evstring_replaceAll(text, evstr("-"), evstr(""));
+    assert(strcmp(r, "abcd") == 0);
+    evstring_free(r);
+
+    r = evstring_replaceAll(text, evstr("x"), evstr("y"));
+    assert(strcmp(r, text) == 0 && r != text);
+    evstring_free(r);
+
+    // Non-overlapping, left to right
+    r = evstring_replaceAll(evstr("aaaaa"), evstr("aa"), evstr("b"));
+    assert(strcmp(r, "bba") == 0);
+    evstring_free(r);
+
+    // Replacements are not searched again, and earlier pairs win ties
+    r = evstring_replaceMany(evstr("<a & b>"), (evstring_replace_pair[]) {
+        { evstr("&"), evstr("&amp;") },
+        { evstr("<"), evstr("&lt;") },
+        { evstr(">"), evstr("&gt;") },
+    }, 3);
+    assert(strcmp(r, "&lt;a &amp; b&gt;") == 0);
+    evstring_free(r);
+    r = evstring_replaceMany(evstr("abcd"), (evstring_replace_pair[]) {
+        { evstr("bc"), evstr("1") },
+        { evstr("b"), evstr("2") },
+        { evstr("abc"), evstr("3") },
+    }, 3);
+    assert(strcmp(r, "3d") == 0);
+    evstring_free(r);
+
+    // More matches than are remembered during the first pass
+    evstring many = evstring_new("");
+    evstring expected = evstring_new("");
+    for(u32 i = 0; i < 1000; i++) {
+      evstring_push(&many, "x=%u;", i);
+      evstring_push(&expected, "x := %u\n", i);
+    }
+    r = evstring_replaceMany(many, (evstring_replace_pair[]) {
+        { evstr("="), evstr(" := ") },
+        { evstr(";"), evstr("\n") },
+    }, 2);
+    assert(evstring_cmp(r, expected) == 0);
+    evstring_free(r);
+
+    // In place: same length, shorter, and longer
+    evstring_replaceAllInPlace(&many, evstr("x"), evstr("y"));
+    assert(evstring_findFirstChar(many, 'x') == -1);
+    evstring_replaceAllInPlace(&many, evstr("y="), evstr(""));
+    evstring_replaceAllInPlace(&many, evstr(";"), evstr(" := ... \n"));
+    evstring_replaceAllInPlace(&expected, evstr("x := "), evstr(""));
+    evstring_replaceAllInPlace(&expected, evstr("\n"), evstr(" := ... \n"));
+    assert(evstring_cmp(many, expected) == 0);
+    assert(evstring_hash(many) == evstring_hash(expected));
+
+    // Overlapping candidates and matches at both ends
+    evstring grown = evstring_new("aaaXaaa");
+    assert(evstring_replaceAllInPlace(&grown, evstr("aa"), evstr("<aa>")) == EV_STR_ERR_NONE);
+    assert(strcmp(grown, "<aa>aX<aa>a") == 0);
+    assert(evstring_replaceAllInPlace(&grown, evstr("none"), evstr("longer")) == EV_STR_ERR_NONE);
+    assert(strcmp(grown, "<aa>aX<aa>a") == 0);
+    evstring_free(grown);
+
+    // Arguments that are the string itself
+    grown = evstring_new("abab");
+    evstring a = evstring_new("a");
+    assert(evstring_replaceAllInPlace(&grown, a, grown) == EV_STR_ERR_NONE);
+    assert(strcmp(grown, "ababbababb") == 0);
+    assert(evstring_replaceAllInPlace(&grown, grown, a) == EV_STR_ERR_NONE);
+    assert(strcmp(grown, "a") == 0);
+    evstring_free(a);
+    evstring_free(grown);
+
+    // A string that cannot grow is left unchanged
+    evstring_allocator failing = {
+      .alloc = plain_alloc,
+      .realloc = failing_realloc,
+      .free = plain_free,
+    };
+    evstring_allocator_set(&failing);
+    evstring fixed = evstring_new("a;b");
+    evstring_allocator_set(NULL);
+    assert(evstring_replaceAllInPlace(&fixed, evstr(";"), evstr(", ")) == EV_STR_ERR_OOM);
+    assert(strcmp(fixed, "a;b") == 0);
+    assert(evstring_replaceAllInPlace(&fixed, evstr(";"), evstr("")) == EV_STR_ERR_NONE);
+    assert(strcmp(fixed, "ab") == 0);
+    evstring_free(fixed);
+
+    evstring_free(expected);
+    evstring_free(many);
+    evstring_free(text);
+  }
+
+  { // Views over arbitrary memory
+    // Not null-terminated, not owned by an evstring
+    const char raw[] = { 'k', 'e', 'y', ' ', '=', ' ', ' ', '4', '2', '\n', 'X' };
+    ev_strview line = ev_strview_from(raw, 10);
+    ev_strview key, value;
+    assert(ev_strview_cut(line, '=', &key, &value));
+    assert(ev_strview_eq(ev_strview_trim(key), ev_strview_fromStr("key")));
+    i64 n;
+    assert(ev_strview_parseI64(ev_strview_trim(value), &n) == EV_STR_ERR_NONE && n == 42);
+    assert(ev_strview_parseI64(value, &n) == EV_STR_ERR_PARSE);
+    assert(!ev_strview_cut(key, '=', &key, &value) && value.len == 0);
+
+    ev_strview rest = ev_strview_fromStr("a,bc,,d"), field;
+    const char *expected[] = { "a", "bc", "", "d" };
+    u32 count = 0;
+    while(ev_strview_split(&rest, ',', &field)) {
+      assert(ev_strview_eq(field, ev_strview_fromStr(expected[count])));
+      count++;
+    }
+    assert(count == 4);
+    rest = ev_strview_fromStr("");
+    assert(ev_strview_split(&rest, ',', &field) && field.len == 0);
+    assert(!ev_strview_split(&rest, ',', &field));
+
+    ev_strview text = ev_strview_fromStr("the cat sat on the mat");
+    assert(ev_strview_find(text, ev_strview_fromStr("the")) == 0);
+    assert(ev_strview_find(ev_strview_slice(text, 1, text.len), ev_strview_fromStr("the")) == 14);
+    assert(ev_strview_find(text, ev_strview_fromStr("dog")) == EV_STR_NPOS);
+    assert(ev_strview_findChar(text, 'a') == 5);
+    assert(ev_strview_findLastChar(text, 'a') == 20);
+    assert(ev_strview_findChar(ev_strview_slice(text, 0, 5), 'a') == EV_STR_NPOS);
+
+    assert(ev_strview_cmp(ev_strview_fromStr("abc"), ev_strview_fromStr("abd")) < 0);
+    assert(ev_strview_cmp(ev_strview_fromStr("ab"), ev_strview_fromStr("abc")) < 0);
+    assert(ev_strview_cmp(ev_strview_fromStr("\xff"), ev_strview_fromStr("a")) > 0);
+    assert(ev_strview_cmp(ev_strview_from(NULL, 0), ev_strview_fromStr("")) == 0);
+    assert(ev_strview_trim(ev_strview_fromStr(" \t\r\n ")).len == 0);
+    assert(ev_strview_eq(ev_strview_trimLeft(ev_strview_fromStr("  x ")), ev_strview_fromStr("x ")));
+    assert(ev_strview_eq(ev_strview_trimRight(ev_strview_fromStr("  x ")), ev_strview_fromStr("  x")));
+
+    f64 d;
+    assert(ev_strview_parseF64(ev_strview_from("2.5e3xyz", 5), &d) == EV_STR_ERR_NONE && d == 2500);
+
+    // Accepted by the generic constructors
+    evstring s = evstring_new(ev_strview_from(raw, 3));
+    assert(strcmp(s, "key") == 0);
+    evstring_push(&s, ev_strview_from(raw + 3, 6));
+    assert(strcmp(s, "key =  42") == 0);
+    assert(ev_strview_eq(evstring_toStrview(s), ev_strview_fromStr("key =  42")));
+    assert(ev_strview_eq(evstring_view_toStrview(evstring_slice(s, 0, 3)), ev_strview_fromStr("key")));
+    evstring_free(s);
+  }
+
+  { // Ordering and case-insensitive comparison
+    evstring a = evstring_new("assets/textures/Grass.png");
+    evstring b = evstring_new("assets/textures/grass.PNG");
+    assert(evstring_cmp(a, b) != 0);
+    assert(evstring_order(a, b) < 0);
+    assert(evstring_order(b, a) > 0);
+    assert(evstring_order(a, a) == 0);
+    assert(evstring_eq_icase(a, b));
+    assert(evstring_order_icase(a, b) == 0);
+    assert(evstring_startsWith(a, "assets/"));
+    assert(evstring_startsWith(a, ""));
+    assert(!evstring_startsWith(a, "assets/textures/Grass.png!"));
+    assert(evstring_endsWith(a, ".png"));
+    assert(!evstring_endsWith(b, ".png"));
+    assert(evstring_endsWith(b, ev_strview_fromStr(".PNG")));
+
+    // Views and evstrings in any combination
+    evstring_view dir = evstring_slice(a, 0, 15);
+    assert(evstring_order(dir, a) < 0);
+    assert(evstring_order(a, dir) > 0);
+    assert(evstring_order(dir, ev_strview_fromStr("assets/textures")) == 0);
+    assert(evstring_startsWith(a, dir));
+    assert(evstring_startsWith(dir, "assets"));
+    assert(evstring_endsWith(dir, evstring_slice(b, 7, 15)));
+    assert(evstring_eq_icase(ev_strview_fromStr("ASSETS/TEXTURES"), dir));
+    assert(evstring_order_icase(ev_strview_fromStr("ASSETS/TEXTURES/h"), a) > 0);
+
+    // Only ASCII letters are folded, and bytes order as unsigned
+    assert(!evstring_eq_icase(ev_strview_fromStr("@[`{"), ev_strview_fromStr("`{@[")));
+    assert(!evstring_eq_icase(ev_strview_fromStr("\xC9"), ev_strview_fromStr("\xE9")));
+    assert(evstring_order(ev_strview_fromStr("\x80"), ev_strview_fromStr("\x7f")) > 0);
+    // Letters fold to lowercase, so '_' orders before them
+    assert(evstring_order_icase(ev_strview_fromStr("_"), ev_strview_fromStr("A")) < 0);
+
+    // Random strings around the SIMD block sizes, against a bytewise reference
+    char x[100], y[100];
+    u64 state = 12345;
+    for(u32 round = 0; round < 20000; round++) {
+      state = state * 6364136223846793005ull + 1442695040888963407ull;
+      u32 xlen = (state >> 33) % 100;
+      u32 ylen = round % 3 == 0 ? xlen : (u32)((state >> 45) % 100);
+      for(u32 i = 0; i < 100; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        // Mostly equal bytes, some in the other case, some different
+        x[i] = (char)('A' + i % 26 + ((state >> 40) % 2) * 32);
+        y[i] = (char)('A' + i % 26 + ((state >> 41) % 2) * 32);
+        if((state >> 50) % 200 == 0) {
+          y[i] = (char)(state >> 20);
+        }
+      }
+      ev_strview vx = ev_strview_from(x, xlen), vy = ev_strview_from(y, ylen);
+
+      i32 expected = 0, expected_icase = 0;
+      u32 common = xlen < ylen ? xlen : ylen;
+      for(u32 i = 0; i < common && expected == 0; i++) {
+        expected = (u8)x[i] - (u8)y[i];
+      }
+      for(u32 i = 0; i < common && expected_icase == 0; i++) {
+        expected_icase = (u8)__ev_str_tolower(x[i]) - (u8)__ev_str_tolower(y[i]);
+      }
+      if(expected == 0) {
+        expected = (i32)xlen - (i32)ylen;
+      }
+      if(expected_icase == 0) {
+        expected_icase = (i32)xlen - (i32)ylen;
+      }
+      assert((evstring_order(vx, vy) > 0) == (expected > 0));
+      assert((evstring_order(vx, vy) < 0) == (expected < 0));
+      assert((evstring_order_icase(vx, vy) > 0) == (expected_icase > 0));
+      assert((evstring_order_icase(vx, vy) < 0) == (expected_icase < 0));
+      assert(evstring_eq_icase(vx, vy) == (expected_icase == 0));
+      assert(evstring_startsWith(vx, vy) == (ylen <= xlen && memcmp(x, y, ylen) == 0));
+      assert(evstring_endsWith(vx, ev_strview_slice(vx, xlen - common, xlen)));
+    }
+
+    // Sorting evstrings with qsort
+    evstring names[] = { evstring_new("b/c"), evstring_new("a"), evstring_new("b"), evstring_new("ab"), evstring_new("") };
+    qsort(names, 5, sizeof(evstring), evstring_order_qsort);
+    assert(strcmp(names[0], "") == 0);
+    assert(strcmp(names[1], "a") == 0);
+    assert(strcmp(names[2], "ab") == 0);
+    assert(strcmp(names[3], "b") == 0);
+    assert(strcmp(names[4], "b/c") == 0);
+    for(u32 i = 0; i < 5; i++) {
+      evstring_free(names[i]);
+    }
+    evstring_free(a);
+    evstring_free(b);
+  }
+
+  { // Allocators
+    assert(evstring_allocator_get() == NULL);
+
+    // Every string goes back to the allocator that created it
+    evstring_allocator counting = {
+      .alloc = counting_alloc,
+      .realloc = counting_realloc,
+      .free = counting_free,
+      .ctx = &alloc_counts,
+    };
+    assert(evstring_allocator_set(&counting) == NULL);
+    assert(evstring_allocator_get() == &counting);
+    evstring s = evstring_new("counted");
+    evstring f = evstring_new("%d-%s", 42, "fmt");
+    evstring_small storage;
+    evstring small = evstring_initSmall(&storage, "small");
+    assert(evstring_allocator_set(NULL) == &counting);
+    assert(alloc_counts.allocs == 2);
+
+    evstring heap = evstring_new("heap");
+    for(u32 i = 0; i < 100; i++) {
+      evstring_push(&s, "0123456789");
+    }
+    assert(alloc_counts.reallocs > 0);
+    assert(evstring_getLength(s) == 1007);
+    assert(memcmp(s, "counted0123456789", 17) == 0);
+
+    // Moved to the allocator that is current when it outgrows its storage
+    evstring_allocator_set(&counting);
+    evstring_push(&small, " string that no longer fits inline");
+    evstring_allocator_set(NULL);
+    assert(alloc_counts.allocs == 3);
+    assert(strcmp(small, "small string that no longer fits inline") == 0);
+
+    // Clearing a shared string allocates an empty one from the same allocator,
+    // while no allocator is current
+    evstring shared = evstring_share(s);
+    evstring_clear(&shared);
+    assert(shared != s && evstring_getLength(shared) == 0 && shared[0] == '\0');
+    assert(alloc_counts.allocs == 4 && evstring_getLength(s) == 1007);
+    assert(!evstring_isShared(s));
+    evstring_push(&shared, "pushed");
+    assert(strcmp(shared, "pushed") == 0);
+    evstring_free(shared);
+
+    evstring_free(s);
+    evstring_free(f);
+    evstring_free(small);
+    evstring_free(heap);
+    assert(alloc_counts.frees == 4);
+    assert(alloc_counts.live == 0);
+
+    // Arena strings grow in place while they are the last allocation
+    evstring_arena arena;
+    evstring_arena_init(&arena, 256);
+    evstring_allocator_set(&arena.allocator);
+    evstring a = evstring_new("a");
+    evstring a_before = a;
+    for(u32 i = 0; i < 10; i++) {
+      evstring_push(&a, (char)'a');
+    }
+    assert(a == a_before);
+    assert(strcmp(a, "aaaaaaaaaaa") == 0);
+
+    // Until another string is allocated after it
+    evstring b = evstring_new("b");
+    for(u32 i = 0; i < 20; i++) {
+      evstring_push(&a, (char)'a');
+    }
+    assert(a != a_before);
+    assert(evstring_getLength(a) == 31);
+    assert(strcmp(b, "b") == 0);
+
+    // Strings larger than a block get one of their own
+    evstring big = evstring_new("");
+    for(u32 i = 0; i < 100; i++) {
+      evstring_push(&big, "0123456789");
+    }
+    assert(evstring_getLength(big) == 1000);
+    assert(arena.blocks->size >= 1000);
+    evstring_allocator_set(NULL);
+
+    // Freeing is a no-op, and the arena still owns the memory
+    evstring_free(b);
+    assert(strcmp(b, "b") == 0);
+    evstring_free(a);
+    evstring_free(big);
+
+    struct evstring_arena_block *kept = arena.blocks;
+    evstring_arena_reset(&arena);
+    assert(arena.blocks == kept && arena.blocks->next == NULL && arena.blocks->used == 0);
+    evstring_allocator_set(&arena.allocator);
+    evstring c = evstring_new("reused");
+    evstring_allocator_set(NULL);
+    assert(c >= kept->data && c < kept->data + kept->size);
+    evstring_arena_fini(&arena);
+    assert(arena.blocks == NULL);
+  }
+
+  { // Shared strings
+    evstring s = evstring_new("shared text");
+    assert(!evstring_isShared(s));
+    evstring a = evstring_share(s);
+    evstring b = evstring_share(s);
+    assert(a == s && b == s);
+    assert(evstring_isShared(s));
+
+    // Modifying one owner gives it a private copy
+    assert(evstring_push(&a, " and more") == EV_STR_ERR_NONE);
+    assert(a != s);
+    assert(strcmp(a, "shared text and more") == 0);
+    assert(strcmp(s, "shared text") == 0);
+    assert(!evstring_isShared(a));
+
+    evstring_clear(&b);
+    assert(b != s && evstring_getLength(b) == 0);
+    // Nothing was copied
+    assert(evstring_getSpace(b) < evstring_getLength(s));
+    assert(strcmp(s, "shared text") == 0);
+    assert(!evstring_isShared(s));
+    evstring_free(a);
+    evstring_free(b);
+
+    evstring c = evstring_share(s);
+    assert(evstring_replaceAllInPlace(&c, evstr("none"), evstr("")) == EV_STR_ERR_NONE);
+    assert(evstring_replaceAllInPlace(&c, evstr("none"), evstr("longer")) == EV_STR_ERR_NONE);
+    assert(c == s);
+    assert(evstring_replaceAllInPlace(&c, evstr("text"), evstr("txt")) == EV_STR_ERR_NONE);
+    assert(strcmp(c, "shared txt") == 0 && strcmp(s, "shared text") == 0);
+    evstring_free(c);
+
+    c = evstring_share(s);
+    assert(evstring_detach(&c) == EV_STR_ERR_NONE);
+    assert(c != s && strcmp(c, "shared text") == 0);
+    c[0] = 'S';
+    assert(s[0] == 's');
+    evstring_free(c);
+    assert(evstring_detach(&s) == EV_STR_ERR_NONE);
+
+#if EV_STR_CACHE_HASH
+    // The hash cache is not written while other owners may read the string
+    c = evstring_share(s);
+    assert(evstring_hash(c) == ev_hash_murmur3(s, (u32)evstring_getLength(s), EV_STR_HASH_SEED));
+    assert(!META(s)->hashValid);
+    evstring_free(c);
+    evstring_hash(s);
+    assert(META(s)->hashValid);
+#endif
+
+    // Copying through the type data shares the string
+    evstring copy;
+    TypeData(evstring).copy_fn(&copy, &s);
+    assert(copy == s);
+    evstring_free(copy);
+    evstring_free(s);
+
+    // The last owner frees it
+    evstring_allocator counting = {
+      .alloc = counting_alloc,
+      .realloc = counting_realloc,
+      .free = counting_free,
+    };
+    alloc_counts.allocs = alloc_counts.frees = 0;
+    evstring_allocator_set(&counting);
+    s = evstring_new("counted");
+    evstring_allocator_set(NULL);
+    evstring owners[16];
+    for(u32 i = 0; i < 16; i++) {
+      owners[i] = evstring_share(s);
+    }
+    evstring_free(s);
+    for(u32 i = 0; i < 16; i++) {
+      assert(alloc_counts.frees == 0);
+      evstring_free(owners[i]);
+    }
+    assert(alloc_counts.allocs == 1 && alloc_counts.frees == 1);
+
+    // Strings that do not own their memory are copied
+    evstring lit = evstr("literal");
+    evstring lit_copy = evstring_share(lit);
+    assert(lit_copy != lit && strcmp(lit_copy, "literal") == 0);
+    evstring_free(lit_copy);
+
+    evstring_small storage;
+    evstring small = evstring_initSmall(&storage, "small");
+    evstring small_copy = evstring_share(small);
+    assert(small_copy != small && !evstring_isShared(small));
+    evstring_push(&small_copy, (char)'!');
+    assert(strcmp(small_copy, "small!") == 0);
+    evstring_free(small_copy);
+    evstring_free(small);
+  }
+
+  { // ASCII transforms
+    evstring path = evstring_new("  C:\\Assets\\Textures\\Grass_01.PNG\t\n");
+    evstring shared = evstring_share(path);
+    assert(evstring_trim(&path) == EV_STR_ERR_NONE);
+    assert(strcmp(path, "C:\\Assets\\Textures\\Grass_01.PNG") == 0);
+    assert(evstring_replaceChar(&path, '\\', '/') == EV_STR_ERR_NONE);
+    assert(evstring_toLower(&path) == EV_STR_ERR_NONE);
+    assert(strcmp(path, "c:/assets/textures/grass_01.png") == 0);
+    assert(evstring_getLength(path) == strlen(path));
+    assert(evstring_hash(path) == evstring_hash(evstr("c:/assets/textures/grass_01.png")));
+    assert(evstring_toUpper(&path) == EV_STR_ERR_NONE);
+    assert(strcmp(path, "C:/ASSETS/TEXTURES/GRASS_01.PNG") == 0);
+    // The other owner still has the original
+    assert(strcmp(shared, "  C:\\Assets\\Textures\\Grass_01.PNG\t\n") == 0);
+
+    // Strings that need no change are not copied
+    evstring again = evstring_share(shared);
+    assert(evstring_replaceChar(&again, '#', '/') == EV_STR_ERR_NONE);
+    assert(again == shared);
+    evstring_free(again);
+    evstring_free(shared);
+    evstring_free(path);
+
+    evstring s = evstring_new(" \t ");
+    assert(evstring_trimRight(&s) == EV_STR_ERR_NONE);
+    assert(evstring_getLength(s) == 0 && s[0] == '\0');
+    evstring_free(s);
+    s = evstring_new("\n\nleft");
+    assert(evstring_trimLeft(&s) == EV_STR_ERR_NONE);
+    assert(strcmp(s, "left") == 0 && evstring_getLength(s) == 4);
+    evstring_free(s);
+
+    evstring text = evstring_new("x  padded  x");
+    evstring_view v = evstring_view_trim(evstring_slice(text, 1, 11));
+    assert(v.data == text && v.offset == 3 && v.len == 6);
+    v = evstring_view_trimLeft(evstring_slice(text, 1, 11));
+    assert(v.offset == 3 && v.len == 8);
+    v = evstring_view_trimRight(evstring_slice(text, 1, 11));
+    assert(v.offset == 1 && v.len == 8);
+    evstring_free(text);
+
+    // Character sets
+    const ev_str_charset seps = ev_str_charset_fromStr("/\\:");
+    assert(evstring_findFirstOf(evstr("assets\\a/b"), &seps) == 6);
+    assert(evstring_findFirstOf(evstr("no separators at all, even in a long string"), &seps) == EV_STR_NPOS);
+    assert(evstring_findFirstNotOf(evstr("///a"), &seps) == 3);
+    assert(evstring_findFirstOf(ev_strview_fromStr("C:x"), &seps) == 1);
+    ev_str_charset high = ev_str_charset_from("\x80\xFF\0", 3);
+    assert(ev_str_charset_has(&high, (char)0x80) && ev_str_charset_has(&high, (char)0xFF) && ev_str_charset_has(&high, 0));
+    assert(!ev_str_charset_has(&high, 0x7F) && !ev_str_charset_has(&high, (char)0xFE) && !ev_str_charset_has(&high, 0x70));
+
+    // Every length and alignment against byte-by-byte references
+    u64 state = 0xD1B54A32D192ED03ull;
+    char src[200], dst[200], ref[200];
+    for(u32 round = 0; round < 20000; round++) {
+      state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+      u64 len = state % 130;
+      u64 at = (state >> 8) % 64;
+      for(u64 i = 0; i < len; i++) {
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        // Mostly letters and the bytes around them
+        src[at + i] = (state & 3) ? (char)("@AZ[`az{"[(state >> 2) % 8] + (i & 1)) : (char)(state >> 8);
+      }
+      char *in = src + at;
+
+      for(u64 i = 0; i < len; i++) {
+        ref[i] = (in[i] >= 'A' && in[i] <= 'Z') ? in[i] + 32 : in[i];
+      }
+      ev_str_toLower(dst, in, len);
+      assert(memcmp(dst, ref, len) == 0);
+      memcpy(dst + 7, in, len);
+      ev_str_toLower(dst + 7, dst + 7, len);
+      assert(memcmp(dst + 7, ref, len) == 0);
+
+      for(u64 i = 0; i < len; i++) {
+        ref[i] = (in[i] >= 'a' && in[i] <= 'z') ? in[i] - 32 : in[i];
+      }
+      ev_str_toUpper(dst, in, len);
+      assert(memcmp(dst, ref, len) == 0);
+
+      char from = len ? in[(state >> 16) % len] : 'a';
+      for(u64 i = 0; i < len; i++) {
+        ref[i] = in[i] == from ? '#' : in[i];
+      }
+      memcpy(dst + 3, in, len);
+      ev_str_replaceChar(dst + 3, len, from, '#');
+      assert(memcmp(dst + 3, ref, len) == 0);
+
+      // Sets of a few random bytes, which also hit the upper half
+      char members[4];
+      for(u32 m = 0; m < 4; m++) {
+        members[m] = (m < 2 && len) ? in[(state >> (20 + 8 * m)) % len] : (char)(state >> (40 + 4 * m));
+      }
+      u32 member_count = (state >> 60) % 5;
+      ev_str_charset set = ev_str_charset_from(members, member_count);
+      u64 expected_of = EV_STR_NPOS, expected_not_of = EV_STR_NPOS;
+      for(u64 i = len; i-- > 0;) {
+        bool in_set = memchr(members, in[i], member_count) != NULL;
+        assert(ev_str_charset_has(&set, in[i]) == in_set);
+        if(in_set) {
+          expected_of = i;
+        } else {
+          expected_not_of = i;
+        }
+      }
+      assert(ev_str_findFirstOf(in, len, &set) == expected_of);
+      assert(ev_str_findFirstNotOf(in, len, &set) == expected_not_of);
+    }
+  }
+
   return 0;
 }
@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define EV_STR_IMPLEMENTATION
+#define EV_UTF8_IMPLEMENTATION
+#include "ev_utf8.h"
+
+#define INPUT_SIZE (64ull * 1024 * 1024)
+#define ROUNDS 4
+
+static double now_ms()
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static double gbps(double ms)
+{
+  return INPUT_SIZE * (double)ROUNDS / ms / 1e6;
+}
+
+// Fills `text` with valid UTF-8: code points are drawn from `ranges`, pairs of
+// [first, last]
+static void generate(char *text, const u32 *ranges, u32 nranges)
+{
+  u64 state = 0x9E3779B97F4A7C15ull;
+  u64 len = 0;
+  while(len + 4 <= INPUT_SIZE) {
+    state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+    const u32 *r = ranges + 2 * ((state >> 40) % nranges);
+    len += __ev_utf8_encode(r[0] + (u32)(state % (r[1] - r[0] + 1)), (u8 *)text + len);
+  }
+  memset(text + len, ' ', INPUT_SIZE - len);
+}
+
+// Baseline: decode every code point
+static bool scalar_validate(const char *data, u64 len)
+{
+  u64 i = 0;
+  u32 cp;
+  while(i < len) {
+    if(!__ev_utf8_decode((const u8 *)data, len, &i, &cp)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main()
+{
+  static const u32 ascii[] = { 0x20, 0x7E };
+  static const u32 latin[] = { 0x20, 0x7E, 0x20, 0x7E, 0x20, 0x7E, 0xC0, 0x17F };
+  static const u32 cjk[] = { 0x4E00, 0x9FFF, 0x3040, 0x30FF };
+  static const u32 emoji[] = { 0x1F300, 0x1F6FF, 0x20, 0x7E };
+  struct { const char *name; const u32 *ranges; u32 nranges; } corpora[] = {
+    { "ascii", ascii, 1 },
+    { "latin (25% 2-byte)", latin, 4 },
+    { "cjk (3-byte)", cjk, 2 },
+    { "emoji (50% 4-byte)", emoji, 2 },
+  };
+
+  char *text = malloc(INPUT_SIZE);
+  u16 *utf16 = malloc(INPUT_SIZE * sizeof(u16));
+  u32 *utf32 = malloc(INPUT_SIZE * sizeof(u32));
+  // Touch the output buffers so that page faults are not timed
+  memset(utf16, 0, INPUT_SIZE * sizeof(u16));
+  memset(utf32, 0, INPUT_SIZE * sizeof(u32));
+  printf("%llu MB input, %u rounds, GB/s of UTF-8 input\n", INPUT_SIZE / (1024 * 1024), ROUNDS);
+  printf("  %-20s %8s %8s %8s %8s %8s\n", "", "scalar", "validate", "count", "->utf16", "->utf32");
+
+  for(u32 c = 0; c < sizeof(corpora) / sizeof(corpora[0]); c++) {
+    generate(text, corpora[c].ranges, corpora[c].nranges);
+
+    double start = now_ms();
+    for(u32 r = 0; r < ROUNDS; r++) {
+      assert(scalar_validate(text, INPUT_SIZE));
+    }
+    double scalar_ms = now_ms() - start;
+
+    start = now_ms();
+    for(u32 r = 0; r < ROUNDS; r++) {
+      assert(ev_utf8_validate(text, INPUT_SIZE));
+    }
+    double validate_ms = now_ms() - start;
+
+    u64 count = 0;
+    start = now_ms();
+    for(u32 r = 0; r < ROUNDS; r++) {
+      count = ev_utf8_count(text, INPUT_SIZE);
+    }
+    double count_ms = now_ms() - start;
+
+    start = now_ms();
+    for(u32 r = 0; r < ROUNDS; r++) {
+      assert(ev_utf8_toUtf16(text, INPUT_SIZE, utf16) != EV_UTF8_INVALID);
+    }
+    double utf16_ms = now_ms() - start;
+
+    start = now_ms();
+    for(u32 r = 0; r < ROUNDS; r++) {
+      assert(ev_utf8_toUtf32(text, INPUT_SIZE, utf32) == count);
+    }
+    double utf32_ms = now_ms() - start;
+
+    printf("  %-20s %8.2f %8.2f %8.2f %8.2f %8.2f\n", corpora[c].name, gbps(scalar_ms), gbps(validate_ms),
+        gbps(count_ms), gbps(utf16_ms), gbps(utf32_ms));
+  }
+
+  free(text);
+  free(utf16);
+  free(utf32);
+  return 0;
+}
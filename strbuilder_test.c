@@ -0,0 +1,188 @@
+#define EV_STR_IMPLEMENTATION
+#define EV_STRBUILDER_IMPLEMENTATION
+#include "ev_strbuilder.h"
+
+#include <stdio.h>
+
+#if !EV_OS_WINDOWS
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+static u32 chunk_count(const evstring_builder *b)
+{
+  u32 count = 0;
+  for(struct evstring_builder_chunk *c = b->head; c; c = c->next) {
+    count++;
+  }
+  return count;
+}
+
+int main()
+{
+  // Mixed pushes
+  {
+    evstring_builder b;
+    evstring_builder_init(&b);
+    assert(evstring_builder_getLength(&b) == 0);
+
+    evstring empty = evstring_builder_build(&b);
+    assert(evstring_getLength(empty) == 0);
+    assert(empty[0] == '\0');
+    evstring_free(empty);
+
+    evstring src = evstring_new("--view--");
+    assert(evstring_builder_push(&b, ev_strview_from("!?", 1)) == EV_STR_ERR_NONE);
+    assert(evstring_builder_push(&b, "Hello") == EV_STR_ERR_NONE);
+    assert(evstring_builder_push(&b, (char)',') == EV_STR_ERR_NONE);
+    assert(evstring_builder_push(&b, " %s #%d", "world", 42) == EV_STR_ERR_NONE);
+    assert(evstring_builder_push(&b, evstring_slice(src, 2, 6)) == EV_STR_ERR_NONE);
+    assert(evstring_builder_getLength(&b) == strlen("!Hello, world #42view"));
+
+    evstring s = evstring_builder_build(&b);
+    assert(strcmp(s, "!Hello, world #42view") == 0);
+    assert(evstring_getLength(s) == evstring_builder_getLength(&b));
+    evstring_free(s);
+    evstring_free(src);
+    evstring_builder_fini(&b);
+  }
+
+  // Content that spans many chunks, compared against evstring_push
+  {
+    evstring_builder b;
+    evstring_builder_init(&b);
+    evstring expected = evstring_new("");
+
+    char big[EV_STRBUILDER_INIT_CHUNK * 3];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+
+    for(u32 i = 0; i < 20000; i++) {
+      switch(i % 5) {
+        case 0:
+          evstring_builder_push(&b, "line %u: %s\n", i, "some text");
+          evstring_push(&expected, "line %u: %s\n", i, "some text");
+          break;
+        case 1:
+          evstring_builder_push(&b, (char)('a' + i % 26));
+          evstring_push(&expected, (char)('a' + i % 26));
+          break;
+        case 2:
+          evstring_builder_push(&b, "plain ");
+          evstring_push(&expected, "plain ");
+          break;
+        case 3:
+          if(i % 1000 == 3) {
+            evstring_builder_push(&b, big);
+            evstring_push(&expected, big);
+          }
+          break;
+        case 4:
+          // Output larger than any chunk
+          if(i % 4000 == 4) {
+            evstring_builder_push(&b, "%s|%s", big, big);
+            evstring_push(&expected, "%s|%s", big, big);
+          }
+          break;
+      }
+    }
+
+    assert(chunk_count(&b) > 4);
+    assert(evstring_builder_getLength(&b) == evstring_getLength(expected));
+    evstring s = evstring_builder_build(&b);
+    assert(evstring_getLength(s) == evstring_getLength(expected));
+    assert(memcmp(s, expected, evstring_getLength(s)) == 0);
+    assert(s[evstring_getLength(s)] == '\0');
+    evstring_free(s);
+
+    // Chunk capacities grow geometrically
+    u64 total_cap = 0;
+    for(struct evstring_builder_chunk *c = b.head; c; c = c->next) {
+      assert(c->len <= c->cap);
+      total_cap += c->cap;
+    }
+    assert(b.tail->cap >= (u64)EV_STRBUILDER_INIT_CHUNK << (chunk_count(&b) / 2));
+    assert(total_cap < evstring_getLength(expected) * 3);
+
+    // Streaming to a FILE* never joins the chunks
+    FILE *f = tmpfile();
+    assert(f);
+    assert(evstring_builder_writeFile(&b, f) == EV_STR_ERR_NONE);
+    assert((u64)ftell(f) == evstring_getLength(expected));
+    rewind(f);
+    char *read_back = malloc(evstring_getLength(expected));
+    assert(fread(read_back, 1, evstring_getLength(expected), f) == evstring_getLength(expected));
+    assert(memcmp(read_back, expected, evstring_getLength(expected)) == 0);
+
+#if !EV_OS_WINDOWS
+    // Streaming to a file descriptor
+    rewind(f);
+    assert(ftruncate(fileno(f), 0) == 0);
+    assert(evstring_builder_writeFd(&b, fileno(f)) == EV_STR_ERR_NONE);
+    assert(lseek(fileno(f), 0, SEEK_CUR) == (off_t)evstring_getLength(expected));
+    assert(lseek(fileno(f), 0, SEEK_SET) == 0);
+    memset(read_back, 0, evstring_getLength(expected));
+    assert(read(fileno(f), read_back, evstring_getLength(expected)) == (ssize_t)evstring_getLength(expected));
+    assert(memcmp(read_back, expected, evstring_getLength(expected)) == 0);
+#endif
+    free(read_back);
+    fclose(f);
+
+    // Clearing keeps the first chunk
+    struct evstring_builder_chunk *head = b.head;
+    evstring_builder_clear(&b);
+    assert(b.head == head);
+    assert(chunk_count(&b) == 1);
+    assert(evstring_builder_getLength(&b) == 0);
+    evstring_builder_push(&b, "again");
+    s = evstring_builder_build(&b);
+    assert(strcmp(s, "again") == 0);
+    evstring_free(s);
+
+    evstring_free(expected);
+    evstring_builder_fini(&b);
+    assert(b.head == NULL);
+  }
+
+#if !EV_OS_WINDOWS
+  // writev batches and partial writes through a pipe
+  {
+    evstring_builder b;
+    evstring_builder_init(&b);
+    for(u32 i = 0; i < 300000; i++) {
+      evstring_builder_push(&b, "%06u,", i);
+    }
+
+    int fds[2];
+    assert(pipe(fds) == 0);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if(pid == 0) {
+      close(fds[0]);
+      _exit(evstring_builder_writeFd(&b, fds[1]) == EV_STR_ERR_NONE ? 0 : 1);
+    }
+    close(fds[1]);
+
+    evstring expected = evstring_builder_build(&b);
+    u64 len = evstring_getLength(expected);
+    char *got = malloc(len);
+    u64 got_len = 0;
+    ssize_t n;
+    while((n = read(fds[0], got + got_len, len - got_len)) > 0) {
+      got_len += n;
+    }
+    close(fds[0]);
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(got_len == len);
+    assert(memcmp(got, expected, len) == 0);
+    free(got);
+    evstring_free(expected);
+    evstring_builder_fini(&b);
+  }
+#endif
+
+  puts("evstring_builder tests passed");
+  return 0;
+}
@@ -0,0 +1,136 @@
+#define EV_STR_IMPLEMENTATION
+#define EV_STRMATCHER_IMPLEMENTATION
+#include "ev_strmatcher.h"
+
+#include <stdio.h>
+
+struct collected {
+  u32 count;
+  u32 patterns[64];
+  u64 offsets[64];
+};
+
+static bool collect(u32 pattern, evstring_view match, void *udata)
+{
+  struct collected *c = udata;
+  c->patterns[c->count] = pattern;
+  c->offsets[c->count] = match.offset;
+  c->count++;
+  return true;
+}
+
+static bool stop_after_two(u32 pattern, evstring_view match, void *udata)
+{
+  (void)pattern;
+  (void)match;
+  return ++*(u32 *)udata < 2;
+}
+
+static u64 brute_force_count(const char *text, const char *const *patterns, u32 count)
+{
+  u64 matches = 0;
+  u64 text_len = strlen(text);
+  for(u32 p = 0; p < count; p++) {
+    u64 len = strlen(patterns[p]);
+    for(u64 i = 0; len && i + len <= text_len; i++) {
+      matches += memcmp(text + i, patterns[p], len) == 0;
+    }
+  }
+  return matches;
+}
+
+static bool count_matches(u32 pattern, evstring_view match, void *udata)
+{
+  (void)pattern;
+  (void)match;
+  (*(u64 *)udata)++;
+  return true;
+}
+
+int main()
+{
+  { // The classic example: overlapping matches and suffixes of other patterns
+    const char *patterns[] = { "he", "she", "his", "hers" };
+    ev_strmatcher_t *m = ev_strmatcher_init_strs(patterns, 4);
+    assert(m);
+    assert(ev_strmatcher_pattern_count(m) == 4);
+
+    struct collected c = { 0 };
+    assert(ev_strmatcher_scan(m, evstr("ushers"), collect, &c) == 3);
+    assert(c.count == 3);
+    // "she" and "he" end at the same position, longest first
+    assert(c.patterns[0] == 1 && c.offsets[0] == 1);
+    assert(c.patterns[1] == 0 && c.offsets[1] == 2);
+    assert(c.patterns[2] == 3 && c.offsets[2] == 2);
+
+    // Views keep their offsets relative to the underlying string
+    evstring text = evstring_new("this is his house");
+    c.count = 0;
+    ev_strmatcher_scan(m, evstring_slice(text, 5, -1), collect, &c);
+    assert(c.count == 1);
+    assert(c.patterns[0] == 2 && c.offsets[0] == 8);
+
+    u32 seen = 0;
+    assert(ev_strmatcher_scan(m, evstr("he he he he"), stop_after_two, &seen) == 2);
+
+    ev_vec(evstring_view) results = ev_vec_init(evstring_view);
+    assert(ev_strmatcher_find_all(m, evstr("she sells his shells"), &results) == EV_VEC_ERR_NONE);
+    // she, he, his, (s)he, he
+    assert(ev_vec_len(&results) == 5);
+    assert(results[2].offset == 10 && results[2].len == 3);
+    ev_vec_fini(&results);
+
+    evstring_free(text);
+    ev_strmatcher_fini(m);
+  }
+
+  { // Duplicated and empty patterns
+    evstring_view patterns[] = {
+      evstring_slice(evstr("abab"), 0, 2),
+      evstring_slice(evstr("xab"), 1, -1),
+      { 0 },
+    };
+    ev_strmatcher_t *m = ev_strmatcher_init(patterns, 3);
+    struct collected c = { 0 };
+    ev_strmatcher_scan(m, evstr("zab"), collect, &c);
+    assert(c.count == 2);
+    assert(c.patterns[0] == 0 && c.patterns[1] == 1);
+    assert(c.offsets[0] == 1 && c.offsets[1] == 1);
+    ev_strmatcher_fini(m);
+  }
+
+  { // Random patterns over a small alphabet, against a brute force count
+    u64 state = 0x2545F4914F6CDD1Dull;
+    char storage[32][8];
+    const char *patterns[32];
+    char text[2048];
+    for(u32 round = 0; round < 200; round++) {
+      u32 count = 1 + round % 32;
+      for(u32 p = 0; p < count; p++) {
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        u32 len = 1 + state % 7;
+        for(u32 i = 0; i < len; i++) {
+          storage[p][i] = 'a' + (state >> (8 + i * 3)) % 3;
+        }
+        storage[p][len] = '\0';
+        patterns[p] = storage[p];
+      }
+      for(u32 i = 0; i < sizeof(text) - 1; i++) {
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        text[i] = 'a' + state % 4;
+      }
+      text[sizeof(text) - 1] = '\0';
+
+      ev_strmatcher_t *m = ev_strmatcher_init_strs(patterns, count);
+      evstring s = evstring_new(text);
+      u64 matches = 0;
+      assert(ev_strmatcher_scan(m, s, count_matches, &matches) == brute_force_count(text, patterns, count));
+      assert(matches == brute_force_count(text, patterns, count));
+      evstring_free(s);
+      ev_strmatcher_fini(m);
+    }
+  }
+
+  puts("ev_strmatcher tests passed");
+  return 0;
+}
@@ -0,0 +1,186 @@
+#define EV_STR_IMPLEMENTATION
+#define EV_STRSPLIT_IMPLEMENTATION
+#include "ev_strsplit.h"
+
+#include <stdio.h>
+
+static bool view_eq(evstring_view v, const char *str)
+{
+  return v.len == strlen(str) && memcmp(v.data + v.offset, str, v.len) == 0;
+}
+
+// Splits `text` on any byte for which `is_delim` is set, one byte at a time
+static u32 reference_split(const char *text, u64 len, const bool *is_delim, bool skip_empty, u64 *offsets, u64 *lens)
+{
+  u32 count = 0;
+  u64 start = 0;
+  for(u64 i = 0; i <= len; i++) {
+    if(i == len || is_delim[(u8)text[i]]) {
+      if(!skip_empty || i > start) {
+        offsets[count] = start;
+        lens[count] = i - start;
+        count++;
+      }
+      start = i + 1;
+    }
+  }
+  return count;
+}
+
+int main()
+{
+  { // Single character
+    evstring s = evstring_new("a,bc,,d,");
+    evstring_split_iter it = evstring_split_char(s, ',');
+    const char *expected[] = { "a", "bc", "", "d", "" };
+    evstring_view token;
+    u32 count = 0;
+    while(evstring_split_next(&it, &token)) {
+      assert(token.data == s);
+      assert(view_eq(token, expected[count]));
+      count++;
+    }
+    assert(count == 5);
+    assert(!evstring_split_next(&it, &token));
+
+    // Views are split relative to the same string
+    it = evstring_split_char(evstring_slice(s, 2, 7), ',');
+    assert(evstring_split_next(&it, &token) && view_eq(token, "bc") && token.offset == 2);
+    assert(evstring_split_next(&it, &token) && view_eq(token, ""));
+    assert(evstring_split_next(&it, &token) && view_eq(token, "d"));
+    assert(!evstring_split_next(&it, &token));
+
+    it = evstring_split_char(s, ',');
+    it.skip_empty = true;
+    count = 0;
+    while(evstring_split_next(&it, &token)) {
+      count++;
+    }
+    assert(count == 3);
+
+    evstring empty = evstring_new("");
+    it = evstring_split_char(empty, ',');
+    assert(evstring_split_next(&it, &token) && token.len == 0);
+    assert(!evstring_split_next(&it, &token));
+    evstring_free(empty);
+    evstring_free(s);
+  }
+
+  { // Multi-character delimiter
+    evstring s = evstring_new("a::b:::c::");
+    evstring_split_iter it = evstring_split_str(s, "::");
+    const char *expected[] = { "a", "b", ":c", "" };
+    evstring_view token;
+    u32 count = 0;
+    while(evstring_split_next(&it, &token)) {
+      assert(view_eq(token, expected[count]));
+      count++;
+    }
+    assert(count == 4);
+    evstring_free(s);
+  }
+
+  { // Lines
+    evstring s = evstring_new("one\r\ntwo\n\nthree\r\n");
+    evstring_lines_iter it = evstring_lines(s);
+    const char *expected[] = { "one", "two", "", "three" };
+    evstring_view line;
+    u32 count = 0;
+    while(evstring_lines_next(&it, &line)) {
+      assert(view_eq(line, expected[count]));
+      count++;
+    }
+    assert(count == 4);
+    evstring_free(s);
+
+    s = evstring_new("no terminator");
+    it = evstring_lines(s);
+    assert(evstring_lines_next(&it, &line) && view_eq(line, "no terminator"));
+    assert(!evstring_lines_next(&it, &line));
+    evstring_free(s);
+
+    // '\r' is only dropped before '\n'
+    s = evstring_new("a\r\nb\r");
+    it = evstring_lines(s);
+    assert(evstring_lines_next(&it, &line) && view_eq(line, "a"));
+    assert(evstring_lines_next(&it, &line) && view_eq(line, "b\r"));
+    assert(!evstring_lines_next(&it, &line));
+    evstring_free(s);
+
+    s = evstring_new("");
+    it = evstring_lines(s);
+    assert(!evstring_lines_next(&it, &line));
+    evstring_free(s);
+
+    // Lines that span several blocks of the scan
+    s = evstring_new("");
+    for(u32 i = 0; i < 50; i++) {
+      for(u32 j = 0; j < i * 7; j++) {
+        evstring_push(&s, (char)('a' + j % 26));
+      }
+      evstring_push(&s, i % 2 ? "\r\n" : "\n");
+    }
+    it = evstring_lines(s);
+    count = 0;
+    while(evstring_lines_next(&it, &line)) {
+      assert(line.len == count * 7);
+      assert(line.len == 0 || line.data[line.offset + line.len - 1] == 'a' + (line.len - 1) % 26);
+      count++;
+    }
+    assert(count == 50);
+    evstring_free(s);
+  }
+
+  { // Collecting into a vector
+    evstring s = evstring_new("x y  z");
+    ev_vec(evstring_view) tokens = ev_vec_init(evstring_view);
+    evstring_split_iter it = evstring_split_any(s, " ");
+    it.skip_empty = true;
+    assert(evstring_split_into(it, &tokens) == EV_VEC_ERR_NONE);
+    assert(ev_vec_len(&tokens) == 3);
+    assert(view_eq(tokens[0], "x") && view_eq(tokens[1], "y") && view_eq(tokens[2], "z"));
+    ev_vec_fini(&tokens);
+    evstring_free(s);
+  }
+
+  { // Char sets against a bytewise reference, across SIMD block boundaries
+    const char *sets[] = { ",", " \t\r\n", ",;|", "abcdefgh", "abcdefghi", "\x80\xff\x01 ", "0123456789ABCDEFabcdef:/\\" };
+    u64 state = 0x9E3779B97F4A7C15ull;
+    static char text[4096];
+    static u64 offsets[4097], lens[4097];
+    for(u32 round = 0; round < 2000; round++) {
+      const char *set = sets[round % (sizeof(sets) / sizeof(sets[0]))];
+      bool is_delim[256] = {0};
+      for(const u8 *c = (const u8 *)set; *c; c++) {
+        is_delim[*c] = true;
+      }
+
+      u64 len = round % 97 + (round % 3 == 0 ? 1000 : 0);
+      for(u64 i = 0; i < len; i++) {
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        // Mostly bytes outside the set, with a varying density of delimiters
+        u8 c = (u8)(state >> 24);
+        text[i] = (state >> 40) % (round % 40 + 2) == 0 ? set[(state >> 8) % strlen(set)] : (char)c;
+      }
+      evstring s = evstring_new_impl(text, len);
+
+      for(u32 skip = 0; skip < 2; skip++) {
+        u32 count = reference_split(text, len, is_delim, skip, offsets, lens);
+        evstring_split_iter it = set[1] == '\0' && round % 2 ? evstring_split_char(s, set[0]) : evstring_split_any(s, set);
+        it.skip_empty = skip;
+        evstring_view token;
+        u32 i = 0;
+        while(evstring_split_next(&it, &token)) {
+          assert(i < count);
+          assert(token.offset == offsets[i] && token.len == lens[i]);
+          i++;
+        }
+        assert(i == count);
+      }
+      evstring_free(s);
+    }
+  }
+
+  puts("evstring split tests passed");
+  return 0;
+}
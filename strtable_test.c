@@ -0,0 +1,279 @@
+#define EV_STR_IMPLEMENTATION
+#define EV_STRTABLE_IMPLEMENTATION
+#include "ev_strtable.h"
+
+#include <stdio.h>
+
+static u64 rng_state = 0x9E3779B97F4A7C15ull;
+static u64 rng()
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+// Short strings over a small alphabet, so that there are many duplicates,
+// shared prefixes and embedded zeros
+static u64 random_string(char *buf)
+{
+  static const char alphabet[] = { 'a', 'b', 'c', '\0', (char)0xFF };
+  u64 len = rng() % 20;
+  for(u64 i = 0; i < len; i++) {
+    buf[i] = alphabet[rng() % sizeof(alphabet)];
+  }
+  return len;
+}
+
+static int view_order(const void *a, const void *b)
+{
+  return ev_strview_cmp(*(const ev_strview *)a, *(const ev_strview *)b);
+}
+
+static u64 saved_size(const ev_strtable *t)
+{
+  FILE *f = tmpfile();
+  assert(ev_strtable_save(t, f) == EV_STR_ERR_NONE);
+  u64 size = (u64)ftell(f);
+  fclose(f);
+  return size;
+}
+
+int main()
+{
+  // Pushing and reading back
+  {
+    ev_strtable t;
+    ev_strtable_init(&t);
+    assert(ev_strtable_count(&t) == 0);
+
+    evstring src = evstring_new("--view--");
+    assert(ev_strtable_push(&t, "first") == EV_STR_ERR_NONE);
+    assert(ev_strtable_push(&t, evstring_slice(src, 2, 6)) == EV_STR_ERR_NONE);
+    assert(ev_strtable_push(&t, ev_strview_from("a\0b", 3)) == EV_STR_ERR_NONE);
+    assert(ev_strtable_push(&t, "") == EV_STR_ERR_NONE);
+    evstring_free(src);
+
+    assert(ev_strtable_count(&t) == 4);
+    assert(ev_strview_eq(ev_strtable_get(&t, 0), ev_strview_fromStr("first")));
+    assert(ev_strview_eq(ev_strtable_get(&t, 1), ev_strview_fromStr("view")));
+    assert(ev_strview_eq(ev_strtable_get(&t, 2), ev_strview_from("a\0b", 3)));
+    assert(ev_strtable_get(&t, 3).len == 0);
+    for(u64 i = 0; i < ev_strtable_count(&t); i++) {
+      ev_strview v = ev_strtable_get(&t, i);
+      assert(v.ptr[v.len] == '\0');
+    }
+    // 5 bytes of overhead per string in the character buffer
+    assert(t.data_len == 5 + 4 + 3 + 0 + 4 * 5);
+
+    ev_strtable_clear(&t);
+    assert(ev_strtable_count(&t) == 0);
+    char *data = t.data;
+    ev_strtable_push(&t, "again");
+    assert(t.data == data);
+    assert(ev_strview_eq(ev_strtable_get(&t, 0), ev_strview_fromStr("again")));
+
+    // Reserving avoids moving the buffers
+    assert(ev_strtable_reserve(&t, 10000, 100000) == EV_STR_ERR_NONE);
+    data = t.data;
+    u64 *offsets = t.offsets;
+    for(u32 i = 0; i < 10000; i++) {
+      ev_strtable_push(&t, "0123456789");
+    }
+    assert(t.data == data && t.offsets == offsets);
+    assert(ev_strtable_count(&t) == 10001);
+    ev_strtable_fini(&t);
+    assert(t.data == NULL && ev_strtable_count(&t) == 0);
+  }
+
+  // Sorting and deduplication against qsort
+  {
+    char buf[32];
+    for(u32 round = 0; round < 200; round++) {
+      ev_strtable t;
+      ev_strtable_init(&t);
+      u64 n = rng() % 2000;
+      for(u64 i = 0; i < n; i++) {
+        assert(ev_strtable_pushImpl(&t, buf, random_string(buf)) == EV_STR_ERR_NONE);
+      }
+
+      // Unique strings in order of first appearance
+      ev_strview *unique = malloc((n + 1) * sizeof(ev_strview));
+      u64 unique_count = 0;
+      for(u64 i = 0; i < n; i++) {
+        ev_strview v = ev_strtable_get(&t, i);
+        bool seen = false;
+        for(u64 j = 0; j < unique_count && !seen; j++) {
+          seen = ev_strview_eq(v, unique[j]);
+        }
+        if(!seen) {
+          unique[unique_count++] = v;
+        }
+      }
+      evstring unique_joined = evstring_new("");
+      for(u64 j = 0; j < unique_count; j++) {
+        evstring_push(&unique_joined, unique[j]);
+        evstring_push(&unique_joined, (char)'|');
+      }
+
+      ev_strview *expected = malloc((n + 1) * sizeof(ev_strview));
+      for(u64 i = 0; i < n; i++) {
+        expected[i] = ev_strtable_get(&t, i);
+      }
+      qsort(expected, n, sizeof(ev_strview), view_order);
+
+      char *data = t.data;
+      assert(ev_strtable_sort(&t) == EV_STR_ERR_NONE);
+      assert(t.data == data);
+      for(u64 i = 0; i < n; i++) {
+        assert(ev_strview_eq(ev_strtable_get(&t, i), expected[i]));
+        // Stable: equal strings are still in push order
+        if(i > 0 && ev_strview_eq(ev_strtable_get(&t, i - 1), ev_strtable_get(&t, i))) {
+          assert(t.offsets[i - 1] < t.offsets[i]);
+        }
+      }
+
+      // Deduplicating the sorted table leaves the sorted unique strings
+      ev_strtable copy;
+      ev_strtable_init(&copy);
+      for(u64 i = 0; i < n; i++) {
+        ev_strtable_push(&copy, ev_strtable_get(&t, i));
+      }
+      assert(ev_strtable_dedupe(&copy) == EV_STR_ERR_NONE);
+      assert(ev_strtable_count(&copy) == unique_count);
+      for(u64 i = 1; i < ev_strtable_count(&copy); i++) {
+        assert(ev_strview_cmp(ev_strtable_get(&copy, i - 1), ev_strtable_get(&copy, i)) < 0);
+      }
+      ev_strtable_fini(&copy);
+
+      // Deduplicating in push order keeps the first occurrences
+      ev_strtable_fini(&t);
+      ev_strtable_init(&t);
+      rng_state ^= round;
+      for(u64 i = 0; i < n; i++) {
+        ev_strtable_pushImpl(&t, buf, random_string(buf));
+      }
+      u64 before = t.data_len;
+      assert(ev_strtable_dedupe(&t) == EV_STR_ERR_NONE);
+      assert(t.data_len <= before);
+      evstring joined = evstring_new("");
+      u64 expected_len = 0;
+      for(u64 i = 0; i < ev_strtable_count(&t); i++) {
+        ev_strview v = ev_strtable_get(&t, i);
+        assert(t.offsets[i] == expected_len);
+        expected_len += 5 + v.len;
+        evstring_push(&joined, v);
+        evstring_push(&joined, (char)'|');
+      }
+      assert(t.data_len == expected_len);
+      for(u64 i = 0; i < ev_strtable_count(&t); i++) {
+        for(u64 j = 0; j < i; j++) {
+          assert(!ev_strview_eq(ev_strtable_get(&t, i), ev_strtable_get(&t, j)));
+        }
+      }
+
+      evstring_free(joined);
+      evstring_free(unique_joined);
+      free(unique);
+      free(expected);
+      ev_strtable_fini(&t);
+    }
+  }
+
+  // Saving and loading
+  {
+    ev_strtable t;
+    ev_strtable_init(&t);
+    char buf[32];
+    for(u32 i = 0; i < 5000; i++) {
+      ev_strtable_pushImpl(&t, buf, random_string(buf));
+    }
+    ev_strtable_sort(&t);
+
+    FILE *f = tmpfile();
+    assert(ev_strtable_save(&t, f) == EV_STR_ERR_NONE);
+    rewind(f);
+    ev_strtable loaded;
+    ev_strtable_init(&loaded);
+    ev_strtable_push(&loaded, "replaced");
+    assert(ev_strtable_load(&loaded, f) == EV_STR_ERR_NONE);
+    assert(ev_strtable_count(&loaded) == ev_strtable_count(&t));
+    for(u64 i = 0; i < ev_strtable_count(&t); i++) {
+      assert(ev_strview_eq(ev_strtable_get(&loaded, i), ev_strtable_get(&t, i)));
+    }
+    // Loaded tables can still grow
+    ev_strtable_push(&loaded, "more");
+    assert(ev_strview_eq(ev_strtable_get(&loaded, ev_strtable_count(&t)), ev_strview_fromStr("more")));
+    ev_strtable_fini(&loaded);
+
+    // Empty tables
+    ev_strtable empty;
+    ev_strtable_init(&empty);
+    rewind(f);
+    assert(ev_strtable_save(&empty, f) == EV_STR_ERR_NONE);
+    rewind(f);
+    ev_strtable_init(&loaded);
+    assert(ev_strtable_load(&loaded, f) == EV_STR_ERR_NONE);
+    assert(ev_strtable_count(&loaded) == 0);
+    ev_strtable_fini(&loaded);
+    fclose(f);
+
+    // Damaged files are rejected, and leave the table untouched
+    u64 size = saved_size(&t);
+    char *bytes = malloc(size);
+    f = tmpfile();
+    ev_strtable_save(&t, f);
+    rewind(f);
+    assert(fread(bytes, 1, size, f) == size);
+    fclose(f);
+
+    u64 offsets_at = 24;
+    u64 data_at = offsets_at + ev_strtable_count(&t) * sizeof(u64);
+    struct { u64 at; u64 value; u64 width; u64 truncate; evstring_error_t err; } damages[] = {
+      { 0, 'X', 1, 0, EV_STR_ERR_CORRUPT },                       // Magic
+      { 4, 2, 4, 0, EV_STR_ERR_CORRUPT },                         // Version
+      { 8, ~0ull, 8, 0, EV_STR_ERR_CORRUPT },                     // Count
+      { offsets_at + 8, t.data_len, 8, 0, EV_STR_ERR_CORRUPT },   // Offset past the end
+      { offsets_at + 8, t.data_len - 4, 8, 0, EV_STR_ERR_CORRUPT },
+      { data_at + t.offsets[0], 1u << 30, 4, 0, EV_STR_ERR_CORRUPT }, // Length
+      { 0, 0, 0, 10, EV_STR_ERR_IO },                             // Truncated header
+      { 0, 0, 0, size - 1, EV_STR_ERR_IO },                       // Truncated data
+    };
+    for(u32 d = 0; d < sizeof(damages) / sizeof(damages[0]); d++) {
+      char *damaged = malloc(size);
+      memcpy(damaged, bytes, size);
+      memcpy(damaged + damages[d].at, &damages[d].value, damages[d].width);
+      f = tmpfile();
+      fwrite(damaged, 1, damages[d].truncate ? damages[d].truncate : size, f);
+      rewind(f);
+
+      ev_strtable_init(&loaded);
+      ev_strtable_push(&loaded, "kept");
+      assert(ev_strtable_load(&loaded, f) == damages[d].err);
+      assert(ev_strtable_count(&loaded) == 1);
+      assert(ev_strview_eq(ev_strtable_get(&loaded, 0), ev_strview_fromStr("kept")));
+      ev_strtable_fini(&loaded);
+      fclose(f);
+      free(damaged);
+    }
+
+    // A missing terminator
+    char *damaged = malloc(size);
+    memcpy(damaged, bytes, size);
+    ev_strview first = ev_strtable_get(&t, ev_strtable_count(&t) - 1);
+    damaged[data_at + (first.ptr - t.data) + first.len] = 'x';
+    f = tmpfile();
+    fwrite(damaged, 1, size, f);
+    rewind(f);
+    ev_strtable_init(&loaded);
+    assert(ev_strtable_load(&loaded, f) == EV_STR_ERR_CORRUPT);
+    fclose(f);
+    free(damaged);
+
+    free(bytes);
+    ev_strtable_fini(&t);
+  }
+
+  puts("ev_strtable tests passed");
+  return 0;
+}
@@ -0,0 +1,264 @@
+#define EV_STR_IMPLEMENTATION
+#define EV_UTF8_IMPLEMENTATION
+#include "ev_utf8.h"
+
+#include <stdio.h>
+
+#define MAX_LEN 512
+
+static u64 rng_state = 0x2545F4914F6CDD1Dull;
+static u64 rng()
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+// Reference decoder following the definition of well-formed sequences: decode
+// by the lead byte, then reject overlong forms, surrogates and values above
+// U+10FFFF.
+// \returns The number of code points, or EV_UTF8_INVALID
+static u64 ref_decode(const u8 *s, u64 len, u32 *out)
+{
+  u64 count = 0;
+  u64 i = 0;
+  while(i < len) {
+    u8 b = s[i];
+    u32 n, cp, min;
+    if(b < 0x80) { n = 0; cp = b; min = 0; }
+    else if((b & 0xE0) == 0xC0) { n = 1; cp = b & 0x1F; min = 0x80; }
+    else if((b & 0xF0) == 0xE0) { n = 2; cp = b & 0x0F; min = 0x800; }
+    else if((b & 0xF8) == 0xF0) { n = 3; cp = b & 0x07; min = 0x10000; }
+    else return EV_UTF8_INVALID;
+    if(len - i <= n) {
+      return EV_UTF8_INVALID;
+    }
+    for(u32 k = 1; k <= n; k++) {
+      if((s[i + k] & 0xC0) != 0x80) {
+        return EV_UTF8_INVALID;
+      }
+      cp = (cp << 6) | (s[i + k] & 0x3F);
+    }
+    if(cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+      return EV_UTF8_INVALID;
+    }
+    if(out) {
+      out[count] = cp;
+    }
+    count++;
+    i += n + 1;
+  }
+  return count;
+}
+
+static u32 random_codepoint()
+{
+  switch(rng() % 5) {
+    case 0: case 1: return 0x20 + rng() % 0x5F;
+    case 2: return 0x80 + rng() % (0x800 - 0x80);
+    case 3: {
+      u32 cp = 0x800 + rng() % (0x10000 - 0x800);
+      return (cp >= 0xD800 && cp <= 0xDFFF) ? cp - 0x1000 : cp;
+    }
+    default: return 0x10000 + rng() % (0x110000 - 0x10000);
+  }
+}
+
+// Encodes random code points, mostly ASCII, and sometimes breaks the result
+static u64 random_text(u8 *buf)
+{
+  u64 target = rng() % MAX_LEN;
+  bool mostly_ascii = rng() % 2;
+  u64 len = 0;
+  while(len + 4 <= target) {
+    u32 cp = mostly_ascii && rng() % 8 ? 0x20 + rng() % 0x5F : random_codepoint();
+    len += __ev_utf8_encode(cp, buf + len);
+  }
+
+  u32 mutations = rng() % 3 == 0 ? (u32)(rng() % 3 + 1) : 0;
+  for(u32 m = 0; m < mutations && len > 0; m++) {
+    u64 at = rng() % len;
+    switch(rng() % 6) {
+      case 0: buf[at] = (u8)rng(); break;
+      case 1: buf[at] = (u8)(0x80 | (rng() % 0x40)); break;
+      case 2: buf[at] = (u8)(0xC0 + rng() % 0x40); break;
+      case 3: buf[at] = (u8)(0xF0 + rng() % 0x10); break;
+      case 4: len = at; break;
+      default: {
+        // Known edge bytes of the overlong, surrogate and range checks
+        static const u8 edges[] = { 0xC0, 0xC1, 0xE0, 0xED, 0xF0, 0xF4, 0xF5, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF };
+        buf[at] = edges[rng() % sizeof(edges)];
+      }
+    }
+  }
+  return len;
+}
+
+static bool validate(const char *s)
+{
+  return ev_utf8_validate(s, strlen(s));
+}
+
+int main()
+{
+  // Known sequences
+  {
+    assert(validate(""));
+    assert(validate("plain ascii"));
+    assert(validate("caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80"));
+    assert(validate("\xC2\x80\xDF\xBF\xE0\xA0\x80\xEF\xBF\xBF\xF0\x90\x80\x80\xF4\x8F\xBF\xBF"));
+    assert(validate("\xED\x9F\xBF\xEE\x80\x80"));
+
+    assert(!validate("\x80"));
+    assert(!validate("\xBF"));
+    assert(!validate("\xC0\x80"));              // Overlong NUL
+    assert(!validate("\xC1\xBF"));              // Overlong 2-byte
+    assert(!validate("\xE0\x9F\xBF"));          // Overlong 3-byte
+    assert(!validate("\xF0\x8F\xBF\xBF"));      // Overlong 4-byte
+    assert(!validate("\xED\xA0\x80"));          // Surrogate
+    assert(!validate("\xED\xBF\xBF"));
+    assert(!validate("\xF4\x90\x80\x80"));      // Above U+10FFFF
+    assert(!validate("\xF5\x80\x80\x80"));
+    assert(!validate("\xFF"));
+    assert(!validate("\xC3"));                  // Truncated
+    assert(!validate("\xE2\x82"));
+    assert(!validate("\xF0\x9F\x98"));
+    assert(!validate("\xC3\xA9\xA9"));          // Extra continuation
+    assert(!validate("a\xE2\x82" "b"));
+
+    evstring s = evstring_new("h\xC3\xA9llo \xE4\xB8\x96\xE7\x95\x8C \xF0\x9F\x98\x80");
+    assert(evstring_utf8_validate(s));
+    assert(evstring_utf8_count(s) == 10);
+    assert(ev_utf8_utf16Length(s, evstring_getLength(s)) == 11);
+    evstring_free(s);
+  }
+
+  // Errors at every position of long blocks, across block boundaries
+  {
+    u8 buf[160];
+    memset(buf, 'a', sizeof(buf));
+    assert(ev_utf8_validate((char *)buf, sizeof(buf)));
+    for(u64 at = 0; at < sizeof(buf); at++) {
+      buf[at] = 0x80;
+      assert(!ev_utf8_validate((char *)buf, sizeof(buf)));
+      buf[at] = 'a';
+
+      // A sequence that straddles the position is valid unless it is cut off
+      if(at + 4 <= sizeof(buf)) {
+        memcpy(buf + at, "\xF0\x9F\x98\x80", 4);
+        assert(ev_utf8_validate((char *)buf, sizeof(buf)));
+        assert(ev_utf8_count((char *)buf, sizeof(buf)) == sizeof(buf) - 3);
+        assert(!ev_utf8_validate((char *)buf, at + 3));
+        memset(buf + at, 'a', 4);
+      }
+    }
+  }
+
+  // Random text against the reference decoder
+  {
+    u8 *buf = malloc(MAX_LEN + 64);
+    u32 *ref = malloc((MAX_LEN + 64) * sizeof(u32));
+    u32 *utf32 = malloc((MAX_LEN + 64) * sizeof(u32));
+    u16 *utf16 = malloc((MAX_LEN + 64) * 2 * sizeof(u16));
+    char *back = malloc((MAX_LEN + 64) * 4);
+    u32 valid_count = 0;
+
+    for(u32 round = 0; round < 100000; round++) {
+      u64 len = random_text(buf);
+      const char *text = (const char *)buf;
+      u64 expected = ref_decode(buf, len, ref);
+      bool valid = expected != EV_UTF8_INVALID;
+      assert(ev_utf8_validate(text, len) == valid);
+
+      u64 n32 = ev_utf8_toUtf32(text, len, utf32);
+      u64 n16 = ev_utf8_toUtf16(text, len, utf16);
+      if(!valid) {
+        assert(n32 == EV_UTF8_INVALID);
+        assert(n16 == EV_UTF8_INVALID);
+        continue;
+      }
+      valid_count++;
+
+      assert(ev_utf8_count(text, len) == expected);
+      assert(n32 == expected);
+      assert(memcmp(utf32, ref, n32 * sizeof(u32)) == 0);
+
+      u64 pairs = 0;
+      for(u64 i = 0; i < expected; i++) {
+        pairs += ref[i] >= 0x10000;
+      }
+      assert(n16 == expected + pairs);
+      assert(ev_utf8_utf16Length(text, len) == n16);
+
+      // Round trips back to the same bytes
+      assert(ev_utf16_utf8Length(utf16, n16) == len);
+      assert(ev_utf16_toUtf8(utf16, n16, back) == len);
+      assert(memcmp(back, text, len) == 0);
+      assert(ev_utf32_utf8Length(utf32, n32) == len);
+      assert(ev_utf32_toUtf8(utf32, n32, back) == len);
+      assert(memcmp(back, text, len) == 0);
+
+      if(round % 16 == 0) {
+        evstring s16 = evstring_newFromUtf16(utf16, n16);
+        evstring s32 = evstring_newFromUtf32(utf32, n32);
+        assert(evstring_getLength(s16) == len && memcmp(s16, text, len) == 0);
+        assert(evstring_getLength(s32) == len && memcmp(s32, text, len) == 0);
+        assert(s16[len] == '\0');
+        evstring_free(s16);
+        evstring_free(s32);
+      }
+    }
+    // Both sides of the comparison were exercised
+    assert(valid_count > 10000 && valid_count < 90000);
+
+    free(buf);
+    free(ref);
+    free(utf32);
+    free(utf16);
+    free(back);
+  }
+
+  // Invalid UTF-16 and UTF-32
+  {
+    char out[64];
+    u16 units[20];
+    for(u32 i = 0; i < 20; i++) {
+      units[i] = (u16)('a' + i);
+    }
+    assert(ev_utf16_toUtf8(units, 20, out) == 20);
+    assert(memcmp(out, "abcdefghijklmnopqrst", 20) == 0);
+
+    for(u32 at = 0; at < 20; at++) {
+      units[at] = 0xD83D; // Lone high surrogate
+      assert(ev_utf16_toUtf8(units, 20, out) == EV_UTF8_INVALID);
+      assert(evstring_newFromUtf16(units, 20) == NULL);
+      units[at] = 0xDE00; // Lone low surrogate
+      assert(ev_utf16_toUtf8(units, 20, out) == EV_UTF8_INVALID);
+      if(at + 1 < 20) {
+        units[at] = 0xD83D;
+        units[at + 1] = 0xDE00;
+        assert(ev_utf16_toUtf8(units, 20, out) == 22);
+        assert(memcmp(out + at, "\xF0\x9F\x98\x80", 4) == 0);
+        units[at + 1] = (u16)('a' + at + 1);
+      }
+      units[at] = (u16)('a' + at);
+    }
+
+    u32 points[20];
+    for(u32 i = 0; i < 20; i++) {
+      points[i] = 'a' + i;
+    }
+    static const u32 bad[] = { 0xD800, 0xDFFF, 0x110000, 0xFFFFFFFF };
+    for(u32 b = 0; b < sizeof(bad) / sizeof(bad[0]); b++) {
+      points[17] = bad[b];
+      assert(ev_utf32_toUtf8(points, 20, out) == EV_UTF8_INVALID);
+      assert(evstring_newFromUtf32(points, 20) == NULL);
+    }
+    points[17] = 0x10FFFF;
+    assert(ev_utf32_toUtf8(points, 20, out) == 23);
+  }
+
+  puts("ev_utf8 tests passed");
+  return 0;
+}